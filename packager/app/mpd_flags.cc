@@ -21,7 +21,20 @@ DEFINE_bool(output_media_info,
             "Create a human readable format of MediaInfo. The output file name "
             "will be the name specified by output flag, suffixed with "
             "'.media_info'.");
+DEFINE_bool(indexed_media_info,
+            false,
+            "Write the MediaInfo file created with --output_media_info in "
+            "indexed binary format instead of human readable format. It is "
+            "faster to write and to parse, and is accepted by mpd_generator.");
 DEFINE_string(mpd_output, "", "MPD output file name.");
+DEFINE_string(mpd_event_output,
+              "",
+              "MPD event log output file name. If specified, MediaInfo and "
+              "segment events are published to this file instead of "
+              "generating the MPD in this process, so that the MPD for streams "
+              "packaged by multiple packager instances can be generated by a "
+              "single aggregator, i.e. mpd_generator with --event_input. "
+              "Cannot be used with --mpd_output.");
 DEFINE_string(base_urls,
               "",
               "Comma separated BaseURLs for the MPD. The values will be added "
@@ -64,3 +77,15 @@ DEFINE_bool(allow_codec_switching,
             "If enabled, allow adaptive switching between different codecs, "
             "if they have the same language, media type (audio, video etc) and "
             "container type.");
+DEFINE_bool(low_latency_dash_mode,
+            false,
+            "If enabled, generates chunked CMAF segments for low latency DASH "
+            "(LL-DASH): each fragment is written out as soon as it is "
+            "finalized, and the dynamic MPD advertises availabilityTimeOffset "
+            "so players can fetch segments while they are being produced. "
+            "--fragment_duration specifies the chunk duration.");
+DEFINE_double(target_latency,
+              0.0,
+              "For low latency DASH only. Target latency in seconds, which is "
+              "advertised in the MPD ServiceDescription element. Not "
+              "advertised if the value is 0.");
@@ -13,7 +13,9 @@
 
 DECLARE_bool(generate_static_live_mpd);
 DECLARE_bool(output_media_info);
+DECLARE_bool(indexed_media_info);
 DECLARE_string(mpd_output);
+DECLARE_string(mpd_event_output);
 DECLARE_string(base_urls);
 DECLARE_double(minimum_update_period);
 DECLARE_double(min_buffer_time);
@@ -22,5 +24,7 @@ DECLARE_string(utc_timings);
 DECLARE_bool(generate_dash_if_iop_compliant_mpd);
 DECLARE_bool(allow_approximate_segment_timeline);
 DECLARE_bool(allow_codec_switching);
+DECLARE_bool(low_latency_dash_mode);
+DECLARE_double(target_latency);
 
 #endif  // APP_MPD_FLAGS_H_
@@ -4,6 +4,7 @@
 // license that can be found in the LICENSE file or at
 // https://developers.google.com/open-source/licenses/bsd
 
+#include <algorithm>
 #include <iostream>
 
 #include "packager/app/mpd_generator_flags.h"
@@ -12,7 +13,16 @@
 #include "packager/base/command_line.h"
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/sys_info.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+#include "packager/mpd/base/mpd_aggregator.h"
+#include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/util/mpd_writer.h"
 #include "packager/tools/license_notice.h"
 #include "packager/version/version.h"
@@ -41,17 +51,83 @@ const char kUsage[] =
     "audio, and 1 text.\n"
     "Sample Usage:\n"
     "%s --input=\"video1.media_info,video2.media_info,audio1.media_info\" "
-    "--output=\"video_audio.mpd\"";
+    "--output=\"video_audio.mpd\"\n"
+    "Batch Usage:\n"
+    "%s --batch_input=\"titles.txt\" --num_threads=8\n"
+    "Aggregation Usage:\n"
+    "%s --event_input=\"packager1.events,packager2.events\" "
+    "--output=\"live.mpd\" --event_poll_interval_in_seconds=2";
 
 enum ExitStatus {
   kSuccess = 0,
   kEmptyInputError,
   kEmptyOutputError,
-  kFailedToWriteMpdToFileError
+  kFailedToWriteMpdToFileError,
+  kFailedToReadBatchInputError,
+  kFailedToReadEventInputError,
+  kInvalidUtcTimingsError,
+};
+
+// An MPD to be generated in batch mode.
+struct Title {
+  std::string output;
+  std::vector<std::string> inputs;
+  bool success = false;
+  base::TimeDelta elapsed_time;
+};
+
+// Generates the MPDs for |titles| on a pool of threads. Each worker thread
+// reuses one MpdWriter across titles.
+class BatchMpdGenerator : public base::DelegateSimpleThread::Delegate {
+ public:
+  BatchMpdGenerator(const std::vector<std::string>& base_urls,
+                    std::vector<Title>* titles)
+      : base_urls_(base_urls), titles_(titles) {}
+
+  // base::DelegateSimpleThread::Delegate implementation. Called once on each
+  // worker thread.
+  void Run() override {
+    MpdWriter mpd_writer;
+    for (const std::string& base_url : base_urls_)
+      mpd_writer.AddBaseUrl(base_url);
+
+    while (Title* title = GetNextTitle()) {
+      const base::TimeTicks start_time = base::TimeTicks::Now();
+      mpd_writer.Reset();
+      for (const std::string& file : title->inputs) {
+        if (!mpd_writer.AddFile(file)) {
+          LOG(WARNING) << "MpdWriter failed to read " << file << ", skipping.";
+        }
+      }
+      title->success = mpd_writer.WriteMpdToFile(title->output.c_str());
+      if (!title->success)
+        LOG(ERROR) << "Failed to write MPD to " << title->output;
+      title->elapsed_time = base::TimeTicks::Now() - start_time;
+    }
+  }
+
+ private:
+  BatchMpdGenerator(const BatchMpdGenerator&) = delete;
+  BatchMpdGenerator& operator=(const BatchMpdGenerator&) = delete;
+
+  Title* GetNextTitle() {
+    base::AutoLock auto_lock(lock_);
+    if (next_title_ >= titles_->size())
+      return nullptr;
+    return &(*titles_)[next_title_++];
+  }
+
+  const std::vector<std::string> base_urls_;
+  std::vector<Title>* titles_;
+  base::Lock lock_;
+  size_t next_title_ = 0;
 };
 
 ExitStatus CheckRequiredFlags() {
-  if (FLAGS_input.empty()) {
+  if (!FLAGS_batch_input.empty())
+    return kSuccess;
+
+  if (FLAGS_input.empty() && FLAGS_event_input.empty()) {
     LOG(ERROR) << "--input is required.";
     return kEmptyInputError;
   }
@@ -95,6 +171,130 @@ ExitStatus RunMpdGenerator() {
   return kSuccess;
 }
 
+ExitStatus RunBatchMpdGenerator() {
+  std::string batch_input;
+  if (!File::ReadFileToString(FLAGS_batch_input.c_str(), &batch_input)) {
+    LOG(ERROR) << "Failed to read " << FLAGS_batch_input;
+    return kFailedToReadBatchInputError;
+  }
+
+  std::vector<Title> titles;
+  // The fields are separated by a tab and not trimmed, so that file names can
+  // contain spaces.
+  for (const std::string& line :
+       base::SplitString(batch_input, "\r\n", base::KEEP_WHITESPACE,
+                         base::SPLIT_WANT_NONEMPTY)) {
+    if (base::TrimWhitespaceASCII(line, base::TRIM_ALL).empty())
+      continue;
+    std::vector<std::string> fields = base::SplitString(
+        line, "\t", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+    if (fields.size() != 2 || fields[0].empty() || fields[1].empty()) {
+      LOG(ERROR) << "Invalid line in " << FLAGS_batch_input << ": " << line;
+      return kFailedToReadBatchInputError;
+    }
+    Title title;
+    title.output = fields[0];
+    title.inputs = base::SplitString(fields[1], ",", base::KEEP_WHITESPACE,
+                                     base::SPLIT_WANT_ALL);
+    titles.push_back(title);
+  }
+
+  std::vector<std::string> base_urls;
+  if (!FLAGS_base_urls.empty()) {
+    base_urls = base::SplitString(FLAGS_base_urls, ",", base::KEEP_WHITESPACE,
+                                  base::SPLIT_WANT_ALL);
+  }
+
+  int num_threads = FLAGS_num_threads > 0
+                        ? FLAGS_num_threads
+                        : base::SysInfo::NumberOfProcessors();
+  num_threads =
+      std::max(1, std::min(num_threads, static_cast<int>(titles.size())));
+
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  BatchMpdGenerator generator(base_urls, &titles);
+  base::DelegateSimpleThreadPool thread_pool("mpd_generator", num_threads);
+  thread_pool.AddWork(&generator, num_threads);
+  thread_pool.Start();
+  thread_pool.JoinAll();
+  const base::TimeDelta total_time = base::TimeTicks::Now() - start_time;
+
+  ExitStatus status = kSuccess;
+  for (const Title& title : titles) {
+    std::cout << title.output << "\t" << (title.success ? "OK" : "FAILED")
+              << "\t" << title.elapsed_time.InMillisecondsF() << " ms"
+              << std::endl;
+    if (!title.success)
+      status = kFailedToWriteMpdToFileError;
+  }
+  std::cout << "Generated " << titles.size() << " MPDs with " << num_threads
+            << " threads in " << total_time.InMillisecondsF() << " ms"
+            << std::endl;
+  return status;
+}
+
+// Generates the MPD from the MPD events published by packager instances.
+ExitStatus RunMpdAggregator() {
+  const bool live = FLAGS_event_poll_interval_in_seconds > 0;
+  MpdOptions mpd_options;
+  if (live) {
+    mpd_options.dash_profile = DashProfile::kLive;
+    mpd_options.mpd_type = MpdType::kDynamic;
+  } else {
+    // Chosen from the streams, as packager does.
+    mpd_options.dash_profile = DashProfile::kUnknown;
+  }
+  MpdParams& mpd_params = mpd_options.mpd_params;
+  mpd_params.mpd_output = FLAGS_output;
+  if (!FLAGS_base_urls.empty()) {
+    mpd_params.base_urls =
+        base::SplitString(FLAGS_base_urls, ",", base::KEEP_WHITESPACE,
+                          base::SPLIT_WANT_ALL);
+  }
+  mpd_params.minimum_update_period = FLAGS_minimum_update_period;
+  mpd_params.suggested_presentation_delay = FLAGS_suggested_presentation_delay;
+  mpd_params.time_shift_buffer_depth = FLAGS_time_shift_buffer_depth;
+  if (!FLAGS_utc_timings.empty()) {
+    base::StringPairs pairs;
+    if (!base::SplitStringIntoKeyValuePairs(FLAGS_utc_timings, '=', ',',
+                                            &pairs)) {
+      LOG(ERROR) << "Invalid --utc_timings scheme_id_uri/value pairs.";
+      return kInvalidUtcTimingsError;
+    }
+    for (const auto& string_pair : pairs)
+      mpd_params.utc_timings.push_back({string_pair.first, string_pair.second});
+  }
+
+  MpdAggregator aggregator(mpd_options);
+  if (!aggregator.Init()) {
+    LOG(ERROR) << "Failed to initialize MpdAggregator.";
+    return kFailedToWriteMpdToFileError;
+  }
+  for (const std::string& file :
+       base::SplitString(FLAGS_event_input, ",", base::KEEP_WHITESPACE,
+                         base::SPLIT_WANT_ALL)) {
+    aggregator.AddEventLog(file);
+  }
+
+  while (true) {
+    size_t num_events = 0;
+    if (!aggregator.Poll(&num_events)) {
+      LOG(ERROR) << "Failed to read MPD events from " << FLAGS_event_input;
+      return kFailedToReadEventInputError;
+    }
+    if (num_events > 0 || !live) {
+      if (!aggregator.Flush()) {
+        LOG(ERROR) << "Failed to write MPD to " << FLAGS_output;
+        return kFailedToWriteMpdToFileError;
+      }
+    }
+    if (!live)
+      return kSuccess;
+    base::PlatformThread::Sleep(
+        base::TimeDelta::FromSeconds(FLAGS_event_poll_interval_in_seconds));
+  }
+}
+
 int MpdMain(int argc, char** argv) {
   base::AtExitManager exit;
   // Needed to enable VLOG/DVLOG through --vmodule or --v.
@@ -106,7 +306,8 @@ int MpdMain(int argc, char** argv) {
   CHECK(logging::InitLogging(log_settings));
 
   google::SetVersionString(GetPackagerVersion());
-  google::SetUsageMessage(base::StringPrintf(kUsage, argv[0]));
+  google::SetUsageMessage(
+      base::StringPrintf(kUsage, argv[0], argv[0], argv[0]));
   google::ParseCommandLineFlags(&argc, &argv, true);
   if (FLAGS_licenses) {
     for (const char* line : kLicenseNotice)
@@ -123,6 +324,10 @@ int MpdMain(int argc, char** argv) {
   if (!FLAGS_test_packager_version.empty())
     SetPackagerVersionForTesting(FLAGS_test_packager_version);
 
+  if (!FLAGS_batch_input.empty())
+    return RunBatchMpdGenerator();
+  if (!FLAGS_event_input.empty())
+    return RunMpdAggregator();
   return RunMpdGenerator();
 }
 
@@ -15,4 +15,50 @@ DEFINE_string(base_urls,
               "",
               "Comma separated BaseURLs for the MPD. The values will be added "
               "as <BaseURL> element(s) immediately under the <MPD> element.");
+DEFINE_string(batch_input,
+              "",
+              "Batch mode: a file listing one MPD per line, in the format "
+              "'<mpd_output><TAB><comma separated MediaInfo files>'. The "
+              "fields are separated by a single tab character and are not "
+              "trimmed, so file names may contain spaces but not tabs or "
+              "commas. All MPDs are generated in this process, and the time "
+              "spent on each MPD is reported. --input and --output are "
+              "ignored in this mode.");
+DEFINE_int32(num_threads,
+             0,
+             "Batch mode only. Number of worker threads. Defaults to the "
+             "number of processors if set to 0.");
+DEFINE_string(event_input,
+              "",
+              "Aggregation mode: comma separated list of MPD event logs "
+              "published by packager instances with --mpd_event_output. The "
+              "MPD is generated from the events and written to --output. "
+              "--input is ignored in this mode.");
+DEFINE_int32(event_poll_interval_in_seconds,
+             0,
+             "Aggregation mode only. If positive, the event logs are polled "
+             "at this interval and a dynamic MPD is updated on new events "
+             "until the program is terminated. Otherwise, the event logs are "
+             "read once and a static MPD is written, in the live profile if "
+             "the streams have segment templates, or the on-demand profile "
+             "otherwise.");
+DEFINE_double(minimum_update_period,
+              5.0,
+              "Aggregation mode only. Indicates to the player how often to "
+              "refresh the media presentation description in seconds. This "
+              "value is used for dynamic MPD only.");
+DEFINE_double(time_shift_buffer_depth,
+              1800.0,
+              "Aggregation mode only. Guaranteed duration of the time shifting "
+              "buffer for dynamic MPD, in seconds.");
+DEFINE_double(suggested_presentation_delay,
+              0.0,
+              "Aggregation mode only. Specifies a delay, in seconds, to be "
+              "added to the media presentation time. This value is used for "
+              "dynamic MPD only.");
+DEFINE_string(utc_timings,
+              "",
+              "Aggregation mode only. Comma separated UTCTiming schemeIdUri "
+              "and value pairs for the MPD. This value is used for dynamic MPD "
+              "only.");
 #endif  // APP_MPD_GENERATOR_FLAGS_H_
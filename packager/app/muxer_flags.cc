@@ -46,6 +46,33 @@ DEFINE_string(temp_dir,
 DEFINE_bool(mp4_include_pssh_in_stream,
             true,
             "MP4 only: include pssh in the encrypted stream.");
+DEFINE_bool(mp4_reserve_header_space,
+            false,
+            "MP4 single file output only: reserve space for the header at the "
+            "beginning of the output file and write the media directly to "
+            "it, instead of writing the media to a temporary file and copying "
+            "it to the output when finalizing. The unused space is covered "
+            "by a 'free' box.");
+DEFINE_bool(webm_reserve_cues_space,
+            false,
+            "WebM single file output only: reserve space for the Cues before "
+            "the first Cluster and write the media directly to the output "
+            "file, instead of writing the media to a temporary file and "
+            "copying it to the output when finalizing. Requires a seekable "
+            "output.");
+DEFINE_int32(max_in_flight_segment_writes,
+             0,
+             "Maximum number of media segments of an output written in the "
+             "background while muxing goes on. Segments are written "
+             "synchronously if it is 0. Applies to multi-segment MP4 and "
+             "packed audio outputs. The manifests only list the segments once "
+             "they are fully written.");
+DEFINE_string(segment_sync_policy,
+              "none",
+              "Policy of flushing the media segments to the storage device "
+              "once written, for local files: 'none' leaves it to the "
+              "operating system, 'fdatasync' flushes the data, 'fsync' "
+              "flushes the data and all the metadata.");
 DEFINE_int32(transport_stream_timestamp_offset_ms,
              100,
              "A positive value, in milliseconds, by which output timestamps "
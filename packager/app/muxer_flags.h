@@ -19,6 +19,10 @@ DECLARE_bool(fragment_sap_aligned);
 DECLARE_bool(generate_sidx_in_media_segments);
 DECLARE_string(temp_dir);
 DECLARE_bool(mp4_include_pssh_in_stream);
+DECLARE_bool(mp4_reserve_header_space);
+DECLARE_bool(webm_reserve_cues_space);
+DECLARE_int32(max_in_flight_segment_writes);
+DECLARE_string(segment_sync_policy);
 DECLARE_int32(transport_stream_timestamp_offset_ms);
 
 #endif  // APP_MUXER_FLAGS_H_
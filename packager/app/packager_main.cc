@@ -6,6 +6,7 @@
 
 #include <gflags/gflags.h>
 #include <iostream>
+#include <memory>
 
 #include "packager/app/ad_cue_generator_flags.h"
 #include "packager/app/crypto_flags.h"
@@ -28,6 +29,8 @@
 #include "packager/base/strings/string_util.h"
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
+#include "packager/file/ram_http_server.h"
+#include "packager/file/ram_store.h"
 #include "packager/packager.h"
 #include "packager/tools/license_notice.h"
 
@@ -48,6 +51,23 @@ DEFINE_bool(use_fake_clock_for_muxer,
 DEFINE_string(test_packager_version,
               "",
               "Packager version for testing. Should be used for testing only.");
+DEFINE_int32(ram_http_server_port,
+             0,
+             "Port of the embedded HTTP server serving the ram:// outputs from "
+             "memory while packaging. The server is disabled if it is 0.");
+DEFINE_string(ram_http_server_address,
+              "127.0.0.1",
+              "IPv4 address the embedded HTTP server serving the ram:// "
+              "outputs listens on. Set it to 0.0.0.0 to listen on all the "
+              "interfaces.");
+DEFINE_int32(ram_http_server_idle_timeout_in_seconds,
+             30,
+             "The connections to the embedded HTTP server idle for this long "
+             "are closed.");
+DEFINE_int32(ram_http_server_max_connections,
+             64,
+             "Maximum number of connections to the embedded HTTP server. The "
+             "connections beyond it are rejected.");
 
 namespace shaka {
 namespace {
@@ -180,6 +200,24 @@ bool GetProtectionScheme(uint32_t* protection_scheme) {
   return false;
 }
 
+bool GetSegmentSyncPolicy(SegmentSyncPolicy* sync_policy) {
+  if (FLAGS_segment_sync_policy == "none") {
+    *sync_policy = SegmentSyncPolicy::kNone;
+    return true;
+  }
+  if (FLAGS_segment_sync_policy == "fdatasync") {
+    *sync_policy = SegmentSyncPolicy::kDataSync;
+    return true;
+  }
+  if (FLAGS_segment_sync_policy == "fsync") {
+    *sync_policy = SegmentSyncPolicy::kFullSync;
+    return true;
+  }
+  LOG(ERROR) << "Unrecognized segment_sync_policy "
+             << FLAGS_segment_sync_policy;
+  return false;
+}
+
 bool ParseKeys(const std::string& keys, RawKeyParams* raw_key) {
   for (const std::string& key_data : base::SplitString(
            keys, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
@@ -424,14 +462,29 @@ base::Optional<PackagingParams> GetPackagingParams() {
   mp4_params.generate_sidx_in_media_segments =
       FLAGS_generate_sidx_in_media_segments;
   mp4_params.include_pssh_in_stream = FLAGS_mp4_include_pssh_in_stream;
+  mp4_params.low_latency_dash_mode = FLAGS_low_latency_dash_mode;
+  mp4_params.reserve_header_space = FLAGS_mp4_reserve_header_space;
 
   packaging_params.transport_stream_timestamp_offset_ms =
       FLAGS_transport_stream_timestamp_offset_ms;
+  packaging_params.webm_reserve_cues_space = FLAGS_webm_reserve_cues_space;
+  if (FLAGS_max_in_flight_segment_writes < 0) {
+    LOG(ERROR) << "--max_in_flight_segment_writes should not be negative.";
+    return base::nullopt;
+  }
+  packaging_params.segment_writer_params.max_in_flight_writes =
+      FLAGS_max_in_flight_segment_writes;
+  if (!GetSegmentSyncPolicy(
+          &packaging_params.segment_writer_params.sync_policy)) {
+    return base::nullopt;
+  }
 
   packaging_params.output_media_info = FLAGS_output_media_info;
+  packaging_params.indexed_media_info = FLAGS_indexed_media_info;
 
   MpdParams& mpd_params = packaging_params.mpd_params;
   mpd_params.mpd_output = FLAGS_mpd_output;
+  mpd_params.mpd_event_output = FLAGS_mpd_event_output;
   mpd_params.base_urls = base::SplitString(
       FLAGS_base_urls, ",", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
   mpd_params.min_buffer_time = FLAGS_min_buffer_time;
@@ -461,6 +514,8 @@ base::Optional<PackagingParams> GetPackagingParams() {
   mpd_params.allow_approximate_segment_timeline =
       FLAGS_allow_approximate_segment_timeline;
   mpd_params.allow_codec_switching = FLAGS_allow_codec_switching;
+  mpd_params.low_latency_dash_mode = FLAGS_low_latency_dash_mode;
+  mpd_params.target_latency = FLAGS_target_latency;
 
   HlsParams& hls_params = packaging_params.hls_params;
   if (!GetHlsPlaylistType(FLAGS_hls_playlist_type, &hls_params.playlist_type)) {
@@ -526,6 +581,35 @@ int PackagerMain(int argc, char** argv) {
       return kArgumentValidationFailed;
     stream_descriptors.push_back(stream_descriptor.value());
   }
+  if (FLAGS_ram_http_server_port < 0 || FLAGS_ram_http_server_port > 65535) {
+    LOG(ERROR) << "--ram_http_server_port must be in the range [0, 65535].";
+    return kArgumentValidationFailed;
+  }
+  if (FLAGS_ram_http_server_idle_timeout_in_seconds <= 0 ||
+      FLAGS_ram_http_server_max_connections <= 0) {
+    LOG(ERROR) << "--ram_http_server_idle_timeout_in_seconds and "
+                  "--ram_http_server_max_connections must be positive.";
+    return kArgumentValidationFailed;
+  }
+  // Declared before the packager, so it serves the outputs until packaging
+  // has completed.
+  std::unique_ptr<RamHttpServer> ram_http_server;
+  if (FLAGS_ram_http_server_port > 0) {
+    RamHttpServer::Options options;
+    options.idle_timeout_in_seconds =
+        FLAGS_ram_http_server_idle_timeout_in_seconds;
+    options.max_connections = FLAGS_ram_http_server_max_connections;
+    ram_http_server.reset(
+        new RamHttpServer(RamStore::GetInstance(), options));
+    const Status status = ram_http_server->Start(
+        FLAGS_ram_http_server_address,
+        static_cast<uint16_t>(FLAGS_ram_http_server_port));
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to start the HTTP server: " << status.ToString();
+      return kArgumentValidationFailed;
+    }
+  }
+
   Packager packager;
   Status status =
       packager.Initialize(packaging_params.value(), stream_descriptors);
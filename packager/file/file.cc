@@ -17,8 +17,11 @@
 #include "packager/base/strings/stringprintf.h"
 #include "packager/file/callback_file.h"
 #include "packager/file/file_util.h"
+#include "packager/file/http_file.h"
 #include "packager/file/local_file.h"
 #include "packager/file/memory_file.h"
+#include "packager/file/ram_file.h"
+#include "packager/file/ram_store.h"
 #include "packager/file/threaded_io_file.h"
 #include "packager/file/udp_file.h"
 
@@ -28,7 +31,14 @@ DEFINE_uint64(io_cache_size,
               "threaded I/O.");
 DEFINE_uint64(io_block_size,
               1ULL << 16,
-              "Size of the block size used for threaded I/O, in bytes.");
+              "Size of the block size used for threaded I/O, in bytes. The "
+              "writes are combined into blocks of this size.");
+DEFINE_bool(io_open_in_background,
+            false,
+            "Open the output files on the threaded I/O thread, so the muxer "
+            "does not wait for the open and files are opened in parallel. "
+            "Useful on network filesystems with high latency. Open failures "
+            "are reported on the following writes.");
 
 // Needed for Windows weirdness which somewhere defines CopyFile as CopyFileW.
 #ifdef CopyFile
@@ -38,8 +48,11 @@ DEFINE_uint64(io_block_size,
 namespace shaka {
 
 const char* kCallbackFilePrefix = "callback://";
+const char* kHttpFilePrefix = "http://";
+const char* kHttpsFilePrefix = "https://";
 const char* kLocalFilePrefix = "file://";
 const char* kMemoryFilePrefix = "memory://";
+const char* kRamFilePrefix = "ram://";
 const char* kUdpFilePrefix = "udp://";
 
 namespace {
@@ -68,20 +81,51 @@ bool DeleteLocalFile(const char* file_name) {
   return LocalFile::Delete(file_name);
 }
 
+// Writes |contents| to a local file in a single write, without the threaded
+// I/O cache, which is not worth setting up for a small file like a manifest.
+bool WriteLocalFileWithNoBuffering(const std::string& file_name,
+                                   const std::string& contents) {
+  std::unique_ptr<File, FileCloser> file(
+      File::OpenWithNoBuffering(file_name.c_str(), "w"));
+  if (!file) {
+    LOG(ERROR) << "Failed to open file " << file_name;
+    return false;
+  }
+  const int64_t bytes_written = file->Write(contents.data(), contents.size());
+  if (bytes_written != static_cast<int64_t>(contents.size())) {
+    LOG(ERROR) << "Failed to write to file " << file_name << " ("
+               << bytes_written << ").";
+    return false;
+  }
+  if (!file.release()->Close()) {
+    LOG(ERROR)
+        << "Failed to close file '" << file_name
+        << "', possibly file permission issue or running out of disk space.";
+    return false;
+  }
+  return true;
+}
+
 bool WriteLocalFileAtomically(const char* file_name,
                               const std::string& contents) {
+  // The temporary file is in the same directory as the file, so the rename
+  // stays within the directory, which is a single operation on network
+  // filesystems, and the directory is already known to exist.
   const base::FilePath file_path = base::FilePath::FromUTF8Unsafe(file_name);
   const std::string dir_name = file_path.DirName().AsUTF8Unsafe();
   std::string temp_file_name;
   if (!TempFilePath(dir_name, &temp_file_name))
     return false;
-  if (!File::WriteStringToFile(temp_file_name.c_str(), contents))
+  if (!WriteLocalFileWithNoBuffering(temp_file_name, contents)) {
+    LocalFile::Delete(temp_file_name.c_str());
     return false;
+  }
   base::File::Error replace_file_error = base::File::FILE_OK;
   if (!base::ReplaceFile(base::FilePath::FromUTF8Unsafe(temp_file_name),
                          file_path, &replace_file_error)) {
     LOG(ERROR) << "Failed to replace file '" << file_name << "' with '"
                << temp_file_name << "', error: " << replace_file_error;
+    LocalFile::Delete(temp_file_name.c_str());
     return false;
   }
   return true;
@@ -104,6 +148,60 @@ bool DeleteMemoryFile(const char* file_name) {
   return true;
 }
 
+File* CreateRamFile(const char* file_name, const char* mode) {
+  return new RamFile(file_name, mode);
+}
+
+bool DeleteRamFile(const char* file_name) {
+  RamStore::GetInstance()->Delete(file_name);
+  return true;
+}
+
+bool WriteRamFileAtomically(const char* file_name,
+                            const std::string& contents) {
+  RamStore::GetInstance()->Put(file_name, RamStore::MakeData(contents));
+  return true;
+}
+
+// The scheme is part of the URL, so it is added back to |file_name|.
+File* CreateHttpFileWithPrefix(const char* prefix,
+                               const char* file_name,
+                               const char* mode) {
+  if (strcmp(mode, "w")) {
+    NOTIMPLEMENTED() << "HttpFile only supports write (upload) mode.";
+    return NULL;
+  }
+  return new HttpFile(std::string(prefix) + file_name);
+}
+
+File* CreateHttpFile(const char* file_name, const char* mode) {
+  return CreateHttpFileWithPrefix(kHttpFilePrefix, file_name, mode);
+}
+
+File* CreateHttpsFile(const char* file_name, const char* mode) {
+  return CreateHttpFileWithPrefix(kHttpsFilePrefix, file_name, mode);
+}
+
+bool DeleteHttpFile(const char* file_name) {
+  return HttpFile::Delete(std::string(kHttpFilePrefix) + file_name);
+}
+
+bool DeleteHttpsFile(const char* file_name) {
+  return HttpFile::Delete(std::string(kHttpsFilePrefix) + file_name);
+}
+
+bool WriteHttpFileAtomically(const char* file_name,
+                             const std::string& contents) {
+  return HttpFile::WriteFileAtomically(std::string(kHttpFilePrefix) + file_name,
+                                       contents);
+}
+
+bool WriteHttpsFileAtomically(const char* file_name,
+                              const std::string& contents) {
+  return HttpFile::WriteFileAtomically(
+      std::string(kHttpsFilePrefix) + file_name, contents);
+}
+
 static const FileTypeInfo kFileTypeInfo[] = {
     {
         kLocalFilePrefix,
@@ -113,7 +211,12 @@ static const FileTypeInfo kFileTypeInfo[] = {
     },
     {kUdpFilePrefix, &CreateUdpFile, nullptr, nullptr},
     {kMemoryFilePrefix, &CreateMemoryFile, &DeleteMemoryFile, nullptr},
+    {kRamFilePrefix, &CreateRamFile, &DeleteRamFile, &WriteRamFileAtomically},
     {kCallbackFilePrefix, &CreateCallbackFile, nullptr, nullptr},
+    {kHttpFilePrefix, &CreateHttpFile, &DeleteHttpFile,
+     &WriteHttpFileAtomically},
+    {kHttpsFilePrefix, &CreateHttpsFile, &DeleteHttpsFile,
+     &WriteHttpsFileAtomically},
 };
 
 base::StringPiece GetFileTypePrefix(base::StringPiece file_name) {
@@ -143,8 +246,12 @@ File* File::Create(const char* file_name, const char* mode) {
 
   base::StringPiece file_type_prefix = GetFileTypePrefix(file_name);
   if (file_type_prefix == kMemoryFilePrefix ||
-      file_type_prefix == kCallbackFilePrefix) {
-    // Disable caching for memory and callback files.
+      file_type_prefix == kRamFilePrefix ||
+      file_type_prefix == kCallbackFilePrefix ||
+      file_type_prefix == kHttpFilePrefix ||
+      file_type_prefix == kHttpsFilePrefix) {
+    // Disable caching for memory, ram and callback files. HTTP files have
+    // their own cache for the upload.
     return internal_file.release();
   }
 
@@ -153,11 +260,15 @@ File* File::Create(const char* file_name, const char* mode) {
     if (!strcmp(mode, "r")) {
       return new ThreadedIoFile(std::move(internal_file),
                                 ThreadedIoFile::kInputMode, FLAGS_io_cache_size,
-                                FLAGS_io_block_size);
+                                FLAGS_io_block_size,
+                                false /* open_in_background */);
     } else if (!strcmp(mode, "w") || !strcmp(mode, "a")) {
-      return new ThreadedIoFile(std::move(internal_file),
-                                ThreadedIoFile::kOutputMode,
-                                FLAGS_io_cache_size, FLAGS_io_block_size);
+      // Files opened for append are not opened in the background, as their
+      // initial size is needed.
+      return new ThreadedIoFile(
+          std::move(internal_file), ThreadedIoFile::kOutputMode,
+          FLAGS_io_cache_size, FLAGS_io_block_size,
+          FLAGS_io_open_in_background && !strcmp(mode, "w"));
     }
   }
 
@@ -376,6 +487,15 @@ bool File::IsLocalRegularFile(const char* file_name) {
 #endif
 }
 
+bool File::SyncToStorage(const char* file_name, bool data_only) {
+  base::StringPiece real_file_name;
+  const FileTypeInfo* file_type = GetFileTypeInfo(file_name, &real_file_name);
+  DCHECK(file_type);
+  if (file_type->type != kLocalFilePrefix)
+    return true;
+  return LocalFile::Sync(real_file_name.data(), data_only);
+}
+
 std::string File::MakeCallbackFileName(
     const BufferCallbackParams& callback_params,
     const std::string& name) {
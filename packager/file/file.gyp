@@ -20,6 +20,10 @@
         'file_util.cc',
         'file_util.h',
         'file_closer.h',
+        'http_client.cc',
+        'http_client.h',
+        'http_file.cc',
+        'http_file.h',
         'io_cache.cc',
         'io_cache.h',
         'local_file.cc',
@@ -27,6 +31,12 @@
         'memory_file.cc',
         'memory_file.h',
         'public/buffer_callback_params.h',
+        'ram_file.cc',
+        'ram_file.h',
+        'ram_http_server.cc',
+        'ram_http_server.h',
+        'ram_store.cc',
+        'ram_store.h',
         'threaded_io_file.cc',
         'threaded_io_file.h',
         'udp_file.cc',
@@ -36,6 +46,8 @@
       ],
       'dependencies': [
         '../base/base.gyp:base',
+        '../packager.gyp:status',
+        '../third_party/curl/curl.gyp:libcurl',
         '../third_party/gflags/gflags.gyp:gflags',
       ],
     },
@@ -46,8 +58,15 @@
         'callback_file_unittest.cc',
         'file_unittest.cc',
         'file_util_unittest.cc',
+        'http_client_unittest.cc',
+        'http_file_unittest.cc',
         'io_cache_unittest.cc',
         'memory_file_unittest.cc',
+        'ram_http_server_unittest.cc',
+        'ram_store_unittest.cc',
+        'test_http_server.cc',
+        'test_http_server.h',
+        'threaded_io_file_unittest.cc',
         'udp_options_unittest.cc',
       ],
       'dependencies': [
@@ -17,8 +17,11 @@
 namespace shaka {
 
 extern const char* kCallbackFilePrefix;
+extern const char* kHttpFilePrefix;
+extern const char* kHttpsFilePrefix;
 extern const char* kLocalFilePrefix;
 extern const char* kMemoryFilePrefix;
+extern const char* kRamFilePrefix;
 extern const char* kUdpFilePrefix;
 const int64_t kWholeFile = -1;
 
@@ -146,6 +149,14 @@ class File {
   /// @return true if `file_name` is a local and regular file.
   static bool IsLocalRegularFile(const char* file_name);
 
+  /// Flush the data of a closed file to the storage device, so it survives a
+  /// system crash. This is a no-op for the files not backed by local storage.
+  /// @param file_name is the name of the file to be synced.
+  /// @param data_only makes it skip the metadata not needed to read the data
+  ///        back, e.g. the modification time, like fdatasync.
+  /// @return true on success, false otherwise.
+  static bool SyncToStorage(const char* file_name, bool data_only);
+
   /// Generate callback file name.
   /// NOTE: THE GENERATED NAME IS ONLY VAID WHILE @a callback_params IS VALID.
   /// @param callback_params references BufferCallbackParams, which will be
@@ -0,0 +1,311 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/http_client.h"
+
+#include <curl/curl.h>
+#include <gflags/gflags.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/stringprintf.h"
+
+DEFINE_bool(disable_peer_verification,
+            false,
+            "Disable peer verification. This is needed to talk to servers "
+            "without valid certificates.");
+
+namespace shaka {
+
+namespace {
+const char kUserAgentString[] = "shaka-packager-http_fetcher/1.0";
+
+const int kMinLogLevelForCurlDebugFunction = 2;
+
+typedef std::vector<std::unique_ptr<base::Lock>> ShareLocks;
+
+int CurlDebugFunction(CURL* /* handle */,
+                      curl_infotype type,
+                      const char* data,
+                      size_t size,
+                      void* /* userptr */) {
+  const char* type_text;
+  int log_level = kMinLogLevelForCurlDebugFunction;
+  switch (type) {
+    case CURLINFO_TEXT:
+      type_text = "== Info";
+      log_level = kMinLogLevelForCurlDebugFunction + 1;
+      break;
+    case CURLINFO_HEADER_IN:
+      type_text = "<= Recv header";
+      log_level = kMinLogLevelForCurlDebugFunction;
+      break;
+    case CURLINFO_HEADER_OUT:
+      type_text = "=> Send header";
+      log_level = kMinLogLevelForCurlDebugFunction;
+      break;
+    case CURLINFO_DATA_IN:
+      type_text = "<= Recv data";
+      log_level = kMinLogLevelForCurlDebugFunction + 1;
+      break;
+    case CURLINFO_DATA_OUT:
+      type_text = "=> Send data";
+      log_level = kMinLogLevelForCurlDebugFunction + 1;
+      break;
+    case CURLINFO_SSL_DATA_IN:
+      type_text = "<= Recv SSL data";
+      log_level = kMinLogLevelForCurlDebugFunction + 2;
+      break;
+    case CURLINFO_SSL_DATA_OUT:
+      type_text = "=> Send SSL data";
+      log_level = kMinLogLevelForCurlDebugFunction + 2;
+      break;
+    default:
+      // Ignore other debug data.
+      return 0;
+  }
+
+  VLOG(log_level) << "\n\n"
+                  << type_text << " (0x" << std::hex << size << std::dec
+                  << " bytes)"
+                  << "\n"
+                  << std::string(data, size) << "\nHex Format: \n"
+                  << base::HexEncode(data, size);
+  return 0;
+}
+
+size_t AppendToString(char* ptr,
+                      size_t size,
+                      size_t nmemb,
+                      std::string* response) {
+  DCHECK(ptr);
+  DCHECK(response);
+  const size_t total_size = size * nmemb;
+  response->append(ptr, total_size);
+  return total_size;
+}
+
+size_t ReadFromBodySource(char* ptr,
+                          size_t size,
+                          size_t nmemb,
+                          const HttpClient::BodySource* body_source) {
+  DCHECK(ptr);
+  DCHECK(body_source);
+  const int64_t bytes_read = (*body_source)(ptr, size * nmemb);
+  if (bytes_read < 0)
+    return CURL_READFUNC_ABORT;
+  return static_cast<size_t>(bytes_read);
+}
+
+void LockSharedData(CURL* /* handle */,
+                    curl_lock_data data,
+                    curl_lock_access /* access */,
+                    void* userptr) {
+  ShareLocks* share_locks = static_cast<ShareLocks*>(userptr);
+  DCHECK_LT(static_cast<size_t>(data), share_locks->size());
+  (*share_locks)[data]->Acquire();
+}
+
+void UnlockSharedData(CURL* /* handle */, curl_lock_data data, void* userptr) {
+  ShareLocks* share_locks = static_cast<ShareLocks*>(userptr);
+  DCHECK_LT(static_cast<size_t>(data), share_locks->size());
+  (*share_locks)[data]->Release();
+}
+
+}  // namespace
+
+// static
+HttpClient* HttpClient::GetInstance() {
+  // Intentionally leaked: the cached connections are used until exit.
+  static HttpClient* const instance = new HttpClient;
+  return instance;
+}
+
+HttpClient::HttpClient() {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  for (int i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+    share_locks_.emplace_back(new base::Lock);
+
+  CURLSH* share = curl_share_init();
+  if (!share) {
+    LOG(ERROR) << "curl_share_init() failed. Connections will not be shared.";
+    return;
+  }
+  curl_share_setopt(share, CURLSHOPT_LOCKFUNC, LockSharedData);
+  curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, UnlockSharedData);
+  curl_share_setopt(share, CURLSHOPT_USERDATA, &share_locks_);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+  // Sharing the connection cache requires curl 7.57.0. With older versions,
+  // connections are still reused by the pooled handles.
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+  share_ = share;
+}
+
+HttpClient::~HttpClient() {
+  for (void* curl : idle_handles_)
+    curl_easy_cleanup(static_cast<CURL*>(curl));
+  if (share_)
+    curl_share_cleanup(static_cast<CURLSH*>(share_));
+  curl_global_cleanup();
+}
+
+Status HttpClient::Send(const Request& request, std::string* response) {
+  DCHECK(response);
+
+  CURL* curl = static_cast<CURL*>(AcquireHandle());
+  if (!curl) {
+    LOG(ERROR) << "curl_easy_init() failed.";
+    return Status(error::HTTP_FAILURE, "curl_easy_init() failed.");
+  }
+  response->clear();
+
+  if (share_)
+    curl_easy_setopt(curl, CURLOPT_SHARE, static_cast<CURLSH*>(share_));
+  curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, kUserAgentString);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT,
+                   static_cast<long>(request.timeout_in_seconds));
+  curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, AppendToString);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+  // CURL_HTTP_VERSION_2TLS, which is an enum value, not a macro, was added in
+  // curl 7.47.0.
+#if LIBCURL_VERSION_NUM >= 0x072F00
+  // Uses HTTP/2 over TLS if the server supports it. This is ignored if curl is
+  // built without HTTP/2 support.
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+#endif
+
+  if (FLAGS_disable_peer_verification)
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+
+  if (!request.client_cert_private_key_file.empty() &&
+      !request.client_cert_file.empty()) {
+    // Some PlayReady packaging servers only allow connects via HTTPS with
+    // client certificates.
+    curl_easy_setopt(curl, CURLOPT_SSLKEY,
+                     request.client_cert_private_key_file.c_str());
+    if (!request.client_cert_private_key_password.empty()) {
+      curl_easy_setopt(curl, CURLOPT_KEYPASSWD,
+                       request.client_cert_private_key_password.c_str());
+    }
+    curl_easy_setopt(curl, CURLOPT_SSLKEYTYPE, "PEM");
+    curl_easy_setopt(curl, CURLOPT_SSLCERTTYPE, "PEM");
+    curl_easy_setopt(curl, CURLOPT_SSLCERT, request.client_cert_file.c_str());
+  }
+  if (!request.ca_file.empty()) {
+    // Host validation needs to be off when using self-signed certificates.
+    curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    curl_easy_setopt(curl, CURLOPT_CAINFO, request.ca_file.c_str());
+  }
+
+  curl_slist* headers = nullptr;
+  switch (request.method) {
+    case Method::kGet:
+      break;
+    case Method::kDelete:
+      curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
+      break;
+    case Method::kPut:
+    case Method::kPost:
+      if (request.body_source) {
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, ReadFromBodySource);
+        curl_easy_setopt(curl, CURLOPT_READDATA, &request.body_source);
+        if (request.method == Method::kPut) {
+          // Without a known size, the body is sent with chunked transfer
+          // encoding.
+          curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+        } else {
+          curl_easy_setopt(curl, CURLOPT_POST, 1L);
+          headers = curl_slist_append(headers, "Transfer-Encoding: chunked");
+        }
+        // Sends the body right away instead of waiting for "100 Continue".
+        headers = curl_slist_append(headers, "Expect:");
+        break;
+      }
+      if (request.method == Method::kPut)
+        curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
+      curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.data());
+      curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                       static_cast<curl_off_t>(request.body.size()));
+      break;
+  }
+
+  for (const std::string& header : request.headers)
+    headers = curl_slist_append(headers, header.c_str());
+  if (headers)
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+
+  if (VLOG_IS_ON(kMinLogLevelForCurlDebugFunction)) {
+    curl_easy_setopt(curl, CURLOPT_DEBUGFUNCTION, CurlDebugFunction);
+    curl_easy_setopt(curl, CURLOPT_VERBOSE, 1L);
+  }
+
+  const CURLcode res = curl_easy_perform(curl);
+
+  long num_new_connections = 0;
+  curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &num_new_connections);
+  long response_code = 0;
+  if (res == CURLE_HTTP_RETURNED_ERROR)
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+  curl_slist_free_all(headers);
+  ReleaseHandle(curl);
+  {
+    base::AutoLock auto_lock(lock_);
+    ++statistics_.num_requests;
+    statistics_.num_new_connections += num_new_connections;
+  }
+
+  if (res != CURLE_OK) {
+    std::string error_message = base::StringPrintf(
+        "curl_easy_perform() failed: %s.", curl_easy_strerror(res));
+    if (res == CURLE_HTTP_RETURNED_ERROR) {
+      error_message +=
+          base::StringPrintf(" Response code: %ld.", response_code);
+    }
+
+    LOG(ERROR) << error_message;
+    return Status(
+        res == CURLE_OPERATION_TIMEDOUT ? error::TIME_OUT : error::HTTP_FAILURE,
+        error_message);
+  }
+  return Status::OK;
+}
+
+HttpClient::Statistics HttpClient::GetStatistics() {
+  base::AutoLock auto_lock(lock_);
+  return statistics_;
+}
+
+void* HttpClient::AcquireHandle() {
+  {
+    base::AutoLock auto_lock(lock_);
+    if (!idle_handles_.empty()) {
+      void* curl = idle_handles_.back();
+      idle_handles_.pop_back();
+      return curl;
+    }
+  }
+  return curl_easy_init();
+}
+
+void HttpClient::ReleaseHandle(void* curl) {
+  // Resets the options but keeps the connections, DNS and TLS session caches
+  // of the handle.
+  curl_easy_reset(static_cast<CURL*>(curl));
+  base::AutoLock auto_lock(lock_);
+  idle_handles_.push_back(curl);
+}
+
+}  // namespace shaka
@@ -0,0 +1,113 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_HTTP_CLIENT_H_
+#define PACKAGER_FILE_HTTP_CLIENT_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/status.h"
+
+namespace shaka {
+
+/// A process-wide HTTP(S) client. Connections, DNS lookups and TLS sessions
+/// are cached and shared by all the requests, so that repeated requests to the
+/// same server, e.g. key requests at every crypto period, do not pay for TCP
+/// and TLS setup again. Connections are kept alive and HTTP/2 is used if the
+/// server supports it. This class is thread safe.
+class HttpClient {
+ public:
+  enum class Method {
+    kGet,
+    kPost,
+    kPut,
+    kDelete,
+  };
+
+  /// Provides the request body in chunks.
+  /// @param buffer is the buffer to fill.
+  /// @param size is the size of @a buffer.
+  /// @return the number of bytes read into @a buffer, which is 0 at the end of
+  ///         the body, or a negative value to abort the request.
+  typedef std::function<int64_t(void* buffer, size_t size)> BodySource;
+
+  struct Request {
+    Method method = Method::kGet;
+    std::string url;
+    /// Request body for POST and PUT.
+    std::string body;
+    /// Streams the request body for POST and PUT, with chunked transfer
+    /// encoding, instead of @a body if set. The body is sent as it is
+    /// provided, i.e. it does not need to be complete when the request starts.
+    BodySource body_source;
+    /// Extra request headers, e.g. "Content-Type: application/json".
+    std::vector<std::string> headers;
+    /// Transfer timeout in seconds. 0 means no timeout.
+    uint32_t timeout_in_seconds = 0;
+    /// Certificate Authority file. Host validation is turned off if it is set,
+    /// to allow self-signed certificates.
+    std::string ca_file;
+    /// Client certificate and its private key files, in PEM format.
+    std::string client_cert_file;
+    std::string client_cert_private_key_file;
+    std::string client_cert_private_key_password;
+  };
+
+  struct Statistics {
+    /// Number of requests sent.
+    uint64_t num_requests = 0;
+    /// Number of new connections opened. Requests reusing a cached connection
+    /// do not open one.
+    uint64_t num_new_connections = 0;
+  };
+
+  /// @return the process-wide HttpClient instance.
+  static HttpClient* GetInstance();
+
+  /// Send @a request and wait for the response.
+  /// @param request is the request to send.
+  /// @param[out] response will contain the body of the http response on
+  ///             success. It should not be NULL.
+  /// @return OK on success, TIME_OUT if the transfer timed out, HTTP_FAILURE
+  ///         otherwise.
+  Status Send(const Request& request, std::string* response);
+
+  /// @return the statistics of the requests sent so far.
+  Statistics GetStatistics();
+
+ private:
+  HttpClient();
+  ~HttpClient();
+
+  HttpClient(const HttpClient&) = delete;
+  HttpClient& operator=(const HttpClient&) = delete;
+
+  // Gets an idle curl easy handle from the pool or creates a new one.
+  void* AcquireHandle();
+  // Returns the curl easy handle |curl| to the pool. The handle keeps its
+  // cached connections.
+  void ReleaseHandle(void* curl);
+
+  // The curl share handle.
+  void* share_ = nullptr;
+  // Locks for the data shared through |share_|, indexed by curl_lock_data.
+  std::vector<std::unique_ptr<base::Lock>> share_locks_;
+
+  // Protects |idle_handles_| and |statistics_|.
+  base::Lock lock_;
+  std::vector<void*> idle_handles_;
+  Statistics statistics_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_HTTP_CLIENT_H_
@@ -0,0 +1,65 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/http_client.h"
+
+#include <gtest/gtest.h>
+
+#if !defined(OS_WIN)
+#include "packager/file/test_http_server.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+
+namespace {
+const char kTestPath[] = "/http_test";
+const char kResponseData[] = "foo=62&type=mp4";
+const int kNumRequests = 5;
+}  // namespace
+
+class HttpClientTest : public testing::Test {
+ protected:
+  void SetUp() override { ASSERT_TRUE(server_.Start()); }
+  void TearDown() override { server_.Stop(); }
+
+  TestHttpServer server_;
+};
+
+TEST_F(HttpClientTest, ConnectionReuse) {
+  server_.SetBody(kTestPath, kResponseData);
+
+  HttpClient* http_client = HttpClient::GetInstance();
+  const HttpClient::Statistics initial_statistics =
+      http_client->GetStatistics();
+
+  HttpClient::Request request;
+  request.url = server_.GetUrl(kTestPath);
+  for (int i = 0; i < kNumRequests; ++i) {
+    std::string response;
+    ASSERT_OK(http_client->Send(request, &response));
+    EXPECT_EQ(kResponseData, response);
+  }
+
+  const HttpClient::Statistics statistics = http_client->GetStatistics();
+  EXPECT_EQ(initial_statistics.num_requests + kNumRequests,
+            statistics.num_requests);
+  // All the requests after the first one reuse the cached connection.
+  EXPECT_EQ(initial_statistics.num_new_connections + 1,
+            statistics.num_new_connections);
+  EXPECT_EQ(1, server_.num_connections());
+}
+
+TEST_F(HttpClientTest, InvalidUrl) {
+  HttpClient::Request request;
+  request.url = server_.GetUrl("/invalid_url");
+  std::string response;
+  Status status = HttpClient::GetInstance()->Send(request, &response);
+  EXPECT_EQ(error::HTTP_FAILURE, status.error_code());
+}
+
+}  // namespace shaka
+
+#endif  // !defined(OS_WIN)
@@ -0,0 +1,266 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/http_file.h"
+
+#include <gflags/gflags.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/http_client.h"
+
+DEFINE_string(http_upload_method,
+              "PUT",
+              "HTTP method used to upload the output files with http:// or "
+              "https:// URLs: 'PUT' or 'POST'.");
+DEFINE_int32(http_upload_max_retries,
+             2,
+             "Number of times a failed upload of an output file with an "
+             "http:// or https:// URL is retried. The content of the files is "
+             "kept in memory until uploaded, up to "
+             "--http_upload_max_retry_buffer_size, if it is not 0.");
+DEFINE_uint64(http_upload_max_retry_buffer_size,
+              16 << 20,
+              "Maximum size in bytes of the content of an output file with an "
+              "http:// or https:// URL kept in memory for the retries. The "
+              "upload of a larger file is not retried.");
+DEFINE_int32(http_upload_max_concurrency,
+             0,
+             "Maximum number of concurrent requests to upload or delete the "
+             "output files with http:// or https:// URLs. The upload of a file "
+             "waits for a free slot in the background, and the writes to the "
+             "file wait once 1MB is buffered, so it should not be less than "
+             "the number of outputs written concurrently. No limit if it is "
+             "0.");
+DEFINE_int32(http_upload_timeout_in_seconds,
+             0,
+             "Timeout of the uploads of output files with http:// or https:// "
+             "URLs. No timeout if it is 0.");
+
+namespace shaka {
+
+namespace {
+// Size of the buffer between the writer and the upload. Writes wait if the
+// upload lags behind by more than that.
+const uint64_t kUploadCacheSize = 1 << 20;
+const int64_t kInitialRetryDelayInMs = 100;
+
+HttpClient::Method GetUploadMethod() {
+  if (FLAGS_http_upload_method == "POST")
+    return HttpClient::Method::kPost;
+  LOG_IF(WARNING, FLAGS_http_upload_method != "PUT")
+      << "Unsupported --http_upload_method " << FLAGS_http_upload_method
+      << ". Using PUT.";
+  return HttpClient::Method::kPut;
+}
+
+// Limits the number of concurrent requests to --http_upload_max_concurrency.
+class UploadSlots {
+ public:
+  static UploadSlots* GetInstance() {
+    // Intentionally leaked, like HttpClient.
+    static UploadSlots* const instance = new UploadSlots;
+    return instance;
+  }
+
+  // Waits for a free slot. Returns false if there is no limit.
+  bool Acquire() {
+    if (FLAGS_http_upload_max_concurrency <= 0)
+      return false;
+    base::AutoLock scoped_lock(lock_);
+    while (num_slots_in_use_ >= FLAGS_http_upload_max_concurrency)
+      slot_released_.Wait();
+    ++num_slots_in_use_;
+    return true;
+  }
+
+  void Release() {
+    base::AutoLock scoped_lock(lock_);
+    DCHECK_GT(num_slots_in_use_, 0);
+    --num_slots_in_use_;
+    slot_released_.Signal();
+  }
+
+ private:
+  UploadSlots() : slot_released_(&lock_) {}
+
+  base::Lock lock_;
+  base::ConditionVariable slot_released_;
+  int num_slots_in_use_ = 0;
+};
+
+// Sends |request| while holding an upload slot. The slot is held for the
+// request only, so the retries and the other requests of a file do not keep
+// it while they wait.
+Status SendRequest(const HttpClient::Request& request, std::string* response) {
+  const bool has_upload_slot = UploadSlots::GetInstance()->Acquire();
+  Status status = HttpClient::GetInstance()->Send(request, response);
+  if (has_upload_slot)
+    UploadSlots::GetInstance()->Release();
+  return status;
+}
+
+// Retries |request|, which failed with |status|, up to |max_retries| times.
+Status RetryRequest(const HttpClient::Request& request,
+                    int max_retries,
+                    Status status) {
+  int64_t retry_delay_in_ms = kInitialRetryDelayInMs;
+  for (int i = 0; i < max_retries && !status.ok(); ++i) {
+    LOG(WARNING) << "Retrying request to " << request.url << ": " << status;
+    base::PlatformThread::Sleep(
+        base::TimeDelta::FromMilliseconds(retry_delay_in_ms));
+    retry_delay_in_ms *= 2;
+    std::string response;
+    status = SendRequest(request, &response);
+  }
+  return status;
+}
+
+Status SendWithRetries(const HttpClient::Request& request) {
+  std::string response;
+  return RetryRequest(request, FLAGS_http_upload_max_retries,
+                      SendRequest(request, &response));
+}
+
+}  // namespace
+
+HttpFile::HttpFile(const std::string& url)
+    : File(url),
+      max_retries_(FLAGS_http_upload_max_retries),
+      max_retry_buffer_size_(FLAGS_http_upload_max_retry_buffer_size),
+      cache_(kUploadCacheSize),
+      task_exit_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+                       base::WaitableEvent::InitialState::NOT_SIGNALED) {}
+
+HttpFile::~HttpFile() {}
+
+bool HttpFile::Open() {
+  if (!base::WorkerPool::PostTask(
+          FROM_HERE, base::Bind(&HttpFile::UploadTask, base::Unretained(this)),
+          true /* task_is_slow */)) {
+    LOG(ERROR) << "Failed to start the upload of " << file_name();
+    return false;
+  }
+  return true;
+}
+
+bool HttpFile::Close() {
+  cache_.Close();
+  task_exit_event_.Wait();
+
+  const bool result = upload_status_.ok();
+  LOG_IF(ERROR, !result) << "Failed to upload " << file_name() << ": "
+                         << upload_status_;
+  delete this;
+  return result;
+}
+
+int64_t HttpFile::Read(void* buffer, uint64_t length) {
+  NOTIMPLEMENTED() << "HttpFile does not support reading.";
+  return -1;
+}
+
+int64_t HttpFile::Write(const void* buffer, uint64_t length) {
+  const uint64_t bytes_written = cache_.Write(buffer, length);
+  size_ += bytes_written;
+  return bytes_written;
+}
+
+int64_t HttpFile::Size() {
+  return size_;
+}
+
+bool HttpFile::Flush() {
+  // Hands the data written so far to the upload.
+  cache_.WaitUntilEmptyOrClosed();
+  return true;
+}
+
+bool HttpFile::Seek(uint64_t position) {
+  NOTIMPLEMENTED() << "HttpFile does not support seeking.";
+  return false;
+}
+
+bool HttpFile::Tell(uint64_t* position) {
+  DCHECK(position);
+  *position = size_;
+  return true;
+}
+
+// static
+bool HttpFile::WriteFileAtomically(const std::string& url,
+                                   const std::string& contents) {
+  HttpClient::Request request;
+  request.method = GetUploadMethod();
+  request.url = url;
+  request.body = contents;
+  request.timeout_in_seconds = FLAGS_http_upload_timeout_in_seconds;
+  Status status = SendWithRetries(request);
+  LOG_IF(ERROR, !status.ok()) << "Failed to upload " << url << ": " << status;
+  return status.ok();
+}
+
+// static
+bool HttpFile::Delete(const std::string& url) {
+  HttpClient::Request request;
+  request.method = HttpClient::Method::kDelete;
+  request.url = url;
+  request.timeout_in_seconds = FLAGS_http_upload_timeout_in_seconds;
+  Status status = SendWithRetries(request);
+  LOG_IF(ERROR, !status.ok()) << "Failed to delete " << url << ": " << status;
+  return status.ok();
+}
+
+void HttpFile::UploadTask() {
+  HttpClient::Request request;
+  request.method = GetUploadMethod();
+  request.url = file_name();
+  request.timeout_in_seconds = FLAGS_http_upload_timeout_in_seconds;
+  request.body_source = [this](void* buffer, size_t size) {
+    return ReadBody(buffer, size);
+  };
+  std::string response;
+  upload_status_ = SendRequest(request, &response);
+
+  if (!upload_status_.ok()) {
+    // Consumes the rest of the file, so the writer does not block on a full
+    // cache, and keeps it for the retries.
+    char buffer[4096];
+    while (ReadBody(buffer, sizeof(buffer)) > 0) {
+    }
+    if (retry_buffer_exceeded_) {
+      LOG(WARNING) << "Not retrying the upload of " << file_name()
+                   << ", which is larger than "
+                      "--http_upload_max_retry_buffer_size.";
+    } else if (max_retries_ > 0) {
+      request.body_source = nullptr;
+      request.body.swap(body_);
+      upload_status_ = RetryRequest(request, max_retries_, upload_status_);
+    }
+  }
+  body_.clear();
+  task_exit_event_.Signal();
+}
+
+int64_t HttpFile::ReadBody(void* buffer, size_t size) {
+  const uint64_t bytes_read = cache_.Read(buffer, size);
+  if (max_retries_ > 0 && !retry_buffer_exceeded_) {
+    if (body_.size() + bytes_read > max_retry_buffer_size_) {
+      // The file is too large to be kept for the retries.
+      retry_buffer_exceeded_ = true;
+      std::string().swap(body_);
+    } else {
+      body_.append(static_cast<const char*>(buffer), bytes_read);
+    }
+  }
+  return bytes_read;
+}
+
+}  // namespace shaka
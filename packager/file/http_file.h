@@ -0,0 +1,90 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_HTTP_FILE_H_
+#define PACKAGER_FILE_HTTP_FILE_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/file/file.h"
+#include "packager/file/io_cache.h"
+#include "packager/status.h"
+
+namespace shaka {
+
+/// Implements HttpFile, which uploads a file to an HTTP(S) server, e.g. the
+/// ingest point of an origin, with a single PUT or POST request. The data is
+/// streamed to the server with chunked transfer encoding as it is written,
+/// over the persistent connections of HttpClient. A failed upload is retried
+/// with the complete content of the file when the file is closed, unless the
+/// file is larger than --http_upload_max_retry_buffer_size.
+class HttpFile : public File {
+ public:
+  /// @param url is the URL of the file, including the scheme. The file is
+  ///        opened for writing.
+  explicit HttpFile(const std::string& url);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+  /// Upload a file in a single request. The server replaces the file as a
+  /// whole, so readers never see partial content, which makes it suitable for
+  /// manifests.
+  /// @param url is the URL of the file, including the scheme.
+  /// @param contents is the content of the file.
+  /// @return true on success, false otherwise.
+  static bool WriteFileAtomically(const std::string& url,
+                                  const std::string& contents);
+
+  /// Delete a file on the server with a DELETE request.
+  /// @param url is the URL of the file, including the scheme.
+  /// @return true on success, false otherwise.
+  static bool Delete(const std::string& url);
+
+ protected:
+  ~HttpFile() override;
+
+  bool Open() override;
+
+ private:
+  HttpFile(const HttpFile&) = delete;
+  HttpFile& operator=(const HttpFile&) = delete;
+
+  // Runs on the worker pool. Streams the data in |cache_| to the server.
+  void UploadTask();
+  // Reads the request body from |cache_|, keeping a copy in |body_| for the
+  // retries, up to |max_retry_buffer_size_|.
+  int64_t ReadBody(void* buffer, size_t size);
+
+  const int max_retries_;
+  const uint64_t max_retry_buffer_size_;
+  IoCache cache_;
+  uint64_t size_ = 0;
+
+  // Used by the upload task only.
+  std::string body_;
+  // Set when the file does not fit in |body_|, so it is not retried.
+  bool retry_buffer_exceeded_ = false;
+  // Set by the upload task before it exits.
+  Status upload_status_;
+  // Signaled when the upload task exits.
+  base::WaitableEvent task_exit_event_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_HTTP_FILE_H_
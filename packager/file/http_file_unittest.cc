@@ -0,0 +1,171 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/http_file.h"
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#if !defined(OS_WIN)
+#include <memory>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/file/test_http_server.h"
+
+DECLARE_int32(http_upload_max_concurrency);
+DECLARE_int32(http_upload_max_retries);
+DECLARE_uint64(http_upload_max_retry_buffer_size);
+
+namespace shaka {
+
+namespace {
+const char kSegmentPath[] = "/live/segment_1.m4s";
+const char kManifestPath[] = "/live/manifest.mpd";
+const int kNumChunks = 8;
+const size_t kChunkSize = 10000;
+
+}  // namespace
+
+class HttpFileTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(server_.Start());
+    for (int i = 0; i < kNumChunks; ++i)
+      chunks_.push_back(std::string(kChunkSize, static_cast<char>('a' + i)));
+  }
+
+  void TearDown() override {
+    server_.Stop();
+    FLAGS_http_upload_max_retries = saved_max_retries_;
+    FLAGS_http_upload_max_retry_buffer_size = saved_max_retry_buffer_size_;
+    FLAGS_http_upload_max_concurrency = saved_max_concurrency_;
+  }
+
+  // Writes |chunks_| to |url| and returns the result of closing the file.
+  bool WriteChunks(const std::string& url) {
+    std::unique_ptr<File, FileCloser> file(File::Open(url.c_str(), "w"));
+    if (!file)
+      return false;
+    for (const std::string& chunk : chunks_) {
+      EXPECT_EQ(static_cast<int64_t>(chunk.size()),
+                file->Write(chunk.data(), chunk.size()));
+      EXPECT_TRUE(file->Flush());
+    }
+    EXPECT_EQ(static_cast<int64_t>(kNumChunks * kChunkSize), file->Size());
+    return file.release()->Close();
+  }
+
+  std::string GetExpectedBody() const {
+    std::string body;
+    for (const std::string& chunk : chunks_)
+      body += chunk;
+    return body;
+  }
+
+  TestHttpServer server_;
+  std::vector<std::string> chunks_;
+  const int saved_max_retries_ = FLAGS_http_upload_max_retries;
+  const uint64_t saved_max_retry_buffer_size_ =
+      FLAGS_http_upload_max_retry_buffer_size;
+  const int saved_max_concurrency_ = FLAGS_http_upload_max_concurrency;
+};
+
+TEST_F(HttpFileTest, StreamsUpload) {
+  ASSERT_TRUE(WriteChunks(server_.GetUrl(kSegmentPath)));
+
+  std::string body;
+  ASSERT_TRUE(server_.GetBody(kSegmentPath, &body));
+  EXPECT_EQ(GetExpectedBody(), body);
+  EXPECT_EQ(1, server_.num_chunked_requests());
+}
+
+TEST_F(HttpFileTest, RetriesFailedUpload) {
+  FLAGS_http_upload_max_retries = 2;
+  server_.FailNextRequests(2);
+  ASSERT_TRUE(WriteChunks(server_.GetUrl(kSegmentPath)));
+
+  std::string body;
+  ASSERT_TRUE(server_.GetBody(kSegmentPath, &body));
+  EXPECT_EQ(GetExpectedBody(), body);
+}
+
+TEST_F(HttpFileTest, FailsAfterRetries) {
+  FLAGS_http_upload_max_retries = 1;
+  server_.FailNextRequests(2);
+  EXPECT_FALSE(WriteChunks(server_.GetUrl(kSegmentPath)));
+
+  std::string body;
+  EXPECT_FALSE(server_.GetBody(kSegmentPath, &body));
+}
+
+TEST_F(HttpFileTest, DoesNotRetryFileLargerThanRetryBuffer) {
+  FLAGS_http_upload_max_retries = 2;
+  FLAGS_http_upload_max_retry_buffer_size = kChunkSize;
+  server_.FailNextRequests(1);
+  EXPECT_FALSE(WriteChunks(server_.GetUrl(kSegmentPath)));
+
+  std::string body;
+  EXPECT_FALSE(server_.GetBody(kSegmentPath, &body));
+}
+
+TEST_F(HttpFileTest, OpensMoreFilesThanMaxConcurrency) {
+  FLAGS_http_upload_max_concurrency = 1;
+  const std::string kOtherSegmentPath = "/live/segment_2.m4s";
+  // Opening a file does not wait for the upload of the other one.
+  std::unique_ptr<File, FileCloser> file1(
+      File::Open(server_.GetUrl(kSegmentPath).c_str(), "w"));
+  ASSERT_TRUE(file1);
+  std::unique_ptr<File, FileCloser> file2(
+      File::Open(server_.GetUrl(kOtherSegmentPath).c_str(), "w"));
+  ASSERT_TRUE(file2);
+
+  const std::string& chunk = chunks_[0];
+  EXPECT_EQ(static_cast<int64_t>(chunk.size()),
+            file1->Write(chunk.data(), chunk.size()));
+  EXPECT_EQ(static_cast<int64_t>(chunk.size()),
+            file2->Write(chunk.data(), chunk.size()));
+  // The second upload starts once the first one completes.
+  ASSERT_TRUE(file1.release()->Close());
+  ASSERT_TRUE(file2.release()->Close());
+
+  std::string body;
+  ASSERT_TRUE(server_.GetBody(kSegmentPath, &body));
+  EXPECT_EQ(chunk, body);
+  ASSERT_TRUE(server_.GetBody(kOtherSegmentPath, &body));
+  EXPECT_EQ(chunk, body);
+}
+
+TEST_F(HttpFileTest, WritesFileAtomically) {
+  const std::string kManifest = "<MPD></MPD>";
+  ASSERT_TRUE(
+      File::WriteFileAtomically(server_.GetUrl(kManifestPath).c_str(),
+                                kManifest));
+
+  std::string body;
+  ASSERT_TRUE(server_.GetBody(kManifestPath, &body));
+  EXPECT_EQ(kManifest, body);
+  // The manifest is sent in a single piece.
+  EXPECT_EQ(0, server_.num_chunked_requests());
+}
+
+TEST_F(HttpFileTest, Delete) {
+  server_.SetBody(kSegmentPath, "segment");
+  ASSERT_TRUE(File::Delete(server_.GetUrl(kSegmentPath).c_str()));
+
+  std::string body;
+  EXPECT_FALSE(server_.GetBody(kSegmentPath, &body));
+}
+
+TEST_F(HttpFileTest, ReadNotSupported) {
+  EXPECT_EQ(nullptr,
+            File::Open(server_.GetUrl(kSegmentPath).c_str(), "r"));
+}
+
+}  // namespace shaka
+
+#endif  // !defined(OS_WIN)
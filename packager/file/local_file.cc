@@ -7,14 +7,22 @@
 #include "packager/file/local_file.h"
 
 #include <stdio.h>
+
+#include <set>
 #if defined(OS_WIN)
 #include <windows.h>
 #else
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <unistd.h>
 #endif  // defined(OS_WIN)
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
 #include "packager/base/logging.h"
+#include "packager/base/synchronization/lock.h"
+#if !defined(OS_WIN)
+#include "packager/base/posix/eintr_wrapper.h"
+#endif  // !defined(OS_WIN)
 
 namespace shaka {
 namespace {
@@ -41,6 +49,40 @@ bool DirectoryExists(const base::FilePath& path, int* mode) {
   return false;
 }
 
+// The directories known to exist. Opening a file for writing checks that its
+// directory and all the parent directories exist, which takes a round trip per
+// directory on network filesystems. The check is skipped for the directories
+// which passed it already, e.g. when writing the segments of a stream.
+class ExistingDirectories {
+ public:
+  static ExistingDirectories* GetInstance() {
+    // Intentionally leaked.
+    static ExistingDirectories* const instance = new ExistingDirectories;
+    return instance;
+  }
+
+  bool Contains(const base::FilePath& path) {
+    base::AutoLock auto_lock(lock_);
+    return directories_.find(path.value()) != directories_.end();
+  }
+
+  void Add(const base::FilePath& path) {
+    base::AutoLock auto_lock(lock_);
+    directories_.insert(path.value());
+  }
+
+  void Remove(const base::FilePath& path) {
+    base::AutoLock auto_lock(lock_);
+    directories_.erase(path.value());
+  }
+
+ private:
+  ExistingDirectories() = default;
+
+  base::Lock lock_;
+  std::set<base::FilePath::StringType> directories_;
+};
+
 // Create all the inexistent directories in the path. Returns true on success or
 // if the directory already exists.
 bool CreateDirectory(const base::FilePath& full_path) {
@@ -185,14 +227,29 @@ bool LocalFile::Open() {
   base::FilePath file_path(base::FilePath::FromUTF8Unsafe(file_name()));
 
   // Create upper level directories for write mode.
-  if (file_mode_.find("w") != std::string::npos) {
+  const bool write_mode = file_mode_.find("w") != std::string::npos;
+  const base::FilePath dir_path = file_path.DirName();
+  ExistingDirectories* existing_directories =
+      ExistingDirectories::GetInstance();
+  const bool dir_known_to_exist =
+      write_mode && existing_directories->Contains(dir_path);
+  if (write_mode && !dir_known_to_exist) {
     // The function returns true if the directories already exist.
-    if (!shaka::CreateDirectory(file_path.DirName())) {
+    if (!shaka::CreateDirectory(dir_path)) {
       return false;
     }
+    existing_directories->Add(dir_path);
   }
 
   internal_file_ = base::OpenFile(file_path, file_mode_.c_str());
+  if (!internal_file_ && dir_known_to_exist) {
+    // The directory may have been removed since it was checked.
+    existing_directories->Remove(dir_path);
+    if (!shaka::CreateDirectory(dir_path))
+      return false;
+    existing_directories->Add(dir_path);
+    internal_file_ = base::OpenFile(file_path, file_mode_.c_str());
+  }
   return (internal_file_ != NULL);
 }
 
@@ -200,4 +257,38 @@ bool LocalFile::Delete(const char* file_name) {
   return base::DeleteFile(base::FilePath::FromUTF8Unsafe(file_name), false);
 }
 
+bool LocalFile::Sync(const char* file_name, bool data_only) {
+#if defined(OS_WIN)
+  const base::FilePath file_path(base::FilePath::FromUTF8Unsafe(file_name));
+  HANDLE handle =
+      CreateFile(file_path.value().c_str(), GENERIC_WRITE,
+                 FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                 FILE_ATTRIBUTE_NORMAL, NULL);
+  if (handle == INVALID_HANDLE_VALUE) {
+    LOG(ERROR) << "Failed to open " << file_name << " for syncing.";
+    return false;
+  }
+  const bool result = FlushFileBuffers(handle) != 0;
+  CloseHandle(handle);
+  return result;
+#else
+  // Syncing through any descriptor of a file flushes all its data.
+  const int fd = HANDLE_EINTR(open(file_name, O_RDONLY));
+  if (fd < 0) {
+    PLOG(ERROR) << "Failed to open " << file_name << " for syncing";
+    return false;
+  }
+#if defined(OS_LINUX)
+  const int result =
+      data_only ? HANDLE_EINTR(fdatasync(fd)) : HANDLE_EINTR(fsync(fd));
+#else
+  const int result = HANDLE_EINTR(fsync(fd));
+#endif  // defined(OS_LINUX)
+  if (result != 0)
+    PLOG(ERROR) << "Failed to sync " << file_name;
+  close(fd);
+  return result == 0;
+#endif  // defined(OS_WIN)
+}
+
 }  // namespace shaka
@@ -40,6 +40,13 @@ class LocalFile : public File {
   /// @return true if successful, or false otherwise.
   static bool Delete(const char* file_name);
 
+  /// Flush the data of a local file to the storage device.
+  /// @param file_name is the path of the file to be synced.
+  /// @param data_only makes it skip the metadata not needed to read the data
+  ///        back where supported, i.e. use fdatasync instead of fsync.
+  /// @return true if successful, or false otherwise.
+  static bool Sync(const char* file_name, bool data_only);
+
  protected:
   ~LocalFile() override;
 
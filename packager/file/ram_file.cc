@@ -0,0 +1,135 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/ram_file.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+
+RamFile::RamFile(const char* file_name, const char* mode)
+    : File(file_name), mode_(mode) {}
+
+RamFile::~RamFile() {}
+
+bool RamFile::Close() {
+  if (is_writing())
+    Publish(true);
+  delete this;
+  return true;
+}
+
+int64_t RamFile::Read(void* buffer, uint64_t length) {
+  DCHECK(read_data_);
+  char* output = static_cast<char*>(buffer);
+  uint64_t bytes_read = 0;
+  uint64_t chunk_start = 0;
+  for (const RamStore::Chunk& chunk : read_data_->chunks) {
+    if (bytes_read == length)
+      break;
+    const uint64_t chunk_end = chunk_start + chunk->size();
+    if (position_ < chunk_end) {
+      const uint64_t offset = position_ - chunk_start;
+      const uint64_t bytes_to_read =
+          std::min<uint64_t>(length - bytes_read, chunk->size() - offset);
+      memcpy(output + bytes_read, chunk->data() + offset, bytes_to_read);
+      bytes_read += bytes_to_read;
+      position_ += bytes_to_read;
+    }
+    chunk_start = chunk_end;
+  }
+  return bytes_read;
+}
+
+int64_t RamFile::Write(const void* buffer, uint64_t length) {
+  DCHECK(is_writing());
+  if (position_ < published_size_) {
+    // Overwrites published data, e.g. a header updated after seeking back. The
+    // published chunks are immutable, so they are merged back into the pending
+    // data.
+    RamStore::Content published;
+    published.chunks.swap(published_chunks_);
+    published.size = published_size_;
+    pending_data_.insert(0, published.ToString());
+    published_size_ = 0;
+  }
+  const uint64_t offset = position_ - published_size_;
+  if (offset == pending_data_.size()) {
+    pending_data_.append(static_cast<const char*>(buffer), length);
+  } else {
+    if (pending_data_.size() < offset + length)
+      pending_data_.resize(offset + length);
+    memcpy(&pending_data_[offset], buffer, length);
+  }
+  position_ += length;
+  return length;
+}
+
+int64_t RamFile::Size() {
+  return is_writing() ? published_size_ + pending_data_.size()
+                      : read_data_->size;
+}
+
+bool RamFile::Flush() {
+  if (is_writing())
+    Publish(false);
+  return true;
+}
+
+bool RamFile::Seek(uint64_t position) {
+  if (position > static_cast<uint64_t>(Size()))
+    return false;
+  position_ = position;
+  return true;
+}
+
+bool RamFile::Tell(uint64_t* position) {
+  DCHECK(position);
+  *position = position_;
+  return true;
+}
+
+bool RamFile::Open() {
+  if (mode_ == "r") {
+    read_data_ = RamStore::GetInstance()->Get(file_name());
+    return read_data_ != nullptr;
+  }
+  if (mode_ == "w")
+    return true;
+  if (mode_ == "a") {
+    RamStore::Data data = RamStore::GetInstance()->Get(file_name());
+    if (data) {
+      published_chunks_ = data->chunks;
+      published_size_ = data->size;
+    }
+    position_ = published_size_;
+    return true;
+  }
+  NOTIMPLEMENTED() << "File mode '" << mode_ << "' not supported by RamFile";
+  return false;
+}
+
+void RamFile::Publish(bool complete) {
+  if (!pending_data_.empty()) {
+    published_size_ += pending_data_.size();
+    published_chunks_.push_back(
+        std::make_shared<const std::string>(std::move(pending_data_)));
+    pending_data_.clear();
+  }
+  std::shared_ptr<RamStore::Content> content =
+      std::make_shared<RamStore::Content>();
+  content->chunks = published_chunks_;
+  content->size = published_size_;
+  content->complete = complete;
+  RamStore::GetInstance()->Put(file_name(), std::move(content));
+}
+
+}  // namespace shaka
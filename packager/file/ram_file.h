@@ -0,0 +1,72 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_RAM_FILE_H_
+#define PACKAGER_FILE_RAM_FILE_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/ram_store.h"
+
+namespace shaka {
+
+/// Implements RamFile, which is stored in RamStore::GetInstance(), e.g. to be
+/// served by RamHttpServer. A file being written is published to the store
+/// when it is closed, and also on every Flush(), e.g. after each chunk of a
+/// low latency segment. So the readers see a partial file if it has been
+/// flushed but not closed yet; such a file is published as not complete, see
+/// RamStore::Content::complete. The data written since the previous Flush()
+/// is published as a new chunk, without copying the chunks published before.
+class RamFile : public File {
+ public:
+  /// @param file_name is the name of the file in the store.
+  /// @param mode is the access mode: "r", "w" or "a".
+  RamFile(const char* file_name, const char* mode);
+
+  /// @name File implementation overrides.
+  /// @{
+  bool Close() override;
+  int64_t Read(void* buffer, uint64_t length) override;
+  int64_t Write(const void* buffer, uint64_t length) override;
+  int64_t Size() override;
+  bool Flush() override;
+  bool Seek(uint64_t position) override;
+  bool Tell(uint64_t* position) override;
+  /// @}
+
+ protected:
+  ~RamFile() override;
+
+  bool Open() override;
+
+ private:
+  RamFile(const RamFile&) = delete;
+  RamFile& operator=(const RamFile&) = delete;
+
+  bool is_writing() const { return mode_ != "r"; }
+
+  // Moves the data written since the previous Flush() to a new published
+  // chunk and publishes the file, as complete if |complete| is true.
+  void Publish(bool complete);
+
+  const std::string mode_;
+  // The content being written: the chunks published by Flush(), followed by
+  // the data written after them.
+  std::vector<RamStore::Chunk> published_chunks_;
+  uint64_t published_size_ = 0;
+  std::string pending_data_;
+  // The content being read.
+  RamStore::Data read_data_;
+  uint64_t position_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_RAM_FILE_H_
@@ -0,0 +1,489 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/ram_http_server.h"
+
+#if defined(OS_WIN)
+
+#include <windows.h>
+#include <ws2tcpip.h>
+#define close closesocket
+#define EINTR_CODE WSAEINTR
+#define SHUTDOWN_BOTH SD_BOTH
+
+#else
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#define INVALID_SOCKET -1
+#define EINTR_CODE EINTR
+#define SHUTDOWN_BOTH SHUT_RDWR
+
+#endif  // defined(OS_WIN)
+
+// Writing to a connection closed by the client must not raise SIGPIPE.
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <utility>
+#include <vector>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/base/time/time.h"
+#include "packager/file/ram_store.h"
+
+namespace shaka {
+
+namespace {
+
+// Requests with larger headers are rejected.
+const size_t kMaxHeaderSize = 16 * 1024;
+const char kHeaderEnd[] = "\r\n\r\n";
+const char kLastChunk[] = "0\r\n\r\n";
+// Interval between the checks for new data of a file being written.
+const int64_t kGrowingFilePollIntervalInMs = 10;
+
+struct ContentType {
+  const char* extension;
+  const char* type;
+  // Manifests are updated in place, so they must not be cached.
+  bool is_manifest;
+};
+
+const ContentType kContentTypes[] = {
+    {".mpd", "application/dash+xml", true},
+    {".m3u8", "application/vnd.apple.mpegurl", true},
+    {".m4s", "video/mp4", false},
+    {".mp4", "video/mp4", false},
+    {".m4a", "audio/mp4", false},
+    {".ts", "video/mp2t", false},
+    {".aac", "audio/aac", false},
+    {".ac3", "audio/ac3", false},
+    {".ec3", "audio/eac3", false},
+    {".vtt", "text/vtt", false},
+    {".webm", "video/webm", false},
+};
+
+const ContentType* GetContentType(const std::string& name) {
+  for (const ContentType& content_type : kContentTypes) {
+    if (base::EndsWith(name, content_type.extension,
+                       base::CompareCase::INSENSITIVE_ASCII)) {
+      return &content_type;
+    }
+  }
+  return nullptr;
+}
+
+int GetSocketErrorCode() {
+#if defined(OS_WIN)
+  return WSAGetLastError();
+#else
+  return errno;
+#endif
+}
+
+// Sets the timeout of the blocking reads and writes on |connection|, so that
+// idle clients do not hold the connection forever.
+bool SetTimeouts(SOCKET connection, int timeout_in_seconds) {
+#if defined(OS_WIN)
+  const DWORD timeout = timeout_in_seconds * 1000;
+#else
+  struct timeval timeout = {};
+  timeout.tv_sec = timeout_in_seconds;
+#endif  // defined(OS_WIN)
+  const char* optval = reinterpret_cast<const char*>(&timeout);
+  return setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, optval,
+                    sizeof(timeout)) == 0 &&
+         setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, optval,
+                    sizeof(timeout)) == 0;
+}
+
+bool SendAll(SOCKET connection, const char* data, size_t size) {
+  while (size > 0) {
+    const int64_t result = send(connection, data, size, MSG_NOSIGNAL);
+    if (result < 0) {
+      if (GetSocketErrorCode() == EINTR_CODE)
+        continue;
+      return false;
+    }
+    data += result;
+    size -= result;
+  }
+  return true;
+}
+
+// Sends the data of |content| from |offset| in the chunked transfer coding.
+bool SendChunks(SOCKET connection,
+                const RamStore::Content& content,
+                uint64_t offset) {
+  uint64_t chunk_start = 0;
+  for (const RamStore::Chunk& chunk : content.chunks) {
+    const uint64_t chunk_end = chunk_start + chunk->size();
+    if (offset < chunk_end) {
+      const uint64_t skipped_size = offset > chunk_start ? offset - chunk_start
+                                                         : 0;
+      const uint64_t size = chunk->size() - skipped_size;
+      const std::string chunk_size =
+          base::StringPrintf("%" PRIx64 "\r\n", size);
+      if (!SendAll(connection, chunk_size.data(), chunk_size.size()) ||
+          !SendAll(connection, chunk->data() + skipped_size, size) ||
+          !SendAll(connection, "\r\n", 2)) {
+        return false;
+      }
+    }
+    chunk_start = chunk_end;
+  }
+  return true;
+}
+
+bool SendResponse(SOCKET connection,
+                  const std::string& status,
+                  bool keep_alive) {
+  std::string response = "HTTP/1.1 " + status + "\r\nContent-Length: 0\r\n";
+  if (!keep_alive)
+    response += "Connection: close\r\n";
+  response += "\r\n";
+  return SendAll(connection, response.data(), response.size()) && keep_alive;
+}
+
+// Reads until |buffer| holds the headers of a request. Returns the size of the
+// headers, including the empty line ending them, or 0 on failure, including a
+// timeout.
+size_t ReadHeaders(SOCKET connection, std::string* buffer, bool* too_large) {
+  *too_large = false;
+  size_t pos;
+  while ((pos = buffer->find(kHeaderEnd)) == std::string::npos) {
+    if (buffer->size() > kMaxHeaderSize) {
+      *too_large = true;
+      return 0;
+    }
+    char data[4096];
+    const int64_t size = recv(connection, data, sizeof(data), 0);
+    if (size < 0 && GetSocketErrorCode() == EINTR_CODE)
+      continue;
+    if (size <= 0)
+      return 0;
+    buffer->append(data, size);
+  }
+  return pos + strlen(kHeaderEnd);
+}
+
+}  // namespace
+
+RamHttpServer::RamHttpServer(RamStore* store, const Options& options)
+    : store_(store),
+      options_(options),
+      listen_socket_(INVALID_SOCKET),
+      connection_closed_(&lock_) {
+  DCHECK(store);
+}
+
+RamHttpServer::~RamHttpServer() {
+  Stop();
+}
+
+Status RamHttpServer::Start(const std::string& address, uint16_t port) {
+  DCHECK_EQ(listen_socket_, INVALID_SOCKET) << "The server is running.";
+
+#if defined(OS_WIN)
+  WSADATA wsa_data;
+  int wsa_error = WSAStartup(MAKEWORD(2, 2), &wsa_data);
+  if (wsa_error != 0) {
+    return Status(error::FILE_FAILURE,
+                  "Winsock start up failed with error " +
+                      base::IntToString(wsa_error));
+  }
+  wsa_started_ = true;
+#endif  // defined(OS_WIN)
+
+  struct sockaddr_in local_sock_addr = {};
+  local_sock_addr.sin_family = AF_INET;
+  local_sock_addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, address.c_str(), &local_sock_addr.sin_addr) != 1) {
+    Stop();
+    return Status(error::INVALID_ARGUMENT,
+                  "Malformed IPv4 address " + address);
+  }
+
+  listen_socket_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_socket_ == INVALID_SOCKET) {
+    Stop();
+    return Status(error::FILE_FAILURE, "Could not allocate socket.");
+  }
+
+  const int optval = 1;
+  if (setsockopt(listen_socket_, SOL_SOCKET, SO_REUSEADDR,
+                 reinterpret_cast<const char*>(&optval),
+                 sizeof(optval)) < 0) {
+    Stop();
+    return Status(error::FILE_FAILURE,
+                  "Could not apply the SO_REUSEADDR property to the socket.");
+  }
+
+  socklen_t sock_addr_size = sizeof(local_sock_addr);
+  struct sockaddr* sock_addr =
+      reinterpret_cast<struct sockaddr*>(&local_sock_addr);
+  if (bind(listen_socket_, sock_addr, sock_addr_size) < 0 ||
+      listen(listen_socket_, SOMAXCONN) < 0 ||
+      getsockname(listen_socket_, sock_addr, &sock_addr_size) < 0) {
+    Stop();
+    return Status(error::FILE_FAILURE,
+                  "Could not listen on " + address + ":" +
+                      base::UintToString(port) + ".");
+  }
+  port_ = ntohs(local_sock_addr.sin_port);
+
+  stopping_ = false;
+  accept_thread_.reset(
+      new base::DelegateSimpleThread(this, "RamHttpServerThread"));
+  accept_thread_->Start();
+  LOG(INFO) << "Serving the ram:// files on " << address << ":" << port_;
+  return Status::OK;
+}
+
+void RamHttpServer::Stop() {
+  if (listen_socket_ != INVALID_SOCKET) {
+    {
+      base::AutoLock auto_lock(lock_);
+      stopping_ = true;
+    }
+    // Unblocks accept().
+    shutdown(listen_socket_, SHUTDOWN_BOTH);
+    if (accept_thread_) {
+      accept_thread_->Join();
+      accept_thread_.reset();
+    }
+    close(listen_socket_);
+    listen_socket_ = INVALID_SOCKET;
+
+    // Unblock the connections waiting for requests and wait for them to be
+    // closed.
+    base::AutoLock auto_lock(lock_);
+    for (SOCKET connection : connections_)
+      shutdown(connection, SHUTDOWN_BOTH);
+    while (!connections_.empty())
+      connection_closed_.Wait();
+  }
+#if defined(OS_WIN)
+  if (wsa_started_) {
+    WSACleanup();
+    wsa_started_ = false;
+  }
+#endif  // defined(OS_WIN)
+}
+
+void RamHttpServer::Run() {
+  while (true) {
+    const SOCKET connection = accept(listen_socket_, nullptr, nullptr);
+    if (connection == INVALID_SOCKET) {
+      if (GetSocketErrorCode() == EINTR_CODE)
+        continue;
+      base::AutoLock auto_lock(lock_);
+      LOG_IF(ERROR, !stopping_) << "Failed to accept a connection, error "
+                                << GetSocketErrorCode();
+      return;
+    }
+#if defined(SO_NOSIGPIPE)
+    const int optval = 1;
+    setsockopt(connection, SOL_SOCKET, SO_NOSIGPIPE, &optval, sizeof(optval));
+#endif  // defined(SO_NOSIGPIPE)
+    if (!SetTimeouts(connection, options_.idle_timeout_in_seconds)) {
+      LOG(ERROR) << "Failed to set the timeouts of a connection, error "
+                 << GetSocketErrorCode();
+      close(connection);
+      continue;
+    }
+
+    {
+      base::AutoLock auto_lock(lock_);
+      if (stopping_) {
+        close(connection);
+        return;
+      }
+      if (connections_.size() < options_.max_connections) {
+        connections_.insert(connection);
+        if (!base::WorkerPool::PostTask(
+                FROM_HERE,
+                base::Bind(&RamHttpServer::ServeConnection,
+                           base::Unretained(this), connection),
+                true /* task_is_slow */)) {
+          LOG(ERROR) << "Failed to post the task serving a connection.";
+          connections_.erase(connection);
+          close(connection);
+        }
+        continue;
+      }
+    }
+    LOG(WARNING) << "Rejecting a connection, as there are already "
+                 << options_.max_connections << " connections.";
+    SendResponse(connection, "503 Service Unavailable", false);
+    close(connection);
+  }
+}
+
+void RamHttpServer::ServeConnection(SOCKET connection) {
+  std::string buffer;
+  while (ServeRequest(connection, &buffer)) {
+  }
+
+  base::AutoLock auto_lock(lock_);
+  close(connection);
+  connections_.erase(connection);
+  connection_closed_.Signal();
+}
+
+bool RamHttpServer::ServeRequest(SOCKET connection, std::string* buffer) {
+  bool too_large = false;
+  const size_t header_size = ReadHeaders(connection, buffer, &too_large);
+  if (header_size == 0) {
+    if (too_large)
+      SendResponse(connection, "400 Bad Request", false);
+    return false;
+  }
+  const std::string headers = buffer->substr(0, header_size);
+  buffer->erase(0, header_size);
+
+  // Splitting on either CR or LF, the empty lines are skipped.
+  std::vector<std::string> lines = base::SplitString(
+      headers, "\r\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  if (lines.empty())
+    return SendResponse(connection, "400 Bad Request", false);
+  const std::vector<std::string> tokens = base::SplitString(
+      lines[0], " ", base::TRIM_WHITESPACE, base::SPLIT_WANT_NONEMPTY);
+  if (tokens.size() != 3)
+    return SendResponse(connection, "400 Bad Request", false);
+  const std::string& method = tokens[0];
+  const std::string& target = tokens[1];
+  const std::string& version = tokens[2];
+
+  // HTTP/1.1 connections are persistent unless the client asks otherwise.
+  bool keep_alive = version == "HTTP/1.1";
+  for (size_t i = 1; i < lines.size(); ++i) {
+    const std::string header = base::ToLowerASCII(lines[i]);
+    if (header == "connection: close") {
+      keep_alive = false;
+    } else if (header == "connection: keep-alive") {
+      keep_alive = true;
+    } else if (base::StartsWith(header, "content-length:",
+                                base::CompareCase::SENSITIVE) ||
+               base::StartsWith(header, "transfer-encoding:",
+                                base::CompareCase::SENSITIVE)) {
+      // The bodies of the requests are not expected and not read, so the
+      // connection cannot be reused.
+      keep_alive = false;
+    }
+  }
+
+  const bool is_head = method == "HEAD";
+  if (method != "GET" && !is_head)
+    return SendResponse(connection, "405 Method Not Allowed", false);
+
+  // The name of the file is the path without the leading '/'.
+  std::string name = target.substr(0, target.find_first_of("?#"));
+  if (!base::StartsWith(name, "/", base::CompareCase::SENSITIVE))
+    return SendResponse(connection, "400 Bad Request", false);
+  name.erase(0, 1);
+
+  RamStore::Data data = store_->Get(name);
+  if (!data)
+    return SendResponse(connection, "404 Not Found", keep_alive);
+  // A file still being written, e.g. a low latency segment at the live edge,
+  // is sent in the chunked transfer coding as it grows, so that the client
+  // does not take the data flushed so far for the whole file. HTTP/1.0
+  // clients do not support it, so the file is not available to them yet.
+  const bool chunked = !data->complete;
+  if (chunked && version != "HTTP/1.1")
+    return SendResponse(connection, "404 Not Found", keep_alive);
+
+  std::string response = "HTTP/1.1 200 OK\r\n";
+  const ContentType* content_type = GetContentType(name);
+  if (content_type) {
+    response += "Content-Type: ";
+    response += content_type->type;
+    response += "\r\n";
+    if (content_type->is_manifest)
+      response += "Cache-Control: no-cache\r\n";
+  }
+  if (chunked) {
+    response += "Transfer-Encoding: chunked\r\n";
+  } else {
+    response +=
+        "Content-Length: " + base::Uint64ToString(data->size) + "\r\n";
+  }
+  response += "Access-Control-Allow-Origin: *\r\n";
+  if (!keep_alive)
+    response += "Connection: close\r\n";
+  response += "\r\n";
+
+  // The body is sent from the snapshot held by |data|, without copying it,
+  // while the file may be replaced in the store.
+  if (!SendAll(connection, response.data(), response.size()))
+    return false;
+  if (!is_head && chunked)
+    return SendGrowingFile(connection, name, std::move(data)) && keep_alive;
+  if (!is_head) {
+    for (const RamStore::Chunk& chunk : data->chunks) {
+      if (!SendAll(connection, chunk->data(), chunk->size()))
+        return false;
+    }
+  }
+  return keep_alive;
+}
+
+bool RamHttpServer::SendGrowingFile(SOCKET connection,
+                                    const std::string& name,
+                                    RamStore::Data data) {
+  const base::TimeDelta idle_timeout =
+      base::TimeDelta::FromSeconds(options_.idle_timeout_in_seconds);
+  uint64_t bytes_sent = 0;
+  base::TimeTicks last_update_time = base::TimeTicks::Now();
+  while (true) {
+    if (data->size > bytes_sent) {
+      if (!SendChunks(connection, *data, bytes_sent))
+        return false;
+      bytes_sent = data->size;
+      last_update_time = base::TimeTicks::Now();
+    }
+    if (data->complete)
+      return SendAll(connection, kLastChunk, strlen(kLastChunk));
+
+    {
+      base::AutoLock auto_lock(lock_);
+      if (stopping_)
+        return false;
+    }
+    if (base::TimeTicks::Now() - last_update_time > idle_timeout) {
+      LOG(WARNING) << "Stopped serving " << name
+                   << ", which has not grown within the idle timeout.";
+      return false;
+    }
+    base::PlatformThread::Sleep(
+        base::TimeDelta::FromMilliseconds(kGrowingFilePollIntervalInMs));
+
+    // Closing the connection without the last chunk tells the client that the
+    // response is incomplete, e.g. if the file has been deleted or rewritten.
+    data = store_->Get(name);
+    if (!data || data->size < bytes_sent)
+      return false;
+  }
+}
+
+}  // namespace shaka
@@ -0,0 +1,107 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_RAM_HTTP_SERVER_H_
+#define PACKAGER_FILE_RAM_HTTP_SERVER_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/file/ram_store.h"
+#include "packager/status.h"
+
+#if defined(OS_WIN)
+#include <winsock2.h>
+#else
+typedef int SOCKET;
+#endif  // defined(OS_WIN)
+
+namespace shaka {
+
+/// A minimal HTTP/1.1 server serving the files of a RamStore straight from
+/// memory, e.g. the segments and manifests of a live presentation packaged to
+/// "ram://" outputs. The path of the URL, without the leading '/', is the name
+/// of the file in the store. Only GET and HEAD requests are supported. A file
+/// still being written, e.g. a low latency segment, is sent in the chunked
+/// transfer coding until it is complete.
+/// Connections are kept alive and each one is served on the worker pool. Idle
+/// connections are closed and the number of connections is limited, so that
+/// clients cannot hold all the worker threads.
+class RamHttpServer : public base::DelegateSimpleThread::Delegate {
+ public:
+  struct Options {
+    /// Connections neither sending a request nor reading a response for this
+    /// long are closed.
+    int idle_timeout_in_seconds = 30;
+    /// Maximum number of open connections. The connections beyond it are
+    /// rejected with "503 Service Unavailable".
+    size_t max_connections = 64;
+  };
+
+  /// @param store is the store to serve. It must outlive the server.
+  /// @param options are the limits of the server.
+  RamHttpServer(RamStore* store, const Options& options);
+  /// Stops the server if it is running.
+  ~RamHttpServer() override;
+
+  /// Start accepting connections.
+  /// @param address is the IPv4 address to listen on, e.g. "127.0.0.1" for
+  ///        the local clients only or "0.0.0.0" for all the interfaces.
+  /// @param port is the port to listen on. A free port is picked if it is 0.
+  /// @return OK on success.
+  Status Start(const std::string& address, uint16_t port);
+
+  /// Stop the server and close the open connections.
+  void Stop();
+
+  /// @return the port the server listens on.
+  uint16_t port() const { return port_; }
+
+ private:
+  RamHttpServer(const RamHttpServer&) = delete;
+  RamHttpServer& operator=(const RamHttpServer&) = delete;
+
+  // base::DelegateSimpleThread::Delegate implementation, which accepts the
+  // connections.
+  void Run() override;
+
+  // Serves the requests on |connection| until it is closed.
+  void ServeConnection(SOCKET connection);
+  // Serves a request, with |buffer| holding the data received and not
+  // processed yet. Returns false if the connection should be closed.
+  bool ServeRequest(SOCKET connection, std::string* buffer);
+  // Sends the file |name|, starting from the snapshot |data|, in the chunked
+  // transfer coding as it grows, until it is complete. Returns false if the
+  // response could not be completed.
+  bool SendGrowingFile(SOCKET connection,
+                       const std::string& name,
+                       RamStore::Data data);
+
+  RamStore* const store_;
+  const Options options_;
+  SOCKET listen_socket_;
+  uint16_t port_ = 0;
+  std::unique_ptr<base::DelegateSimpleThread> accept_thread_;
+#if defined(OS_WIN)
+  bool wsa_started_ = false;
+#endif  // defined(OS_WIN)
+
+  base::Lock lock_;
+  // Signaled when a connection is closed.
+  base::ConditionVariable connection_closed_;
+  std::set<SOCKET> connections_;
+  bool stopping_ = false;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_RAM_HTTP_SERVER_H_
@@ -0,0 +1,229 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/ram_http_server.h"
+
+#include <gtest/gtest.h>
+
+#if !defined(OS_WIN)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif  // !defined(OS_WIN)
+
+#include <memory>
+#include <vector>
+
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/file/http_client.h"
+#include "packager/file/ram_store.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+
+namespace {
+const char kSegmentName[] = "live/segment_1.m4s";
+const int kNumRequests = 5;
+
+// Makes the content of a file published in |chunks|.
+RamStore::Data MakeContent(const std::vector<std::string>& chunks,
+                           bool complete) {
+  std::shared_ptr<RamStore::Content> content =
+      std::make_shared<RamStore::Content>();
+  for (const std::string& chunk : chunks) {
+    content->chunks.push_back(std::make_shared<const std::string>(chunk));
+    content->size += chunk.size();
+  }
+  content->complete = complete;
+  return content;
+}
+
+// Publishes a file after a delay, e.g. the next chunk of a segment while it
+// is being served.
+class DelayedPut : public base::DelegateSimpleThread::Delegate {
+ public:
+  DelayedPut(RamStore* store, const std::string& name, RamStore::Data data)
+      : store_(store), name_(name), data_(data) {}
+
+  void Run() override {
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(100));
+    store_->Put(name_, data_);
+  }
+
+ private:
+  RamStore* const store_;
+  const std::string name_;
+  const RamStore::Data data_;
+};
+}  // namespace
+
+class RamHttpServerTest : public testing::Test {
+ protected:
+  RamHttpServerTest()
+      : store_(RamStore::Options()), server_(&store_, GetServerOptions()) {}
+
+  static RamHttpServer::Options GetServerOptions() {
+    RamHttpServer::Options options;
+    options.idle_timeout_in_seconds = 1;
+    options.max_connections = 2;
+    return options;
+  }
+
+  void SetUp() override { ASSERT_OK(server_.Start("127.0.0.1", 0)); }
+
+  void TearDown() override { server_.Stop(); }
+
+#if !defined(OS_WIN)
+  // Opens a connection to the server without sending any request. The reads
+  // time out after 10 seconds.
+  int Connect() {
+    const int connection = socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT_GE(connection, 0);
+    struct timeval timeout = {};
+    timeout.tv_sec = 10;
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(server_.port());
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    EXPECT_EQ(0, connect(connection,
+                         reinterpret_cast<struct sockaddr*>(&address),
+                         sizeof(address)));
+    return connection;
+  }
+#endif  // !defined(OS_WIN)
+
+  std::string GetUrl(const std::string& name) const {
+    return base::StringPrintf("http://127.0.0.1:%d/%s", server_.port(),
+                              name.c_str());
+  }
+
+  RamStore store_;
+  RamHttpServer server_;
+};
+
+TEST_F(RamHttpServerTest, ServesFiles) {
+  const std::string kSegment(100000, 's');
+  store_.Put(kSegmentName, RamStore::MakeData(kSegment));
+
+  HttpClient* http_client = HttpClient::GetInstance();
+  const HttpClient::Statistics initial_statistics =
+      http_client->GetStatistics();
+
+  HttpClient::Request request;
+  request.url = GetUrl(kSegmentName);
+  for (int i = 0; i < kNumRequests; ++i) {
+    std::string response;
+    ASSERT_OK(http_client->Send(request, &response));
+    EXPECT_EQ(kSegment, response);
+  }
+
+  // The connection is kept alive.
+  const HttpClient::Statistics statistics = http_client->GetStatistics();
+  EXPECT_GE(initial_statistics.num_new_connections + 1,
+            statistics.num_new_connections);
+}
+
+TEST_F(RamHttpServerTest, ServesReplacedFiles) {
+  HttpClient::Request request;
+  request.url = GetUrl("live/manifest.mpd") + "?t=1";
+  store_.Put("live/manifest.mpd",
+             RamStore::MakeData("<MPD>1</MPD>"));
+  std::string response;
+  ASSERT_OK(HttpClient::GetInstance()->Send(request, &response));
+  EXPECT_EQ("<MPD>1</MPD>", response);
+
+  store_.Put("live/manifest.mpd",
+             RamStore::MakeData("<MPD>2</MPD>"));
+  response.clear();
+  ASSERT_OK(HttpClient::GetInstance()->Send(request, &response));
+  EXPECT_EQ("<MPD>2</MPD>", response);
+}
+
+TEST_F(RamHttpServerTest, FileNotFound) {
+  HttpClient::Request request;
+  request.url = GetUrl("live/segment_2.m4s");
+  std::string response;
+  EXPECT_EQ(error::HTTP_FAILURE,
+            HttpClient::GetInstance()->Send(request, &response).error_code());
+}
+
+TEST_F(RamHttpServerTest, MethodNotAllowed) {
+  store_.Put(kSegmentName, RamStore::MakeData("segment"));
+  HttpClient::Request request;
+  request.method = HttpClient::Method::kDelete;
+  request.url = GetUrl(kSegmentName);
+  std::string response;
+  EXPECT_EQ(error::HTTP_FAILURE,
+            HttpClient::GetInstance()->Send(request, &response).error_code());
+  EXPECT_TRUE(store_.Get(kSegmentName));
+}
+
+// A segment flushed but not closed yet is sent as it grows until it is
+// complete, not truncated to the data flushed so far.
+TEST_F(RamHttpServerTest, ServesGrowingFiles) {
+  store_.Put(kSegmentName, MakeContent({"seg"}, false));
+  DelayedPut delayed_put(&store_, kSegmentName,
+                         MakeContent({"seg", "ment"}, true));
+  base::DelegateSimpleThread thread(&delayed_put, "DelayedPut");
+  thread.Start();
+
+  HttpClient::Request request;
+  request.url = GetUrl(kSegmentName);
+  std::string response;
+  ASSERT_OK(HttpClient::GetInstance()->Send(request, &response));
+  EXPECT_EQ("segment", response);
+  thread.Join();
+}
+
+// The response is aborted if the segment is not completed.
+TEST_F(RamHttpServerTest, IncompleteFile) {
+  store_.Put(kSegmentName, MakeContent({"seg"}, false));
+
+  HttpClient::Request request;
+  request.url = GetUrl(kSegmentName);
+  std::string response;
+  EXPECT_EQ(error::HTTP_FAILURE,
+            HttpClient::GetInstance()->Send(request, &response).error_code());
+}
+
+#if !defined(OS_WIN)
+TEST_F(RamHttpServerTest, ClosesIdleConnections) {
+  const int connection = Connect();
+  char data[16];
+  // The server closes the connection after the idle timeout, before the
+  // client gives up.
+  EXPECT_EQ(0, recv(connection, data, sizeof(data), 0));
+  close(connection);
+}
+
+TEST_F(RamHttpServerTest, RejectsConnectionsBeyondMaxConnections) {
+  const int connection1 = Connect();
+  const int connection2 = Connect();
+  const int connection3 = Connect();
+
+  // The response is sent and the connection is closed.
+  std::string response;
+  char data[256];
+  ssize_t size;
+  while ((size = recv(connection3, data, sizeof(data), 0)) > 0)
+    response.append(data, size);
+  EXPECT_EQ(0, size);
+  EXPECT_TRUE(base::StartsWith(response, "HTTP/1.1 503 Service Unavailable",
+                               base::CompareCase::SENSITIVE));
+
+  close(connection1);
+  close(connection2);
+  close(connection3);
+}
+#endif  // !defined(OS_WIN)
+
+}  // namespace shaka
@@ -0,0 +1,243 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/ram_store.h"
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "packager/base/logging.h"
+
+DEFINE_uint64(ram_store_max_bytes,
+              0,
+              "Maximum total size of the ram:// output files in bytes. The "
+              "least recently used media segments are evicted beyond it. The "
+              "init segments and manifests are never evicted. No limit if it "
+              "is 0.");
+DEFINE_double(ram_store_max_idle_time_in_seconds,
+              0,
+              "The ram:// media segments neither written nor served for this "
+              "long are evicted. The init segments and manifests are never "
+              "evicted. Set it above the live window, i.e. "
+              "--time_shift_buffer_depth, plus a few segments, so that the "
+              "files listed in the manifests stay available. No time limit if "
+              "it is 0.");
+
+namespace shaka {
+
+namespace {
+// Minimum interval between the scans for idle files.
+const int64_t kIdleEvictionIntervalInMs = 1000;
+}  // namespace
+
+RamStore::RamStore(const Options& options)
+    : options_(options), total_bytes_(0) {}
+
+RamStore::~RamStore() {}
+
+// static
+RamStore* RamStore::GetInstance() {
+  // Intentionally leaked, as the files may be served until exit.
+  static RamStore* const instance = [] {
+    Options options;
+    options.max_bytes = FLAGS_ram_store_max_bytes;
+    options.max_idle_time =
+        base::TimeDelta::FromMicroseconds(static_cast<int64_t>(
+            FLAGS_ram_store_max_idle_time_in_seconds *
+            base::Time::kMicrosecondsPerSecond));
+    return new RamStore(options);
+  }();
+  return instance;
+}
+
+std::string RamStore::Content::ToString() const {
+  std::string data;
+  data.reserve(size);
+  for (const Chunk& chunk : chunks)
+    data += *chunk;
+  return data;
+}
+
+// static
+RamStore::Data RamStore::MakeData(std::string data) {
+  std::shared_ptr<Content> content = std::make_shared<Content>();
+  content->size = data.size();
+  content->complete = true;
+  content->chunks.push_back(
+      std::make_shared<const std::string>(std::move(data)));
+  return content;
+}
+
+void RamStore::Put(const std::string& name, Data data) {
+  DCHECK(data);
+  const base::TimeTicks now = base::TimeTicks::Now();
+  const uint64_t size = data->size;
+  {
+    Stripe* stripe = GetStripe(name);
+    base::AutoLock auto_lock(stripe->lock);
+    Entry& entry = stripe->entries[name];
+    if (entry.data)
+      total_bytes_ -= entry.data->size;
+    entry.data = std::move(data);
+    entry.last_access_time = now;
+    total_bytes_ += size;
+  }
+  Evict(name, now);
+}
+
+RamStore::Data RamStore::Get(const std::string& name) {
+  Stripe* stripe = GetStripe(name);
+  base::AutoLock auto_lock(stripe->lock);
+  auto iter = stripe->entries.find(name);
+  if (iter == stripe->entries.end())
+    return nullptr;
+  iter->second.last_access_time = base::TimeTicks::Now();
+  return iter->second.data;
+}
+
+bool RamStore::Delete(const std::string& name) {
+  Stripe* stripe = GetStripe(name);
+  base::AutoLock auto_lock(stripe->lock);
+  auto iter = stripe->entries.find(name);
+  if (iter == stripe->entries.end())
+    return false;
+  total_bytes_ -= iter->second.data->size;
+  stripe->entries.erase(iter);
+  return true;
+}
+
+void RamStore::Clear() {
+  for (Stripe& stripe : stripes_) {
+    base::AutoLock auto_lock(stripe.lock);
+    for (const auto& entry : stripe.entries)
+      total_bytes_ -= entry.second.data->size;
+    stripe.entries.clear();
+  }
+}
+
+void RamStore::AddSegmentTemplate(const std::string& segment_template) {
+  std::vector<std::string> literals(1);
+  size_t pos = 0;
+  while (pos < segment_template.size()) {
+    const size_t start = segment_template.find('$', pos);
+    if (start == std::string::npos) {
+      literals.back() += segment_template.substr(pos);
+      break;
+    }
+    literals.back() += segment_template.substr(pos, start - pos);
+    const size_t end = segment_template.find('$', start + 1);
+    if (end == std::string::npos) {
+      // Not a valid template identifier, taken literally.
+      literals.back() += segment_template.substr(start);
+      break;
+    }
+    if (end == start + 1)
+      literals.back() += '$';  // "$$" is an escaped '$'.
+    else
+      literals.emplace_back();
+    pos = end + 1;
+  }
+
+  base::AutoLock auto_lock(eviction_lock_);
+  segment_templates_.push_back(literals);
+}
+
+bool RamStore::IsMediaSegment(const std::string& name) const {
+  for (const std::vector<std::string>& literals : segment_templates_) {
+    // The literals must appear in order, the first one at the start and the
+    // last one at the end of |name|.
+    const std::string& first = literals.front();
+    const std::string& last = literals.back();
+    if (name.size() < first.size() + (literals.size() > 1 ? last.size() : 0) ||
+        name.compare(0, first.size(), first) != 0) {
+      continue;
+    }
+    if (literals.size() == 1) {
+      if (name.size() == first.size())
+        return true;
+      continue;
+    }
+    if (name.compare(name.size() - last.size(), last.size(), last) != 0)
+      continue;
+    size_t pos = first.size();
+    const size_t end = name.size() - last.size();
+    bool matches = true;
+    for (size_t i = 1; i + 1 < literals.size() && matches; ++i) {
+      pos = name.find(literals[i], pos);
+      matches = pos != std::string::npos && pos + literals[i].size() <= end;
+      pos += literals[i].size();
+    }
+    if (matches)
+      return true;
+  }
+  return false;
+}
+
+RamStore::Stripe* RamStore::GetStripe(const std::string& name) {
+  return &stripes_[std::hash<std::string>()(name) % kNumStripes];
+}
+
+void RamStore::Evict(const std::string& new_name, base::TimeTicks now) {
+  const bool over_max_bytes =
+      options_.max_bytes > 0 && total_bytes_ > options_.max_bytes;
+  const bool has_max_idle_time = options_.max_idle_time > base::TimeDelta();
+  if (!over_max_bytes && !has_max_idle_time)
+    return;
+
+  base::AutoLock eviction_auto_lock(eviction_lock_);
+  const base::TimeDelta idle_eviction_interval =
+      std::min(options_.max_idle_time,
+               base::TimeDelta::FromMilliseconds(kIdleEvictionIntervalInMs));
+  const bool check_idle_files =
+      has_max_idle_time &&
+      now - last_idle_eviction_time_ >= idle_eviction_interval;
+  if (!over_max_bytes && !check_idle_files)
+    return;
+  if (check_idle_files)
+    last_idle_eviction_time_ = now;
+
+  // The media segments from the least recently used. The scan holds one
+  // stripe lock at a time, so the accesses to the other stripes go on.
+  std::vector<std::pair<base::TimeTicks, std::string>> files;
+  for (Stripe& stripe : stripes_) {
+    base::AutoLock auto_lock(stripe.lock);
+    for (const auto& entry : stripe.entries) {
+      if (IsMediaSegment(entry.first))
+        files.emplace_back(entry.second.last_access_time, entry.first);
+    }
+  }
+  std::sort(files.begin(), files.end());
+
+  for (const auto& file : files) {
+    const bool idle =
+        check_idle_files && now - file.first > options_.max_idle_time;
+    const bool over_limit =
+        options_.max_bytes > 0 && total_bytes_ > options_.max_bytes;
+    if (!idle && !over_limit)
+      break;
+    // The file just written is kept even if it is larger than the limit.
+    if (file.second == new_name)
+      continue;
+
+    Stripe* stripe = GetStripe(file.second);
+    base::AutoLock auto_lock(stripe->lock);
+    auto iter = stripe->entries.find(file.second);
+    // Skips the files accessed since the scan.
+    if (iter == stripe->entries.end() ||
+        iter->second.last_access_time != file.first) {
+      continue;
+    }
+    VLOG(1) << "Evicting " << file.second << " from RamStore.";
+    total_bytes_ -= iter->second.data->size;
+    stripe->entries.erase(iter);
+  }
+}
+
+}  // namespace shaka
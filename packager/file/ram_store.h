@@ -0,0 +1,141 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_RAM_STORE_H_
+#define PACKAGER_FILE_RAM_STORE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+/// An in-memory store of output files, e.g. the segments and manifests of a
+/// live presentation served by RamHttpServer. The files are immutable
+/// snapshots, so readers hold on to them without copying or locking while
+/// they are replaced. The store is bounded by bytes, evicting the least
+/// recently used media segments, and can evict the media segments not used
+/// within a time window, e.g. the live window. Only the files matching a
+/// segment template added with AddSegmentTemplate() are media segments; the
+/// other files, e.g. init segments and manifests, are never evicted, as new
+/// clients need them however long they have not been read. The files are
+/// spread over lock stripes, so that concurrent accesses to different files
+/// rarely contend. This class is thread safe.
+class RamStore {
+ public:
+  struct Options {
+    /// Maximum total size of the files in bytes. No limit if it is 0.
+    uint64_t max_bytes = 0;
+    /// Media segments neither written nor read for this long are evicted. No
+    /// time limit if it is zero.
+    base::TimeDelta max_idle_time;
+  };
+
+  /// An immutable chunk of a file.
+  typedef std::shared_ptr<const std::string> Chunk;
+
+  /// The content of a file, as a sequence of immutable chunks. A file growing
+  /// while it is written, e.g. a low latency segment flushed after every
+  /// chunk, is published again without copying the chunks published before.
+  struct Content {
+    /// @return the whole content in a single string.
+    std::string ToString() const;
+
+    std::vector<Chunk> chunks;
+    /// Total size of the chunks in bytes.
+    uint64_t size = 0;
+    /// Whether the file is complete, i.e. it is not being written any more.
+    /// A file published by a flush while it is written is not complete.
+    bool complete = false;
+  };
+
+  typedef std::shared_ptr<const Content> Data;
+
+  explicit RamStore(const Options& options);
+  ~RamStore();
+
+  /// @return the process-wide store of the "ram://" files, configured with
+  ///         --ram_store_max_bytes and --ram_store_max_idle_time_in_seconds.
+  static RamStore* GetInstance();
+
+  /// @param data is the content of a file.
+  /// @return the content of a complete file in a single chunk.
+  static Data MakeData(std::string data);
+
+  /// Add or replace a file.
+  /// @param name is the name of the file.
+  /// @param data is the content of the file.
+  void Put(const std::string& name, Data data);
+
+  /// @param name is the name of the file.
+  /// @return the content of the file, or null if the file does not exist.
+  Data Get(const std::string& name);
+
+  /// Delete a file.
+  /// @param name is the name of the file.
+  /// @return true if the file existed.
+  bool Delete(const std::string& name);
+
+  /// Delete all the files.
+  void Clear();
+
+  /// Makes the files generated from a segment template, i.e. the media
+  /// segments, evictable.
+  /// @param segment_template is a segment template, e.g.
+  ///        "live/video_$Number$.m4s". Each template identifier matches any
+  ///        text.
+  void AddSegmentTemplate(const std::string& segment_template);
+
+  /// @return the total size of the files in bytes.
+  uint64_t total_bytes() const { return total_bytes_; }
+
+ private:
+  RamStore(const RamStore&) = delete;
+  RamStore& operator=(const RamStore&) = delete;
+
+  struct Entry {
+    Data data;
+    // Time of the last write or read.
+    base::TimeTicks last_access_time;
+  };
+
+  struct Stripe {
+    base::Lock lock;
+    std::map<std::string, Entry> entries;
+  };
+
+  static const size_t kNumStripes = 16;
+
+  Stripe* GetStripe(const std::string& name);
+  // Returns true if |name| matches one of |segment_templates_|. Must be called
+  // with |eviction_lock_| held.
+  bool IsMediaSegment(const std::string& name) const;
+  // Evicts media segments until the store is within the limits, except |new_name|,
+  // which has just been written.
+  void Evict(const std::string& new_name, base::TimeTicks now);
+
+  const Options options_;
+  Stripe stripes_[kNumStripes];
+  std::atomic<uint64_t> total_bytes_;
+
+  // Serializes the evictions.
+  base::Lock eviction_lock_;
+  base::TimeTicks last_idle_eviction_time_;
+  // The literal parts of the segment templates, which are separated by the
+  // template identifiers.
+  std::vector<std::vector<std::string>> segment_templates_;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_RAM_STORE_H_
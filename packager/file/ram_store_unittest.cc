@@ -0,0 +1,252 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/ram_store.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+#include "packager/base/threading/platform_thread.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+
+namespace {
+const char kSegment[] = "segment";
+const char kSegmentFileName[] = "ram://live/segment_1.m4s";
+const char kSegmentName[] = "live/segment_1.m4s";
+const char kSegmentTemplate[] = "live/segment_$Number$.m4s";
+
+// Makes sure the following accesses have later times.
+void WaitForClockTick() {
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(2));
+}
+}  // namespace
+
+TEST(RamStoreTest, PutGetDelete) {
+  RamStore store((RamStore::Options()));
+  EXPECT_FALSE(store.Get("a"));
+
+  store.Put("a", RamStore::MakeData("1234"));
+  RamStore::Data data = store.Get("a");
+  ASSERT_TRUE(data);
+  EXPECT_EQ("1234", data->ToString());
+  EXPECT_EQ(4u, store.total_bytes());
+
+  // The readers keep their snapshot when the file is replaced.
+  store.Put("a", RamStore::MakeData("56"));
+  EXPECT_EQ("1234", data->ToString());
+  EXPECT_EQ("56", store.Get("a")->ToString());
+  EXPECT_EQ(2u, store.total_bytes());
+
+  EXPECT_TRUE(store.Delete("a"));
+  EXPECT_FALSE(store.Delete("a"));
+  EXPECT_FALSE(store.Get("a"));
+  EXPECT_EQ(0u, store.total_bytes());
+}
+
+TEST(RamStoreTest, EvictsLeastRecentlyUsedOverMaxBytes) {
+  RamStore::Options options;
+  options.max_bytes = 10;
+  RamStore store(options);
+  store.AddSegmentTemplate(kSegmentTemplate);
+
+  store.Put("live/segment_1.m4s", RamStore::MakeData("1234"));
+  WaitForClockTick();
+  store.Put("live/segment_2.m4s", RamStore::MakeData("1234"));
+  WaitForClockTick();
+  ASSERT_TRUE(store.Get("live/segment_1.m4s"));
+  WaitForClockTick();
+  store.Put("live/segment_3.m4s", RamStore::MakeData("1234"));
+
+  EXPECT_TRUE(store.Get("live/segment_1.m4s"));
+  EXPECT_FALSE(store.Get("live/segment_2.m4s"));
+  EXPECT_TRUE(store.Get("live/segment_3.m4s"));
+  EXPECT_EQ(8u, store.total_bytes());
+}
+
+TEST(RamStoreTest, KeepsNewFileLargerThanMaxBytes) {
+  RamStore::Options options;
+  options.max_bytes = 2;
+  RamStore store(options);
+  store.AddSegmentTemplate(kSegmentTemplate);
+
+  store.Put("live/segment_1.m4s", RamStore::MakeData("1"));
+  store.Put("live/segment_2.m4s", RamStore::MakeData("1234"));
+  EXPECT_FALSE(store.Get("live/segment_1.m4s"));
+  EXPECT_TRUE(store.Get("live/segment_2.m4s"));
+}
+
+TEST(RamStoreTest, EvictsIdleFiles) {
+  RamStore::Options options;
+  options.max_idle_time = base::TimeDelta::FromMilliseconds(50);
+  RamStore store(options);
+  store.AddSegmentTemplate(kSegmentTemplate);
+
+  store.Put("live/segment_1.m4s", RamStore::MakeData("1234"));
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(100));
+  store.Put("live/segment_2.m4s", RamStore::MakeData("1234"));
+
+  EXPECT_FALSE(store.Get("live/segment_1.m4s"));
+  EXPECT_TRUE(store.Get("live/segment_2.m4s"));
+}
+
+// An init segment is written once and only read by new clients, so it is the
+// least recently used and idle file, but it must stay available. So must the
+// manifests.
+TEST(RamStoreTest, KeepsOldUnreadInitSegments) {
+  RamStore::Options options;
+  options.max_bytes = 10;
+  options.max_idle_time = base::TimeDelta::FromMilliseconds(50);
+  RamStore store(options);
+  store.AddSegmentTemplate(kSegmentTemplate);
+
+  store.Put("live/init.mp4", RamStore::MakeData("init"));
+  store.Put("live/manifest.mpd", RamStore::MakeData("mpd"));
+  base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(100));
+  store.Put("live/segment_1.m4s", RamStore::MakeData("1234"));
+  WaitForClockTick();
+  store.Put("live/segment_2.m4s", RamStore::MakeData("1234"));
+
+  EXPECT_TRUE(store.Get("live/init.mp4"));
+  EXPECT_TRUE(store.Get("live/manifest.mpd"));
+  EXPECT_FALSE(store.Get("live/segment_1.m4s"));
+  EXPECT_TRUE(store.Get("live/segment_2.m4s"));
+}
+
+TEST(RamStoreTest, MatchesSegmentTemplates) {
+  RamStore::Options options;
+  options.max_bytes = 1;
+  RamStore store(options);
+  store.AddSegmentTemplate("live/$RepresentationID$/$Number%05d$.m4s");
+  store.AddSegmentTemplate("live/text_$Time$$$.vtt");
+
+  const char* const kMediaSegments[] = {
+      "live/video/00001.m4s",
+      "live/text_1000$.vtt",
+  };
+  const char* const kOtherFiles[] = {
+      "live/video/init.mp4",
+      "live/00001.m4s",
+      "live/text_1000.vtt",
+      "other/video/00001.m4s",
+  };
+  for (const char* name : kOtherFiles)
+    store.Put(name, RamStore::MakeData("1234"));
+  for (const char* name : kMediaSegments)
+    store.Put(name, RamStore::MakeData("1234"));
+  store.Put("live/video/00002.m4s", RamStore::MakeData("1234"));
+
+  for (const char* name : kMediaSegments)
+    EXPECT_FALSE(store.Get(name)) << name;
+  for (const char* name : kOtherFiles)
+    EXPECT_TRUE(store.Get(name)) << name;
+}
+
+class RamFileTest : public testing::Test {
+ protected:
+  void TearDown() override { RamStore::GetInstance()->Clear(); }
+};
+
+TEST_F(RamFileTest, PublishesOnClose) {
+  std::unique_ptr<File, FileCloser> writer(File::Open(kSegmentFileName, "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(3, writer->Write(kSegment, 3));
+  // Partially written files are not visible.
+  EXPECT_FALSE(RamStore::GetInstance()->Get(kSegmentName));
+  ASSERT_EQ(4, writer->Write(kSegment + 3, 4));
+  ASSERT_TRUE(writer.release()->Close());
+
+  RamStore::Data data = RamStore::GetInstance()->Get(kSegmentName);
+  ASSERT_TRUE(data);
+  EXPECT_EQ(kSegment, data->ToString());
+  EXPECT_TRUE(data->complete);
+
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString(kSegmentFileName, &contents));
+  EXPECT_EQ(kSegment, contents);
+}
+
+TEST_F(RamFileTest, FlushPublishes) {
+  std::unique_ptr<File, FileCloser> writer(File::Open(kSegmentFileName, "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(3, writer->Write(kSegment, 3));
+  ASSERT_TRUE(writer->Flush());
+  RamStore::Data data = RamStore::GetInstance()->Get(kSegmentName);
+  ASSERT_TRUE(data);
+  EXPECT_EQ("seg", data->ToString());
+  EXPECT_FALSE(data->complete);
+
+  // The chunks published before are shared, not copied.
+  ASSERT_EQ(4, writer->Write(kSegment + 3, 4));
+  ASSERT_TRUE(writer->Flush());
+  RamStore::Data flushed_data = RamStore::GetInstance()->Get(kSegmentName);
+  ASSERT_TRUE(flushed_data);
+  EXPECT_EQ(kSegment, flushed_data->ToString());
+  ASSERT_EQ(2u, flushed_data->chunks.size());
+  EXPECT_EQ(data->chunks[0], flushed_data->chunks[0]);
+  ASSERT_TRUE(writer.release()->Close());
+
+  EXPECT_TRUE(RamStore::GetInstance()->Get(kSegmentName)->complete);
+
+  // The chunks are read as a whole.
+  std::string contents;
+  ASSERT_TRUE(File::ReadFileToString(kSegmentFileName, &contents));
+  EXPECT_EQ(kSegment, contents);
+}
+
+TEST_F(RamFileTest, OverwriteFlushedData) {
+  std::unique_ptr<File, FileCloser> writer(File::Open(kSegmentFileName, "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(3, writer->Write(kSegment, 3));
+  ASSERT_TRUE(writer->Flush());
+  ASSERT_EQ(4, writer->Write(kSegment + 3, 4));
+  ASSERT_TRUE(writer->Seek(1));
+  ASSERT_EQ(4, writer->Write("EGME", 4));
+  EXPECT_EQ(7, writer->Size());
+  ASSERT_TRUE(writer.release()->Close());
+
+  EXPECT_EQ("sEGMEnt",
+            RamStore::GetInstance()->Get(kSegmentName)->ToString());
+}
+
+TEST_F(RamFileTest, Append) {
+  ASSERT_TRUE(File::WriteFileAtomically(kSegmentFileName, "seg"));
+  std::unique_ptr<File, FileCloser> writer(File::Open(kSegmentFileName, "a"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(4, writer->Write(kSegment + 3, 4));
+  ASSERT_TRUE(writer.release()->Close());
+
+  EXPECT_EQ(kSegment, RamStore::GetInstance()->Get(kSegmentName)->ToString());
+}
+
+TEST_F(RamFileTest, SeekAndOverwrite) {
+  std::unique_ptr<File, FileCloser> writer(File::Open(kSegmentFileName, "w"));
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(7, writer->Write(kSegment, 7));
+  ASSERT_TRUE(writer->Seek(1));
+  ASSERT_EQ(2, writer->Write("EG", 2));
+  uint64_t position = 0;
+  ASSERT_TRUE(writer->Tell(&position));
+  EXPECT_EQ(3u, position);
+  EXPECT_EQ(7, writer->Size());
+  ASSERT_TRUE(writer.release()->Close());
+
+  EXPECT_EQ("sEGment", RamStore::GetInstance()->Get(kSegmentName)->ToString());
+}
+
+TEST_F(RamFileTest, WriteFileAtomicallyAndDelete) {
+  ASSERT_TRUE(File::WriteFileAtomically(kSegmentFileName, kSegment));
+  EXPECT_EQ(kSegment, RamStore::GetInstance()->Get(kSegmentName)->ToString());
+
+  ASSERT_TRUE(File::Delete(kSegmentFileName));
+  EXPECT_FALSE(RamStore::GetInstance()->Get(kSegmentName));
+  EXPECT_FALSE(File::Open(kSegmentFileName, "r"));
+}
+
+}  // namespace shaka
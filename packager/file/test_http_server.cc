@@ -0,0 +1,264 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/test_http_server.h"
+
+#if !defined(OS_WIN)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/strings/string_split.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/threading/simple_thread.h"
+
+namespace shaka {
+
+class ClosureThread : public base::SimpleThread {
+ public:
+  ClosureThread(const std::string& name_prefix, const base::Closure& task)
+      : base::SimpleThread(name_prefix), task_(task) {}
+
+  ~ClosureThread() {
+    if (HasBeenStarted() && !HasBeenJoined())
+      Join();
+  }
+
+  void Run() override { task_.Run(); }
+
+ private:
+  const base::Closure task_;
+};
+
+namespace {
+
+// Reads more data from |connection| into |buffer|.
+bool ReadMore(int connection, std::string* buffer) {
+  char data[4096];
+  const ssize_t size = recv(connection, data, sizeof(data), 0);
+  if (size <= 0)
+    return false;
+  buffer->append(data, size);
+  return true;
+}
+
+// Reads a line terminated by CRLF from |buffer|, reading more data from
+// |connection| as needed.
+bool ReadLine(int connection, std::string* buffer, std::string* line) {
+  size_t pos;
+  while ((pos = buffer->find("\r\n")) == std::string::npos) {
+    if (!ReadMore(connection, buffer))
+      return false;
+  }
+  line->assign(*buffer, 0, pos);
+  buffer->erase(0, pos + 2);
+  return true;
+}
+
+bool ReadBytes(int connection,
+               size_t size,
+               std::string* buffer,
+               std::string* data) {
+  while (buffer->size() < size) {
+    if (!ReadMore(connection, buffer))
+      return false;
+  }
+  data->append(*buffer, 0, size);
+  buffer->erase(0, size);
+  return true;
+}
+
+}  // namespace
+
+TestHttpServer::TestHttpServer() = default;
+
+TestHttpServer::~TestHttpServer() {
+  Stop();
+}
+
+bool TestHttpServer::Start() {
+  listen_socket_ = socket(AF_INET, SOCK_STREAM, 0);
+  if (listen_socket_ < 0)
+    return false;
+  struct sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t address_size = sizeof(address);
+  struct sockaddr* socket_address =
+      reinterpret_cast<struct sockaddr*>(&address);
+  if (bind(listen_socket_, socket_address, address_size) < 0 ||
+      listen(listen_socket_, 16) < 0 ||
+      getsockname(listen_socket_, socket_address, &address_size) < 0) {
+    return false;
+  }
+  port_ = ntohs(address.sin_port);
+  accept_thread_.reset(new ClosureThread(
+      "AcceptThread",
+      base::Bind(&TestHttpServer::AcceptConnections, base::Unretained(this))));
+  accept_thread_->Start();
+  return true;
+}
+
+void TestHttpServer::Stop() {
+  if (listen_socket_ < 0)
+    return;
+  shutdown(listen_socket_, SHUT_RDWR);
+  accept_thread_.reset();
+  close(listen_socket_);
+  listen_socket_ = -1;
+  // The accept thread has exited, so the connections do not change.
+  for (int connection : connections_)
+    shutdown(connection, SHUT_RDWR);
+  connection_threads_.clear();
+  for (int connection : connections_)
+    close(connection);
+  connections_.clear();
+}
+
+std::string TestHttpServer::GetUrl(const std::string& path) const {
+  return base::StringPrintf("http://127.0.0.1:%d%s", port_, path.c_str());
+}
+
+bool TestHttpServer::GetBody(const std::string& path, std::string* body) {
+  base::AutoLock auto_lock(lock_);
+  auto iter = bodies_.find(path);
+  if (iter == bodies_.end())
+    return false;
+  *body = iter->second;
+  return true;
+}
+
+void TestHttpServer::SetBody(const std::string& path,
+                             const std::string& body) {
+  base::AutoLock auto_lock(lock_);
+  bodies_[path] = body;
+}
+
+void TestHttpServer::FailNextRequests(int num_failures) {
+  base::AutoLock auto_lock(lock_);
+  num_failures_ = num_failures;
+}
+
+int TestHttpServer::num_chunked_requests() {
+  base::AutoLock auto_lock(lock_);
+  return num_chunked_requests_;
+}
+
+int TestHttpServer::num_connections() {
+  base::AutoLock auto_lock(lock_);
+  return static_cast<int>(connections_.size());
+}
+
+void TestHttpServer::AcceptConnections() {
+  while (true) {
+    const int connection = accept(listen_socket_, nullptr, nullptr);
+    if (connection < 0)
+      return;
+    base::AutoLock auto_lock(lock_);
+    connections_.push_back(connection);
+    connection_threads_.emplace_back(new ClosureThread(
+        "ConnectionThread", base::Bind(&TestHttpServer::ServeConnection,
+                                       base::Unretained(this), connection)));
+    connection_threads_.back()->Start();
+  }
+}
+
+void TestHttpServer::ServeConnection(int connection) {
+  std::string buffer;
+  while (ServeRequest(connection, &buffer)) {
+  }
+}
+
+bool TestHttpServer::ServeRequest(int connection, std::string* buffer) {
+  std::string request_line;
+  if (!ReadLine(connection, buffer, &request_line))
+    return false;
+  std::vector<std::string> tokens =
+      base::SplitString(request_line, " ", base::TRIM_WHITESPACE,
+                        base::SPLIT_WANT_NONEMPTY);
+  if (tokens.size() != 3)
+    return false;
+  const std::string& method = tokens[0];
+  const std::string& path = tokens[1];
+
+  size_t content_length = 0;
+  bool chunked = false;
+  std::string header;
+  while (ReadLine(connection, buffer, &header) && !header.empty()) {
+    const std::string lower_case_header = base::ToLowerASCII(header);
+    if (base::StartsWith(lower_case_header, "content-length:",
+                         base::CompareCase::SENSITIVE)) {
+      base::StringToSizeT(
+          base::TrimWhitespaceASCII(header.substr(15), base::TRIM_ALL),
+          &content_length);
+    } else if (lower_case_header == "transfer-encoding: chunked") {
+      chunked = true;
+    }
+  }
+
+  std::string body;
+  if (chunked) {
+    while (true) {
+      std::string chunk_size_line;
+      if (!ReadLine(connection, buffer, &chunk_size_line))
+        return false;
+      const size_t chunk_size = strtoul(chunk_size_line.c_str(), nullptr, 16);
+      std::string chunk_end;
+      if (chunk_size == 0)
+        break;
+      if (!ReadBytes(connection, chunk_size, buffer, &body) ||
+          !ReadLine(connection, buffer, &chunk_end)) {
+        return false;
+      }
+    }
+    // Trailer, which is empty.
+    std::string trailer;
+    if (!ReadLine(connection, buffer, &trailer))
+      return false;
+  } else if (!ReadBytes(connection, content_length, buffer, &body)) {
+    return false;
+  }
+
+  std::string status = "200 OK";
+  std::string response_body;
+  {
+    base::AutoLock auto_lock(lock_);
+    if (num_failures_ > 0) {
+      --num_failures_;
+      status = "500 Internal Server Error";
+    } else if (method == "PUT" || method == "POST") {
+      bodies_[path] = body;
+      if (chunked)
+        ++num_chunked_requests_;
+    } else if (method == "GET") {
+      auto iter = bodies_.find(path);
+      if (iter == bodies_.end())
+        status = "404 Not Found";
+      else
+        response_body = iter->second;
+    } else if (method == "DELETE") {
+      if (bodies_.erase(path) == 0)
+        status = "404 Not Found";
+    } else {
+      status = "405 Method Not Allowed";
+    }
+  }
+  const std::string response =
+      base::StringPrintf("HTTP/1.1 %s\r\nContent-Length: %zu\r\n\r\n",
+                         status.c_str(), response_body.size()) +
+      response_body;
+  return send(connection, response.data(), response.size(), 0) ==
+         static_cast<ssize_t>(response.size());
+}
+
+}  // namespace shaka
+
+#endif  // !defined(OS_WIN)
@@ -0,0 +1,76 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_FILE_TEST_HTTP_SERVER_H_
+#define PACKAGER_FILE_TEST_HTTP_SERVER_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+
+namespace shaka {
+
+class ClosureThread;
+
+/// A minimal HTTP/1.1 server on the loopback interface standing in for an
+/// origin in tests. It keeps the bodies of the PUT and POST requests by path,
+/// returns them on GET requests and removes them on DELETE requests. Each
+/// connection is served by its own thread and kept open for further requests.
+/// Only available on POSIX.
+class TestHttpServer {
+ public:
+  TestHttpServer();
+  ~TestHttpServer();
+
+  /// Starts listening on a free port.
+  /// @return true on success, false otherwise.
+  bool Start();
+  /// Stops the server and closes all the connections.
+  void Stop();
+
+  /// @return The URL of @a path on this server.
+  std::string GetUrl(const std::string& path) const;
+
+  /// Gets the body stored for @a path.
+  /// @return true if there is a body for @a path, false otherwise.
+  bool GetBody(const std::string& path, std::string* body);
+  /// Stores @a body for @a path.
+  void SetBody(const std::string& path, const std::string& body);
+
+  /// Fails the next @a num_failures requests with "500 Internal Server Error".
+  void FailNextRequests(int num_failures);
+
+  /// @return The number of requests with a chunked body.
+  int num_chunked_requests();
+  /// @return The number of connections accepted.
+  int num_connections();
+
+ private:
+  TestHttpServer(const TestHttpServer&) = delete;
+  TestHttpServer& operator=(const TestHttpServer&) = delete;
+
+  void AcceptConnections();
+  void ServeConnection(int connection);
+  bool ServeRequest(int connection, std::string* buffer);
+
+  int listen_socket_ = -1;
+  int port_ = 0;
+  std::unique_ptr<ClosureThread> accept_thread_;
+
+  base::Lock lock_;
+  std::vector<int> connections_;
+  std::vector<std::unique_ptr<ClosureThread>> connection_threads_;
+  std::map<std::string, std::string> bodies_;
+  int num_failures_ = 0;
+  int num_chunked_requests_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_FILE_TEST_HTTP_SERVER_H_
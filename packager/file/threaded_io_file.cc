@@ -9,6 +9,7 @@
 #include "packager/base/bind.h"
 #include "packager/base/bind_helpers.h"
 #include "packager/base/location.h"
+#include "packager/base/logging.h"
 #include "packager/base/threading/worker_pool.h"
 
 namespace shaka {
@@ -16,10 +17,12 @@ namespace shaka {
 ThreadedIoFile::ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
                                Mode mode,
                                uint64_t io_cache_size,
-                               uint64_t io_block_size)
+                               uint64_t io_block_size,
+                               bool open_in_background)
     : File(internal_file->file_name()),
       internal_file_(std::move(internal_file)),
       mode_(mode),
+      open_in_background_(open_in_background),
       cache_(io_cache_size),
       io_buffer_(io_block_size),
       position_(0),
@@ -32,6 +35,7 @@ ThreadedIoFile::ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
       task_exit_event_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
                        base::WaitableEvent::InitialState::NOT_SIGNALED) {
   DCHECK(internal_file_);
+  DCHECK(!open_in_background_ || mode_ == kOutputMode);
 }
 
 ThreadedIoFile::~ThreadedIoFile() {}
@@ -39,11 +43,16 @@ ThreadedIoFile::~ThreadedIoFile() {}
 bool ThreadedIoFile::Open() {
   DCHECK(internal_file_);
 
-  if (!internal_file_->Open())
-    return false;
-
   position_ = 0;
-  size_ = internal_file_->Size();
+  if (open_in_background_) {
+    // The file is opened by the task. It is expected to be empty, i.e. opened
+    // in "w" mode.
+    size_ = 0;
+  } else {
+    if (!internal_file_->Open())
+      return false;
+    size_ = internal_file_->Size();
+  }
 
   base::WorkerPool::PostTask(
       FROM_HERE,
@@ -114,6 +123,9 @@ bool ThreadedIoFile::Flush() {
   flushing_ = true;
   cache_.Close();
   flush_complete_event_.Wait();
+  // The file may have failed to open or write in the meantime.
+  if (internal_file_error_.load(std::memory_order_relaxed))
+    return false;
   return internal_file_->Flush();
 }
 
@@ -187,8 +199,24 @@ void ThreadedIoFile::RunInOutputMode() {
   DCHECK(internal_file_);
   DCHECK_EQ(kOutputMode, mode_);
 
+  if (open_in_background_ && !internal_file_->Open()) {
+    LOG(ERROR) << "Failed to open " << file_name();
+    internal_file_error_.store(-1, std::memory_order_relaxed);
+  }
+
   while (true) {
-    uint64_t write_bytes = cache_.Read(&io_buffer_[0], io_buffer_.size());
+    // Combines the data into blocks of |io_buffer_| size, which saves round
+    // trips on network filesystems. A partial block is written when flushing
+    // or closing, which closes the cache.
+    uint64_t write_bytes = 0;
+    while (write_bytes < io_buffer_.size()) {
+      const uint64_t read_bytes = cache_.Read(&io_buffer_[write_bytes],
+                                              io_buffer_.size() - write_bytes);
+      if (read_bytes == 0)
+        break;
+      write_bytes += read_bytes;
+    }
+
     if (write_bytes == 0) {
       if (flushing_) {
         cache_.Reopen();
@@ -197,19 +225,16 @@ void ThreadedIoFile::RunInOutputMode() {
       } else {
         return;
       }
-    } else {
+    } else if (!internal_file_error_.load(std::memory_order_relaxed)) {
       uint64_t bytes_written(0);
       while (bytes_written < write_bytes) {
         int64_t write_result = internal_file_->Write(
             &io_buffer_[bytes_written], write_bytes - bytes_written);
         if (write_result < 0) {
+          // The following data is discarded, but the flushes are still
+          // completed, so the writer never waits on a failed file.
           internal_file_error_.store(write_result, std::memory_order_relaxed);
-          cache_.Close();
-          if (flushing_) {
-            flushing_ = false;
-            flush_complete_event_.Signal();
-          }
-          return;
+          break;
         }
         bytes_written += write_result;
       }
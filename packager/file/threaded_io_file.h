@@ -21,10 +21,21 @@ class ThreadedIoFile : public File {
  public:
   enum Mode { kInputMode, kOutputMode };
 
+  /// @param internal_file is the file to read from or write to.
+  /// @param mode specifies if the file is read or written.
+  /// @param io_cache_size is the size of the cache.
+  /// @param io_block_size is the size of the blocks read from or written to
+  ///        @a internal_file. In output mode, the writes are combined into
+  ///        blocks of this size, except when flushing.
+  /// @param open_in_background makes Open() return without waiting for
+  ///        @a internal_file to be opened, which is useful on filesystems with
+  ///        high latency. An open failure is then reported by the following
+  ///        calls. Only supported in output mode.
   ThreadedIoFile(std::unique_ptr<File, FileCloser> internal_file,
                  Mode mode,
                  uint64_t io_cache_size,
-                 uint64_t io_block_size);
+                 uint64_t io_block_size,
+                 bool open_in_background);
 
   /// @name File implementation overrides.
   /// @{
@@ -51,6 +62,7 @@ class ThreadedIoFile : public File {
 
   std::unique_ptr<File, FileCloser> internal_file_;
   const Mode mode_;
+  const bool open_in_background_;
   IoCache cache_;
   std::vector<uint8_t> io_buffer_;
   uint64_t position_;
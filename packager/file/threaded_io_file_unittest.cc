@@ -0,0 +1,212 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/file/threaded_io_file.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+
+#include "packager/base/logging.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/base/time/time.h"
+
+namespace shaka {
+
+namespace {
+const char kFileName[] = "slow_file";
+const uint64_t kIoCacheSize = 1 << 20;
+const uint64_t kIoBlockSize = 1024;
+// Size of a transport stream packet, a typical small write.
+const size_t kWriteSize = 188;
+
+struct FileStatistics {
+  int num_opens = 0;
+  int num_writes = 0;
+  int num_flushes = 0;
+  std::string data;
+};
+
+// A file simulating a high-latency filesystem, e.g. NFS, where every operation
+// takes a round trip to the server.
+class SlowFile : public File {
+ public:
+  SlowFile(base::TimeDelta latency, bool can_open, FileStatistics* statistics)
+      : File(kFileName),
+        latency_(latency),
+        can_open_(can_open),
+        statistics_(statistics) {}
+
+  bool Close() override {
+    Wait();
+    delete this;
+    return true;
+  }
+  int64_t Read(void* buffer, uint64_t length) override { return -1; }
+  int64_t Write(const void* buffer, uint64_t length) override {
+    Wait();
+    ++statistics_->num_writes;
+    statistics_->data.append(static_cast<const char*>(buffer), length);
+    return length;
+  }
+  int64_t Size() override { return statistics_->data.size(); }
+  bool Flush() override {
+    Wait();
+    ++statistics_->num_flushes;
+    return true;
+  }
+  bool Seek(uint64_t position) override { return false; }
+  bool Tell(uint64_t* position) override { return false; }
+
+ protected:
+  bool Open() override {
+    Wait();
+    ++statistics_->num_opens;
+    return can_open_;
+  }
+
+ private:
+  void Wait() {
+    if (latency_ > base::TimeDelta())
+      base::PlatformThread::Sleep(latency_);
+  }
+
+  const base::TimeDelta latency_;
+  const bool can_open_;
+  FileStatistics* const statistics_;
+};
+
+// Exposes Open() to the tests.
+class TestThreadedIoFile : public ThreadedIoFile {
+ public:
+  using ThreadedIoFile::ThreadedIoFile;
+  using ThreadedIoFile::Open;
+};
+
+File* OpenSlowFile(base::TimeDelta latency,
+                   bool can_open,
+                   uint64_t io_block_size,
+                   bool open_in_background,
+                   FileStatistics* statistics) {
+  std::unique_ptr<File, FileCloser> internal_file(
+      new SlowFile(latency, can_open, statistics));
+  std::unique_ptr<TestThreadedIoFile, FileCloser> file(new TestThreadedIoFile(
+      std::move(internal_file), ThreadedIoFile::kOutputMode, kIoCacheSize,
+      io_block_size, open_in_background));
+  if (!file->Open())
+    return nullptr;
+  return file.release();
+}
+
+std::string CreateData(size_t size) {
+  std::string data(size, 0);
+  for (size_t i = 0; i < size; ++i)
+    data[i] = static_cast<char>(i % 251);
+  return data;
+}
+
+// Writes |data| to |file| in writes of |kWriteSize| bytes.
+bool WriteInSmallPieces(const std::string& data, File* file) {
+  for (size_t pos = 0; pos < data.size(); pos += kWriteSize) {
+    const size_t size = std::min(kWriteSize, data.size() - pos);
+    if (file->Write(data.data() + pos, size) != static_cast<int64_t>(size))
+      return false;
+  }
+  return true;
+}
+}  // namespace
+
+TEST(ThreadedIoFileTest, CombinesWrites) {
+  const size_t kDataSize = 10 * kIoBlockSize + 100;
+  const std::string data = CreateData(kDataSize);
+
+  FileStatistics statistics;
+  File* file = OpenSlowFile(base::TimeDelta(), true, kIoBlockSize, false,
+                            &statistics);
+  ASSERT_TRUE(file);
+  EXPECT_TRUE(WriteInSmallPieces(data, file));
+  ASSERT_TRUE(file->Close());
+
+  EXPECT_EQ(data, statistics.data);
+  // Full blocks, then the remaining bytes when the file is closed.
+  EXPECT_EQ(11, statistics.num_writes);
+}
+
+TEST(ThreadedIoFileTest, FlushWritesPartialBlock) {
+  FileStatistics statistics;
+  File* file = OpenSlowFile(base::TimeDelta(), true, kIoBlockSize, false,
+                            &statistics);
+  ASSERT_TRUE(file);
+  const std::string data = CreateData(kWriteSize);
+  EXPECT_TRUE(WriteInSmallPieces(data, file));
+  EXPECT_TRUE(file->Flush());
+  EXPECT_EQ(data, statistics.data);
+  EXPECT_EQ(1, statistics.num_writes);
+  ASSERT_TRUE(file->Close());
+}
+
+TEST(ThreadedIoFileTest, OpensInBackground) {
+  FileStatistics statistics;
+  File* file = OpenSlowFile(base::TimeDelta(), true, kIoBlockSize, true,
+                            &statistics);
+  ASSERT_TRUE(file);
+  const std::string data = CreateData(kIoBlockSize * 3);
+  EXPECT_TRUE(WriteInSmallPieces(data, file));
+  ASSERT_TRUE(file->Close());
+
+  EXPECT_EQ(1, statistics.num_opens);
+  EXPECT_EQ(data, statistics.data);
+}
+
+TEST(ThreadedIoFileTest, BackgroundOpenFailure) {
+  FileStatistics statistics;
+  File* file = OpenSlowFile(base::TimeDelta(), false, kIoBlockSize, true,
+                            &statistics);
+  // The failure is reported by the following calls.
+  ASSERT_TRUE(file);
+  WriteInSmallPieces(CreateData(kIoBlockSize * 3), file);
+  EXPECT_FALSE(file->Flush());
+  EXPECT_FALSE(file->Close());
+  EXPECT_EQ(0, statistics.num_writes);
+}
+
+// Writes segments to a simulated high-latency filesystem with different
+// settings. Run with --gtest_also_run_disabled_tests.
+TEST(ThreadedIoFileTest, DISABLED_HighLatencyBenchmark) {
+  const base::TimeDelta kLatency = base::TimeDelta::FromMilliseconds(2);
+  const int kNumSegments = 20;
+  const std::string data = CreateData(500 * 1024);
+
+  struct Settings {
+    uint64_t io_block_size;
+    bool open_in_background;
+  } const kSettings[] = {
+      {4 * 1024, false},
+      {64 * 1024, false},
+      {1024 * 1024, false},
+      {64 * 1024, true},
+  };
+
+  for (const Settings& settings : kSettings) {
+    FileStatistics statistics;
+    const base::TimeTicks start = base::TimeTicks::Now();
+    for (int i = 0; i < kNumSegments; ++i) {
+      File* file = OpenSlowFile(kLatency, true, settings.io_block_size,
+                                settings.open_in_background, &statistics);
+      ASSERT_TRUE(file);
+      ASSERT_TRUE(WriteInSmallPieces(data, file));
+      ASSERT_TRUE(file->Close());
+    }
+    const base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+    LOG(INFO) << "io_block_size " << settings.io_block_size
+              << ", open_in_background " << settings.open_in_background
+              << ": " << elapsed.InMilliseconds() << " ms for " << kNumSegments
+              << " segments, " << statistics.num_writes << " writes.";
+  }
+}
+
+}  // namespace shaka
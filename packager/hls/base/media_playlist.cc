@@ -494,10 +494,12 @@ bool MediaPlaylist::WriteToFile(const std::string& file_path) {
 uint64_t MediaPlaylist::MaxBitrate() const {
   if (media_info_.has_bandwidth())
     return media_info_.bandwidth();
+  base::AutoLock auto_lock(bandwidth_estimator_lock_);
   return bandwidth_estimator_.Max();
 }
 
 uint64_t MediaPlaylist::AvgBitrate() const {
+  base::AutoLock auto_lock(bandwidth_estimator_lock_);
   return bandwidth_estimator_.Estimate();
 }
 
@@ -591,7 +593,10 @@ void MediaPlaylist::AddSegmentInfoEntry(const std::string& segment_file_name,
       static_cast<double>(duration) / time_scale_;
   longest_segment_duration_seconds_ =
       std::max(longest_segment_duration_seconds_, segment_duration_seconds);
-  bandwidth_estimator_.AddBlock(size, segment_duration_seconds);
+  {
+    base::AutoLock auto_lock(bandwidth_estimator_lock_);
+    bandwidth_estimator_.AddBlock(size, segment_duration_seconds);
+  }
   current_buffer_depth_ += segment_duration_seconds;
 
   if (!entries_.empty() &&
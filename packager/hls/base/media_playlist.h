@@ -13,6 +13,7 @@
 #include <vector>
 
 #include "packager/base/macros.h"
+#include "packager/base/synchronization/lock.h"
 #include "packager/hls/public/hls_params.h"
 #include "packager/mpd/base/bandwidth_estimator.h"
 #include "packager/mpd/base/media_info.pb.h"
@@ -163,12 +164,13 @@ class MediaPlaylist {
   virtual bool WriteToFile(const std::string& file_path);
 
   /// If bitrate is specified in MediaInfo then it will use that value.
-  /// Otherwise, returns the max bitrate.
+  /// Otherwise, returns the max bitrate. Unlike the other methods, this can be
+  /// called concurrently with AddSegment().
   /// @return the max bitrate (in bits per second) of this MediaPlaylist.
   virtual uint64_t MaxBitrate() const;
 
   /// Unlike @a MaxBitrate, AvgBitrate is always computed from the segment size
-  /// and duration.
+  /// and duration. This can be called concurrently with AddSegment().
   /// @return The average bitrate (in bits per second) of this MediaPlaylist.
   virtual uint64_t AvgBitrate() const;
 
@@ -243,6 +245,9 @@ class MediaPlaylist {
   double longest_segment_duration_seconds_ = 0.0;
   uint32_t time_scale_ = 0;
 
+  // Protects |bandwidth_estimator_|, which is read by MasterPlaylist while
+  // segments may still be added.
+  mutable base::Lock bandwidth_estimator_lock_;
   BandwidthEstimator bandwidth_estimator_;
 
   // Cache the previous calls AddSegment() end offset. This is used to construct
@@ -335,24 +335,27 @@ bool SimpleHlsNotifier::NotifyNewStream(const MediaInfo& media_info,
     encryption_method = enc_method.value();
   }
 
+  std::unique_ptr<StreamEntry> stream_entry(new StreamEntry);
+  stream_entry->media_playlist = std::move(media_playlist);
+  stream_entry->encryption_method = encryption_method;
+
   base::AutoLock auto_lock(lock_);
   *stream_id = sequence_number_++;
-  media_playlists_.push_back(media_playlist.get());
-  stream_map_[*stream_id].reset(
-      new StreamEntry{std::move(media_playlist), encryption_method});
+  media_playlists_.push_back(stream_entry->media_playlist.get());
+  stream_map_[*stream_id] = std::move(stream_entry);
   return true;
 }
 
 bool SimpleHlsNotifier::NotifySampleDuration(uint32_t stream_id,
                                              uint32_t sample_duration) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream_entry = GetStreamEntry(stream_id);
+  if (!stream_entry)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  media_playlist->SetSampleDuration(sample_duration);
+  base::AutoLock auto_lock(stream_entry->lock);
+  // The sample duration is read by the master playlist, which is written
+  // without holding the stream locks.
+  base::AutoLock master_playlist_lock(master_playlist_lock_);
+  stream_entry->media_playlist->SetSampleDuration(sample_duration);
   return true;
 }
 
@@ -362,75 +365,68 @@ bool SimpleHlsNotifier::NotifyNewSegment(uint32_t stream_id,
                                          uint64_t duration,
                                          uint64_t start_byte_offset,
                                          uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream_entry = GetStreamEntry(stream_id);
+  if (!stream_entry)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  const std::string& segment_url =
-      GenerateSegmentUrl(segment_name, hls_params().base_url,
-                         master_playlist_dir_, media_playlist->file_name());
-  media_playlist->AddSegment(segment_url, start_time, duration,
-                             start_byte_offset, size);
-
-  // Update target duration.
-  uint32_t longest_segment_duration =
-      static_cast<uint32_t>(ceil(media_playlist->GetLongestSegmentDuration()));
-  bool target_duration_updated = false;
-  if (longest_segment_duration > target_duration_) {
-    target_duration_ = longest_segment_duration;
-    target_duration_updated = true;
-  }
 
-  // Update the playlists when there is new segments in live mode.
-  if (hls_params().playlist_type == HlsPlaylistType::kLive ||
-      hls_params().playlist_type == HlsPlaylistType::kEvent) {
-    // Update all playlists if target duration is updated.
-    if (target_duration_updated) {
-      for (MediaPlaylist* playlist : media_playlists_) {
-        playlist->SetTargetDuration(target_duration_);
-        if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
-          return false;
+  const bool is_live_or_event =
+      hls_params().playlist_type == HlsPlaylistType::kLive ||
+      hls_params().playlist_type == HlsPlaylistType::kEvent;
+  bool target_duration_updated = false;
+  {
+    base::AutoLock auto_lock(stream_entry->lock);
+    MediaPlaylist* media_playlist = stream_entry->media_playlist.get();
+    const std::string& segment_url =
+        GenerateSegmentUrl(segment_name, hls_params().base_url,
+                           master_playlist_dir_, media_playlist->file_name());
+    media_playlist->AddSegment(segment_url, start_time, duration,
+                               start_byte_offset, size);
+
+    // Update target duration.
+    uint32_t longest_segment_duration = static_cast<uint32_t>(
+        ceil(media_playlist->GetLongestSegmentDuration()));
+    {
+      base::AutoLock target_duration_lock(lock_);
+      if (longest_segment_duration > target_duration_) {
+        target_duration_ = longest_segment_duration;
+        target_duration_updated = true;
       }
-    } else {
-      if (!WriteMediaPlaylist(master_playlist_dir_, media_playlist.get()))
-        return false;
     }
-    if (!master_playlist_->WriteMasterPlaylist(
-            hls_params().base_url, master_playlist_dir_, media_playlists_)) {
-      LOG(ERROR) << "Failed to write master playlist.";
-      return false;
+
+    // Update the playlist when there is new segments in live mode. All
+    // playlists are updated below if target duration is updated.
+    if (is_live_or_event && !target_duration_updated) {
+      if (!WriteMediaPlaylist(master_playlist_dir_, media_playlist))
+        return false;
     }
   }
-  return true;
+
+  if (!is_live_or_event)
+    return true;
+  if (target_duration_updated && !UpdateTargetDuration())
+    return false;
+  return UpdateMasterPlaylist();
 }
 
 bool SimpleHlsNotifier::NotifyKeyFrame(uint32_t stream_id,
                                        uint64_t timestamp,
                                        uint64_t start_byte_offset,
                                        uint64_t size) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream_entry = GetStreamEntry(stream_id);
+  if (!stream_entry)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  media_playlist->AddKeyFrame(timestamp, start_byte_offset, size);
+  base::AutoLock auto_lock(stream_entry->lock);
+  stream_entry->media_playlist->AddKeyFrame(timestamp, start_byte_offset,
+                                            size);
   return true;
 }
 
 bool SimpleHlsNotifier::NotifyCueEvent(uint32_t stream_id, uint64_t timestamp) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream_entry = GetStreamEntry(stream_id);
+  if (!stream_entry)
     return false;
-  }
-  auto& media_playlist = stream_iterator->second->media_playlist;
-  media_playlist->AddPlacementOpportunity();
+  base::AutoLock auto_lock(stream_entry->lock);
+  stream_entry->media_playlist->AddPlacementOpportunity();
   return true;
 }
 
@@ -440,23 +436,20 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
     const std::vector<uint8_t>& system_id,
     const std::vector<uint8_t>& iv,
     const std::vector<uint8_t>& protection_system_specific_data) {
-  base::AutoLock auto_lock(lock_);
-  auto stream_iterator = stream_map_.find(stream_id);
-  if (stream_iterator == stream_map_.end()) {
-    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+  StreamEntry* stream_entry = GetStreamEntry(stream_id);
+  if (!stream_entry)
     return false;
-  }
+  base::AutoLock auto_lock(stream_entry->lock);
 
-  std::unique_ptr<MediaPlaylist>& media_playlist =
-      stream_iterator->second->media_playlist;
+  MediaPlaylist* media_playlist = stream_entry->media_playlist.get();
   const MediaPlaylist::EncryptionMethod encryption_method =
-      stream_iterator->second->encryption_method;
+      stream_entry->encryption_method;
   LOG_IF(WARNING, encryption_method == MediaPlaylist::EncryptionMethod::kNone)
       << "Got encryption notification but the encryption method is NONE";
   if (IsWidevineSystemId(system_id)) {
     return HandleWidevineKeyFormats(encryption_method,
                                     key_id, iv, protection_system_specific_data,
-                                    media_playlist.get());
+                                    media_playlist);
   }
 
   // Key Id does not need to be specified with "identity" and "sdk".
@@ -471,7 +464,7 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
       key_uri = Base64EncodeData(kUriBase64Prefix, key_uri_data);
     }
     NotifyEncryptionToMediaPlaylist(encryption_method, key_uri, empty_key_id,
-                                    iv, "identity", "", media_playlist.get());
+                                    iv, "identity", "", media_playlist);
     return true;
   }
   if (IsFairPlaySystemId(system_id)) {
@@ -487,7 +480,7 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
     const std::vector<uint8_t> empty_iv;
     NotifyEncryptionToMediaPlaylist(encryption_method, key_uri, empty_key_id,
                                     empty_iv, "com.apple.streamingkeydelivery",
-                                    "1", media_playlist.get());
+                                    "1", media_playlist);
     return true;
   }
 
@@ -497,14 +490,110 @@ bool SimpleHlsNotifier::NotifyEncryptionUpdate(
 }
 
 bool SimpleHlsNotifier::Flush() {
+  bool master_playlist_write_failed = false;
+  {
+    base::AutoLock auto_lock(master_playlist_update_lock_);
+    master_playlist_write_failed = master_playlist_write_failed_;
+    master_playlist_write_failed_ = false;
+  }
+  if (!UpdateTargetDuration())
+    return false;
+  return WriteMasterPlaylist() && !master_playlist_write_failed;
+}
+
+SimpleHlsNotifier::StreamEntry* SimpleHlsNotifier::GetStreamEntry(
+    uint32_t stream_id) {
   base::AutoLock auto_lock(lock_);
-  for (MediaPlaylist* playlist : media_playlists_) {
-    playlist->SetTargetDuration(target_duration_);
-    if (!WriteMediaPlaylist(master_playlist_dir_, playlist))
+  auto stream_iterator = stream_map_.find(stream_id);
+  if (stream_iterator == stream_map_.end()) {
+    LOG(ERROR) << "Cannot find stream with ID: " << stream_id;
+    return nullptr;
+  }
+  // Entries are never removed, so the pointer stays valid after the lock is
+  // released.
+  return stream_iterator->second.get();
+}
+
+std::vector<SimpleHlsNotifier::StreamEntry*>
+SimpleHlsNotifier::GetStreamEntries() {
+  base::AutoLock auto_lock(lock_);
+  std::vector<StreamEntry*> stream_entries;
+  stream_entries.reserve(stream_map_.size());
+  for (const auto& stream : stream_map_)
+    stream_entries.push_back(stream.second.get());
+  return stream_entries;
+}
+
+bool SimpleHlsNotifier::UpdateTargetDuration() {
+  for (StreamEntry* stream_entry : GetStreamEntries()) {
+    base::AutoLock auto_lock(stream_entry->lock);
+    // Read the target duration for every playlist: it may have been increased
+    // by another stream in the meantime. It never decreases, so the playlists
+    // end up with the latest value.
+    uint32_t target_duration = 0;
+    {
+      base::AutoLock target_duration_lock(lock_);
+      target_duration = target_duration_;
+    }
+    MediaPlaylist* media_playlist = stream_entry->media_playlist.get();
+    media_playlist->SetTargetDuration(target_duration);
+    if (!WriteMediaPlaylist(master_playlist_dir_, media_playlist))
       return false;
   }
+  return true;
+}
+
+bool SimpleHlsNotifier::UpdateMasterPlaylist() {
+  // A write failure on behalf of an earlier call is reported by this call.
+  bool result = true;
+  {
+    base::AutoLock auto_lock(master_playlist_update_lock_);
+    if (master_playlist_write_failed_) {
+      master_playlist_write_failed_ = false;
+      result = false;
+    }
+    master_playlist_update_pending_ = true;
+    if (master_playlist_writer_active_)
+      return result;
+    master_playlist_writer_active_ = true;
+  }
+
+  // The first write covers this call's update; the following ones cover the
+  // updates handed over by other calls in the meantime.
+  bool handed_over = false;
+  while (true) {
+    {
+      base::AutoLock auto_lock(master_playlist_update_lock_);
+      if (!master_playlist_update_pending_) {
+        master_playlist_writer_active_ = false;
+        return result;
+      }
+      master_playlist_update_pending_ = false;
+    }
+    if (!WriteMasterPlaylist()) {
+      if (handed_over) {
+        base::AutoLock auto_lock(master_playlist_update_lock_);
+        master_playlist_write_failed_ = true;
+      } else {
+        result = false;
+      }
+    }
+    handed_over = true;
+  }
+}
+
+bool SimpleHlsNotifier::WriteMasterPlaylist() {
+  // Take a snapshot of the playlists, so new streams can be added while the
+  // master playlist is being written.
+  std::list<MediaPlaylist*> media_playlists;
+  {
+    base::AutoLock auto_lock(lock_);
+    media_playlists = media_playlists_;
+  }
+
+  base::AutoLock auto_lock(master_playlist_lock_);
   if (!master_playlist_->WriteMasterPlaylist(
-          hls_params().base_url, master_playlist_dir_, media_playlists_)) {
+          hls_params().base_url, master_playlist_dir_, media_playlists)) {
     LOG(ERROR) << "Failed to write master playlist.";
     return false;
   }
@@ -34,7 +34,8 @@ class MediaPlaylistFactory {
                                                 const std::string& group_id);
 };
 
-/// This is thread safe.
+/// This is thread safe. Each stream has its own lock, so that updating and
+/// writing the media playlist of one stream does not block the other streams.
 class SimpleHlsNotifier : public HlsNotifier {
  public:
   /// @param hls_params contains parameters for setting up the notifier.
@@ -77,8 +78,27 @@ class SimpleHlsNotifier : public HlsNotifier {
   struct StreamEntry {
     std::unique_ptr<MediaPlaylist> media_playlist;
     MediaPlaylist::EncryptionMethod encryption_method;
+    // Protects |media_playlist|.
+    base::Lock lock;
   };
 
+  // Returns the entry for |stream_id|, or NULL if it is not found.
+  StreamEntry* GetStreamEntry(uint32_t stream_id);
+  // Returns the entries of all the streams, ordered by stream id.
+  std::vector<StreamEntry*> GetStreamEntries();
+  // Sets the current target duration on all the media playlists and writes
+  // them out.
+  bool UpdateTargetDuration();
+  // Writes the master playlist. If another thread is already writing it, the
+  // update is handed over to that thread, which writes the master playlist
+  // again with the latest state, so muxer threads do not queue behind each
+  // other on the master playlist. A failure to write an update handed over by
+  // another thread is returned by the next call to UpdateMasterPlaylist() or
+  // Flush().
+  bool UpdateMasterPlaylist();
+  // Writes the master playlist from the current media playlists.
+  bool WriteMasterPlaylist();
+
   std::string master_playlist_dir_;
   uint32_t target_duration_ = 0;
 
@@ -91,7 +111,21 @@ class SimpleHlsNotifier : public HlsNotifier {
 
   uint32_t sequence_number_ = 0;
 
+  // Protects |stream_map_|, |media_playlists_|, |sequence_number_| and
+  // |target_duration_|. It is only held for lookups and updates of these
+  // members, never while writing a playlist.
   base::Lock lock_;
+  // Serializes the writes of |master_playlist_|. Also held when updating media
+  // playlist state that is read by |master_playlist_|, other than the bitrates
+  // which are protected by MediaPlaylist itself.
+  base::Lock master_playlist_lock_;
+  // Protects |master_playlist_update_pending_|,
+  // |master_playlist_writer_active_| and |master_playlist_write_failed_|.
+  base::Lock master_playlist_update_lock_;
+  bool master_playlist_update_pending_ = false;
+  bool master_playlist_writer_active_ = false;
+  // Set if writing an update handed over by another thread failed.
+  bool master_playlist_write_failed_ = false;
 
   DISALLOW_COPY_AND_ASSIGN(SimpleHlsNotifier);
 };
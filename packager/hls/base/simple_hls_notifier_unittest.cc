@@ -8,10 +8,16 @@
 #include <gtest/gtest.h>
 
 #include <gflags/gflags.h>
+#include <algorithm>
 #include <memory>
 
 #include "packager/base/base64.h"
 #include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/base/threading/simple_thread.h"
+#include "packager/base/time/time.h"
 #include "packager/hls/base/mock_media_playlist.h"
 #include "packager/hls/base/simple_hls_notifier.h"
 #include "packager/media/base/protection_system_ids.h"
@@ -24,9 +30,11 @@ namespace shaka {
 namespace hls {
 
 using ::testing::_;
+using ::testing::AnyNumber;
 using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::InSequence;
+using ::testing::Invoke;
 using ::testing::Mock;
 using ::testing::Property;
 using ::testing::Return;
@@ -84,6 +92,25 @@ const uint64_t kAnySize = 2000;
 const char kCencProtectionScheme[] = "cenc";
 const char kSampleAesProtectionScheme[] = "cbca";
 
+// Notifies a segment on its own thread.
+class NewSegmentNotifier : public base::DelegateSimpleThread::Delegate {
+ public:
+  NewSegmentNotifier(SimpleHlsNotifier* notifier, uint32_t stream_id)
+      : notifier_(notifier), stream_id_(stream_id) {}
+
+  void Run() override {
+    result_ = notifier_->NotifyNewSegment(stream_id_, "segment", kAnyStartTime,
+                                          kAnyDuration, 0, kAnySize);
+  }
+
+  bool result() const { return result_; }
+
+ private:
+  SimpleHlsNotifier* const notifier_;
+  const uint32_t stream_id_;
+  bool result_ = false;
+};
+
 }  // namespace
 
 class SimpleHlsNotifierTest : public ::testing::Test {
@@ -662,6 +689,82 @@ TEST_P(LiveOrEventSimpleHlsNotifierTest, NotifyNewSegmentsWithMultipleStreams) {
                                         kDuration, 0, kSize));
 }
 
+// A master playlist update handed over to the thread writing the master
+// playlist fails; the failure is returned by the next notification.
+TEST_P(LiveOrEventSimpleHlsNotifierTest, HandedOverMasterPlaylistWriteFailure) {
+  std::unique_ptr<MockMasterPlaylist> mock_master_playlist(
+      new MockMasterPlaylist());
+  std::unique_ptr<MockMediaPlaylistFactory> factory(
+      new MockMediaPlaylistFactory());
+
+  // Pointer released by SimpleHlsNotifier.
+  MockMediaPlaylist* mock_media_playlist =
+      new MockMediaPlaylist("playlist.m3u8", "", "");
+
+  EXPECT_CALL(*mock_media_playlist, SetMediaInfo(_)).WillOnce(Return(true));
+  EXPECT_CALL(*factory, CreateMock(_, _, _, _))
+      .WillOnce(Return(mock_media_playlist));
+  EXPECT_CALL(*mock_media_playlist, AddSegment(_, _, _, _, _))
+      .Times(AnyNumber());
+  EXPECT_CALL(*mock_media_playlist, GetLongestSegmentDuration())
+      .WillRepeatedly(Return(1.0));
+  EXPECT_CALL(*mock_media_playlist, SetTargetDuration(_)).Times(AnyNumber());
+  EXPECT_CALL(*mock_media_playlist, WriteToFile(_))
+      .WillRepeatedly(Return(true));
+
+  base::WaitableEvent writing(
+      base::WaitableEvent::ResetPolicy::MANUAL,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  base::WaitableEvent resume(base::WaitableEvent::ResetPolicy::MANUAL,
+                             base::WaitableEvent::InitialState::NOT_SIGNALED);
+  {
+    InSequence in_sequence;
+    // The first write blocks until the second notification has handed its
+    // update over.
+    EXPECT_CALL(*mock_master_playlist, WriteMasterPlaylist(_, _, _))
+        .WillOnce(Invoke([&writing, &resume](const std::string&,
+                                             const std::string&,
+                                             const std::list<MediaPlaylist*>&) {
+          writing.Signal();
+          resume.Wait();
+          return true;
+        }));
+    // The write of the handed over update.
+    EXPECT_CALL(*mock_master_playlist, WriteMasterPlaylist(_, _, _))
+        .WillOnce(Return(false));
+    EXPECT_CALL(*mock_master_playlist, WriteMasterPlaylist(_, _, _))
+        .WillRepeatedly(Return(true));
+  }
+
+  hls_params_.playlist_type = GetParam();
+  SimpleHlsNotifier notifier(hls_params_);
+  InjectMasterPlaylist(std::move(mock_master_playlist), &notifier);
+  InjectMediaPlaylistFactory(std::move(factory), &notifier);
+  EXPECT_TRUE(notifier.Init());
+  MediaInfo media_info;
+  uint32_t stream_id;
+  EXPECT_TRUE(notifier.NotifyNewStream(media_info, "playlist.m3u8", "name",
+                                       "groupid", &stream_id));
+
+  NewSegmentNotifier segment_notifier(&notifier, stream_id);
+  base::DelegateSimpleThread thread(&segment_notifier, "NewSegmentNotifier");
+  thread.Start();
+  writing.Wait();
+  // Handed over to |thread|, which has not written it yet.
+  EXPECT_TRUE(notifier.NotifyNewSegment(stream_id, "segment", kAnyStartTime,
+                                        kAnyDuration, 0, kAnySize));
+  resume.Signal();
+  thread.Join();
+  // The update of |thread| itself was written successfully.
+  EXPECT_TRUE(segment_notifier.result());
+
+  EXPECT_FALSE(notifier.NotifyNewSegment(stream_id, "segment", kAnyStartTime,
+                                         kAnyDuration, 0, kAnySize));
+  // The failure is only reported once.
+  EXPECT_TRUE(notifier.NotifyNewSegment(stream_id, "segment", kAnyStartTime,
+                                        kAnyDuration, 0, kAnySize));
+}
+
 INSTANTIATE_TEST_CASE_P(PlaylistTypes,
                         LiveOrEventSimpleHlsNotifierTest,
                         ::testing::Values(HlsPlaylistType::kLive,
@@ -983,5 +1086,150 @@ INSTANTIATE_TEST_CASE_P(WidevineEnableDisableLegacyWidevineHls,
                         WidevineSimpleHlsNotifierTest,
                         ::testing::Bool());
 
+namespace {
+
+const int kNumStressTestStreams = 24;
+const int kNumStressTestSegments = 50;
+const uint32_t kStressTestTimeScale = 90000;
+const uint64_t kStressTestSegmentDuration = 2 * kStressTestTimeScale;
+const uint64_t kStressTestSegmentSize = 500000;
+
+// Notifies segments of one stream and records how long the notifier blocks.
+class SegmentNotifier : public base::DelegateSimpleThread::Delegate {
+ public:
+  SegmentNotifier(SimpleHlsNotifier* notifier,
+                  uint32_t stream_id,
+                  const base::FilePath& output_dir)
+      : notifier_(notifier), stream_id_(stream_id), output_dir_(output_dir) {}
+
+  void Run() override {
+    for (int i = 0; i < kNumStressTestSegments; ++i) {
+      const std::string segment_name =
+          output_dir_
+              .AppendASCII(base::StringPrintf("stream%u_%d.ts", stream_id_, i))
+              .AsUTF8Unsafe();
+      const base::TimeTicks start = base::TimeTicks::Now();
+      if (!notifier_->NotifyNewSegment(
+              stream_id_, segment_name, i * kStressTestSegmentDuration,
+              kStressTestSegmentDuration, 0, kStressTestSegmentSize)) {
+        ++num_failures_;
+      }
+      const base::TimeDelta blocked_time = base::TimeTicks::Now() - start;
+      total_blocked_time_ += blocked_time;
+      max_blocked_time_ = std::max(max_blocked_time_, blocked_time);
+    }
+  }
+
+  int num_failures() const { return num_failures_; }
+  base::TimeDelta total_blocked_time() const { return total_blocked_time_; }
+  base::TimeDelta max_blocked_time() const { return max_blocked_time_; }
+
+ private:
+  SimpleHlsNotifier* const notifier_;
+  const uint32_t stream_id_;
+  const base::FilePath output_dir_;
+  int num_failures_ = 0;
+  base::TimeDelta total_blocked_time_;
+  base::TimeDelta max_blocked_time_;
+};
+
+}  // namespace
+
+class SimpleHlsNotifierStressTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(base::CreateNewTempDirectory(base::FilePath::StringType(),
+                                             &output_dir_));
+  }
+
+  void TearDown() override {
+    const bool kRecursive = true;
+    base::DeleteFile(output_dir_, kRecursive);
+  }
+
+  base::FilePath output_dir_;
+};
+
+// Notifies segments of many live streams concurrently with real playlists, and
+// reports how long the muxer threads are blocked in NotifyNewSegment().
+TEST_F(SimpleHlsNotifierStressTest, ConcurrentStreams) {
+  const base::FilePath& output_dir = output_dir_;
+
+  HlsParams hls_params;
+  hls_params.playlist_type = HlsPlaylistType::kEvent;
+  hls_params.master_playlist_output =
+      output_dir.AppendASCII(kMasterPlaylistName).AsUTF8Unsafe();
+  SimpleHlsNotifier notifier(hls_params);
+  ASSERT_TRUE(notifier.Init());
+
+  MediaInfo media_info;
+  media_info.set_reference_time_scale(kStressTestTimeScale);
+  MediaInfo::VideoInfo* video_info = media_info.mutable_video_info();
+  video_info->set_codec("avc1.64001f");
+  video_info->set_width(1280);
+  video_info->set_height(720);
+  video_info->set_time_scale(kStressTestTimeScale);
+
+  std::vector<std::unique_ptr<SegmentNotifier>> segment_notifiers;
+  for (int i = 0; i < kNumStressTestStreams; ++i) {
+    const std::string playlist_name =
+        output_dir.AppendASCII(base::StringPrintf("stream%d.m3u8", i))
+            .AsUTF8Unsafe();
+    uint32_t stream_id;
+    ASSERT_TRUE(notifier.NotifyNewStream(media_info, playlist_name, "name",
+                                         "groupid", &stream_id));
+    segment_notifiers.emplace_back(
+        new SegmentNotifier(&notifier, stream_id, output_dir));
+  }
+
+  const base::TimeTicks start = base::TimeTicks::Now();
+  std::vector<std::unique_ptr<base::DelegateSimpleThread>> threads;
+  for (auto& segment_notifier : segment_notifiers) {
+    threads.emplace_back(new base::DelegateSimpleThread(
+        segment_notifier.get(), "SegmentNotifierThread"));
+    threads.back()->Start();
+  }
+  for (auto& thread : threads)
+    thread->Join();
+  const base::TimeDelta elapsed_time = base::TimeTicks::Now() - start;
+  EXPECT_TRUE(notifier.Flush());
+
+  base::TimeDelta total_blocked_time;
+  base::TimeDelta max_blocked_time;
+  for (const auto& segment_notifier : segment_notifiers) {
+    EXPECT_EQ(0, segment_notifier->num_failures());
+    total_blocked_time += segment_notifier->total_blocked_time();
+    max_blocked_time =
+        std::max(max_blocked_time, segment_notifier->max_blocked_time());
+  }
+  LOG(INFO) << kNumStressTestStreams << " streams x " << kNumStressTestSegments
+            << " segments in " << elapsed_time.InMilliseconds()
+            << " ms. NotifyNewSegment() average "
+            << total_blocked_time.InMicroseconds() /
+                   (kNumStressTestStreams * kNumStressTestSegments)
+            << " us, max " << max_blocked_time.InMicroseconds() << " us.";
+
+  // Every playlist has all its segments.
+  for (int i = 0; i < kNumStressTestStreams; ++i) {
+    std::string playlist;
+    ASSERT_TRUE(base::ReadFileToString(
+        output_dir.AppendASCII(base::StringPrintf("stream%d.m3u8", i)),
+        &playlist));
+    size_t num_segments = 0;
+    for (size_t pos = playlist.find("#EXTINF"); pos != std::string::npos;
+         pos = playlist.find("#EXTINF", pos + 1)) {
+      ++num_segments;
+    }
+    EXPECT_EQ(static_cast<size_t>(kNumStressTestSegments), num_segments);
+  }
+  std::string master_playlist;
+  ASSERT_TRUE(base::ReadFileToString(
+      output_dir.AppendASCII(kMasterPlaylistName), &master_playlist));
+  EXPECT_NE(std::string::npos, master_playlist.find("stream0.m3u8"));
+  EXPECT_NE(std::string::npos,
+            master_playlist.find(base::StringPrintf(
+                "stream%d.m3u8", kNumStressTestStreams - 1)));
+}
+
 }  // namespace hls
 }  // namespace shaka
@@ -67,6 +67,17 @@ bool AesCryptor::Crypt(const std::string& text, std::string* crypt_text) {
   return true;
 }
 
+bool AesCryptor::CryptBuffers(const std::vector<CryptBuffer>& buffers) {
+  for (const CryptBuffer& buffer : buffers) {
+    DCHECK_EQ(0u, NumPaddingBytes(buffer.text_size));
+    if (!SetIv(buffer.iv) ||
+        !Crypt(buffer.text, buffer.text_size, buffer.crypt_text)) {
+      return false;
+    }
+  }
+  return true;
+}
+
 bool AesCryptor::SetIv(const std::vector<uint8_t>& iv) {
   if (!IsIvSizeValid(iv.size())) {
     LOG(ERROR) << "Invalid IV size: " << iv.size();
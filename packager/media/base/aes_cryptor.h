@@ -68,6 +68,24 @@ class AesCryptor {
   }
   /// @}
 
+  /// A buffer encrypted or decrypted independently of the other buffers.
+  struct CryptBuffer {
+    const uint8_t* text = nullptr;
+    size_t text_size = 0;
+    /// Should have at least @a text_size bytes. It can be the same as @a text
+    /// for in place encryption/decryption.
+    uint8_t* crypt_text = nullptr;
+    /// The iv to encrypt or decrypt the buffer with.
+    std::vector<uint8_t> iv;
+  };
+
+  /// Encrypt or decrypt several independent buffers, e.g. the samples of a
+  /// fragment, each with its own iv, in a single call. The key setup is shared
+  /// by all the buffers. The iv of the last buffer is the current iv on return.
+  /// Not supported with padding.
+  /// @return true if successful, false otherwise.
+  bool CryptBuffers(const std::vector<CryptBuffer>& buffers);
+
   /// Set IV. SetIv() implementation guarantees that the iv passed to SetIv()
   /// is set to iv() and then calls SetIvInternal().
   /// @return true if successful, false if the input is invalid.
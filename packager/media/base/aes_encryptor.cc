@@ -134,7 +134,8 @@ bool AesCbcEncryptor::CryptInternal(const uint8_t* plaintext,
                     internal_iv_.data(), AES_ENCRYPT);
   } else if (padding_scheme_ == kCtsPadding) {
     // Don't have a full block, leave unencrypted.
-    memcpy(ciphertext, plaintext, plaintext_size);
+    if (ciphertext != plaintext)
+      memcpy(ciphertext, plaintext, plaintext_size);
     return true;
   }
   if (residual_block_size == 0 && padding_scheme_ != kPkcs5Padding) {
@@ -144,7 +145,10 @@ bool AesCbcEncryptor::CryptInternal(const uint8_t* plaintext,
 
   if (padding_scheme_ == kNoPadding) {
     // The residual block is left unencrypted.
-    memcpy(ciphertext + cbc_size, plaintext + cbc_size, residual_block_size);
+    if (ciphertext != plaintext) {
+      memcpy(ciphertext + cbc_size, plaintext + cbc_size,
+             residual_block_size);
+    }
     return true;
   }
 
@@ -0,0 +1,218 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/aes_evp_cryptor.h"
+
+#include <gflags/gflags.h>
+#include <openssl/aes.h>
+#include <openssl/cipher.h>
+#include <openssl/err.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "packager/base/logging.h"
+#include "packager/media/base/aes_decryptor.h"
+#include "packager/media/base/aes_encryptor.h"
+
+DEFINE_bool(use_evp_aes_cryptor,
+            false,
+            "Encrypt and decrypt media with AES cryptors using the EVP "
+            "interface of BoringSSL, which uses the fastest AES "
+            "implementation available on the CPU.");
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint64_t kNoCounterWrap = std::numeric_limits<uint64_t>::max();
+
+const EVP_CIPHER* GetCipher(AesEvpCryptor::CipherMode cipher_mode,
+                            size_t key_size) {
+  const bool ctr_mode = cipher_mode == AesEvpCryptor::kCtrMode;
+  // AES defines three key sizes: 128, 192 and 256 bits.
+  switch (key_size) {
+    case 16:
+      return ctr_mode ? EVP_aes_128_ctr() : EVP_aes_128_cbc();
+    case 24:
+      return ctr_mode ? EVP_aes_192_ctr() : EVP_aes_192_cbc();
+    case 32:
+      return ctr_mode ? EVP_aes_256_ctr() : EVP_aes_256_cbc();
+    default:
+      return nullptr;
+  }
+}
+
+}  // namespace
+
+AesEvpCryptor::AesEvpCryptor(CipherMode cipher_mode,
+                             Direction direction,
+                             ConstantIvFlag constant_iv_flag)
+    : AesCryptor(constant_iv_flag),
+      cipher_mode_(cipher_mode),
+      direction_(direction),
+      ctx_(EVP_CIPHER_CTX_new()) {
+  CHECK(ctx_);
+  DCHECK(cipher_mode_ != kCtrMode || constant_iv_flag == kDontUseConstantIv)
+      << "Constant iv is not supported in CTR mode.";
+}
+
+AesEvpCryptor::~AesEvpCryptor() {}
+
+bool AesEvpCryptor::InitializeWithIv(const std::vector<uint8_t>& key,
+                                     const std::vector<uint8_t>& iv) {
+  const EVP_CIPHER* cipher = GetCipher(cipher_mode_, key.size());
+  if (!cipher) {
+    LOG(ERROR) << "Invalid AES key size: " << key.size();
+    return false;
+  }
+  // Encryption and decryption are identical in CTR mode.
+  const int enc = cipher_mode_ == kCtrMode || direction_ == kEncrypt ? 1 : 0;
+  if (EVP_CipherInit_ex(ctx_.get(), cipher, nullptr, key.data(), nullptr,
+                        enc) != 1) {
+    LOG(ERROR) << "EVP_CipherInit_ex failed with error: "
+               << ERR_error_string(ERR_get_error(), NULL);
+    return false;
+  }
+  CHECK_EQ(EVP_CIPHER_CTX_set_padding(ctx_.get(), 0), 1);
+  return SetIv(iv);
+}
+
+// static
+bool AesEvpCryptor::IsSelected() {
+  return FLAGS_use_evp_aes_cryptor;
+}
+
+void AesEvpCryptor::EvpCipherCtxDeleter::operator()(
+    EVP_CIPHER_CTX* ctx) const {
+  EVP_CIPHER_CTX_free(ctx);
+}
+
+bool AesEvpCryptor::CryptInternal(const uint8_t* text,
+                                  size_t text_size,
+                                  uint8_t* crypt_text,
+                                  size_t* crypt_text_size) {
+  DCHECK(text);
+  DCHECK(crypt_text);
+
+  // |crypt_text_size| is always the same as |text_size| without padding.
+  if (*crypt_text_size < text_size) {
+    LOG(ERROR) << "Expecting output size of at least " << text_size
+               << " bytes.";
+    return false;
+  }
+  *crypt_text_size = text_size;
+
+  if (cipher_mode_ == kCbcMode) {
+    const size_t residual_block_size = text_size % AES_BLOCK_SIZE;
+    const size_t cbc_size = text_size - residual_block_size;
+    if (!CipherUpdate(text, cbc_size, crypt_text))
+      return false;
+    // The residual block is left unencrypted.
+    if (residual_block_size > 0 && crypt_text != text) {
+      memcpy(crypt_text + cbc_size, text + cbc_size, residual_block_size);
+    }
+    return true;
+  }
+
+  while (text_size > 0) {
+    const size_t chunk_size = static_cast<size_t>(
+        std::min<uint64_t>(text_size, bytes_before_counter_wrap_));
+    if (!CipherUpdate(text, chunk_size, crypt_text))
+      return false;
+    text += chunk_size;
+    text_size -= chunk_size;
+    crypt_text += chunk_size;
+    bytes_before_counter_wrap_ -= chunk_size;
+
+    if (bytes_before_counter_wrap_ == 0) {
+      // Wrap the lower 64 bits of the counter around, keeping the upper 64
+      // bits, as specified in ISO/IEC 23001-7:2016 CENC spec.
+      std::fill(internal_iv_.begin() + 8, internal_iv_.end(), 0);
+      CHECK_EQ(EVP_CipherInit_ex(ctx_.get(), nullptr, nullptr, nullptr,
+                                 internal_iv_.data(), -1),
+               1);
+      bytes_before_counter_wrap_ = kNoCounterWrap;
+    }
+  }
+  return true;
+}
+
+void AesEvpCryptor::SetIvInternal() {
+  internal_iv_ = iv();
+  internal_iv_.resize(AES_BLOCK_SIZE, 0);
+  // The key schedule is kept when only the iv is set.
+  CHECK_EQ(EVP_CipherInit_ex(ctx_.get(), nullptr, nullptr, nullptr,
+                             internal_iv_.data(), -1),
+           1);
+
+  if (cipher_mode_ != kCtrMode)
+    return;
+  uint64_t lower_counter = 0;
+  for (size_t i = 8; i < AES_BLOCK_SIZE; ++i)
+    lower_counter = (lower_counter << 8) | internal_iv_[i];
+  // 2^64 - |lower_counter| blocks are left before the lower 64 bits wrap.
+  const uint64_t blocks_before_wrap = 0 - lower_counter;
+  bytes_before_counter_wrap_ =
+      (blocks_before_wrap == 0 ||
+       blocks_before_wrap > kNoCounterWrap / AES_BLOCK_SIZE)
+          ? kNoCounterWrap
+          : blocks_before_wrap * AES_BLOCK_SIZE;
+}
+
+bool AesEvpCryptor::CipherUpdate(const uint8_t* text,
+                                 size_t text_size,
+                                 uint8_t* crypt_text) {
+  // EVP takes int sizes. Keep the chunks block aligned for CBC mode.
+  const size_t kMaxChunkSize = 1 << 30;
+  while (text_size > 0) {
+    const size_t chunk_size = std::min(text_size, kMaxChunkSize);
+    int crypt_size = 0;
+    if (EVP_CipherUpdate(ctx_.get(), crypt_text, &crypt_size, text,
+                         static_cast<int>(chunk_size)) != 1 ||
+        static_cast<size_t>(crypt_size) != chunk_size) {
+      LOG(ERROR) << "EVP_CipherUpdate failed with error: "
+                 << ERR_error_string(ERR_get_error(), NULL);
+      return false;
+    }
+    text += chunk_size;
+    text_size -= chunk_size;
+    crypt_text += chunk_size;
+  }
+  return true;
+}
+
+std::unique_ptr<AesCryptor> CreateAesCtrCryptor() {
+  if (AesEvpCryptor::IsSelected()) {
+    return std::unique_ptr<AesCryptor>(
+        new AesEvpCryptor(AesEvpCryptor::kCtrMode, AesEvpCryptor::kEncrypt,
+                          AesCryptor::kDontUseConstantIv));
+  }
+  return std::unique_ptr<AesCryptor>(new AesCtrEncryptor);
+}
+
+std::unique_ptr<AesCryptor> CreateAesCbcEncryptor(
+    AesCryptor::ConstantIvFlag constant_iv_flag) {
+  if (AesEvpCryptor::IsSelected()) {
+    return std::unique_ptr<AesCryptor>(new AesEvpCryptor(
+        AesEvpCryptor::kCbcMode, AesEvpCryptor::kEncrypt, constant_iv_flag));
+  }
+  return std::unique_ptr<AesCryptor>(
+      new AesCbcEncryptor(kNoPadding, constant_iv_flag));
+}
+
+std::unique_ptr<AesCryptor> CreateAesCbcDecryptor(
+    AesCryptor::ConstantIvFlag constant_iv_flag) {
+  if (AesEvpCryptor::IsSelected()) {
+    return std::unique_ptr<AesCryptor>(new AesEvpCryptor(
+        AesEvpCryptor::kCbcMode, AesEvpCryptor::kDecrypt, constant_iv_flag));
+  }
+  return std::unique_ptr<AesCryptor>(
+      new AesCbcDecryptor(kNoPadding, constant_iv_flag));
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,103 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_AES_EVP_CRYPTOR_H_
+#define PACKAGER_MEDIA_BASE_AES_EVP_CRYPTOR_H_
+
+#include <memory>
+#include <vector>
+
+#include "packager/media/base/aes_cryptor.h"
+
+struct evp_cipher_ctx_st;
+typedef struct evp_cipher_ctx_st EVP_CIPHER_CTX;
+
+namespace shaka {
+namespace media {
+
+/// AES cryptor using the EVP interface of BoringSSL, which dispatches to the
+/// fastest implementation available on the CPU, e.g. pipelined AES-NI for
+/// AES-CTR, instead of processing one block at a time with the low level AES
+/// functions. The cipher context, including the key schedule, is set up once
+/// per key and reused when the iv changes.
+class AesEvpCryptor : public AesCryptor {
+ public:
+  enum CipherMode {
+    kCtrMode,
+    /// CBC mode without padding, i.e. the residual block is left unencrypted.
+    kCbcMode,
+  };
+
+  enum Direction {
+    kEncrypt,
+    kDecrypt,
+  };
+
+  /// @param cipher_mode is the AES mode of operation.
+  /// @param direction indicates whether to encrypt or decrypt. Encryption and
+  ///        decryption are identical in CTR mode.
+  /// @param constant_iv_flag indicates whether a constant iv is used. See
+  ///        AesCryptor. CTR mode does not support constant iv.
+  AesEvpCryptor(CipherMode cipher_mode,
+                Direction direction,
+                ConstantIvFlag constant_iv_flag);
+  ~AesEvpCryptor() override;
+
+  /// @name AesCryptor implementation overrides.
+  /// @{
+  bool InitializeWithIv(const std::vector<uint8_t>& key,
+                        const std::vector<uint8_t>& iv) override;
+  /// @}
+
+  /// @return true if the EVP backend is selected with --use_evp_aes_cryptor.
+  static bool IsSelected();
+
+ private:
+  struct EvpCipherCtxDeleter {
+    void operator()(EVP_CIPHER_CTX* ctx) const;
+  };
+
+  bool CryptInternal(const uint8_t* text,
+                     size_t text_size,
+                     uint8_t* crypt_text,
+                     size_t* crypt_text_size) override;
+  void SetIvInternal() override;
+
+  // Runs the cipher on |text_size| bytes, which should be a multiple of the
+  // block size in CBC mode.
+  bool CipherUpdate(const uint8_t* text, size_t text_size, uint8_t* crypt_text);
+
+  const CipherMode cipher_mode_;
+  const Direction direction_;
+  std::unique_ptr<EVP_CIPHER_CTX, EvpCipherCtxDeleter> ctx_;
+  // 16-byte counter or iv the cipher context is set up with.
+  std::vector<uint8_t> internal_iv_;
+  // CENC increments the lower 64 bits of the counter without carrying into
+  // the upper 64 bits, while EVP increments the whole 128-bit counter. This is
+  // the number of bytes left until the lower 64 bits wrap around.
+  uint64_t bytes_before_counter_wrap_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(AesEvpCryptor);
+};
+
+/// @return a new AES-CTR cryptor, which can encrypt and decrypt, using the
+///         backend selected with --use_evp_aes_cryptor.
+std::unique_ptr<AesCryptor> CreateAesCtrCryptor();
+
+/// @return a new AES-CBC encryptor without padding using the backend selected
+///         with --use_evp_aes_cryptor.
+std::unique_ptr<AesCryptor> CreateAesCbcEncryptor(
+    AesCryptor::ConstantIvFlag constant_iv_flag);
+
+/// @return a new AES-CBC decryptor without padding using the backend selected
+///         with --use_evp_aes_cryptor.
+std::unique_ptr<AesCryptor> CreateAesCbcDecryptor(
+    AesCryptor::ConstantIvFlag constant_iv_flag);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_AES_EVP_CRYPTOR_H_
@@ -0,0 +1,292 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/aes_evp_cryptor.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/aes_decryptor.h"
+#include "packager/media/base/aes_encryptor.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint8_t kKey[] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+const uint8_t kIv8[] = {0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7};
+const uint8_t kIv16[] = {0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+                         0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff};
+// The lower 64 bits of the counter wrap around after two blocks.
+const uint8_t kIvNearCounterWrap[] = {0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5,
+                                      0xf6, 0xf7, 0xff, 0xff, 0xff, 0xff,
+                                      0xff, 0xff, 0xff, 0xfe};
+// Sizes of consecutive Crypt calls, not aligned to the block size.
+const size_t kChunkSizes[] = {5, 16, 27, 1, 64, 100, 3};
+
+std::vector<uint8_t> GetText(size_t size) {
+  std::vector<uint8_t> text(size);
+  for (size_t i = 0; i < size; ++i)
+    text[i] = static_cast<uint8_t>(i * 13 + 7);
+  return text;
+}
+
+// Crypts |text| in chunks of |kChunkSizes| with a fresh iv for each pass over
+// the chunks, emulating samples with subsamples.
+std::vector<uint8_t> CryptInChunks(AesCryptor* cryptor,
+                                   const std::vector<uint8_t>& text) {
+  std::vector<uint8_t> crypt_text(text.size());
+  size_t offset = 0;
+  while (offset < text.size()) {
+    for (size_t chunk_size : kChunkSizes) {
+      chunk_size = std::min(chunk_size, text.size() - offset);
+      EXPECT_TRUE(
+          cryptor->Crypt(&text[offset], chunk_size, &crypt_text[offset]));
+      offset += chunk_size;
+    }
+    cryptor->UpdateIv();
+  }
+  return crypt_text;
+}
+
+}  // namespace
+
+class AesEvpCryptorTest : public ::testing::Test {
+ public:
+  AesEvpCryptorTest()
+      : key_(std::begin(kKey), std::end(kKey)), text_(GetText(1000)) {}
+
+ protected:
+  std::vector<uint8_t> key_;
+  std::vector<uint8_t> text_;
+};
+
+TEST_F(AesEvpCryptorTest, CtrMatchesAesCtrEncryptor) {
+  const std::vector<std::vector<uint8_t>> ivs = {
+      std::vector<uint8_t>(std::begin(kIv8), std::end(kIv8)),
+      std::vector<uint8_t>(std::begin(kIv16), std::end(kIv16)),
+      std::vector<uint8_t>(std::begin(kIvNearCounterWrap),
+                           std::end(kIvNearCounterWrap)),
+  };
+  for (const std::vector<uint8_t>& iv : ivs) {
+    AesCtrEncryptor expected_encryptor;
+    ASSERT_TRUE(expected_encryptor.InitializeWithIv(key_, iv));
+    AesEvpCryptor encryptor(AesEvpCryptor::kCtrMode, AesEvpCryptor::kEncrypt,
+                            AesCryptor::kDontUseConstantIv);
+    ASSERT_TRUE(encryptor.InitializeWithIv(key_, iv));
+
+    const std::vector<uint8_t> ciphertext = CryptInChunks(&encryptor, text_);
+    EXPECT_EQ(CryptInChunks(&expected_encryptor, text_), ciphertext);
+    EXPECT_EQ(expected_encryptor.iv(), encryptor.iv());
+
+    AesEvpCryptor decryptor(AesEvpCryptor::kCtrMode, AesEvpCryptor::kDecrypt,
+                            AesCryptor::kDontUseConstantIv);
+    ASSERT_TRUE(decryptor.InitializeWithIv(key_, iv));
+    EXPECT_EQ(text_, CryptInChunks(&decryptor, ciphertext));
+  }
+}
+
+TEST_F(AesEvpCryptorTest, CtrCounterWrapInSingleCall) {
+  const std::vector<uint8_t> iv(std::begin(kIvNearCounterWrap),
+                                std::end(kIvNearCounterWrap));
+  AesCtrEncryptor expected_encryptor;
+  ASSERT_TRUE(expected_encryptor.InitializeWithIv(key_, iv));
+  std::vector<uint8_t> expected_ciphertext;
+  ASSERT_TRUE(expected_encryptor.Crypt(text_, &expected_ciphertext));
+
+  AesEvpCryptor encryptor(AesEvpCryptor::kCtrMode, AesEvpCryptor::kEncrypt,
+                          AesCryptor::kDontUseConstantIv);
+  ASSERT_TRUE(encryptor.InitializeWithIv(key_, iv));
+  std::vector<uint8_t> ciphertext;
+  ASSERT_TRUE(encryptor.Crypt(text_, &ciphertext));
+  EXPECT_EQ(expected_ciphertext, ciphertext);
+}
+
+TEST_F(AesEvpCryptorTest, CbcMatchesAesCbcEncryptor) {
+  const std::vector<uint8_t> iv(std::begin(kIv16), std::end(kIv16));
+  for (AesCryptor::ConstantIvFlag constant_iv_flag :
+       {AesCryptor::kUseConstantIv, AesCryptor::kDontUseConstantIv}) {
+    AesCbcEncryptor expected_encryptor(kNoPadding, constant_iv_flag);
+    ASSERT_TRUE(expected_encryptor.InitializeWithIv(key_, iv));
+    AesEvpCryptor encryptor(AesEvpCryptor::kCbcMode, AesEvpCryptor::kEncrypt,
+                            constant_iv_flag);
+    ASSERT_TRUE(encryptor.InitializeWithIv(key_, iv));
+
+    const std::vector<uint8_t> ciphertext = CryptInChunks(&encryptor, text_);
+    EXPECT_EQ(CryptInChunks(&expected_encryptor, text_), ciphertext);
+
+    AesCbcDecryptor expected_decryptor(kNoPadding, constant_iv_flag);
+    ASSERT_TRUE(expected_decryptor.InitializeWithIv(key_, iv));
+    AesEvpCryptor decryptor(AesEvpCryptor::kCbcMode, AesEvpCryptor::kDecrypt,
+                            constant_iv_flag);
+    ASSERT_TRUE(decryptor.InitializeWithIv(key_, iv));
+    EXPECT_EQ(CryptInChunks(&expected_decryptor, ciphertext),
+              CryptInChunks(&decryptor, ciphertext));
+  }
+}
+
+TEST_F(AesEvpCryptorTest, InPlace) {
+  const std::vector<uint8_t> iv(std::begin(kIv16), std::end(kIv16));
+  for (AesEvpCryptor::CipherMode cipher_mode :
+       {AesEvpCryptor::kCtrMode, AesEvpCryptor::kCbcMode}) {
+    AesEvpCryptor encryptor(cipher_mode, AesEvpCryptor::kEncrypt,
+                            AesCryptor::kDontUseConstantIv);
+    ASSERT_TRUE(encryptor.InitializeWithIv(key_, iv));
+    std::vector<uint8_t> expected_ciphertext;
+    ASSERT_TRUE(encryptor.Crypt(text_, &expected_ciphertext));
+
+    ASSERT_TRUE(encryptor.SetIv(iv));
+    std::vector<uint8_t> buffer = text_;
+    ASSERT_TRUE(encryptor.Crypt(buffer.data(), buffer.size(), buffer.data()));
+    EXPECT_EQ(expected_ciphertext, buffer);
+
+    AesEvpCryptor decryptor(cipher_mode, AesEvpCryptor::kDecrypt,
+                            AesCryptor::kDontUseConstantIv);
+    ASSERT_TRUE(decryptor.InitializeWithIv(key_, iv));
+    ASSERT_TRUE(decryptor.Crypt(buffer.data(), buffer.size(), buffer.data()));
+    EXPECT_EQ(text_, buffer);
+  }
+}
+
+TEST_F(AesEvpCryptorTest, CryptBuffers) {
+  const size_t kNumBuffers = 5;
+  const size_t kBufferSize = text_.size() / kNumBuffers;
+  std::vector<uint8_t> ciphertext(text_.size());
+  std::vector<AesCryptor::CryptBuffer> buffers(kNumBuffers);
+  for (size_t i = 0; i < kNumBuffers; ++i) {
+    buffers[i].text = &text_[i * kBufferSize];
+    buffers[i].text_size = kBufferSize;
+    buffers[i].crypt_text = &ciphertext[i * kBufferSize];
+    buffers[i].iv.assign(std::begin(kIv8), std::end(kIv8));
+    buffers[i].iv.back() += static_cast<uint8_t>(i);
+  }
+
+  AesEvpCryptor encryptor(AesEvpCryptor::kCtrMode, AesEvpCryptor::kEncrypt,
+                          AesCryptor::kDontUseConstantIv);
+  ASSERT_TRUE(encryptor.InitializeWithIv(key_, buffers[0].iv));
+  ASSERT_TRUE(encryptor.CryptBuffers(buffers));
+  EXPECT_EQ(buffers.back().iv, encryptor.iv());
+
+  for (size_t i = 0; i < kNumBuffers; ++i) {
+    AesCtrEncryptor expected_encryptor;
+    ASSERT_TRUE(expected_encryptor.InitializeWithIv(key_, buffers[i].iv));
+    std::vector<uint8_t> expected_ciphertext(kBufferSize);
+    ASSERT_TRUE(expected_encryptor.Crypt(buffers[i].text, kBufferSize,
+                                         expected_ciphertext.data()));
+    EXPECT_EQ(expected_ciphertext,
+              std::vector<uint8_t>(buffers[i].crypt_text,
+                                   buffers[i].crypt_text + kBufferSize));
+  }
+}
+
+TEST_F(AesEvpCryptorTest, UnsupportedKeySize) {
+  AesEvpCryptor encryptor(AesEvpCryptor::kCtrMode, AesEvpCryptor::kEncrypt,
+                          AesCryptor::kDontUseConstantIv);
+  const std::vector<uint8_t> key(15, 0);
+  EXPECT_FALSE(encryptor.InitializeWithIv(
+      key, std::vector<uint8_t>(std::begin(kIv8), std::end(kIv8))));
+}
+
+// Compares the EVP backend with the low level AES backend. Run with
+// --gtest_also_run_disabled_tests.
+class AesEvpCryptorBenchmark : public ::testing::Test {
+ public:
+  AesEvpCryptorBenchmark()
+      : key_(std::begin(kKey), std::end(kKey)),
+        iv_(std::begin(kIv16), std::end(kIv16)),
+        text_(GetText(kSampleSize * kNumSamples)),
+        crypt_text_(text_.size()) {}
+
+ protected:
+  static const size_t kSampleSize = 64 * 1024;
+  static const size_t kNumSamples = 256;
+  static const int kNumIterations = 16;
+
+  // Encrypts the samples of |text_| one at a time, chaining the iv.
+  void Run(const std::string& name, AesCryptor* cryptor) {
+    ASSERT_TRUE(cryptor->InitializeWithIv(key_, iv_));
+    const base::TimeTicks start = base::TimeTicks::Now();
+    for (int i = 0; i < kNumIterations; ++i) {
+      for (size_t offset = 0; offset < text_.size(); offset += kSampleSize) {
+        ASSERT_TRUE(cryptor->Crypt(&text_[offset], kSampleSize,
+                                   &crypt_text_[offset]));
+        cryptor->UpdateIv();
+      }
+    }
+    Report(name, base::TimeTicks::Now() - start);
+  }
+
+  // Encrypts all the samples of |text_| in one call.
+  void RunCryptBuffers(const std::string& name, AesCryptor* cryptor) {
+    ASSERT_TRUE(cryptor->InitializeWithIv(key_, iv_));
+    std::vector<AesCryptor::CryptBuffer> buffers(kNumSamples);
+    for (size_t i = 0; i < kNumSamples; ++i) {
+      buffers[i].text = &text_[i * kSampleSize];
+      buffers[i].text_size = kSampleSize;
+      buffers[i].crypt_text = &crypt_text_[i * kSampleSize];
+      ASSERT_TRUE(AesCryptor::GenerateRandomIv(FOURCC_cenc, &buffers[i].iv));
+    }
+    const base::TimeTicks start = base::TimeTicks::Now();
+    for (int i = 0; i < kNumIterations; ++i)
+      ASSERT_TRUE(cryptor->CryptBuffers(buffers));
+    Report(name, base::TimeTicks::Now() - start);
+  }
+
+  void Report(const std::string& name, base::TimeDelta elapsed) {
+    const double total_mb =
+        kNumIterations * text_.size() / (1024.0 * 1024.0);
+    LOG(INFO) << name << ": " << elapsed.InMilliseconds() << " ms, "
+              << total_mb / elapsed.InSecondsF() << " MB/s.";
+  }
+
+  std::vector<uint8_t> key_;
+  std::vector<uint8_t> iv_;
+  std::vector<uint8_t> text_;
+  std::vector<uint8_t> crypt_text_;
+};
+
+TEST_F(AesEvpCryptorBenchmark, DISABLED_Ctr) {
+  AesCtrEncryptor aes_encryptor;
+  Run("AES-CTR", &aes_encryptor);
+  AesEvpCryptor evp_encryptor(AesEvpCryptor::kCtrMode,
+                              AesEvpCryptor::kEncrypt,
+                              AesCryptor::kDontUseConstantIv);
+  Run("EVP AES-CTR", &evp_encryptor);
+}
+
+TEST_F(AesEvpCryptorBenchmark, DISABLED_CbcEncrypt) {
+  AesCbcEncryptor aes_encryptor(kNoPadding, AesCryptor::kUseConstantIv);
+  Run("AES-CBC encrypt", &aes_encryptor);
+  AesEvpCryptor evp_encryptor(AesEvpCryptor::kCbcMode,
+                              AesEvpCryptor::kEncrypt,
+                              AesCryptor::kUseConstantIv);
+  Run("EVP AES-CBC encrypt", &evp_encryptor);
+}
+
+TEST_F(AesEvpCryptorBenchmark, DISABLED_CbcDecrypt) {
+  AesCbcDecryptor aes_decryptor(kNoPadding, AesCryptor::kUseConstantIv);
+  Run("AES-CBC decrypt", &aes_decryptor);
+  AesEvpCryptor evp_decryptor(AesEvpCryptor::kCbcMode,
+                              AesEvpCryptor::kDecrypt,
+                              AesCryptor::kUseConstantIv);
+  Run("EVP AES-CBC decrypt", &evp_decryptor);
+}
+
+TEST_F(AesEvpCryptorBenchmark, DISABLED_CtrCryptBuffers) {
+  AesCtrEncryptor aes_encryptor;
+  RunCryptBuffers("AES-CTR buffers", &aes_encryptor);
+  AesEvpCryptor evp_encryptor(AesEvpCryptor::kCtrMode,
+                              AesEvpCryptor::kEncrypt,
+                              AesCryptor::kDontUseConstantIv);
+  RunCryptBuffers("EVP AES-CTR buffers", &evp_encryptor);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,156 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/crypto_period_key_cache.h"
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+#include "packager/base/strings/stringprintf.h"
+
+namespace shaka {
+namespace media {
+
+CryptoPeriodKeyCache::CryptoPeriodKeyCache(
+    uint32_t first_crypto_period_index,
+    uint32_t prefetch_crypto_period_count,
+    uint32_t retained_crypto_period_count)
+    : prefetch_crypto_period_count_(prefetch_crypto_period_count),
+      retained_crypto_period_count_(retained_crypto_period_count),
+      keys_added_cv_(&lock_),
+      prefetch_cv_(&lock_),
+      first_available_index_(first_crypto_period_index),
+      latest_requested_index_(first_crypto_period_index) {
+  DCHECK_GT(prefetch_crypto_period_count, 0u);
+}
+
+CryptoPeriodKeyCache::~CryptoPeriodKeyCache() {}
+
+void CryptoPeriodKeyCache::Put(
+    uint32_t crypto_period_index,
+    std::shared_ptr<EncryptionKeyMap> encryption_key_map) {
+  DCHECK(encryption_key_map);
+  base::AutoLock scoped_lock(lock_);
+  if (crypto_period_index < first_available_index_) {
+    VLOG(1) << "Dropping keys of evicted crypto period "
+            << crypto_period_index;
+    return;
+  }
+  cache_[crypto_period_index] = std::move(encryption_key_map);
+  keys_added_cv_.Broadcast();
+}
+
+Status CryptoPeriodKeyCache::Get(
+    uint32_t crypto_period_index,
+    int64_t timeout_ms,
+    std::shared_ptr<EncryptionKeyMap>* encryption_key_map) {
+  DCHECK(encryption_key_map);
+  DCHECK_GE(timeout_ms, 0);
+
+  base::AutoLock scoped_lock(lock_);
+  UpdateLatestRequestedIndex(crypto_period_index);
+
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  const base::TimeDelta timeout = base::TimeDelta::FromMilliseconds(timeout_ms);
+  bool waited = false;
+  while (true) {
+    if (crypto_period_index < first_available_index_) {
+      if (waited)
+        RecordStall(base::TimeTicks::Now() - start_time);
+      return Status(
+          error::INVALID_ARGUMENT,
+          base::StringPrintf("Crypto period %u is no longer available. The "
+                             "first available crypto period is %u.",
+                             crypto_period_index, first_available_index_));
+    }
+
+    auto iter = cache_.find(crypto_period_index);
+    if (iter != cache_.end()) {
+      if (waited) {
+        RecordStall(base::TimeTicks::Now() - start_time);
+      } else {
+        ++statistics_.hits;
+      }
+      *encryption_key_map = iter->second;
+      return Status::OK;
+    }
+
+    if (stopped_) {
+      if (waited)
+        RecordStall(base::TimeTicks::Now() - start_time);
+      return Status(error::STOPPED, "");
+    }
+
+    const base::TimeDelta elapsed = base::TimeTicks::Now() - start_time;
+    if (elapsed >= timeout) {
+      RecordStall(elapsed);
+      return Status(error::TIME_OUT,
+                    base::StringPrintf(
+                        "Time out on getting keys of crypto period %u.",
+                        crypto_period_index));
+    }
+    if (!waited) {
+      VLOG(1) << "Waiting for the keys of crypto period "
+              << crypto_period_index;
+      waited = true;
+    }
+    keys_added_cv_.TimedWait(timeout - elapsed);
+  }
+}
+
+bool CryptoPeriodKeyCache::WaitForPrefetch(uint32_t crypto_period_index) {
+  base::AutoLock scoped_lock(lock_);
+  while (!stopped_ &&
+         crypto_period_index >=
+             latest_requested_index_ + prefetch_crypto_period_count_) {
+    prefetch_cv_.Wait();
+  }
+  return !stopped_;
+}
+
+void CryptoPeriodKeyCache::Stop() {
+  base::AutoLock scoped_lock(lock_);
+  stopped_ = true;
+  keys_added_cv_.Broadcast();
+  prefetch_cv_.Broadcast();
+}
+
+CryptoPeriodKeyCache::Statistics CryptoPeriodKeyCache::GetStatistics() {
+  base::AutoLock scoped_lock(lock_);
+  return statistics_;
+}
+
+void CryptoPeriodKeyCache::UpdateLatestRequestedIndex(
+    uint32_t crypto_period_index) {
+  lock_.AssertAcquired();
+  if (crypto_period_index <= latest_requested_index_)
+    return;
+  latest_requested_index_ = crypto_period_index;
+  prefetch_cv_.Broadcast();
+
+  if (latest_requested_index_ <
+      first_available_index_ + retained_crypto_period_count_) {
+    return;
+  }
+  first_available_index_ =
+      latest_requested_index_ - retained_crypto_period_count_;
+  while (!cache_.empty() && cache_.begin()->first < first_available_index_) {
+    cache_.erase(cache_.begin());
+    ++statistics_.evictions;
+  }
+  // Wakes up the Get() calls waiting for the evicted crypto periods.
+  keys_added_cv_.Broadcast();
+}
+
+void CryptoPeriodKeyCache::RecordStall(base::TimeDelta stall_time) {
+  lock_.AssertAcquired();
+  ++statistics_.misses;
+  statistics_.total_stall_time += stall_time;
+  statistics_.max_stall_time = std::max(statistics_.max_stall_time, stall_time);
+}
+
+}  // namespace media
+}  // namespace shaka
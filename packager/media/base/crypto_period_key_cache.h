@@ -0,0 +1,116 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_CRYPTO_PERIOD_KEY_CACHE_H_
+#define PACKAGER_MEDIA_BASE_CRYPTO_PERIOD_KEY_CACHE_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/key_source.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// Caches the keys of the crypto periods for key rotation. The keys of a crypto
+/// period are shared by all the streams, i.e. all the stream labels.
+/// The cache tracks the latest crypto period requested by the streams, so that
+/// the keys can be prefetched a number of crypto periods ahead of it and a
+/// stream crossing a crypto period boundary does not wait for a key server
+/// round trip. Crypto periods falling too far behind the latest requested one
+/// are evicted. This class is thread safe.
+class CryptoPeriodKeyCache {
+ public:
+  struct Statistics {
+    /// Number of Get() calls served without waiting.
+    uint64_t hits = 0;
+    /// Number of Get() calls which had to wait for the keys.
+    uint64_t misses = 0;
+    /// Total and maximum time spent waiting in Get().
+    base::TimeDelta total_stall_time;
+    base::TimeDelta max_stall_time;
+    /// Number of crypto periods evicted.
+    uint64_t evictions = 0;
+  };
+
+  /// @param first_crypto_period_index is the first crypto period to be cached.
+  ///        Earlier crypto periods are not available.
+  /// @param prefetch_crypto_period_count is the number of crypto periods to
+  ///        fetch ahead of the latest requested crypto period.
+  /// @param retained_crypto_period_count is the number of crypto periods kept
+  ///        behind the latest requested crypto period, for the streams lagging
+  ///        behind.
+  CryptoPeriodKeyCache(uint32_t first_crypto_period_index,
+                       uint32_t prefetch_crypto_period_count,
+                       uint32_t retained_crypto_period_count);
+  ~CryptoPeriodKeyCache();
+
+  /// Add the keys of a crypto period to the cache. The Get() calls waiting for
+  /// the crypto period are woken up.
+  /// @param crypto_period_index is the index of the crypto period.
+  /// @param encryption_key_map contains the keys of the crypto period.
+  void Put(uint32_t crypto_period_index,
+           std::shared_ptr<EncryptionKeyMap> encryption_key_map);
+
+  /// Get the keys of a crypto period, waiting for them to be added if needed.
+  /// @param crypto_period_index is the index of the crypto period.
+  /// @param timeout_ms is the maximum time to wait, in milliseconds.
+  /// @param[out] encryption_key_map receives the keys of the crypto period.
+  /// @return OK on success, INVALID_ARGUMENT if the crypto period has been
+  ///         evicted or is before the first crypto period, TIME_OUT on
+  ///         timeout and STOPPED if the cache is stopped before the keys are
+  ///         added.
+  Status Get(uint32_t crypto_period_index,
+             int64_t timeout_ms,
+             std::shared_ptr<EncryptionKeyMap>* encryption_key_map);
+
+  /// Wait until the keys of @a crypto_period_index should be fetched, i.e.
+  /// until it is within the prefetch window of the latest requested crypto
+  /// period, or until the cache is stopped.
+  /// @return true if the keys should be fetched, false if the cache is stopped.
+  bool WaitForPrefetch(uint32_t crypto_period_index);
+
+  /// Stop the cache. Pending and future Get() calls for the crypto periods not
+  /// in the cache return STOPPED.
+  void Stop();
+
+  /// @return the statistics of the cache.
+  Statistics GetStatistics();
+
+ private:
+  CryptoPeriodKeyCache(const CryptoPeriodKeyCache&) = delete;
+  CryptoPeriodKeyCache& operator=(const CryptoPeriodKeyCache&) = delete;
+
+  // Records a request of |crypto_period_index| and evicts the crypto periods
+  // that fell out of the retention window. Must be called with |lock_| held.
+  void UpdateLatestRequestedIndex(uint32_t crypto_period_index);
+  // Must be called with |lock_| held.
+  void RecordStall(base::TimeDelta stall_time);
+
+  const uint32_t prefetch_crypto_period_count_;
+  const uint32_t retained_crypto_period_count_;
+
+  base::Lock lock_;
+  base::ConditionVariable keys_added_cv_;
+  base::ConditionVariable prefetch_cv_;
+  std::map<uint32_t, std::shared_ptr<EncryptionKeyMap>> cache_;
+  // Crypto periods before this index are not available.
+  uint32_t first_available_index_;
+  uint32_t latest_requested_index_;
+  bool stopped_ = false;
+  Statistics statistics_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_CRYPTO_PERIOD_KEY_CACHE_H_
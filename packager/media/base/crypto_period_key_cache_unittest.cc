@@ -0,0 +1,160 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/crypto_period_key_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/bind.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const uint32_t kFirstCryptoPeriodIndex = 10;
+const uint32_t kPrefetchCount = 4;
+const uint32_t kRetainedCount = 3;
+const int64_t kTimeoutMs = 100;
+const int64_t kLongTimeoutMs = 60 * 1000;
+
+std::shared_ptr<EncryptionKeyMap> CreateKeys(uint32_t crypto_period_index) {
+  std::shared_ptr<EncryptionKeyMap> encryption_key_map =
+      std::make_shared<EncryptionKeyMap>();
+  std::unique_ptr<EncryptionKey> encryption_key(new EncryptionKey);
+  encryption_key->key.assign(1, static_cast<uint8_t>(crypto_period_index));
+  (*encryption_key_map)["SD"] = std::move(encryption_key);
+  return encryption_key_map;
+}
+}  // namespace
+
+class CryptoPeriodKeyCacheTest : public ::testing::Test {
+ public:
+  CryptoPeriodKeyCacheTest()
+      : key_cache_(kFirstCryptoPeriodIndex, kPrefetchCount, kRetainedCount) {}
+
+ protected:
+  CryptoPeriodKeyCache key_cache_;
+};
+
+TEST_F(CryptoPeriodKeyCacheTest, Hit) {
+  key_cache_.Put(kFirstCryptoPeriodIndex, CreateKeys(kFirstCryptoPeriodIndex));
+
+  std::shared_ptr<EncryptionKeyMap> encryption_key_map;
+  ASSERT_OK(key_cache_.Get(kFirstCryptoPeriodIndex, kTimeoutMs,
+                           &encryption_key_map));
+  EXPECT_EQ(kFirstCryptoPeriodIndex, encryption_key_map->at("SD")->key[0]);
+
+  const CryptoPeriodKeyCache::Statistics statistics =
+      key_cache_.GetStatistics();
+  EXPECT_EQ(1u, statistics.hits);
+  EXPECT_EQ(0u, statistics.misses);
+}
+
+TEST_F(CryptoPeriodKeyCacheTest, TimeOut) {
+  std::shared_ptr<EncryptionKeyMap> encryption_key_map;
+  EXPECT_EQ(error::TIME_OUT,
+            key_cache_.Get(kFirstCryptoPeriodIndex, kTimeoutMs,
+                           &encryption_key_map)
+                .error_code());
+
+  const CryptoPeriodKeyCache::Statistics statistics =
+      key_cache_.GetStatistics();
+  EXPECT_EQ(0u, statistics.hits);
+  EXPECT_EQ(1u, statistics.misses);
+  EXPECT_GE(statistics.total_stall_time.InMilliseconds(), kTimeoutMs);
+}
+
+TEST_F(CryptoPeriodKeyCacheTest, BeforeFirstCryptoPeriod) {
+  std::shared_ptr<EncryptionKeyMap> encryption_key_map;
+  EXPECT_EQ(error::INVALID_ARGUMENT,
+            key_cache_.Get(kFirstCryptoPeriodIndex - 1, kTimeoutMs,
+                           &encryption_key_map)
+                .error_code());
+}
+
+TEST_F(CryptoPeriodKeyCacheTest, Eviction) {
+  const uint32_t kLatestIndex = kFirstCryptoPeriodIndex + 5;
+  for (uint32_t i = kFirstCryptoPeriodIndex; i <= kLatestIndex; ++i)
+    key_cache_.Put(i, CreateKeys(i));
+
+  std::shared_ptr<EncryptionKeyMap> encryption_key_map;
+  ASSERT_OK(key_cache_.Get(kLatestIndex, kTimeoutMs, &encryption_key_map));
+  // The crypto periods within the retention window are still available.
+  ASSERT_OK(key_cache_.Get(kLatestIndex - kRetainedCount, kTimeoutMs,
+                           &encryption_key_map));
+  EXPECT_EQ(error::INVALID_ARGUMENT,
+            key_cache_.Get(kLatestIndex - kRetainedCount - 1, kTimeoutMs,
+                           &encryption_key_map)
+                .error_code());
+  EXPECT_EQ(kLatestIndex - kRetainedCount - kFirstCryptoPeriodIndex,
+            key_cache_.GetStatistics().evictions);
+}
+
+TEST_F(CryptoPeriodKeyCacheTest, Stop) {
+  key_cache_.Put(kFirstCryptoPeriodIndex, CreateKeys(kFirstCryptoPeriodIndex));
+  key_cache_.Stop();
+
+  EXPECT_FALSE(key_cache_.WaitForPrefetch(kFirstCryptoPeriodIndex));
+  std::shared_ptr<EncryptionKeyMap> encryption_key_map;
+  // Keys already in the cache are still available.
+  ASSERT_OK(key_cache_.Get(kFirstCryptoPeriodIndex, kTimeoutMs,
+                           &encryption_key_map));
+  EXPECT_EQ(error::STOPPED,
+            key_cache_.Get(kFirstCryptoPeriodIndex + 1, kTimeoutMs,
+                           &encryption_key_map)
+                .error_code());
+}
+
+class CryptoPeriodKeyCachePrefetchTest : public CryptoPeriodKeyCacheTest {
+ public:
+  CryptoPeriodKeyCachePrefetchTest()
+      : producer_thread_(
+            "ProducerThread",
+            base::Bind(&CryptoPeriodKeyCachePrefetchTest::ProduceKeysTask,
+                       base::Unretained(this))) {}
+
+  void SetUp() override { producer_thread_.Start(); }
+  void TearDown() override {
+    key_cache_.Stop();
+    producer_thread_.Join();
+  }
+
+ protected:
+  void ProduceKeysTask() {
+    uint32_t crypto_period_index = kFirstCryptoPeriodIndex;
+    while (key_cache_.WaitForPrefetch(crypto_period_index)) {
+      key_cache_.Put(crypto_period_index, CreateKeys(crypto_period_index));
+      base::AutoLock scoped_lock(lock_);
+      next_index_to_produce_ = ++crypto_period_index;
+    }
+  }
+
+  uint32_t next_index_to_produce() {
+    base::AutoLock scoped_lock(lock_);
+    return next_index_to_produce_;
+  }
+
+  ClosureThread producer_thread_;
+  base::Lock lock_;
+  uint32_t next_index_to_produce_ = kFirstCryptoPeriodIndex;
+};
+
+TEST_F(CryptoPeriodKeyCachePrefetchTest, PrefetchAhead) {
+  const uint32_t kNumCryptoPeriods = 20;
+  std::shared_ptr<EncryptionKeyMap> encryption_key_map;
+  for (uint32_t i = kFirstCryptoPeriodIndex;
+       i < kFirstCryptoPeriodIndex + kNumCryptoPeriods; ++i) {
+    ASSERT_OK(key_cache_.Get(i, kLongTimeoutMs, &encryption_key_map));
+    EXPECT_EQ(i, encryption_key_map->at("SD")->key[0]);
+    // The producer never runs more than the prefetch count ahead.
+    EXPECT_LE(next_index_to_produce(), i + kPrefetchCount);
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -7,7 +7,7 @@
 #include "packager/media/base/decryptor_source.h"
 
 #include "packager/base/logging.h"
-#include "packager/media/base/aes_decryptor.h"
+#include "packager/media/base/aes_evp_cryptor.h"
 #include "packager/media/base/aes_pattern_cryptor.h"
 
 namespace {
@@ -59,10 +59,11 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
     std::unique_ptr<AesCryptor> aes_decryptor;
     switch (decrypt_config->protection_scheme()) {
       case FOURCC_cenc:
-        aes_decryptor.reset(new AesCtrDecryptor);
+        aes_decryptor = CreateAesCtrCryptor();
         break;
       case FOURCC_cbc1:
-        aes_decryptor.reset(new AesCbcDecryptor(kNoPadding));
+        aes_decryptor =
+            CreateAesCbcDecryptor(AesCryptor::kDontUseConstantIv);
         break;
       case FOURCC_cens:
         aes_decryptor.reset(new AesPatternCryptor(
@@ -70,7 +71,7 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
             decrypt_config->skip_byte_block(),
             AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
             AesCryptor::kDontUseConstantIv,
-            std::unique_ptr<AesCryptor>(new AesCtrDecryptor())));
+            CreateAesCtrCryptor()));
         break;
       case FOURCC_cbcs:
         aes_decryptor.reset(new AesPatternCryptor(
@@ -78,7 +79,7 @@ bool DecryptorSource::DecryptSampleBuffer(const DecryptConfig* decrypt_config,
             decrypt_config->skip_byte_block(),
             AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
             AesCryptor::kUseConstantIv,
-            std::unique_ptr<AesCryptor>(new AesCbcDecryptor(kNoPadding))));
+            CreateAesCbcDecryptor(AesCryptor::kDontUseConstantIv)));
         break;
       default:
         LOG(ERROR) << "Unsupported protection scheme: "
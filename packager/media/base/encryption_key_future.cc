@@ -0,0 +1,71 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/encryption_key_future.h"
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+EncryptionKeyFuture::EncryptionKeyFuture() : ready_cv_(&lock_) {}
+
+EncryptionKeyFuture::~EncryptionKeyFuture() {}
+
+// static
+std::shared_ptr<EncryptionKeyFuture> EncryptionKeyFuture::FromResult(
+    const Status& status,
+    const EncryptionKey& key) {
+  std::shared_ptr<EncryptionKeyFuture> future(new EncryptionKeyFuture);
+  future->SetResult(status, key);
+  return future;
+}
+
+void EncryptionKeyFuture::SetResult(const Status& status,
+                                    const EncryptionKey& key) {
+  std::vector<Callback> callbacks;
+  {
+    base::AutoLock scoped_lock(lock_);
+    DCHECK(!ready_) << "The result is already set.";
+    ready_ = true;
+    status_ = status;
+    key_ = key;
+    callbacks.swap(callbacks_);
+    ready_cv_.Broadcast();
+  }
+  // The callbacks run without the lock, so they can use this future.
+  for (const Callback& callback : callbacks)
+    callback(status, key);
+}
+
+bool EncryptionKeyFuture::IsReady() {
+  base::AutoLock scoped_lock(lock_);
+  return ready_;
+}
+
+Status EncryptionKeyFuture::Wait(EncryptionKey* key) {
+  base::AutoLock scoped_lock(lock_);
+  while (!ready_)
+    ready_cv_.Wait();
+  if (key && status_.ok())
+    *key = key_;
+  return status_;
+}
+
+void EncryptionKeyFuture::AddCallback(const Callback& callback) {
+  {
+    base::AutoLock scoped_lock(lock_);
+    if (!ready_) {
+      callbacks_.push_back(callback);
+      return;
+    }
+  }
+  // |status_| and |key_| do not change once the result is set.
+  callback(status_, key_);
+}
+
+}  // namespace media
+}  // namespace shaka
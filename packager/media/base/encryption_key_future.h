@@ -0,0 +1,73 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_ENCRYPTION_KEY_FUTURE_H_
+#define PACKAGER_MEDIA_BASE_ENCRYPTION_KEY_FUTURE_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/base/key_source.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// Holds the result of an asynchronous key request, e.g.
+/// KeySource::GetCryptoPeriodKeyAsync(). The result is set once by the key
+/// source. It can be waited for, or observed with a callback. This class is
+/// thread safe.
+class EncryptionKeyFuture {
+ public:
+  typedef std::function<void(const Status& status, const EncryptionKey& key)>
+      Callback;
+
+  EncryptionKeyFuture();
+  ~EncryptionKeyFuture();
+
+  /// @return a future which already holds the result.
+  static std::shared_ptr<EncryptionKeyFuture> FromResult(
+      const Status& status,
+      const EncryptionKey& key);
+
+  /// Set the result, waking up the waiters and running the callbacks on the
+  /// calling thread. Must be called exactly once.
+  /// @param status is the status of the request.
+  /// @param key is the key on success.
+  void SetResult(const Status& status, const EncryptionKey& key);
+
+  /// @return true if the result has been set, i.e. Wait() does not block.
+  bool IsReady();
+
+  /// Wait for the result.
+  /// @param[out] key receives the key on success. Can be NULL.
+  /// @return the status of the request.
+  Status Wait(EncryptionKey* key);
+
+  /// Run @a callback with the result when it is set. It runs immediately on
+  /// the calling thread if the result is already set, otherwise on the thread
+  /// setting the result.
+  void AddCallback(const Callback& callback);
+
+ private:
+  EncryptionKeyFuture(const EncryptionKeyFuture&) = delete;
+  EncryptionKeyFuture& operator=(const EncryptionKeyFuture&) = delete;
+
+  base::Lock lock_;
+  base::ConditionVariable ready_cv_;
+  bool ready_ = false;
+  Status status_;
+  EncryptionKey key_;
+  std::vector<Callback> callbacks_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_ENCRYPTION_KEY_FUTURE_H_
@@ -0,0 +1,135 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/encryption_key_future.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const uint32_t kCryptoPeriodIndex = 7;
+const uint32_t kCryptoPeriodDurationInSeconds = 10;
+const char kStreamLabel[] = "SD";
+
+EncryptionKey CreateKey(uint8_t value) {
+  EncryptionKey key;
+  key.key.assign(16, value);
+  return key;
+}
+
+// A key source implementing only the synchronous interface, to exercise the
+// default GetCryptoPeriodKeyAsync().
+class SyncKeySource : public KeySource {
+ public:
+  SyncKeySource() : KeySource(0, FOURCC_cenc) {}
+
+  Status FetchKeys(EmeInitDataType init_data_type,
+                   const std::vector<uint8_t>& init_data) override {
+    return Status::OK;
+  }
+  Status GetKey(const std::string& stream_label, EncryptionKey* key) override {
+    return Status(error::UNIMPLEMENTED, "");
+  }
+  Status GetKey(const std::vector<uint8_t>& key_id,
+                EncryptionKey* key) override {
+    return Status(error::UNIMPLEMENTED, "");
+  }
+  Status GetCryptoPeriodKey(uint32_t crypto_period_index,
+                            uint32_t crypto_period_duration_in_seconds,
+                            const std::string& stream_label,
+                            EncryptionKey* key) override {
+    thread_id_ = base::PlatformThread::CurrentId();
+    if (stream_label != kStreamLabel)
+      return Status(error::NOT_FOUND, "Unknown stream label.");
+    *key = CreateKey(static_cast<uint8_t>(crypto_period_index));
+    return Status::OK;
+  }
+
+  base::PlatformThreadId thread_id() const { return thread_id_; }
+
+ private:
+  base::PlatformThreadId thread_id_ = base::kInvalidThreadId;
+};
+}  // namespace
+
+TEST(EncryptionKeyFutureTest, FromResult) {
+  std::shared_ptr<EncryptionKeyFuture> future =
+      EncryptionKeyFuture::FromResult(Status::OK, CreateKey(1));
+  EXPECT_TRUE(future->IsReady());
+  EncryptionKey key;
+  ASSERT_OK(future->Wait(&key));
+  EXPECT_EQ(CreateKey(1).key, key.key);
+}
+
+TEST(EncryptionKeyFutureTest, WaitForResult) {
+  EncryptionKeyFuture future;
+  EXPECT_FALSE(future.IsReady());
+
+  ClosureThread thread(
+      "SetResultThread",
+      base::Bind(
+          [](EncryptionKeyFuture* future) {
+            base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(10));
+            future->SetResult(Status::OK, CreateKey(2));
+          },
+          base::Unretained(&future)));
+  thread.Start();
+
+  EncryptionKey key;
+  ASSERT_OK(future.Wait(&key));
+  EXPECT_TRUE(future.IsReady());
+  EXPECT_EQ(CreateKey(2).key, key.key);
+  thread.Join();
+}
+
+TEST(EncryptionKeyFutureTest, Callbacks) {
+  EncryptionKeyFuture future;
+  int num_callbacks = 0;
+  auto callback = [&num_callbacks](const Status& status,
+                                   const EncryptionKey& key) {
+    EXPECT_EQ(error::NOT_FOUND, status.error_code());
+    ++num_callbacks;
+  };
+
+  future.AddCallback(callback);
+  EXPECT_EQ(0, num_callbacks);
+  future.SetResult(Status(error::NOT_FOUND, ""), EncryptionKey());
+  EXPECT_EQ(1, num_callbacks);
+  // Runs immediately once the result is set.
+  future.AddCallback(callback);
+  EXPECT_EQ(2, num_callbacks);
+  EXPECT_EQ(error::NOT_FOUND, future.Wait(nullptr).error_code());
+}
+
+TEST(EncryptionKeyFutureTest, DefaultAsyncKeySource) {
+  SyncKeySource key_source;
+  std::shared_ptr<EncryptionKeyFuture> future =
+      key_source.GetCryptoPeriodKeyAsync(
+          kCryptoPeriodIndex, kCryptoPeriodDurationInSeconds, kStreamLabel);
+  EncryptionKey key;
+  ASSERT_OK(future->Wait(&key));
+  EXPECT_EQ(CreateKey(kCryptoPeriodIndex).key, key.key);
+  // The synchronous request runs on a worker thread.
+  EXPECT_NE(base::PlatformThread::CurrentId(), key_source.thread_id());
+}
+
+TEST(EncryptionKeyFutureTest, DefaultAsyncKeySourceError) {
+  SyncKeySource key_source;
+  std::shared_ptr<EncryptionKeyFuture> future =
+      key_source.GetCryptoPeriodKeyAsync(
+          kCryptoPeriodIndex, kCryptoPeriodDurationInSeconds, "UNKNOWN");
+  EXPECT_EQ(error::NOT_FOUND, future->Wait(nullptr).error_code());
+}
+
+}  // namespace media
+}  // namespace shaka
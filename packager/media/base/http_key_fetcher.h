@@ -18,11 +18,8 @@
 namespace shaka {
 namespace media {
 
-/// A KeyFetcher implementation that retrieves keys over HTTP(s).
-/// This class is not fully thread safe. It can be used in multi-thread
-/// environment once constructed, but it may not be safe to create a
-/// HttpKeyFetcher object when any other thread is running due to use of
-/// curl_global_init.
+/// A KeyFetcher implementation that retrieves keys over HTTP(s). Requests are
+/// sent through the process-wide HttpClient, which pools the connections.
 class HttpKeyFetcher : public KeyFetcher {
  public:
   /// Creates a fetcher with no timeout.
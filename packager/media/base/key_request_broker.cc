@@ -0,0 +1,127 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/key_request_broker.h"
+
+#include <gflags/gflags.h>
+
+#include "packager/base/logging.h"
+#include "packager/media/base/key_fetcher.h"
+
+DEFINE_int32(max_concurrent_key_requests,
+             0,
+             "Maximum number of concurrent requests to a Widevine key server "
+             "from all the Widevine key sources in the process. 0 means no "
+             "limit.");
+
+namespace shaka {
+namespace media {
+
+// static
+KeyRequestBroker* KeyRequestBroker::GetInstance() {
+  // Intentionally leaked: the key sources may be destroyed at exit.
+  static KeyRequestBroker* const instance = new KeyRequestBroker;
+  return instance;
+}
+
+KeyRequestBroker::KeyRequestBroker()
+    : request_done_cv_(&lock_),
+      max_concurrent_requests_per_server_(
+          FLAGS_max_concurrent_key_requests > 0
+              ? FLAGS_max_concurrent_key_requests
+              : 0) {}
+
+KeyRequestBroker::~KeyRequestBroker() {}
+
+Status KeyRequestBroker::FetchKeys(KeyFetcher* key_fetcher,
+                                   const std::string& server_url,
+                                   const std::string& dedup_key,
+                                   const std::string& request,
+                                   std::string* response) {
+  DCHECK(key_fetcher);
+  DCHECK(response);
+
+  if (dedup_key.empty()) {
+    {
+      base::AutoLock scoped_lock(lock_);
+      ++statistics_.num_requests;
+    }
+    return SendRequest(key_fetcher, server_url, request, response);
+  }
+
+  // The server url is part of the key, so identical requests to different
+  // servers are not merged.
+  const std::string in_flight_key = server_url + '\n' + dedup_key;
+  std::shared_ptr<InFlightRequest> in_flight_request;
+  {
+    base::AutoLock scoped_lock(lock_);
+    ++statistics_.num_requests;
+    auto iter = in_flight_requests_.find(in_flight_key);
+    if (iter != in_flight_requests_.end()) {
+      ++statistics_.num_deduplicated_requests;
+      in_flight_request = iter->second;
+      while (!in_flight_request->done)
+        request_done_cv_.Wait();
+      *response = in_flight_request->response;
+      return in_flight_request->status;
+    }
+    in_flight_request = std::make_shared<InFlightRequest>();
+    in_flight_requests_[in_flight_key] = in_flight_request;
+  }
+
+  Status status = SendRequest(key_fetcher, server_url, request, response);
+
+  base::AutoLock scoped_lock(lock_);
+  in_flight_request->status = status;
+  in_flight_request->response = *response;
+  in_flight_request->done = true;
+  in_flight_requests_.erase(in_flight_key);
+  request_done_cv_.Broadcast();
+  return status;
+}
+
+void KeyRequestBroker::set_max_concurrent_requests_per_server(
+    size_t max_concurrent_requests) {
+  base::AutoLock scoped_lock(lock_);
+  max_concurrent_requests_per_server_ = max_concurrent_requests;
+  request_done_cv_.Broadcast();
+}
+
+KeyRequestBroker::Statistics KeyRequestBroker::GetStatistics() {
+  base::AutoLock scoped_lock(lock_);
+  return statistics_;
+}
+
+Status KeyRequestBroker::SendRequest(KeyFetcher* key_fetcher,
+                                     const std::string& server_url,
+                                     const std::string& request,
+                                     std::string* response) {
+  {
+    base::AutoLock scoped_lock(lock_);
+    size_t& active_requests = active_requests_per_server_[server_url];
+    if (max_concurrent_requests_per_server_ > 0 &&
+        active_requests >= max_concurrent_requests_per_server_) {
+      ++statistics_.num_throttled_requests;
+      VLOG(1) << "Waiting for a request slot of " << server_url;
+      while (max_concurrent_requests_per_server_ > 0 &&
+             active_requests >= max_concurrent_requests_per_server_) {
+        request_done_cv_.Wait();
+      }
+    }
+    ++active_requests;
+    ++statistics_.num_server_requests;
+  }
+
+  Status status = key_fetcher->FetchKeys(server_url, request, response);
+
+  base::AutoLock scoped_lock(lock_);
+  --active_requests_per_server_[server_url];
+  request_done_cv_.Broadcast();
+  return status;
+}
+
+}  // namespace media
+}  // namespace shaka
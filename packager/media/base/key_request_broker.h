@@ -0,0 +1,104 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_KEY_REQUEST_BROKER_H_
+#define PACKAGER_MEDIA_BASE_KEY_REQUEST_BROKER_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+class KeyFetcher;
+
+/// A process-wide broker for the requests sent to the key servers by all the
+/// Widevine key sources in the process, e.g. by many Packager instances
+/// packaging live channels. Identical requests in flight at the same time are
+/// sent to the key server once and share the response. The number of
+/// concurrent requests to a key server can be limited with
+/// --max_concurrent_key_requests, so that key rotations happening at the same
+/// time in many channels do not flood the server. This class is thread safe.
+class KeyRequestBroker {
+ public:
+  struct Statistics {
+    /// Number of requests received by the broker.
+    uint64_t num_requests = 0;
+    /// Number of requests sent to the key servers.
+    uint64_t num_server_requests = 0;
+    /// Number of requests served with the response of an identical request.
+    uint64_t num_deduplicated_requests = 0;
+    /// Number of requests which waited because the key server already had
+    /// the maximum number of concurrent requests.
+    uint64_t num_throttled_requests = 0;
+  };
+
+  /// @return the process-wide KeyRequestBroker instance.
+  static KeyRequestBroker* GetInstance();
+
+  /// Fetch keys from a key server through the broker.
+  /// @param key_fetcher is used to send the request if it is not deduplicated.
+  /// @param server_url is the key server url.
+  /// @param dedup_key identifies the content of the request regardless of
+  ///        volatile data such as its signature. Concurrent requests to the
+  ///        same server with the same non-empty @a dedup_key are sent once.
+  /// @param request is the request to send.
+  /// @param[out] response receives the response of the server.
+  /// @return the status returned by @a key_fetcher.
+  Status FetchKeys(KeyFetcher* key_fetcher,
+                   const std::string& server_url,
+                   const std::string& dedup_key,
+                   const std::string& request,
+                   std::string* response);
+
+  /// Set the maximum number of concurrent requests to a key server.
+  /// 0 means no limit.
+  void set_max_concurrent_requests_per_server(size_t max_concurrent_requests);
+
+  /// @return the statistics of the requests received so far.
+  Statistics GetStatistics();
+
+ private:
+  struct InFlightRequest {
+    bool done = false;
+    Status status;
+    std::string response;
+  };
+
+  KeyRequestBroker();
+  ~KeyRequestBroker();
+
+  KeyRequestBroker(const KeyRequestBroker&) = delete;
+  KeyRequestBroker& operator=(const KeyRequestBroker&) = delete;
+
+  // Sends |request| once a request slot of |server_url| is available.
+  Status SendRequest(KeyFetcher* key_fetcher,
+                     const std::string& server_url,
+                     const std::string& request,
+                     std::string* response);
+
+  base::Lock lock_;
+  // Signaled when a request completes.
+  base::ConditionVariable request_done_cv_;
+  size_t max_concurrent_requests_per_server_;
+  // Number of requests being sent to each key server.
+  std::map<std::string, size_t> active_requests_per_server_;
+  // Requests being sent, keyed by server url and dedup key.
+  std::map<std::string, std::shared_ptr<InFlightRequest>> in_flight_requests_;
+  Statistics statistics_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_KEY_REQUEST_BROKER_H_
@@ -0,0 +1,200 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/key_request_broker.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/base/closure_thread.h"
+#include "packager/media/base/protection_system_specific_info.h"
+#include "packager/media/base/test/fake_key_server.h"
+#include "packager/media/base/widevine_key_source.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const char kServerUrl[] = "http://fake.key.server/getcontentkey";
+const char kContentId[] = "ContentFoo";
+const char kPolicy[] = "PolicyFoo";
+const size_t kNumThreads = 8;
+const size_t kNumChannels = 50;
+const int64_t kLatencyMs = 200;
+
+std::string ToString(const std::vector<uint8_t>& v) {
+  return std::string(v.begin(), v.end());
+}
+
+}  // namespace
+
+class KeyRequestBrokerTest : public ::testing::Test {
+ public:
+  KeyRequestBrokerTest()
+      : key_server_(base::TimeDelta::FromMilliseconds(kLatencyMs)),
+        broker_(KeyRequestBroker::GetInstance()) {}
+
+  void SetUp() override {
+    initial_statistics_ = broker_->GetStatistics();
+    broker_->set_max_concurrent_requests_per_server(0);
+  }
+
+ protected:
+  // Runs |task| on |num_threads| threads and waits for them to complete.
+  void RunOnThreads(size_t num_threads,
+                    const base::Callback<void(size_t)>& task) {
+    std::vector<std::unique_ptr<ClosureThread>> threads;
+    for (size_t i = 0; i < num_threads; ++i) {
+      threads.emplace_back(new ClosureThread(
+          "BrokerTestThread" + base::SizeTToString(i), base::Bind(task, i)));
+      threads.back()->Start();
+    }
+    for (auto& thread : threads)
+      thread->Join();
+  }
+
+  void FetchKeysTask(const std::string& dedup_key, size_t /* thread_index */) {
+    std::string response;
+    EXPECT_OK(broker_->FetchKeys(&key_server_, kServerUrl, dedup_key,
+                                 CreateRequest(), &response));
+    EXPECT_FALSE(response.empty());
+  }
+
+  void FetchDistinctKeysTask(size_t thread_index) {
+    FetchKeysTask("Request" + base::SizeTToString(thread_index),
+                  thread_index);
+  }
+
+  static std::string CreateRequest() {
+    return R"({"request":"eyJjb250ZW50X2lkIjoiUTI5dWRHVnVkRVp2Ync9PSJ9"})";
+  }
+
+  FakeKeyServer key_server_;
+  KeyRequestBroker* broker_;
+  KeyRequestBroker::Statistics initial_statistics_;
+};
+
+TEST_F(KeyRequestBrokerTest, DeduplicatesConcurrentRequests) {
+  RunOnThreads(kNumThreads,
+               base::Bind(&KeyRequestBrokerTest::FetchKeysTask,
+                          base::Unretained(this), std::string("SameRequest")));
+
+  const KeyRequestBroker::Statistics statistics = broker_->GetStatistics();
+  EXPECT_EQ(initial_statistics_.num_requests + kNumThreads,
+            statistics.num_requests);
+  EXPECT_EQ(key_server_.num_requests(),
+            statistics.num_server_requests -
+                initial_statistics_.num_server_requests);
+  EXPECT_EQ(kNumThreads,
+            key_server_.num_requests() + statistics.num_deduplicated_requests -
+                initial_statistics_.num_deduplicated_requests);
+  // The threads start well within the latency of the first request.
+  EXPECT_LT(key_server_.num_requests(), kNumThreads);
+}
+
+TEST_F(KeyRequestBrokerTest, DoesNotDeduplicateDistinctRequests) {
+  RunOnThreads(kNumThreads,
+               base::Bind(&KeyRequestBrokerTest::FetchDistinctKeysTask,
+                          base::Unretained(this)));
+  EXPECT_EQ(kNumThreads, key_server_.num_requests());
+}
+
+TEST_F(KeyRequestBrokerTest, LimitsConcurrentRequests) {
+  const size_t kMaxConcurrentRequests = 2;
+  broker_->set_max_concurrent_requests_per_server(kMaxConcurrentRequests);
+  RunOnThreads(kNumThreads,
+               base::Bind(&KeyRequestBrokerTest::FetchDistinctKeysTask,
+                          base::Unretained(this)));
+
+  EXPECT_EQ(kNumThreads, key_server_.num_requests());
+  EXPECT_LE(key_server_.max_concurrent_requests(), kMaxConcurrentRequests);
+  EXPECT_GT(broker_->GetStatistics().num_throttled_requests,
+            initial_statistics_.num_throttled_requests);
+}
+
+class KeyRequestBrokerKeySourceTest : public KeyRequestBrokerTest {
+ protected:
+  std::unique_ptr<WidevineKeySource> CreateKeySource(
+      const std::string& content_id) {
+    std::unique_ptr<WidevineKeySource> key_source(new WidevineKeySource(
+        kServerUrl, NO_PROTECTION_SYSTEM_FLAG, FOURCC_cenc));
+    key_source->set_key_fetcher(std::unique_ptr<KeyFetcher>(
+        new FakeKeyServerProxy(&key_server_)));
+    const std::vector<uint8_t> content_id_bytes(content_id.begin(),
+                                                content_id.end());
+    EXPECT_OK(key_source->FetchKeys(content_id_bytes, kPolicy));
+    return key_source;
+  }
+
+  void GetCryptoPeriodKeysTask(const std::string& content_id,
+                               uint32_t num_crypto_periods,
+                               size_t /* thread_index */) {
+    const uint32_t kCryptoPeriodDurationInSeconds = 10;
+    std::unique_ptr<WidevineKeySource> key_source = CreateKeySource(content_id);
+    for (uint32_t i = 0; i < num_crypto_periods; ++i) {
+      EncryptionKey key;
+      ASSERT_OK(key_source->GetCryptoPeriodKey(
+          i, kCryptoPeriodDurationInSeconds, "SD", &key));
+      EXPECT_EQ(FakeKeyServer::GetKey(content_id, "SD", i), ToString(key.key));
+    }
+  }
+
+  void GetChannelKeysTask(uint32_t num_crypto_periods, size_t thread_index) {
+    GetCryptoPeriodKeysTask("Channel" + base::SizeTToString(thread_index),
+                            num_crypto_periods, thread_index);
+  }
+
+ private:
+  // Forwards the requests to a FakeKeyServer shared by the key sources.
+  class FakeKeyServerProxy : public KeyFetcher {
+   public:
+    explicit FakeKeyServerProxy(FakeKeyServer* key_server)
+        : key_server_(key_server) {}
+
+    Status FetchKeys(const std::string& server_url,
+                     const std::string& request,
+                     std::string* response) override {
+      return key_server_->FetchKeys(server_url, request, response);
+    }
+
+   private:
+    FakeKeyServer* key_server_;
+  };
+};
+
+TEST_F(KeyRequestBrokerKeySourceTest, KeySourcesOfSameContent) {
+  const uint32_t kNumCryptoPeriods = 5;
+  RunOnThreads(
+      kNumThreads,
+      base::Bind(&KeyRequestBrokerKeySourceTest::GetCryptoPeriodKeysTask,
+                 base::Unretained(this), std::string(kContentId),
+                 kNumCryptoPeriods));
+  EXPECT_GT(broker_->GetStatistics().num_deduplicated_requests,
+            initial_statistics_.num_deduplicated_requests);
+}
+
+// Simulates a process hosting many live channels, each with its own key
+// source, rotating keys at the same time. Run with
+// --gtest_also_run_disabled_tests.
+TEST_F(KeyRequestBrokerKeySourceTest, DISABLED_ManyChannelsBenchmark) {
+  const uint32_t kNumCryptoPeriods = 100;
+  const base::TimeTicks start = base::TimeTicks::Now();
+  RunOnThreads(kNumChannels,
+               base::Bind(&KeyRequestBrokerKeySourceTest::GetChannelKeysTask,
+                          base::Unretained(this), kNumCryptoPeriods));
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+
+  LOG(INFO) << kNumChannels << " channels, " << kNumCryptoPeriods
+            << " crypto periods: " << elapsed.InMilliseconds() << " ms, "
+            << key_server_.num_requests() << " key server requests, at most "
+            << key_server_.max_concurrent_requests() << " concurrent.";
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -6,8 +6,12 @@
 
 #include "packager/media/base/key_source.h"
 
+#include "packager/base/bind.h"
+#include "packager/base/location.h"
 #include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
 #include "packager/media/base/common_pssh_generator.h"
+#include "packager/media/base/encryption_key_future.h"
 #include "packager/media/base/playready_pssh_generator.h"
 #include "packager/media/base/protection_system_ids.h"
 #include "packager/media/base/widevine_pssh_generator.h"
@@ -15,8 +19,13 @@
 
 namespace shaka {
 namespace media {
+namespace {
+// Large enough for the keys of a few crypto periods in multi-DRM setups.
+const size_t kPsshBoxCacheSize = 64;
+}  // namespace
 
-KeySource::KeySource(int protection_systems_flags, FourCC protection_scheme) {
+KeySource::KeySource(int protection_systems_flags, FourCC protection_scheme)
+    : pssh_box_cache_(kPsshBoxCacheSize) {
   if (protection_systems_flags & COMMON_PROTECTION_SYSTEM_FLAG) {
     pssh_generators_.emplace_back(new CommonPsshGenerator());
   }
@@ -45,6 +54,38 @@ KeySource::KeySource(int protection_systems_flags, FourCC protection_scheme) {
 
 KeySource::~KeySource() = default;
 
+std::shared_ptr<EncryptionKeyFuture> KeySource::GetCryptoPeriodKeyAsync(
+    uint32_t crypto_period_index,
+    uint32_t crypto_period_duration_in_seconds,
+    const std::string& stream_label) {
+  std::shared_ptr<EncryptionKeyFuture> future(new EncryptionKeyFuture);
+  const bool task_is_slow = true;
+  if (!base::WorkerPool::PostTask(
+          FROM_HERE,
+          base::Bind(&KeySource::GetCryptoPeriodKeyTask, base::Unretained(this),
+                     crypto_period_index, crypto_period_duration_in_seconds,
+                     stream_label, future),
+          task_is_slow)) {
+    LOG(WARNING) << "Failed to post key request. Requesting synchronously.";
+    GetCryptoPeriodKeyTask(crypto_period_index,
+                           crypto_period_duration_in_seconds, stream_label,
+                           future);
+  }
+  return future;
+}
+
+void KeySource::GetCryptoPeriodKeyTask(
+    uint32_t crypto_period_index,
+    uint32_t crypto_period_duration_in_seconds,
+    const std::string& stream_label,
+    std::shared_ptr<EncryptionKeyFuture> future) {
+  EncryptionKey key;
+  const Status status =
+      GetCryptoPeriodKey(crypto_period_index,
+                         crypto_period_duration_in_seconds, stream_label, &key);
+  future->SetResult(status, key);
+}
+
 Status KeySource::UpdateProtectionSystemInfo(
     EncryptionKeyMap* encryption_key_map) {
   for (const auto& pssh_generator : pssh_generators_) {
@@ -55,15 +96,16 @@ Status KeySource::UpdateProtectionSystemInfo(
       for (const EncryptionKeyMap::value_type& pair : *encryption_key_map) {
         key_ids.push_back(pair.second->key_id);
       }
-      RETURN_IF_ERROR(pssh_generator->GeneratePsshFromKeyIds(key_ids, &info));
+      RETURN_IF_ERROR(
+          pssh_box_cache_.GetFromKeyIds(*pssh_generator, key_ids, &info));
       for (const EncryptionKeyMap::value_type& pair : *encryption_key_map) {
         pair.second->key_system_info.push_back(info);
       }
     } else {
       for (const EncryptionKeyMap::value_type& pair : *encryption_key_map) {
         ProtectionSystemSpecificInfo info;
-        RETURN_IF_ERROR(pssh_generator->GeneratePsshFromKeyIdAndKey(
-            pair.second->key_id, pair.second->key, &info));
+        RETURN_IF_ERROR(pssh_box_cache_.GetFromKeyIdAndKey(
+            *pssh_generator, pair.second->key_id, pair.second->key, &info));
         pair.second->key_system_info.push_back(info);
       }
     }
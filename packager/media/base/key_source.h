@@ -14,12 +14,15 @@
 
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/protection_system_specific_info.h"
+#include "packager/media/base/pssh_box_cache.h"
 #include "packager/media/base/pssh_generator.h"
 #include "packager/status.h"
 
 namespace shaka {
 namespace media {
 
+class EncryptionKeyFuture;
+
 /// Encrypted media init data types. It is extended from:
 /// https://www.w3.org/TR/eme-initdata-registry/#registry.
 enum class EmeInitDataType {
@@ -88,14 +91,40 @@ class KeySource {
                                     const std::string& stream_label,
                                     EncryptionKey* key) = 0;
 
+  /// Request the encryption key of a crypto period without blocking, e.g. to
+  /// fetch the key of the next crypto period ahead of time. The default
+  /// implementation calls GetCryptoPeriodKey() on a worker thread, so that
+  /// every key source supports it. The key source must outlive the request,
+  /// e.g. by holding a reference to it in a callback of the returned future,
+  /// which is released once the request completes.
+  /// @param crypto_period_index is the sequence number of the key rotation
+  ///        period for which the key is being retrieved.
+  /// @param crypto_period_duration_in_seconds is the duration of the crypto
+  ///        period in seconds.
+  /// @param stream_label is the label of stream for which retrieving the key.
+  /// @return a future holding the key and the status of the request once the
+  ///         key is available.
+  virtual std::shared_ptr<EncryptionKeyFuture> GetCryptoPeriodKeyAsync(
+      uint32_t crypto_period_index,
+      uint32_t crypto_period_duration_in_seconds,
+      const std::string& stream_label);
+
  protected:
   /// Update the protection sysmtem specific info for the encryption keys.
   /// @param encryption_key_map is a map of encryption keys for all tracks.
   Status UpdateProtectionSystemInfo(EncryptionKeyMap* encryption_key_map);
 
  private:
+  // Runs GetCryptoPeriodKey() for GetCryptoPeriodKeyAsync().
+  void GetCryptoPeriodKeyTask(uint32_t crypto_period_index,
+                              uint32_t crypto_period_duration_in_seconds,
+                              const std::string& stream_label,
+                              std::shared_ptr<EncryptionKeyFuture> future);
+
   std::vector<std::unique_ptr<PsshGenerator>> pssh_generators_;
   std::vector<std::vector<uint8_t>> no_pssh_systems_;
+  // Boxes generated by |pssh_generators_|.
+  PsshBoxCache pssh_box_cache_;
 
   DISALLOW_COPY_AND_ASSIGN(KeySource);
 };
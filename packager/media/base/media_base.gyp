@@ -19,6 +19,8 @@
         'aes_decryptor.h',
         'aes_encryptor.cc',
         'aes_encryptor.h',
+        'aes_evp_cryptor.cc',
+        'aes_evp_cryptor.h',
         'aes_pattern_cryptor.cc',
         'aes_pattern_cryptor.h',
         'audio_stream_info.cc',
@@ -41,11 +43,15 @@
         'common_pssh_generator.h',
         'container_names.cc',
         'container_names.h',
+        'crypto_period_key_cache.cc',
+        'crypto_period_key_cache.h',
         'decrypt_config.cc',
         'decrypt_config.h',
         'decryptor_source.cc',
         'decryptor_source.h',
         'encryption_config.h',
+        'encryption_key_future.cc',
+        'encryption_key_future.h',
         'fourccs.h',
         'http_key_fetcher.cc',
         'http_key_fetcher.h',
@@ -53,6 +59,8 @@
         'id3_tag.h',
         'key_fetcher.cc',
         'key_fetcher.h',
+        'key_request_broker.cc',
+        'key_request_broker.h',
         'key_source.cc',
         'key_source.h',
         'language_utils.cc',
@@ -84,6 +92,8 @@
         'protection_system_specific_info.h',
         'proto_json_util.cc',
         'proto_json_util.h',
+        'pssh_box_cache.cc',
+        'pssh_box_cache.h',
         'pssh_generator.cc',
         'pssh_generator.h',
         'pssh_generator_util.cc',
@@ -96,6 +106,8 @@
         'request_signer.h',
         'rsa_key.cc',
         'rsa_key.h',
+        'segment_writer.cc',
+        'segment_writer.h',
         'stream_info.cc',
         'stream_info.h',
         'text_sample.cc',
@@ -168,6 +180,7 @@
       'type': '<(gtest_target_type)',
       'sources': [
         'aes_cryptor_unittest.cc',
+        'aes_evp_cryptor_unittest.cc',
         'aes_pattern_cryptor_unittest.cc',
         'audio_timestamp_helper_unittest.cc',
         'bit_reader_unittest.cc',
@@ -175,17 +188,24 @@
         'buffer_writer_unittest.cc',
         'closure_thread_unittest.cc',
         'container_names_unittest.cc',
+        'crypto_period_key_cache_unittest.cc',
         'decryptor_source_unittest.cc',
+        'encryption_key_future_unittest.cc',
         'http_key_fetcher_unittest.cc',
         'id3_tag_unittest.cc',
+        'key_request_broker_unittest.cc',
         'muxer_util_unittest.cc',
         'offset_byte_queue_unittest.cc',
         'producer_consumer_queue_unittest.cc',
         'protection_system_specific_info_unittest.cc',
+        'pssh_box_cache_unittest.cc',
         'pssh_generator_unittest.cc',
         'raw_key_source_unittest.cc',
         'rsa_key_unittest.cc',
+        'segment_writer_unittest.cc',
         'status_test_util_unittest.cc',
+        'test/fake_key_server.cc',  # For key_request_broker_unittest
+        'test/fake_key_server.h',   # For key_request_broker_unittest
         'test/fake_prng.cc',  # For rsa_key_unittest
         'test/fake_prng.h',   # For rsa_key_unittest
         'test/rsa_test_data.cc',  # For rsa_key_unittest
@@ -52,8 +52,12 @@ Status Muxer::Process(std::unique_ptr<StreamData> stream_data) {
       if (muxer_listener_ && segment_info.is_encrypted) {
         const EncryptionConfig* encryption_config =
             segment_info.key_rotation_encryption_config.get();
+        const bool key_updated =
+            encryption_config && encryption_config->key_id != current_key_id_;
+        if (key_updated || !encryption_started_)
+          RETURN_IF_ERROR(WaitForPendingSegments());
         // Only call OnEncryptionInfoReady again when key updates.
-        if (encryption_config && encryption_config->key_id != current_key_id_) {
+        if (key_updated) {
           muxer_listener_->OnEncryptionInfoReady(
               !kInitialEncryptionInfo, encryption_config->protection_scheme,
               encryption_config->key_id, encryption_config->constant_iv,
@@ -76,6 +80,7 @@ Status Muxer::Process(std::unique_ptr<StreamData> stream_data) {
         const double time_in_seconds = stream_data->cue_event->time_in_seconds;
         const int64_t scaled_time =
             static_cast<int64_t>(time_in_seconds * time_scale);
+        RETURN_IF_ERROR(WaitForPendingSegments());
         muxer_listener_->OnCueEvent(scaled_time,
                                     stream_data->cue_event->cue_data);
 
@@ -99,8 +104,13 @@ Status Muxer::OnFlushRequest(size_t input_stream_index) {
   return Finalize();
 }
 
+Status Muxer::WaitForPendingSegments() {
+  return Status::OK;
+}
+
 Status Muxer::ReinitializeMuxer(int64_t timestamp) {
   if (muxer_listener_ && streams_.back()->is_encrypted()) {
+    RETURN_IF_ERROR(WaitForPendingSegments());
     const EncryptionConfig& encryption_config =
         streams_.back()->encryption_config();
     muxer_listener_->OnEncryptionInfoReady(
@@ -93,6 +93,12 @@ class Muxer : public MediaHandler {
       size_t stream_id,
       const SegmentInfo& segment_info) = 0;
 
+  // Wait for the segments being written, whose notifications to the muxer
+  // listener run once they are written, so that the listener is notified in
+  // order before being notified directly. The default implementation does
+  // nothing.
+  virtual Status WaitForPendingSegments();
+
   // Re-initialize Muxer. Could be called on StreamInfo or CueEvent.
   // |timestamp| may be used to set the output file name.
   Status ReinitializeMuxer(int64_t timestamp);
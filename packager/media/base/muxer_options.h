@@ -12,6 +12,7 @@
 #include <string>
 
 #include "packager/media/public/mp4_output_params.h"
+#include "packager/media/public/segment_writer_params.h"
 
 namespace shaka {
 namespace media {
@@ -28,6 +29,13 @@ struct MuxerOptions {
   // compensate for negative timestamps in the input.
   uint32_t transport_stream_timestamp_offset_ms = 0;
 
+  /// Parameters of writing the media segments.
+  SegmentWriterParams segment_writer_params;
+
+  /// Reserve space for the Cues in single file WebM output, so that it is
+  /// written in a single pass if the output is seekable.
+  bool webm_reserve_cues_space = false;
+
   /// Output file name. If segment_template is not specified, the Muxer
   /// generates this single output file with all segments concatenated;
   /// Otherwise, it specifies the init segment name.
@@ -0,0 +1,95 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/pssh_box_cache.h"
+
+#include <tuple>
+
+#include "packager/base/logging.h"
+#include "packager/media/base/pssh_generator.h"
+
+namespace shaka {
+namespace media {
+
+bool PsshBoxCache::CacheKey::operator<(const CacheKey& other) const {
+  return std::tie(system_id, key_ids, key) <
+         std::tie(other.system_id, other.key_ids, other.key);
+}
+
+PsshBoxCache::PsshBoxCache(size_t max_entries) : max_entries_(max_entries) {
+  DCHECK_GT(max_entries, 0u);
+}
+
+PsshBoxCache::~PsshBoxCache() {}
+
+Status PsshBoxCache::GetFromKeyIds(
+    const PsshGenerator& generator,
+    const std::vector<std::vector<uint8_t>>& key_ids,
+    ProtectionSystemSpecificInfo* info) {
+  DCHECK(info);
+  CacheKey key;
+  key.system_id = generator.system_id();
+  key.key_ids = key_ids;
+  if (Find(key, info))
+    return Status::OK;
+
+  Status status = generator.GeneratePsshFromKeyIds(key_ids, info);
+  if (status.ok())
+    Insert(key, *info);
+  return status;
+}
+
+Status PsshBoxCache::GetFromKeyIdAndKey(const PsshGenerator& generator,
+                                        const std::vector<uint8_t>& key_id,
+                                        const std::vector<uint8_t>& key,
+                                        ProtectionSystemSpecificInfo* info) {
+  DCHECK(info);
+  CacheKey cache_key;
+  cache_key.system_id = generator.system_id();
+  cache_key.key_ids.push_back(key_id);
+  cache_key.key = key;
+  if (Find(cache_key, info))
+    return Status::OK;
+
+  Status status = generator.GeneratePsshFromKeyIdAndKey(key_id, key, info);
+  if (status.ok())
+    Insert(cache_key, *info);
+  return status;
+}
+
+PsshBoxCache::Statistics PsshBoxCache::GetStatistics() {
+  base::AutoLock scoped_lock(lock_);
+  return statistics_;
+}
+
+bool PsshBoxCache::Find(const CacheKey& key,
+                        ProtectionSystemSpecificInfo* info) {
+  base::AutoLock scoped_lock(lock_);
+  auto iter = cache_.find(key);
+  if (iter == cache_.end()) {
+    ++statistics_.misses;
+    return false;
+  }
+  ++statistics_.hits;
+  *info = iter->second;
+  return true;
+}
+
+void PsshBoxCache::Insert(const CacheKey& key,
+                          const ProtectionSystemSpecificInfo& info) {
+  base::AutoLock scoped_lock(lock_);
+  // Another thread may have generated the same box in the meantime.
+  if (!cache_.insert(std::make_pair(key, info)).second)
+    return;
+  insertion_order_.push_back(key);
+  if (insertion_order_.size() > max_entries_) {
+    cache_.erase(insertion_order_.front());
+    insertion_order_.pop_front();
+  }
+}
+
+}  // namespace media
+}  // namespace shaka
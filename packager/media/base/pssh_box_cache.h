@@ -0,0 +1,88 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_PSSH_BOX_CACHE_H_
+#define PACKAGER_MEDIA_BASE_PSSH_BOX_CACHE_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/base/protection_system_specific_info.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+class PsshGenerator;
+
+/// Caches the serialized 'pssh' boxes generated by the PsshGenerators, keyed
+/// by the protection system and the key IDs, so that the boxes are not
+/// regenerated when the same keys are seen again, e.g. by the streams sharing
+/// a key or by repeated requests for the keys of a crypto period. The oldest
+/// entries are evicted when the cache is full. This class is thread safe.
+class PsshBoxCache {
+ public:
+  struct Statistics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  /// @param max_entries is the maximum number of boxes kept in the cache.
+  explicit PsshBoxCache(size_t max_entries);
+  ~PsshBoxCache();
+
+  /// Get the 'pssh' box of @a generator for @a key_ids, generating it if it is
+  /// not in the cache.
+  /// @return OK on success, the error of the generator otherwise.
+  Status GetFromKeyIds(const PsshGenerator& generator,
+                       const std::vector<std::vector<uint8_t>>& key_ids,
+                       ProtectionSystemSpecificInfo* info);
+
+  /// Get the 'pssh' box of @a generator for @a key_id and @a key, generating
+  /// it if it is not in the cache.
+  /// @return OK on success, the error of the generator otherwise.
+  Status GetFromKeyIdAndKey(const PsshGenerator& generator,
+                            const std::vector<uint8_t>& key_id,
+                            const std::vector<uint8_t>& key,
+                            ProtectionSystemSpecificInfo* info);
+
+  /// @return the hit and miss counts of the cache.
+  Statistics GetStatistics();
+
+ private:
+  struct CacheKey {
+    std::vector<uint8_t> system_id;
+    std::vector<std::vector<uint8_t>> key_ids;
+    // Only set for the generators which need the key.
+    std::vector<uint8_t> key;
+
+    bool operator<(const CacheKey& other) const;
+  };
+
+  PsshBoxCache(const PsshBoxCache&) = delete;
+  PsshBoxCache& operator=(const PsshBoxCache&) = delete;
+
+  // Looks up |key|. Returns true and sets |info| on hit.
+  bool Find(const CacheKey& key, ProtectionSystemSpecificInfo* info);
+  void Insert(const CacheKey& key, const ProtectionSystemSpecificInfo& info);
+
+  const size_t max_entries_;
+
+  base::Lock lock_;
+  std::map<CacheKey, ProtectionSystemSpecificInfo> cache_;
+  // Keys in insertion order, for eviction.
+  std::deque<CacheKey> insertion_order_;
+  Statistics statistics_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_PSSH_BOX_CACHE_H_
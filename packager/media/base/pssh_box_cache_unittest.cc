@@ -0,0 +1,103 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/pssh_box_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/common_pssh_generator.h"
+#include "packager/media/base/playready_pssh_generator.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace {
+const std::vector<uint8_t> kKeyId1(16, '1');
+const std::vector<uint8_t> kKeyId2(16, '2');
+const std::vector<uint8_t> kKey1(16, 'a');
+const std::vector<uint8_t> kKey2(16, 'b');
+const size_t kMaxEntries = 2;
+}  // namespace
+
+class PsshBoxCacheTest : public ::testing::Test {
+ public:
+  PsshBoxCacheTest()
+      : playready_generator_(FOURCC_cenc), cache_(kMaxEntries) {}
+
+ protected:
+  CommonPsshGenerator common_generator_;
+  PlayReadyPsshGenerator playready_generator_;
+  PsshBoxCache cache_;
+};
+
+TEST_F(PsshBoxCacheTest, FromKeyIds) {
+  const std::vector<std::vector<uint8_t>> kKeyIds = {kKeyId1, kKeyId2};
+  ProtectionSystemSpecificInfo expected_info;
+  ASSERT_OK(common_generator_.GeneratePsshFromKeyIds(kKeyIds, &expected_info));
+
+  ProtectionSystemSpecificInfo info;
+  ASSERT_OK(cache_.GetFromKeyIds(common_generator_, kKeyIds, &info));
+  EXPECT_EQ(expected_info.system_id, info.system_id);
+  EXPECT_EQ(expected_info.psshs, info.psshs);
+
+  ProtectionSystemSpecificInfo cached_info;
+  ASSERT_OK(cache_.GetFromKeyIds(common_generator_, kKeyIds, &cached_info));
+  EXPECT_EQ(expected_info.psshs, cached_info.psshs);
+
+  const PsshBoxCache::Statistics statistics = cache_.GetStatistics();
+  EXPECT_EQ(1u, statistics.hits);
+  EXPECT_EQ(1u, statistics.misses);
+}
+
+TEST_F(PsshBoxCacheTest, FromKeyIdAndKey) {
+  ProtectionSystemSpecificInfo expected_info;
+  ASSERT_OK(playready_generator_.GeneratePsshFromKeyIdAndKey(kKeyId1, kKey1,
+                                                             &expected_info));
+
+  ProtectionSystemSpecificInfo info;
+  ASSERT_OK(
+      cache_.GetFromKeyIdAndKey(playready_generator_, kKeyId1, kKey1, &info));
+  ASSERT_OK(
+      cache_.GetFromKeyIdAndKey(playready_generator_, kKeyId1, kKey1, &info));
+  EXPECT_EQ(expected_info.system_id, info.system_id);
+  EXPECT_EQ(expected_info.psshs, info.psshs);
+
+  // The key is part of the cache key.
+  ASSERT_OK(
+      cache_.GetFromKeyIdAndKey(playready_generator_, kKeyId1, kKey2, &info));
+  EXPECT_NE(expected_info.psshs, info.psshs);
+
+  const PsshBoxCache::Statistics statistics = cache_.GetStatistics();
+  EXPECT_EQ(1u, statistics.hits);
+  EXPECT_EQ(2u, statistics.misses);
+}
+
+TEST_F(PsshBoxCacheTest, SystemIsPartOfCacheKey) {
+  ProtectionSystemSpecificInfo common_info;
+  ASSERT_OK(cache_.GetFromKeyIds(common_generator_, {kKeyId1}, &common_info));
+  ProtectionSystemSpecificInfo playready_info;
+  ASSERT_OK(cache_.GetFromKeyIdAndKey(playready_generator_, kKeyId1, kKey1,
+                                      &playready_info));
+  EXPECT_NE(common_info.system_id, playready_info.system_id);
+  EXPECT_EQ(0u, cache_.GetStatistics().hits);
+}
+
+TEST_F(PsshBoxCacheTest, EvictsOldestEntries) {
+  const std::vector<uint8_t> kKeyId3(16, '3');
+  ProtectionSystemSpecificInfo info;
+  ASSERT_OK(cache_.GetFromKeyIds(common_generator_, {kKeyId1}, &info));
+  ASSERT_OK(cache_.GetFromKeyIds(common_generator_, {kKeyId2}, &info));
+  ASSERT_OK(cache_.GetFromKeyIds(common_generator_, {kKeyId3}, &info));
+
+  // |kKeyId1| is evicted. |kKeyId3| is still cached.
+  ASSERT_OK(cache_.GetFromKeyIds(common_generator_, {kKeyId3}, &info));
+  EXPECT_EQ(1u, cache_.GetStatistics().hits);
+  ASSERT_OK(cache_.GetFromKeyIds(common_generator_, {kKeyId1}, &info));
+  EXPECT_EQ(1u, cache_.GetStatistics().hits);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -28,6 +28,9 @@ class PsshGenerator {
   ///          IDs.
   virtual bool SupportMultipleKeys() = 0;
 
+  /// @return the protection system id of the generated PSSH boxes.
+  const std::vector<uint8_t>& system_id() const { return system_id_; }
+
   /// Generate the PSSH and set the ProtectionSystemSpecificInfo.
   /// @param key_ids is a vector of key IDs for all tracks.
   /// @param info is a pointer to the ProtectionSystemSpecificInfo for setting
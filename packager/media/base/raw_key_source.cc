@@ -9,6 +9,7 @@
 #include <algorithm>
 #include "packager/base/logging.h"
 #include "packager/base/strings/string_number_conversions.h"
+#include "packager/media/base/encryption_key_future.h"
 #include "packager/media/base/key_source.h"
 #include "packager/status_macros.h"
 
@@ -96,6 +97,17 @@ Status RawKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
   return Status::OK;
 }
 
+std::shared_ptr<EncryptionKeyFuture> RawKeySource::GetCryptoPeriodKeyAsync(
+    uint32_t crypto_period_index,
+    uint32_t crypto_period_duration_in_seconds,
+    const std::string& stream_label) {
+  EncryptionKey key;
+  const Status status =
+      GetCryptoPeriodKey(crypto_period_index,
+                         crypto_period_duration_in_seconds, stream_label, &key);
+  return EncryptionKeyFuture::FromResult(status, key);
+}
+
 std::unique_ptr<RawKeySource> RawKeySource::Create(const RawKeyParams& raw_key,
                                                    int protection_systems_flags,
                                                    FourCC protection_scheme) {
@@ -33,6 +33,11 @@ class RawKeySource : public KeySource {
                             uint32_t crypto_period_duration_in_seconds,
                             const std::string& stream_label,
                             EncryptionKey* key) override;
+  /// The keys are in memory, so the request completes on the calling thread.
+  std::shared_ptr<EncryptionKeyFuture> GetCryptoPeriodKeyAsync(
+      uint32_t crypto_period_index,
+      uint32_t crypto_period_duration_in_seconds,
+      const std::string& stream_label) override;
   /// @}
 
   /// Creates a new RawKeySource from the given data.  Returns null
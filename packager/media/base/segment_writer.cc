@@ -0,0 +1,147 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/segment_writer.h"
+
+#include "packager/base/bind.h"
+#include "packager/base/logging.h"
+#include "packager/base/threading/worker_pool.h"
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/status_macros.h"
+
+namespace shaka {
+namespace media {
+
+SegmentWriter::SegmentWriter(const SegmentWriterParams& params)
+    : params_(params), state_changed_(&lock_) {}
+
+SegmentWriter::~SegmentWriter() {
+  // The writes in flight and the callbacks use |this|.
+  base::AutoLock scoped_lock(lock_);
+  while (!tasks_.empty() || running_callbacks_)
+    state_changed_.Wait();
+}
+
+Status SegmentWriter::Write(const std::string& file_name,
+                            BufferWriter* header,
+                            BufferWriter* data,
+                            const Callback& callback) {
+  DCHECK(data);
+  if (params_.max_in_flight_writes == 0) {
+    if (status_.ok()) {
+      status_ =
+          WriteSegmentToFile(file_name, header, data, params_.sync_policy);
+      if (status_.ok() && callback)
+        callback();
+    }
+    if (header)
+      header->Clear();
+    data->Clear();
+    return status_;
+  }
+
+  std::unique_ptr<WriteTask> task(new WriteTask);
+  task->file_name = file_name;
+  if (header)
+    task->header.Swap(header);
+  task->data.Swap(data);
+  task->callback = callback;
+  WriteTask* task_ptr = task.get();
+  {
+    base::AutoLock scoped_lock(lock_);
+    while (num_writes_in_flight_ >= params_.max_in_flight_writes)
+      state_changed_.Wait();
+    if (!status_.ok())
+      return status_;
+    ++num_writes_in_flight_;
+    tasks_.push_back(std::move(task));
+  }
+
+  const bool task_is_slow = true;
+  if (!base::WorkerPool::PostTask(
+          FROM_HERE,
+          base::Bind(&SegmentWriter::RunWriteTask, base::Unretained(this),
+                     task_ptr),
+          task_is_slow)) {
+    LOG(WARNING) << "Failed to post segment write. Writing synchronously.";
+    RunWriteTask(task_ptr);
+  }
+  return Status::OK;
+}
+
+Status SegmentWriter::Flush() {
+  base::AutoLock scoped_lock(lock_);
+  while (!tasks_.empty() || running_callbacks_)
+    state_changed_.Wait();
+  return status_;
+}
+
+void SegmentWriter::RunWriteTask(WriteTask* task) {
+  Status status = WriteSegmentToFile(task->file_name, &task->header,
+                                     &task->data, params_.sync_policy);
+
+  base::AutoLock scoped_lock(lock_);
+  task->status = status;
+  task->done = true;
+  --num_writes_in_flight_;
+  state_changed_.Broadcast();
+  // Otherwise, the thread running the callbacks runs this one too if it is
+  // next.
+  if (!running_callbacks_)
+    RunCompletedCallbacks();
+}
+
+void SegmentWriter::RunCompletedCallbacks() {
+  lock_.AssertAcquired();
+  running_callbacks_ = true;
+  while (!tasks_.empty() && tasks_.front()->done) {
+    std::unique_ptr<WriteTask> task = std::move(tasks_.front());
+    tasks_.pop_front();
+    status_.Update(task->status);
+    // The segments following a failed write are not notified, so a manifest
+    // never lists a segment after a missing one.
+    if (status_.ok() && task->callback) {
+      base::AutoUnlock scoped_unlock(lock_);
+      task->callback();
+    }
+  }
+  running_callbacks_ = false;
+  state_changed_.Broadcast();
+}
+
+Status WriteSegmentToFile(const std::string& file_name,
+                          BufferWriter* header,
+                          BufferWriter* data,
+                          SegmentSyncPolicy sync_policy) {
+  // The segment is written in a single batch, so the threaded I/O cache, which
+  // would be set up and torn down for every segment, is not used.
+  std::unique_ptr<File, FileCloser> file(
+      File::OpenWithNoBuffering(file_name.c_str(), "w"));
+  if (!file) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file for write " + file_name);
+  }
+  if (header && header->Size() > 0)
+    RETURN_IF_ERROR(header->WriteToFile(file.get()));
+  RETURN_IF_ERROR(data->WriteToFile(file.get()));
+  if (!file.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+  if (sync_policy != SegmentSyncPolicy::kNone &&
+      !File::SyncToStorage(file_name.c_str(),
+                           sync_policy == SegmentSyncPolicy::kDataSync)) {
+    return Status(error::FILE_FAILURE, "Cannot sync file " + file_name);
+  }
+  return Status::OK;
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,109 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_SEGMENT_WRITER_H_
+#define PACKAGER_MEDIA_BASE_SEGMENT_WRITER_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "packager/base/synchronization/condition_variable.h"
+#include "packager/base/synchronization/lock.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/media/public/segment_writer_params.h"
+#include "packager/status.h"
+
+namespace shaka {
+namespace media {
+
+/// Writes media segments, which are complete in memory, to their files. If
+/// @b SegmentWriterParams.max_in_flight_writes is not 0, the segments are
+/// written on a worker pool, with at most that number of writes in flight, so
+/// the muxer does not wait for the storage. The callbacks of the writes, e.g.
+/// notifying the MuxerListener, run in the order of the writes as soon as the
+/// segments are fully written, on the thread completing the write. They never
+/// run concurrently.
+/// The methods of this class must be called from a single thread.
+class SegmentWriter {
+ public:
+  typedef std::function<void()> Callback;
+
+  explicit SegmentWriter(const SegmentWriterParams& params);
+  /// Waits for the writes in flight and their callbacks.
+  ~SegmentWriter();
+
+  /// Write a segment. Waits if the maximum number of writes in flight is
+  /// reached. The buffers are written directly by synchronous writes.
+  /// Otherwise, their content is swapped into buffers owned by the write, so
+  /// the segment is never copied. Both are empty on return.
+  /// @param file_name is the name of the segment file, which is replaced.
+  /// @param header is the beginning of the segment, e.g. its 'styp' and
+  ///        'sidx' boxes. Can be null.
+  /// @param data is the rest of the segment.
+  /// @param callback runs once the segment is written. It does not run if the
+  ///        write, or a previous write, fails. Can be null.
+  /// @return the error of the first failed write if any, OK otherwise.
+  Status Write(const std::string& file_name,
+               BufferWriter* header,
+               BufferWriter* data,
+               const Callback& callback);
+
+  /// Wait for all the writes and their callbacks.
+  /// @return the error of the first failed write if any, OK otherwise.
+  Status Flush();
+
+ private:
+  SegmentWriter(const SegmentWriter&) = delete;
+  SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+  struct WriteTask {
+    std::string file_name;
+    BufferWriter header;
+    BufferWriter data;
+    Callback callback;
+    // Set on completion, with |lock_| held.
+    bool done = false;
+    Status status;
+  };
+
+  // Runs on the worker pool.
+  void RunWriteTask(WriteTask* task);
+  // Runs the callbacks of the completed writes at the front of |tasks_|. Must
+  // be called with |lock_| held, which is released while the callbacks run.
+  void RunCompletedCallbacks();
+
+  const SegmentWriterParams params_;
+
+  base::Lock lock_;
+  // Signaled when a write completes or the callbacks stop running.
+  base::ConditionVariable state_changed_;
+  size_t num_writes_in_flight_ = 0;
+  // Set while a thread runs the callbacks, so that they run in order.
+  bool running_callbacks_ = false;
+  // The writes whose callbacks have not run, in the order of the writes.
+  std::deque<std::unique_ptr<WriteTask>> tasks_;
+  // Error of the first failed write.
+  Status status_;
+};
+
+/// Write a segment, which is complete in memory, to a file in a single batch
+/// and flush it to the storage device as specified by @a sync_policy.
+/// @param file_name is the name of the segment file, which is replaced.
+/// @param header is the beginning of the segment. Can be null. It is cleared.
+/// @param data is the rest of the segment. It is cleared.
+/// @param sync_policy specifies if and how the file is flushed.
+/// @return OK on success.
+Status WriteSegmentToFile(const std::string& file_name,
+                          BufferWriter* header,
+                          BufferWriter* data,
+                          SegmentSyncPolicy sync_policy);
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_SEGMENT_WRITER_H_
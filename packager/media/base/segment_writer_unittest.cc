@@ -0,0 +1,128 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/segment_writer.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/strings/stringprintf.h"
+#include "packager/base/synchronization/waitable_event.h"
+#include "packager/file/file.h"
+#include "packager/file/memory_file.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+
+namespace {
+const char kSegmentFileFormat[] = "memory://segment_%u.m4s";
+const char kInvalidSegmentFile[] = "";
+const uint32_t kNumSegments = 10;
+
+std::string GetSegmentFileName(uint32_t index) {
+  return base::StringPrintf(kSegmentFileFormat, index);
+}
+
+std::string GetSegmentContent(uint32_t index) {
+  return std::string(100 + index, static_cast<char>('a' + index));
+}
+
+// The first 10 bytes of the segment are in |header|.
+void CreateSegmentData(uint32_t index,
+                       BufferWriter* header,
+                       BufferWriter* data) {
+  const std::string content = GetSegmentContent(index);
+  header->AppendString(content.substr(0, 10));
+  data->AppendString(content.substr(10));
+}
+}  // namespace
+
+class SegmentWriterTest : public ::testing::TestWithParam<uint32_t> {
+ protected:
+  void TearDown() override { MemoryFile::DeleteAll(); }
+
+  SegmentWriterParams GetParams() const {
+    SegmentWriterParams params;
+    params.max_in_flight_writes = GetParam();
+    params.sync_policy = SegmentSyncPolicy::kFullSync;
+    return params;
+  }
+};
+
+TEST_P(SegmentWriterTest, WritesSegmentsAndRunsCallbacksInOrder) {
+  std::vector<uint32_t> notified_segments;
+  {
+    SegmentWriter writer(GetParams());
+    for (uint32_t i = 0; i < kNumSegments; ++i) {
+      BufferWriter header;
+      BufferWriter data;
+      CreateSegmentData(i, &header, &data);
+      ASSERT_OK(writer.Write(GetSegmentFileName(i), &header, &data,
+                             [i, &notified_segments]() {
+                               // The segment is complete when notified.
+                               std::string content;
+                               ASSERT_TRUE(File::ReadFileToString(
+                                   GetSegmentFileName(i).c_str(), &content));
+                               EXPECT_EQ(GetSegmentContent(i), content);
+                               notified_segments.push_back(i);
+                             }));
+      // The segment is not copied.
+      EXPECT_EQ(0u, header.Size());
+      EXPECT_EQ(0u, data.Size());
+    }
+    ASSERT_OK(writer.Flush());
+  }
+
+  ASSERT_EQ(kNumSegments, notified_segments.size());
+  for (uint32_t i = 0; i < kNumSegments; ++i)
+    EXPECT_EQ(i, notified_segments[i]);
+}
+
+TEST_P(SegmentWriterTest, StopsNotifyingAfterFailedWrite) {
+  std::vector<uint32_t> notified_segments;
+  SegmentWriter writer(GetParams());
+  auto callback = [&notified_segments](uint32_t index) {
+    return [index, &notified_segments]() {
+      notified_segments.push_back(index);
+    };
+  };
+  BufferWriter data;
+  data.AppendString(GetSegmentContent(0));
+  ASSERT_OK(writer.Write(GetSegmentFileName(0), nullptr, &data, callback(0)));
+  // The error is reported by this write or a later call.
+  data.AppendString(GetSegmentContent(1));
+  writer.Write(kInvalidSegmentFile, nullptr, &data, callback(1));
+  data.AppendString(GetSegmentContent(2));
+  writer.Write(GetSegmentFileName(2), nullptr, &data, callback(2));
+  EXPECT_EQ(error::FILE_FAILURE, writer.Flush().error_code());
+
+  ASSERT_EQ(1u, notified_segments.size());
+  EXPECT_EQ(0u, notified_segments[0]);
+}
+
+TEST_P(SegmentWriterTest, RunsCallbackOnceWritten) {
+  base::WaitableEvent written_event(
+      base::WaitableEvent::ResetPolicy::AUTOMATIC,
+      base::WaitableEvent::InitialState::NOT_SIGNALED);
+  SegmentWriter writer(GetParams());
+  BufferWriter data;
+  data.AppendString(GetSegmentContent(0));
+  ASSERT_OK(writer.Write(GetSegmentFileName(0), nullptr, &data,
+                         [&written_event]() { written_event.Signal(); }));
+  // The callback runs without waiting for a later call, so the segment is
+  // notified as soon as it is available.
+  EXPECT_TRUE(written_event.TimedWait(base::TimeDelta::FromSeconds(10)));
+  ASSERT_OK(writer.Flush());
+}
+
+INSTANTIATE_TEST_CASE_P(Synchronous, SegmentWriterTest, ::testing::Values(0u));
+INSTANTIATE_TEST_CASE_P(Asynchronous,
+                        SegmentWriterTest,
+                        ::testing::Values(1u, 4u));
+
+}  // namespace media
+}  // namespace shaka
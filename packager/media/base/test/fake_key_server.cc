@@ -0,0 +1,118 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/base/test/fake_key_server.h"
+
+#include <algorithm>
+
+#include "packager/base/strings/string_number_conversions.h"
+#include "packager/base/threading/platform_thread.h"
+#include "packager/media/base/proto_json_util.h"
+#include "packager/media/base/widevine_common_encryption.pb.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kKeySize = 16;
+const char kFakePsshData[] = "FakePsshData";
+
+std::string PadTo16Bytes(std::string value) {
+  value.resize(kKeySize, '~');
+  return value;
+}
+
+void AddTrack(const std::string& content_id,
+              const std::string& track_type,
+              bool has_crypto_period_index,
+              uint32_t crypto_period_index,
+              CommonEncryptionResponse* response) {
+  CommonEncryptionResponse::Track* track = response->add_tracks();
+  track->set_type(track_type);
+  track->set_key_id(PadTo16Bytes("Id" + track_type +
+                                 base::UintToString(crypto_period_index)));
+  track->set_key(
+      FakeKeyServer::GetKey(content_id, track_type, crypto_period_index));
+  CommonEncryptionResponse::Track::Pssh* pssh = track->add_pssh();
+  pssh->set_drm_type(ModularDrmType::WIDEVINE);
+  pssh->set_data(kFakePsshData);
+  if (has_crypto_period_index)
+    track->set_crypto_period_index(crypto_period_index);
+}
+
+}  // namespace
+
+FakeKeyServer::FakeKeyServer(base::TimeDelta latency) : latency_(latency) {}
+
+FakeKeyServer::~FakeKeyServer() {}
+
+Status FakeKeyServer::FetchKeys(const std::string& server_url,
+                                const std::string& request,
+                                std::string* response) {
+  {
+    base::AutoLock scoped_lock(lock_);
+    ++num_requests_;
+    ++num_concurrent_requests_;
+    max_concurrent_requests_ =
+        std::max(max_concurrent_requests_, num_concurrent_requests_);
+  }
+  base::PlatformThread::Sleep(latency_);
+  {
+    base::AutoLock scoped_lock(lock_);
+    --num_concurrent_requests_;
+  }
+
+  SignedModularDrmRequest signed_request;
+  CommonEncryptionRequest request_proto;
+  if (!JsonStringToMessage(request, &signed_request) ||
+      !JsonStringToMessage(signed_request.request(), &request_proto)) {
+    return Status(error::HTTP_FAILURE, "Malformed key request.");
+  }
+
+  CommonEncryptionResponse response_proto;
+  response_proto.set_status(CommonEncryptionResponse::OK);
+  const bool key_rotation = request_proto.has_crypto_period_count();
+  const uint32_t first_crypto_period_index =
+      request_proto.first_crypto_period_index();
+  const uint32_t crypto_period_count =
+      key_rotation ? request_proto.crypto_period_count() : 1;
+  for (uint32_t i = 0; i < crypto_period_count; ++i) {
+    for (const auto& track : request_proto.tracks()) {
+      AddTrack(request_proto.content_id(), track.type(), key_rotation,
+               first_crypto_period_index + i, &response_proto);
+    }
+  }
+
+  SignedModularDrmResponse signed_response;
+  signed_response.set_response(MessageToJsonString(response_proto));
+  *response = MessageToJsonString(signed_response);
+  return Status::OK;
+}
+
+// static
+std::string FakeKeyServer::GetKey(const std::string& content_id,
+                                  const std::string& track_type,
+                                  uint32_t crypto_period_index) {
+  std::string key = content_id + track_type +
+                    base::UintToString(crypto_period_index);
+  // Keep the distinguishing suffix if the key is too long.
+  if (key.size() > kKeySize)
+    key.erase(0, key.size() - kKeySize);
+  return PadTo16Bytes(key);
+}
+
+uint64_t FakeKeyServer::num_requests() {
+  base::AutoLock scoped_lock(lock_);
+  return num_requests_;
+}
+
+size_t FakeKeyServer::max_concurrent_requests() {
+  base::AutoLock scoped_lock(lock_);
+  return max_concurrent_requests_;
+}
+
+}  // namespace media
+}  // namespace shaka
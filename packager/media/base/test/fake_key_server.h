@@ -0,0 +1,64 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_BASE_TEST_FAKE_KEY_SERVER_H_
+#define PACKAGER_MEDIA_BASE_TEST_FAKE_KEY_SERVER_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/key_fetcher.h"
+
+namespace shaka {
+namespace media {
+
+/// A local stand-in for the Widevine key server, to be used in tests and
+/// benchmarks. Requests are answered in process with deterministic keys after
+/// a configurable latency. The keys of a track depend only on the content,
+/// the track type and the crypto period, so identical requests get identical
+/// keys. This class is thread safe.
+class FakeKeyServer : public KeyFetcher {
+ public:
+  /// @param latency is the time taken to answer a request.
+  explicit FakeKeyServer(base::TimeDelta latency);
+  ~FakeKeyServer() override;
+
+  /// @name KeyFetcher implementation overrides.
+  /// @{
+  Status FetchKeys(const std::string& server_url,
+                   const std::string& request,
+                   std::string* response) override;
+  /// @}
+
+  /// @return the key of a track, as served by FakeKeyServer.
+  static std::string GetKey(const std::string& content_id,
+                            const std::string& track_type,
+                            uint32_t crypto_period_index);
+
+  /// @return the number of requests received.
+  uint64_t num_requests();
+  /// @return the maximum number of requests being answered at the same time.
+  size_t max_concurrent_requests();
+
+ private:
+  FakeKeyServer(const FakeKeyServer&) = delete;
+  FakeKeyServer& operator=(const FakeKeyServer&) = delete;
+
+  const base::TimeDelta latency_;
+
+  base::Lock lock_;
+  uint64_t num_requests_ = 0;
+  size_t num_concurrent_requests_ = 0;
+  size_t max_concurrent_requests_ = 0;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_BASE_TEST_FAKE_KEY_SERVER_H_
@@ -12,8 +12,8 @@
 #include "packager/base/bind.h"
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/media/base/http_key_fetcher.h"
+#include "packager/media/base/key_request_broker.h"
 #include "packager/media/base/network_util.h"
-#include "packager/media/base/producer_consumer_queue.h"
 #include "packager/media/base/protection_system_ids.h"
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/proto_json_util.h"
@@ -41,6 +41,14 @@ const int kFirstRetryDelayMilliseconds = 1000;
 // key rotation enabled request.
 const int kDefaultCryptoPeriodCount = 10;
 const int kGetKeyTimeoutInSeconds = 5 * 60;  // 5 minutes.
+// Number of crypto periods to fetch ahead of the latest requested crypto
+// period, in units of crypto period count, i.e. key requests. With two
+// requests of look ahead, the keys of the next crypto periods are in the cache
+// well before the streams cross a crypto period boundary.
+const int kPrefetchKeyRequests = 2;
+// Number of crypto periods to keep behind the latest requested crypto period,
+// in units of crypto period count, for the streams lagging behind.
+const int kRetainedKeyRequests = 2;
 const int kKeyFetchTimeoutInSeconds = 60;  // 1 minute.
 
 CommonEncryptionRequest::ProtectionScheme ToCommonEncryptionProtectionScheme(
@@ -107,8 +115,17 @@ WidevineKeySource::WidevineKeySource(const std::string& server_url,
 }
 
 WidevineKeySource::~WidevineKeySource() {
-  if (key_pool_)
-    key_pool_->Stop();
+  if (key_cache_) {
+    key_cache_->Stop();
+    const CryptoPeriodKeyCache::Statistics statistics =
+        key_cache_->GetStatistics();
+    LOG(INFO) << "Crypto period key cache: " << statistics.hits << " hits, "
+              << statistics.misses << " misses, "
+              << statistics.evictions << " evictions, stalled "
+              << statistics.total_stall_time.InMilliseconds()
+              << " ms in total and "
+              << statistics.max_stall_time.InMilliseconds() << " ms at most.";
+  }
   if (key_production_thread_.HasBeenStarted()) {
     // Signal the production thread to start key production if it is not
     // signaled yet so the thread can be joined.
@@ -232,10 +249,11 @@ Status WidevineKeySource::GetCryptoPeriodKey(uint32_t crypto_period_index,
       // index. Set the initial value to account for that.
       first_crypto_period_index_ =
           crypto_period_index ? crypto_period_index - 1 : 0;
-      DCHECK(!key_pool_);
-      const size_t queue_size = crypto_period_count_ * 10;
-      key_pool_.reset(
-          new EncryptionKeyQueue(queue_size, first_crypto_period_index_));
+      DCHECK(!key_cache_);
+      key_cache_.reset(new CryptoPeriodKeyCache(
+          first_crypto_period_index_,
+          crypto_period_count_ * kPrefetchKeyRequests,
+          crypto_period_count_ * kRetainedKeyRequests));
       start_key_production_.Signal();
       key_production_started_ = true;
     }  else if (crypto_period_duration_in_seconds_ !=
@@ -256,15 +274,25 @@ void WidevineKeySource::set_key_fetcher(
   key_fetcher_ = std::move(key_fetcher);
 }
 
+CryptoPeriodKeyCache::Statistics WidevineKeySource::GetKeyCacheStatistics() {
+  {
+    base::AutoLock scoped_lock(lock_);
+    if (!key_cache_)
+      return CryptoPeriodKeyCache::Statistics();
+  }
+  return key_cache_->GetStatistics();
+}
+
 Status WidevineKeySource::GetKeyInternal(uint32_t crypto_period_index,
                                          const std::string& stream_label,
                                          EncryptionKey* key) {
-  DCHECK(key_pool_);
+  DCHECK(key_cache_);
   DCHECK(key);
 
   std::shared_ptr<EncryptionKeyMap> encryption_key_map;
-  Status status = key_pool_->Peek(crypto_period_index, &encryption_key_map,
-                                  kGetKeyTimeoutInSeconds * 1000);
+  Status status = key_cache_->Get(crypto_period_index,
+                                  kGetKeyTimeoutInSeconds * 1000,
+                                  &encryption_key_map);
   if (!status.ok()) {
     if (status.error_code() == error::STOPPED) {
       CHECK(!common_encryption_request_status_.ok());
@@ -284,20 +312,22 @@ Status WidevineKeySource::GetKeyInternal(uint32_t crypto_period_index,
 void WidevineKeySource::FetchKeysTask() {
   // Wait until key production is signaled.
   start_key_production_.Wait();
-  if (!key_pool_ || key_pool_->Stopped())
+  if (!key_cache_)
     return;
 
-  Status status = FetchKeysInternal(kEnableKeyRotation,
-                                    first_crypto_period_index_,
-                                    false);
-  while (status.ok()) {
-    first_crypto_period_index_ += crypto_period_count_;
+  // Keys are fetched ahead of the crypto periods requested by the streams, so
+  // they are usually in the cache when the streams need them.
+  Status status;
+  while (key_cache_->WaitForPrefetch(first_crypto_period_index_)) {
     status = FetchKeysInternal(kEnableKeyRotation,
                                first_crypto_period_index_,
                                false);
+    if (!status.ok())
+      break;
+    first_crypto_period_index_ += crypto_period_count_;
   }
   common_encryption_request_status_ = status;
-  key_pool_->Stop();
+  key_cache_->Stop();
 }
 
 Status WidevineKeySource::FetchKeysInternal(bool enable_key_rotation,
@@ -312,13 +342,23 @@ Status WidevineKeySource::FetchKeysInternal(bool enable_key_rotation,
     return status;
   VLOG(1) << "Message: " << message;
 
+  // Identical requests from other key sources in the process, e.g. other
+  // Packager instances packaging the same content, are sent only once. The
+  // signature is excluded as it may differ between identical requests.
+  std::string dedup_key;
+  if (!request.SerializeToString(&dedup_key))
+    return Status(error::INTERNAL_ERROR, "Failed to serialize key request.");
+  if (signer_)
+    dedup_key += signer_->signer_name();
+
   std::string raw_response;
   int64_t sleep_duration = kFirstRetryDelayMilliseconds;
 
   // Perform client side retries if seeing server transient error to workaround
   // server limitation.
   for (int i = 0; i < kNumTransientErrorRetries; ++i) {
-    status = key_fetcher_->FetchKeys(server_url_, message, &raw_response);
+    status = KeyRequestBroker::GetInstance()->FetchKeys(
+        key_fetcher_.get(), server_url_, dedup_key, message, &raw_response);
     if (status.ok()) {
       VLOG(1) << "Retry [" << i << "] Response:" << raw_response;
 
@@ -446,8 +486,7 @@ bool WidevineKeySource::ExtractEncryptionKey(
                      << track.crypto_period_index();
           return false;
         }
-        if (!PushToKeyPool(&encryption_key_map))
-          return false;
+        AddToKeyCache(current_crypto_period_index, &encryption_key_map);
         ++current_crypto_period_index;
       }
     }
@@ -490,21 +529,17 @@ bool WidevineKeySource::ExtractEncryptionKey(
       encryption_key_map_[pair.first] = std::move(pair.second);
     return true;
   }
-  return PushToKeyPool(&encryption_key_map);
+  AddToKeyCache(current_crypto_period_index, &encryption_key_map);
+  return true;
 }
 
-bool WidevineKeySource::PushToKeyPool(
-    EncryptionKeyMap* encryption_key_map) {
-  DCHECK(key_pool_);
+void WidevineKeySource::AddToKeyCache(uint32_t crypto_period_index,
+                                      EncryptionKeyMap* encryption_key_map) {
+  DCHECK(key_cache_);
   DCHECK(encryption_key_map);
   auto encryption_key_map_shared = std::make_shared<EncryptionKeyMap>();
   encryption_key_map_shared->swap(*encryption_key_map);
-  Status status = key_pool_->Push(encryption_key_map_shared, kInfiniteTimeout);
-  if (!status.ok()) {
-    DCHECK_EQ(error::STOPPED, status.error_code());
-    return false;
-  }
-  return true;
+  key_cache_->Put(crypto_period_index, std::move(encryption_key_map_shared));
 }
 
 }  // namespace media
@@ -11,6 +11,7 @@
 #include <memory>
 #include "packager/base/synchronization/waitable_event.h"
 #include "packager/media/base/closure_thread.h"
+#include "packager/media/base/crypto_period_key_cache.h"
 #include "packager/media/base/fourccs.h"
 #include "packager/media/base/key_source.h"
 
@@ -22,7 +23,6 @@ namespace media {
 
 class KeyFetcher;
 class RequestSigner;
-template <class T> class ProducerConsumerQueue;
 
 /// WidevineKeySource talks to the Widevine encryption service to
 /// acquire the encryption keys.
@@ -75,10 +75,11 @@ class WidevineKeySource : public KeySource {
     enable_entitlement_license_ = enable_entitlement_license;
   }
 
- private:
-  typedef ProducerConsumerQueue<std::shared_ptr<EncryptionKeyMap>>
-      EncryptionKeyQueue;
+  /// @return the hit, miss and stall statistics of the crypto period key
+  ///         cache. All zeros if key rotation is not used.
+  CryptoPeriodKeyCache::Statistics GetKeyCacheStatistics();
 
+ private:
   // Internal routine for getting keys.
   Status GetKeyInternal(uint32_t crypto_period_index,
                         const std::string& stream_label,
@@ -109,8 +110,9 @@ class WidevineKeySource : public KeySource {
                             bool widevine_classic,
                             const std::string& response,
                             bool* transient_error);
-  // Push the keys to the key pool.
-  bool PushToKeyPool(EncryptionKeyMap* encryption_key_map);
+  // Add the keys of crypto period |crypto_period_index| to the key cache.
+  void AddToKeyCache(uint32_t crypto_period_index,
+                     EncryptionKeyMap* encryption_key_map);
 
   // Indicates whether Widevine protection system should be generated.
   bool generate_widevine_protection_system_ = true;
@@ -133,7 +135,8 @@ class WidevineKeySource : public KeySource {
   uint32_t crypto_period_duration_in_seconds_ = 0;
   std::vector<uint8_t> group_id_;
   bool enable_entitlement_license_ = false;
-  std::unique_ptr<EncryptionKeyQueue> key_pool_;
+  // Keys of the crypto periods, shared by all the streams.
+  std::unique_ptr<CryptoPeriodKeyCache> key_cache_;
   EncryptionKeyMap encryption_key_map_;  // For non key rotation request.
   Status common_encryption_request_status_;
 
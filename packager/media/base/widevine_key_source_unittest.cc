@@ -659,6 +659,7 @@ TEST_P(WidevineKeySourceParameterizedTest, KeyRotationTest) {
       kFirstCryptoPeriodIndex, kCryptoPeriodSeconds, kStreamLabels[0],
       &encryption_key);
   EXPECT_EQ(error::INVALID_ARGUMENT, status.error_code());
+  EXPECT_GT(widevine_key_source_->GetKeyCacheStatistics().evictions, 0u);
 }
 
 INSTANTIATE_TEST_CASE_P(WidevineKeySourceInstance,
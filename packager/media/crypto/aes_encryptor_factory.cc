@@ -6,8 +6,9 @@
 
 #include "packager/media/crypto/aes_encryptor_factory.h"
 
-#include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/aes_evp_cryptor.h"
 #include "packager/media/base/aes_pattern_cryptor.h"
+#include "packager/media/crypto/sample_aes_cryptor.h"
 #include "packager/media/crypto/sample_aes_ec3_cryptor.h"
 
 namespace shaka {
@@ -23,40 +24,32 @@ std::unique_ptr<AesCryptor> AesEncryptorFactory::CreateEncryptor(
   std::unique_ptr<AesCryptor> encryptor;
   switch (protection_scheme) {
     case FOURCC_cenc:
-      encryptor.reset(new AesCtrEncryptor);
+      encryptor = CreateAesCtrCryptor();
       break;
     case FOURCC_cbc1:
-      encryptor.reset(new AesCbcEncryptor(kNoPadding));
+      encryptor = CreateAesCbcEncryptor(AesCryptor::kDontUseConstantIv);
       break;
     case FOURCC_cens:
       encryptor.reset(new AesPatternCryptor(
           crypt_byte_block, skip_byte_block,
           AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
           AesCryptor::kDontUseConstantIv,
-          std::unique_ptr<AesCryptor>(new AesCtrEncryptor)));
+          CreateAesCtrCryptor()));
       break;
     case FOURCC_cbcs:
       encryptor.reset(new AesPatternCryptor(
           crypt_byte_block, skip_byte_block,
           AesPatternCryptor::kEncryptIfCryptByteBlockRemaining,
           AesCryptor::kUseConstantIv,
-          std::unique_ptr<AesCryptor>(new AesCbcEncryptor(kNoPadding))));
+          CreateAesCbcEncryptor(AesCryptor::kDontUseConstantIv)));
       break;
     case kAppleSampleAesProtectionScheme:
-      if (crypt_byte_block == 0 && skip_byte_block == 0) {
-        if (codec == kCodecEAC3) {
-          encryptor.reset(new SampleAesEc3Cryptor(
-              std::unique_ptr<AesCryptor>(new AesCbcEncryptor(kNoPadding))));
-        } else {
-          encryptor.reset(
-              new AesCbcEncryptor(kNoPadding, AesCryptor::kUseConstantIv));
-        }
+      if (codec == kCodecEAC3) {
+        encryptor.reset(new SampleAesEc3Cryptor(
+            CreateAesCbcEncryptor(AesCryptor::kDontUseConstantIv)));
       } else {
-        encryptor.reset(new AesPatternCryptor(
-            crypt_byte_block, skip_byte_block,
-            AesPatternCryptor::kSkipIfCryptByteBlockRemaining,
-            AesCryptor::kUseConstantIv,
-            std::unique_ptr<AesCryptor>(new AesCbcEncryptor(kNoPadding))));
+        encryptor.reset(
+            new SampleAesCryptor(crypt_byte_block, skip_byte_block));
       }
       break;
     default:
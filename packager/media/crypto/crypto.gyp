@@ -17,6 +17,10 @@
         'aes_encryptor_factory.h',
         'encryption_handler.cc',
         'encryption_handler.h',
+        'encryptor_cache.cc',
+        'encryptor_cache.h',
+        'sample_aes_cryptor.cc',
+        'sample_aes_cryptor.h',
         'sample_aes_ec3_cryptor.cc',
         'sample_aes_ec3_cryptor.h',
         'subsample_generator.cc',
@@ -32,6 +36,8 @@
       'type': '<(gtest_target_type)',
       'sources': [
         'encryption_handler_unittest.cc',
+        'encryptor_cache_unittest.cc',
+        'sample_aes_cryptor_unittest.cc',
         'sample_aes_ec3_cryptor_unittest.cc',
         'subsample_generator_unittest.cc',
       ],
@@ -13,6 +13,7 @@
 
 #include "packager/media/base/aes_encryptor.h"
 #include "packager/media/base/audio_stream_info.h"
+#include "packager/media/base/decryptor_source.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/macros.h"
 #include "packager/media/base/media_sample.h"
@@ -28,6 +29,10 @@ namespace {
 // The encryption handler only supports a single output.
 const size_t kStreamIndex = 0;
 
+// Number of encryptors cached. A few entries cover key rotation with keys
+// shared across crypto periods, and alternating keys.
+const size_t kEncryptorCacheSize = 4;
+
 // The default KID, KEY and IV for key rotation are all 0s.
 // They are placeholders and are not really being used to encrypt data.
 const uint8_t kKeyRotationDefaultKeyId[] = {
@@ -68,16 +73,40 @@ bool IsPatternEncryptionScheme(FourCC protection_scheme) {
 }  // namespace
 
 EncryptionHandler::EncryptionHandler(const EncryptionParams& encryption_params,
-                                     KeySource* key_source)
+                                     std::shared_ptr<KeySource> key_source)
     : encryption_params_(encryption_params),
       protection_scheme_(
           static_cast<FourCC>(encryption_params.protection_scheme)),
-      key_source_(key_source),
+      key_source_(std::move(key_source)),
+      encryptor_cache_(kEncryptorCacheSize),
       subsample_generator_(
           new SubsampleGenerator(encryption_params.vp9_subsample_encryption)),
       encryptor_factory_(new AesEncryptorFactory) {}
 
-EncryptionHandler::~EncryptionHandler() = default;
+EncryptionHandler::~EncryptionHandler() {
+  // The outstanding key requests are not waited for. They keep |key_source_|
+  // alive until they complete.
+  if (num_key_stalls_ > 0) {
+    VLOG(1) << "Key requests for stream '" << stream_label_
+            << "' stalled " << num_key_stalls_ << " times: total="
+            << total_key_stall_time_.InMilliseconds()
+            << "ms max=" << max_key_stall_time_.InMilliseconds() << "ms";
+  }
+
+  const EncryptorCache::Statistics statistics = encryptor_cache_.statistics();
+  const uint64_t requests = statistics.hits + statistics.misses;
+  if (requests > 0) {
+    VLOG(1) << "Encryptor cache for stream '" << stream_label_
+            << "': size=" << statistics.size << " hits=" << statistics.hits
+            << " misses=" << statistics.misses << " hit_rate="
+            << static_cast<double>(statistics.hits) / requests;
+  }
+}
+
+void EncryptionHandler::SetDecryptorSource(
+    std::shared_ptr<DecryptorSource> decryptor_source) {
+  decryptor_source_ = std::move(decryptor_source);
+}
 
 Status EncryptionHandler::InitializeInternal() {
   if (!encryption_params_.stream_label_func) {
@@ -122,7 +151,7 @@ Status EncryptionHandler::Process(std::unique_ptr<StreamData> stream_data) {
 }
 
 Status EncryptionHandler::ProcessStreamInfo(const StreamInfo& clear_info) {
-  if (clear_info.is_encrypted()) {
+  if (clear_info.is_encrypted() && !decryptor_source_) {
     return Status(error::INVALID_ARGUMENT,
                   "Input stream is already encrypted.");
   }
@@ -169,14 +198,33 @@ Status EncryptionHandler::ProcessStreamInfo(const StreamInfo& clear_info) {
 }
 
 Status EncryptionHandler::ProcessMediaSample(
-    std::shared_ptr<const MediaSample> clear_sample) {
-  DCHECK(clear_sample);
+    std::shared_ptr<const MediaSample> sample) {
+  DCHECK(sample);
+
+  // An encrypted sample is decrypted into a new buffer, which is then
+  // encrypted in place and becomes the data of the output sample.
+  const uint8_t* clear_data = sample->data();
+  std::shared_ptr<uint8_t> decrypted_data;
+  if (sample->is_encrypted()) {
+    if (!decryptor_source_ || !sample->decrypt_config()) {
+      return Status(error::INVALID_ARGUMENT,
+                    "Cannot decrypt the encrypted input sample.");
+    }
+    decrypted_data.reset(new uint8_t[sample->data_size()],
+                         std::default_delete<uint8_t[]>());
+    if (!decryptor_source_->DecryptSampleBuffer(
+            sample->decrypt_config(), sample->data(), sample->data_size(),
+            decrypted_data.get())) {
+      return Status(error::ENCRYPTION_FAILURE, "Failed to decrypt sample.");
+    }
+    clear_data = decrypted_data.get();
+  }
 
   // Process the frame even if the frame is not encrypted as the next
   // (encrypted) frame may be dependent on this clear frame.
   std::vector<SubsampleEntry> subsamples;
   RETURN_IF_ERROR(subsample_generator_->GenerateSubsamples(
-      clear_sample->data(), clear_sample->data_size(), &subsamples));
+      clear_data, sample->data_size(), &subsamples));
 
   // Need to setup the encryptor for new segments even if this segment does not
   // need to be encrypted, so we can signal encryption metadata earlier to
@@ -184,18 +232,32 @@ Status EncryptionHandler::ProcessMediaSample(
   if (check_new_crypto_period_) {
     // |dts| can be negative, e.g. after EditList adjustments. Normalized to 0
     // in that case.
-    const int64_t dts = std::max(clear_sample->dts(), static_cast<int64_t>(0));
+    const int64_t dts = std::max(sample->dts(), static_cast<int64_t>(0));
     const int64_t current_crypto_period_index = dts / crypto_period_duration_;
-    const uint32_t crypto_period_duration_in_seconds =
-        static_cast<uint32_t>(encryption_params_.crypto_period_duration_in_seconds);
     if (current_crypto_period_index != prev_crypto_period_index_) {
+      std::shared_ptr<EncryptionKeyFuture> key_future;
+      if (next_crypto_period_key_ &&
+          next_crypto_period_index_ == current_crypto_period_index) {
+        key_future = std::move(next_crypto_period_key_);
+      } else {
+        // The prefetched key, if any, is not needed, e.g. because of a gap in
+        // the stream. Its request is dropped.
+        key_future = RequestCryptoPeriodKey(current_crypto_period_index);
+      }
+      next_crypto_period_key_.reset();
+
       EncryptionKey encryption_key;
-      RETURN_IF_ERROR(key_source_->GetCryptoPeriodKey(
-          current_crypto_period_index, crypto_period_duration_in_seconds,
-          stream_label_, &encryption_key));
+      RETURN_IF_ERROR(WaitForCryptoPeriodKey(
+          current_crypto_period_index, key_future.get(), &encryption_key));
       if (!CreateEncryptor(encryption_key))
         return Status(error::ENCRYPTION_FAILURE, "Failed to create encryptor");
       prev_crypto_period_index_ = current_crypto_period_index;
+
+      // Request the key of the next crypto period while this one is being
+      // encrypted, so it is usually available when needed.
+      next_crypto_period_index_ = current_crypto_period_index + 1;
+      next_crypto_period_key_ =
+          RequestCryptoPeriodKey(next_crypto_period_index_);
     }
     check_new_crypto_period_ = false;
   }
@@ -203,19 +265,31 @@ Status EncryptionHandler::ProcessMediaSample(
   // Since there is no encryption needed right now, send the clear copy
   // downstream so we can save the costs of copying it.
   if (remaining_clear_lead_ > 0) {
+    if (!decrypted_data)
+      return DispatchMediaSample(kStreamIndex, std::move(sample));
+    std::shared_ptr<MediaSample> clear_sample(sample->Clone());
+    clear_sample->TransferData(std::move(decrypted_data), sample->data_size());
+    clear_sample->set_is_encrypted(false);
+    clear_sample->set_decrypt_config(nullptr);
     return DispatchMediaSample(kStreamIndex, std::move(clear_sample));
   }
 
-  std::shared_ptr<uint8_t> cipher_sample_data(
-      new uint8_t[clear_sample->data_size()], std::default_delete<uint8_t[]>());
+  std::shared_ptr<uint8_t> cipher_sample_data =
+      decrypted_data ? std::move(decrypted_data)
+                     : std::shared_ptr<uint8_t>(
+                           new uint8_t[sample->data_size()],
+                           std::default_delete<uint8_t[]>());
 
-  const uint8_t* source = clear_sample->data();
+  const uint8_t* source = clear_data;
   uint8_t* dest = cipher_sample_data.get();
   if (!subsamples.empty()) {
     size_t total_size = 0;
     for (const SubsampleEntry& subsample : subsamples) {
       if (subsample.clear_bytes > 0) {
-        memcpy(dest, source, subsample.clear_bytes);
+        // The clear bytes are already in the output buffer if the sample was
+        // decrypted into it.
+        if (dest != source)
+          memcpy(dest, source, subsample.clear_bytes);
         source += subsample.clear_bytes;
         dest += subsample.clear_bytes;
         total_size += subsample.clear_bytes;
@@ -227,14 +301,14 @@ Status EncryptionHandler::ProcessMediaSample(
         total_size += subsample.cipher_bytes;
       }
     }
-    DCHECK_EQ(total_size, clear_sample->data_size());
+    DCHECK_EQ(total_size, sample->data_size());
   } else {
-    EncryptBytes(source, clear_sample->data_size(), dest);
+    EncryptBytes(source, sample->data_size(), dest);
   }
 
-  std::shared_ptr<MediaSample> cipher_sample(clear_sample->Clone());
+  std::shared_ptr<MediaSample> cipher_sample(sample->Clone());
   cipher_sample->TransferData(std::move(cipher_sample_data),
-                              clear_sample->data_size());
+                              sample->data_size());
 
   // Finish initializing the sample before sending it downstream. We must
   // wait until now to finish the initialization as we will lose access to
@@ -264,10 +338,45 @@ void EncryptionHandler::SetupProtectionPattern(StreamType stream_type) {
   }
 }
 
+std::shared_ptr<EncryptionKeyFuture> EncryptionHandler::RequestCryptoPeriodKey(
+    int64_t crypto_period_index) {
+  std::shared_ptr<EncryptionKeyFuture> future =
+      key_source_->GetCryptoPeriodKeyAsync(
+          static_cast<uint32_t>(crypto_period_index),
+          static_cast<uint32_t>(
+              encryption_params_.crypto_period_duration_in_seconds),
+          stream_label_);
+  // The callback holds a reference to the key source until the request
+  // completes.
+  std::shared_ptr<KeySource> key_source = key_source_;
+  future->AddCallback(
+      [key_source](const Status&, const EncryptionKey&) {});
+  return future;
+}
+
+Status EncryptionHandler::WaitForCryptoPeriodKey(
+    int64_t crypto_period_index,
+    EncryptionKeyFuture* future,
+    EncryptionKey* encryption_key) {
+  if (future->IsReady())
+    return future->Wait(encryption_key);
+
+  const base::TimeTicks start = base::TimeTicks::Now();
+  Status status = future->Wait(encryption_key);
+  const base::TimeDelta stall_time = base::TimeTicks::Now() - start;
+  ++num_key_stalls_;
+  total_key_stall_time_ += stall_time;
+  max_key_stall_time_ = std::max(max_key_stall_time_, stall_time);
+  VLOG(1) << "Stalled " << stall_time.InMilliseconds()
+          << "ms waiting for the key of crypto period " << crypto_period_index
+          << " of stream '" << stream_label_ << "'.";
+  return status;
+}
+
 bool EncryptionHandler::CreateEncryptor(const EncryptionKey& encryption_key) {
-  std::unique_ptr<AesCryptor> encryptor = encryptor_factory_->CreateEncryptor(
-      protection_scheme_, crypt_byte_block_, skip_byte_block_, codec_,
-      encryption_key.key, encryption_key.iv);
+  std::shared_ptr<AesCryptor> encryptor = encryptor_cache_.GetEncryptor(
+      encryptor_factory_.get(), protection_scheme_, crypt_byte_block_,
+      skip_byte_block_, codec_, encryption_key.key, encryption_key.iv);
   if (!encryptor)
     return false;
   encryptor_ = std::move(encryptor);
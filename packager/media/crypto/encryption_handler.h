@@ -7,8 +7,11 @@
 #ifndef PACKAGER_MEDIA_CRYPTO_ENCRYPTION_HANDLER_H_
 #define PACKAGER_MEDIA_CRYPTO_ENCRYPTION_HANDLER_H_
 
+#include "packager/base/time/time.h"
+#include "packager/media/base/encryption_key_future.h"
 #include "packager/media/base/key_source.h"
 #include "packager/media/base/media_handler.h"
+#include "packager/media/crypto/encryptor_cache.h"
 #include "packager/media/public/crypto_params.h"
 
 namespace shaka {
@@ -16,16 +19,30 @@ namespace media {
 
 class AesCryptor;
 class AesEncryptorFactory;
+class DecryptorSource;
 class SubsampleGenerator;
 struct EncryptionKey;
 
 class EncryptionHandler : public MediaHandler {
  public:
+  /// @param encryption_params contains the encryption parameters.
+  /// @param key_source is the source of the encryption keys. It is shared, as
+  ///        the outstanding key requests keep it alive after the handler is
+  ///        destroyed.
   EncryptionHandler(const EncryptionParams& encryption_params,
-                    KeySource* key_source);
+                    std::shared_ptr<KeySource> key_source);
 
   ~EncryptionHandler() override;
 
+  /// Set the DecryptorSource to decrypt encrypted input samples, e.g. the
+  /// samples dispatched by a Demuxer deferring decryption. Each encrypted
+  /// sample is decrypted into the buffer of the output sample and re-encrypted
+  /// in place, so converting the protection scheme, e.g. from 'cenc' to
+  /// 'cbcs', takes a single copy of the sample data.
+  /// @param decryptor_source is the source of decryptors, usually shared with
+  ///        the Demuxer, whose KeySource fetches the keys of the input.
+  void SetDecryptorSource(std::shared_ptr<DecryptorSource> decryptor_source);
+
  protected:
   /// @name MediaHandler implementation overrides.
   /// @{
@@ -41,27 +58,26 @@ class EncryptionHandler : public MediaHandler {
 
   // Processes |stream_info| and sets up stream specific variables.
   Status ProcessStreamInfo(const StreamInfo& stream_info);
-  // Processes media sample and encrypts it if needed.
-  Status ProcessMediaSample(std::shared_ptr<const MediaSample> clear_sample);
+  // Processes media sample and encrypts it if needed. The sample is decrypted
+  // first if it is encrypted.
+  Status ProcessMediaSample(std::shared_ptr<const MediaSample> sample);
 
   void SetupProtectionPattern(StreamType stream_type);
+  // Requests the key of crypto period |crypto_period_index|. The request keeps
+  // |key_source_| alive until it completes, so it can be dropped when its key
+  // is not needed any more, without waiting for it.
+  std::shared_ptr<EncryptionKeyFuture> RequestCryptoPeriodKey(
+      int64_t crypto_period_index);
+  // Waits for the key of crypto period |crypto_period_index| from |future|,
+  // recording the time spent waiting if it is not ready yet.
+  Status WaitForCryptoPeriodKey(int64_t crypto_period_index,
+                                EncryptionKeyFuture* future,
+                                EncryptionKey* encryption_key);
   bool CreateEncryptor(const EncryptionKey& encryption_key);
-  // Encrypt an E-AC3 frame with size |source_size| according to SAMPLE-AES
-  // specification. |dest| should have at least |source_size| bytes.
-  bool SampleAesEncryptEac3Frame(const uint8_t* source,
-                                 size_t source_size,
-                                 uint8_t* dest);
   // Encrypt an array with size |source_size|. |dest| should have at
   // least |source_size| bytes.
   void EncryptBytes(const uint8_t* source, size_t source_size, uint8_t* dest);
 
-  // An E-AC3 frame comprises of one or more syncframes. This function extracts
-  // the syncframe sizes from the source bytes.
-  // Returns false if the frame is not well formed.
-  bool ExtractEac3SyncframeSizes(const uint8_t* source,
-                                 size_t source_size,
-                                 std::vector<size_t>* syncframe_sizes);
-
   // Testing injections.
   void InjectSubsampleGeneratorForTesting(
       std::unique_ptr<SubsampleGenerator> generator);
@@ -70,11 +86,15 @@ class EncryptionHandler : public MediaHandler {
 
   const EncryptionParams encryption_params_;
   const FourCC protection_scheme_ = FOURCC_NULL;
-  KeySource* key_source_ = nullptr;
+  const std::shared_ptr<KeySource> key_source_;
+  // Decrypts encrypted input samples if set.
+  std::shared_ptr<DecryptorSource> decryptor_source_;
   std::string stream_label_;
   // Current encryption config and encryptor.
   std::shared_ptr<EncryptionConfig> encryption_config_;
-  std::unique_ptr<AesCryptor> encryptor_;
+  std::shared_ptr<AesCryptor> encryptor_;
+  // Encryptors of recent keys, reused when a key comes back.
+  EncryptorCache encryptor_cache_;
   Codec codec_ = kUnknownCodec;
   // Remaining clear lead in the stream's time scale.
   int64_t remaining_clear_lead_ = 0;
@@ -83,6 +103,14 @@ class EncryptionHandler : public MediaHandler {
   // Previous crypto period index if key rotation is enabled.
   int64_t prev_crypto_period_index_ = -1;
   bool check_new_crypto_period_ = false;
+  // Key request of the next crypto period, prefetched when a crypto period
+  // starts.
+  std::shared_ptr<EncryptionKeyFuture> next_crypto_period_key_;
+  int64_t next_crypto_period_index_ = -1;
+  // Statistics of the waits for crypto period keys.
+  uint64_t num_key_stalls_ = 0;
+  base::TimeDelta total_key_stall_time_;
+  base::TimeDelta max_key_stall_time_;
 
   std::unique_ptr<SubsampleGenerator> subsample_generator_;
   std::unique_ptr<AesEncryptorFactory> encryptor_factory_;
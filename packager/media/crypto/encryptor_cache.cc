@@ -0,0 +1,87 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/crypto/encryptor_cache.h"
+
+#include "packager/base/logging.h"
+#include "packager/media/base/aes_cryptor.h"
+#include "packager/media/crypto/aes_encryptor_factory.h"
+
+namespace shaka {
+namespace media {
+
+EncryptorCache::EncryptorCache(size_t max_entries) : max_entries_(max_entries) {
+  DCHECK_GT(max_entries_, 0u);
+}
+
+EncryptorCache::~EncryptorCache() {}
+
+std::shared_ptr<AesCryptor> EncryptorCache::GetEncryptor(
+    AesEncryptorFactory* encryptor_factory,
+    FourCC protection_scheme,
+    uint8_t crypt_byte_block,
+    uint8_t skip_byte_block,
+    Codec codec,
+    const std::vector<uint8_t>& key,
+    const std::vector<uint8_t>& iv) {
+  DCHECK(encryptor_factory);
+
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->protection_scheme != protection_scheme ||
+        it->crypt_byte_block != crypt_byte_block ||
+        it->skip_byte_block != skip_byte_block || it->codec != codec ||
+        it->key != key) {
+      continue;
+    }
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it);
+    const std::shared_ptr<AesCryptor>& encryptor = entries_.front().encryptor;
+
+    // Only the iv needs to be set up again. The key schedule is kept.
+    if (iv.empty()) {
+      std::vector<uint8_t> random_iv;
+      if (!AesCryptor::GenerateRandomIv(protection_scheme, &random_iv)) {
+        LOG(ERROR) << "Failed to generate random iv.";
+        return nullptr;
+      }
+      if (!encryptor->SetIv(random_iv))
+        return nullptr;
+    } else {
+      if (!encryptor->SetIv(iv))
+        return nullptr;
+    }
+    return encryptor;
+  }
+
+  ++misses_;
+  std::unique_ptr<AesCryptor> encryptor = encryptor_factory->CreateEncryptor(
+      protection_scheme, crypt_byte_block, skip_byte_block, codec, key, iv);
+  if (!encryptor)
+    return nullptr;
+
+  Entry entry;
+  entry.protection_scheme = protection_scheme;
+  entry.crypt_byte_block = crypt_byte_block;
+  entry.skip_byte_block = skip_byte_block;
+  entry.codec = codec;
+  entry.key = key;
+  entry.encryptor = std::move(encryptor);
+  entries_.push_front(std::move(entry));
+  while (entries_.size() > max_entries_)
+    entries_.pop_back();
+  return entries_.front().encryptor;
+}
+
+EncryptorCache::Statistics EncryptorCache::statistics() const {
+  Statistics statistics;
+  statistics.size = entries_.size();
+  statistics.hits = hits_;
+  statistics.misses = misses_;
+  return statistics;
+}
+
+}  // namespace media
+}  // namespace shaka
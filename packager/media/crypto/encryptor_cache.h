@@ -0,0 +1,86 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_CRYPTO_ENCRYPTOR_CACHE_H_
+#define PACKAGER_MEDIA_CRYPTO_ENCRYPTOR_CACHE_H_
+
+#include <stdint.h>
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "packager/media/base/fourccs.h"
+#include "packager/media/base/stream_info.h"
+
+namespace shaka {
+namespace media {
+
+class AesCryptor;
+class AesEncryptorFactory;
+
+/// Caches the encryptors of the most recently used keys, so that an encryptor,
+/// with its expanded key schedule, is reused instead of created again when a
+/// key comes back, e.g. across crypto periods. The entries are keyed by key,
+/// protection scheme, pattern and codec. This class is not thread safe.
+class EncryptorCache {
+ public:
+  struct Statistics {
+    /// Number of cached encryptors.
+    size_t size = 0;
+    /// Number of requests served with a cached encryptor.
+    uint64_t hits = 0;
+    /// Number of requests which created an encryptor.
+    uint64_t misses = 0;
+  };
+
+  /// @param max_entries is the maximum number of cached encryptors. The least
+  ///        recently used encryptor is evicted when the cache is full.
+  explicit EncryptorCache(size_t max_entries);
+  ~EncryptorCache();
+
+  /// Get an encryptor, reusing a cached encryptor if any. The parameters are
+  /// the same as AesEncryptorFactory::CreateEncryptor.
+  /// @param encryptor_factory creates the encryptor on cache miss.
+  /// @return an encryptor set up with @a iv, or with a new random iv if @a iv
+  ///         is empty, or nullptr on failure. The encryptor stays in the
+  ///         cache, and a later call with the same parameters resets its iv.
+  std::shared_ptr<AesCryptor> GetEncryptor(
+      AesEncryptorFactory* encryptor_factory,
+      FourCC protection_scheme,
+      uint8_t crypt_byte_block,
+      uint8_t skip_byte_block,
+      Codec codec,
+      const std::vector<uint8_t>& key,
+      const std::vector<uint8_t>& iv);
+
+  /// @return the cache statistics.
+  Statistics statistics() const;
+
+ private:
+  EncryptorCache(const EncryptorCache&) = delete;
+  EncryptorCache& operator=(const EncryptorCache&) = delete;
+
+  struct Entry {
+    FourCC protection_scheme;
+    uint8_t crypt_byte_block;
+    uint8_t skip_byte_block;
+    Codec codec;
+    std::vector<uint8_t> key;
+    std::shared_ptr<AesCryptor> encryptor;
+  };
+
+  const size_t max_entries_;
+  // Most recently used entry first.
+  std::list<Entry> entries_;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_CRYPTO_ENCRYPTOR_CACHE_H_
@@ -0,0 +1,163 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/crypto/encryptor_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/media/base/aes_cryptor.h"
+#include "packager/media/crypto/aes_encryptor_factory.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const size_t kMaxEntries = 2;
+const uint8_t kKey1[] = {
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+    0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0x10,
+};
+const uint8_t kKey2[] = {
+    0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
+    0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20,
+};
+const uint8_t kKey3[] = {
+    0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+};
+const uint8_t kIv1[] = {
+    0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38,
+};
+const uint8_t kIv2[] = {
+    0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+};
+const uint8_t kData[] = {
+    0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a,
+    0x5b, 0x5c, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62, 0x63, 0x64,
+};
+
+class CountingEncryptorFactory : public AesEncryptorFactory {
+ public:
+  std::unique_ptr<AesCryptor> CreateEncryptor(
+      FourCC protection_scheme,
+      uint8_t crypt_byte_block,
+      uint8_t skip_byte_block,
+      Codec codec,
+      const std::vector<uint8_t>& key,
+      const std::vector<uint8_t>& iv) override {
+    ++num_created_;
+    return AesEncryptorFactory::CreateEncryptor(
+        protection_scheme, crypt_byte_block, skip_byte_block, codec, key, iv);
+  }
+
+  int num_created() const { return num_created_; }
+
+ private:
+  int num_created_ = 0;
+};
+
+}  // namespace
+
+class EncryptorCacheTest : public ::testing::Test {
+ public:
+  EncryptorCacheTest()
+      : cache_(kMaxEntries),
+        key1_(std::begin(kKey1), std::end(kKey1)),
+        key2_(std::begin(kKey2), std::end(kKey2)),
+        key3_(std::begin(kKey3), std::end(kKey3)),
+        iv1_(std::begin(kIv1), std::end(kIv1)),
+        iv2_(std::begin(kIv2), std::end(kIv2)) {}
+
+ protected:
+  std::shared_ptr<AesCryptor> GetCencEncryptor(const std::vector<uint8_t>& key,
+                                               const std::vector<uint8_t>& iv) {
+    return cache_.GetEncryptor(&factory_, FOURCC_cenc, 0, 0, kCodecH264, key,
+                               iv);
+  }
+
+  std::vector<uint8_t> Encrypt(AesCryptor* encryptor) {
+    std::vector<uint8_t> encrypted;
+    EXPECT_TRUE(encryptor->Crypt(
+        std::vector<uint8_t>(std::begin(kData), std::end(kData)), &encrypted));
+    return encrypted;
+  }
+
+  CountingEncryptorFactory factory_;
+  EncryptorCache cache_;
+  const std::vector<uint8_t> key1_;
+  const std::vector<uint8_t> key2_;
+  const std::vector<uint8_t> key3_;
+  const std::vector<uint8_t> iv1_;
+  const std::vector<uint8_t> iv2_;
+};
+
+TEST_F(EncryptorCacheTest, ReuseEncryptorWithNewIv) {
+  std::shared_ptr<AesCryptor> encryptor = GetCencEncryptor(key1_, iv1_);
+  ASSERT_TRUE(encryptor);
+  Encrypt(encryptor.get());
+
+  std::shared_ptr<AesCryptor> cached_encryptor = GetCencEncryptor(key1_, iv2_);
+  EXPECT_EQ(encryptor, cached_encryptor);
+  EXPECT_EQ(1, factory_.num_created());
+  EXPECT_EQ(iv2_, cached_encryptor->iv());
+
+  // The cached encryptor starts over with the new iv.
+  AesEncryptorFactory factory;
+  std::unique_ptr<AesCryptor> new_encryptor =
+      factory.CreateEncryptor(FOURCC_cenc, 0, 0, kCodecH264, key1_, iv2_);
+  ASSERT_TRUE(new_encryptor);
+  EXPECT_EQ(Encrypt(new_encryptor.get()), Encrypt(cached_encryptor.get()));
+
+  const EncryptorCache::Statistics statistics = cache_.statistics();
+  EXPECT_EQ(1u, statistics.size);
+  EXPECT_EQ(1u, statistics.hits);
+  EXPECT_EQ(1u, statistics.misses);
+}
+
+TEST_F(EncryptorCacheTest, RandomIvOnHit) {
+  std::shared_ptr<AesCryptor> encryptor =
+      GetCencEncryptor(key1_, std::vector<uint8_t>());
+  ASSERT_TRUE(encryptor);
+  const std::vector<uint8_t> first_iv = encryptor->iv();
+
+  ASSERT_EQ(encryptor, GetCencEncryptor(key1_, std::vector<uint8_t>()));
+  EXPECT_EQ(first_iv.size(), encryptor->iv().size());
+  EXPECT_NE(first_iv, encryptor->iv());
+}
+
+TEST_F(EncryptorCacheTest, DifferentParametersMiss) {
+  std::shared_ptr<AesCryptor> encryptor = GetCencEncryptor(key1_, iv1_);
+  EXPECT_NE(encryptor, GetCencEncryptor(key2_, iv1_));
+  EXPECT_NE(encryptor, cache_.GetEncryptor(&factory_, FOURCC_cbc1, 0, 0,
+                                           kCodecH264, key1_, iv1_));
+  EXPECT_EQ(3, factory_.num_created());
+  EXPECT_EQ(0u, cache_.statistics().hits);
+  EXPECT_EQ(3u, cache_.statistics().misses);
+}
+
+TEST_F(EncryptorCacheTest, EvictLeastRecentlyUsed) {
+  std::shared_ptr<AesCryptor> encryptor1 = GetCencEncryptor(key1_, iv1_);
+  std::shared_ptr<AesCryptor> encryptor2 = GetCencEncryptor(key2_, iv1_);
+  // |key1_| becomes the most recently used.
+  EXPECT_EQ(encryptor1, GetCencEncryptor(key1_, iv1_));
+  // |key2_| is evicted.
+  GetCencEncryptor(key3_, iv1_);
+  EXPECT_EQ(kMaxEntries, cache_.statistics().size);
+
+  EXPECT_EQ(encryptor1, GetCencEncryptor(key1_, iv1_));
+  EXPECT_NE(encryptor2, GetCencEncryptor(key2_, iv1_));
+  EXPECT_EQ(4, factory_.num_created());
+}
+
+TEST_F(EncryptorCacheTest, FailedCreationNotCached) {
+  EXPECT_FALSE(cache_.GetEncryptor(&factory_, FOURCC_NULL, 0, 0, kCodecH264,
+                                   key1_, iv1_));
+  EXPECT_EQ(0u, cache_.statistics().size);
+  EXPECT_EQ(1u, cache_.statistics().misses);
+}
+
+}  // namespace media
+}  // namespace shaka
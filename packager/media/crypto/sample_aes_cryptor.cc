@@ -0,0 +1,97 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/crypto/sample_aes_cryptor.h"
+
+#include <openssl/aes.h>
+
+#include <algorithm>
+
+#include "packager/base/logging.h"
+
+namespace shaka {
+namespace media {
+
+SampleAesCryptor::SampleAesCryptor(uint8_t crypt_byte_block,
+                                   uint8_t skip_byte_block)
+    : AesCryptor(kUseConstantIv),
+      crypt_byte_size_(crypt_byte_block * AES_BLOCK_SIZE),
+      skip_byte_size_(skip_byte_block * AES_BLOCK_SIZE),
+      internal_iv_(AES_BLOCK_SIZE, 0) {
+  DCHECK(crypt_byte_block > 0 || skip_byte_block == 0);
+}
+
+SampleAesCryptor::~SampleAesCryptor() {}
+
+bool SampleAesCryptor::InitializeWithIv(const std::vector<uint8_t>& key,
+                                        const std::vector<uint8_t>& iv) {
+  // AES defines three key sizes: 128, 192 and 256 bits.
+  if (key.size() != 16 && key.size() != 24 && key.size() != 32) {
+    LOG(ERROR) << "Invalid AES key size: " << key.size();
+    return false;
+  }
+  CHECK_EQ(AES_set_encrypt_key(key.data(), key.size() * 8, mutable_aes_key()),
+           0);
+  return SetIv(iv);
+}
+
+bool SampleAesCryptor::CryptInternal(const uint8_t* text,
+                                     size_t text_size,
+                                     uint8_t* crypt_text,
+                                     size_t* crypt_text_size) {
+  // |crypt_text_size| is always the same as |text_size|.
+  if (*crypt_text_size < text_size) {
+    LOG(ERROR) << "Expecting output size of at least " << text_size
+               << " bytes.";
+    return false;
+  }
+  *crypt_text_size = text_size;
+  const bool in_place = crypt_text == text;
+
+  if (crypt_byte_size_ == 0) {
+    // All the full blocks are encrypted in a single call. The residual block
+    // is left unencrypted.
+    const size_t cbc_size = text_size - text_size % AES_BLOCK_SIZE;
+    if (cbc_size > 0) {
+      AES_cbc_encrypt(text, crypt_text, cbc_size, aes_key(),
+                      internal_iv_.data(), AES_ENCRYPT);
+    }
+    if (!in_place)
+      memcpy(crypt_text + cbc_size, text + cbc_size, text_size - cbc_size);
+    return true;
+  }
+
+  // The cipher block chain continues across the skipped blocks, i.e.
+  // |internal_iv_| keeps the last encrypted block.
+  while (text_size > crypt_byte_size_) {
+    AES_cbc_encrypt(text, crypt_text, crypt_byte_size_, aes_key(),
+                    internal_iv_.data(), AES_ENCRYPT);
+    text += crypt_byte_size_;
+    crypt_text += crypt_byte_size_;
+    text_size -= crypt_byte_size_;
+
+    const size_t skip_byte_size = std::min(skip_byte_size_, text_size);
+    if (!in_place)
+      memcpy(crypt_text, text, skip_byte_size);
+    text += skip_byte_size;
+    crypt_text += skip_byte_size;
+    text_size -= skip_byte_size;
+  }
+  // The remaining bytes, which are no more than the encrypted part of the
+  // pattern, are left unencrypted.
+  if (!in_place && text_size > 0)
+    memcpy(crypt_text, text, text_size);
+  return true;
+}
+
+void SampleAesCryptor::SetIvInternal() {
+  // Reuses the storage of |internal_iv_|, as the iv is set for every sample.
+  std::fill(std::copy(iv().begin(), iv().end(), internal_iv_.begin()),
+            internal_iv_.end(), 0);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -0,0 +1,61 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_CRYPTO_SAMPLE_AES_CRYPTOR_H_
+#define PACKAGER_MEDIA_CRYPTO_SAMPLE_AES_CRYPTOR_H_
+
+#include <vector>
+
+#include "packager/media/base/aes_cryptor.h"
+
+namespace shaka {
+namespace media {
+
+/// Encryptor for MPEG-2 Stream Encryption Format for HTTP Live Streaming, i.e.
+/// SAMPLE-AES, of H.264 video NAL units and AAC / AC-3 audio frames. The
+/// leading clear bytes are handled by SubsampleGenerator; each Crypt call
+/// encrypts one protected region, starting with the constant iv.
+/// Video is encrypted with a crypt:skip pattern. The encrypted blocks are
+/// chained with AES-CBC in place and the skipped blocks are not touched, so
+/// there is no intermediate cryptor or buffer per block. Audio is encrypted
+/// with a single AES-CBC call, leaving the residual block in the clear.
+/// E-AC-3 is handled by SampleAesEc3Cryptor.
+class SampleAesCryptor : public AesCryptor {
+ public:
+  /// @param crypt_byte_block indicates number of encrypted blocks (16-byte) in
+  ///        pattern based encryption, e.g. 1 for H.264 video.
+  /// @param skip_byte_block indicates number of unencrypted blocks (16-byte)
+  ///        in pattern based encryption, e.g. 9 for H.264 video. Pattern 0:0
+  ///        means that all the full blocks are encrypted, as for audio.
+  SampleAesCryptor(uint8_t crypt_byte_block, uint8_t skip_byte_block);
+  ~SampleAesCryptor() override;
+
+  /// @name AesCryptor implementation overrides.
+  /// @{
+  bool InitializeWithIv(const std::vector<uint8_t>& key,
+                        const std::vector<uint8_t>& iv) override;
+  /// @}
+
+ private:
+  SampleAesCryptor(const SampleAesCryptor&) = delete;
+  SampleAesCryptor& operator=(const SampleAesCryptor&) = delete;
+
+  bool CryptInternal(const uint8_t* text,
+                     size_t text_size,
+                     uint8_t* crypt_text,
+                     size_t* crypt_text_size) override;
+  void SetIvInternal() override;
+
+  const size_t crypt_byte_size_;
+  const size_t skip_byte_size_;
+  // 16-byte chaining value, reset to the iv for every Crypt call.
+  std::vector<uint8_t> internal_iv_;
+};
+
+}  // namespace media
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_CRYPTO_SAMPLE_AES_CRYPTOR_H_
@@ -0,0 +1,178 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/crypto/sample_aes_cryptor.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/time/time.h"
+#include "packager/media/base/aes_encryptor.h"
+#include "packager/media/base/aes_pattern_cryptor.h"
+
+namespace shaka {
+namespace media {
+namespace {
+
+const uint8_t kKey[] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                        0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+const uint8_t kIv[] = {0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+                       0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff};
+// SAMPLE-AES encrypts one of every ten blocks of H.264 video slices.
+const uint8_t kVideoCryptByteBlock = 1;
+const uint8_t kVideoSkipByteBlock = 9;
+// Sizes of consecutive protected regions, each starting with the iv.
+const size_t kRegionSizes[] = {0, 5, 16, 17, 160, 161, 176, 177, 1000, 4097};
+
+std::vector<uint8_t> GetText(size_t size) {
+  std::vector<uint8_t> text(size);
+  for (size_t i = 0; i < size; ++i)
+    text[i] = static_cast<uint8_t>(i * 13 + 7);
+  return text;
+}
+
+// Creates the cryptor stack used for SAMPLE-AES before SampleAesCryptor.
+std::unique_ptr<AesCryptor> CreateReferenceCryptor(uint8_t crypt_byte_block,
+                                                   uint8_t skip_byte_block) {
+  if (crypt_byte_block == 0 && skip_byte_block == 0) {
+    return std::unique_ptr<AesCryptor>(
+        new AesCbcEncryptor(kNoPadding, AesCryptor::kUseConstantIv));
+  }
+  return std::unique_ptr<AesCryptor>(new AesPatternCryptor(
+      crypt_byte_block, skip_byte_block,
+      AesPatternCryptor::kSkipIfCryptByteBlockRemaining,
+      AesCryptor::kUseConstantIv,
+      std::unique_ptr<AesCryptor>(
+          new AesCbcEncryptor(kNoPadding, AesCryptor::kDontUseConstantIv))));
+}
+
+}  // namespace
+
+class SampleAesCryptorTest : public ::testing::Test {
+ public:
+  SampleAesCryptorTest()
+      : key_(std::begin(kKey), std::end(kKey)),
+        iv_(std::begin(kIv), std::end(kIv)) {}
+
+ protected:
+  void VerifyMatchesReference(uint8_t crypt_byte_block,
+                              uint8_t skip_byte_block) {
+    std::unique_ptr<AesCryptor> reference_cryptor =
+        CreateReferenceCryptor(crypt_byte_block, skip_byte_block);
+    ASSERT_TRUE(reference_cryptor->InitializeWithIv(key_, iv_));
+    SampleAesCryptor cryptor(crypt_byte_block, skip_byte_block);
+    ASSERT_TRUE(cryptor.InitializeWithIv(key_, iv_));
+
+    for (size_t region_size : kRegionSizes) {
+      const std::vector<uint8_t> text = GetText(region_size);
+      std::vector<uint8_t> expected;
+      ASSERT_TRUE(reference_cryptor->Crypt(text, &expected));
+      std::vector<uint8_t> crypt_text;
+      ASSERT_TRUE(cryptor.Crypt(text, &crypt_text));
+      EXPECT_EQ(expected, crypt_text) << "region size " << region_size;
+
+      // In place.
+      std::vector<uint8_t> in_place_text = text;
+      ASSERT_TRUE(cryptor.Crypt(in_place_text.data(), in_place_text.size(),
+                                in_place_text.data()));
+      EXPECT_EQ(expected, in_place_text) << "region size " << region_size;
+    }
+  }
+
+  const std::vector<uint8_t> key_;
+  const std::vector<uint8_t> iv_;
+};
+
+TEST_F(SampleAesCryptorTest, VideoMatchesPatternCryptor) {
+  VerifyMatchesReference(kVideoCryptByteBlock, kVideoSkipByteBlock);
+}
+
+TEST_F(SampleAesCryptorTest, OtherPatternMatchesPatternCryptor) {
+  VerifyMatchesReference(2, 3);
+}
+
+TEST_F(SampleAesCryptorTest, AudioMatchesCbcEncryptor) {
+  VerifyMatchesReference(0, 0);
+}
+
+TEST_F(SampleAesCryptorTest, ConstantIv) {
+  SampleAesCryptor cryptor(kVideoCryptByteBlock, kVideoSkipByteBlock);
+  ASSERT_TRUE(cryptor.InitializeWithIv(key_, iv_));
+  const std::vector<uint8_t> text = GetText(1000);
+  std::vector<uint8_t> crypt_text1;
+  ASSERT_TRUE(cryptor.Crypt(text, &crypt_text1));
+  cryptor.UpdateIv();
+  EXPECT_EQ(iv_, cryptor.iv());
+  std::vector<uint8_t> crypt_text2;
+  ASSERT_TRUE(cryptor.Crypt(text, &crypt_text2));
+  EXPECT_EQ(crypt_text1, crypt_text2);
+}
+
+TEST_F(SampleAesCryptorTest, InvalidKeySize) {
+  SampleAesCryptor cryptor(kVideoCryptByteBlock, kVideoSkipByteBlock);
+  EXPECT_FALSE(cryptor.InitializeWithIv(std::vector<uint8_t>(15, 0), iv_));
+}
+
+// Compares SampleAesCryptor with the previous cryptor stack on the protected
+// regions of a typical HLS TS ladder. Run with --gtest_also_run_disabled_tests.
+class SampleAesCryptorBenchmark : public ::testing::Test {
+ protected:
+  struct Rendition {
+    const char* name;
+    uint8_t crypt_byte_block;
+    uint8_t skip_byte_block;
+    // Average protected bytes per frame.
+    size_t frame_size;
+    size_t frames_per_second;
+  };
+
+  // Encrypts |kDurationInSeconds| of |rendition| one frame at a time.
+  void Run(const Rendition& rendition) {
+    const size_t kDurationInSeconds = 60;
+    const size_t num_frames = kDurationInSeconds * rendition.frames_per_second;
+    std::vector<uint8_t> text = GetText(rendition.frame_size * num_frames);
+
+    std::unique_ptr<AesCryptor> reference_cryptor = CreateReferenceCryptor(
+        rendition.crypt_byte_block, rendition.skip_byte_block);
+    SampleAesCryptor cryptor(rendition.crypt_byte_block,
+                             rendition.skip_byte_block);
+    const base::TimeDelta reference_elapsed =
+        Encrypt(reference_cryptor.get(), rendition.frame_size, &text);
+    const base::TimeDelta elapsed =
+        Encrypt(&cryptor, rendition.frame_size, &text);
+    LOG(INFO) << rendition.name << ": " << reference_elapsed.InMilliseconds()
+              << " ms before, " << elapsed.InMilliseconds() << " ms after.";
+  }
+
+  base::TimeDelta Encrypt(AesCryptor* cryptor,
+                          size_t frame_size,
+                          std::vector<uint8_t>* text) {
+    const std::vector<uint8_t> key(std::begin(kKey), std::end(kKey));
+    const std::vector<uint8_t> iv(std::begin(kIv), std::end(kIv));
+    CHECK(cryptor->InitializeWithIv(key, iv));
+    const base::TimeTicks start = base::TimeTicks::Now();
+    for (size_t offset = 0; offset < text->size(); offset += frame_size) {
+      CHECK(cryptor->Crypt(&(*text)[offset], frame_size, &(*text)[offset]));
+    }
+    return base::TimeTicks::Now() - start;
+  }
+};
+
+TEST_F(SampleAesCryptorBenchmark, DISABLED_HlsLadder) {
+  const Rendition kRenditions[] = {
+      {"416x234 145 kbps", 1, 9, 600, 30},
+      {"640x360 730 kbps", 1, 9, 3000, 30},
+      {"1280x720 3 Mbps", 1, 9, 12500, 30},
+      {"1920x1080 6 Mbps", 1, 9, 25000, 30},
+      {"AAC 128 kbps", 0, 0, 370, 43},
+      {"AC-3 384 kbps", 0, 0, 1536, 31},
+  };
+  for (const Rendition& rendition : kRenditions)
+    Run(rendition);
+}
+
+}  // namespace media
+}  // namespace shaka
@@ -15,43 +15,39 @@ namespace shaka {
 namespace media {
 namespace {
 
-bool ExtractEac3SyncframeSizes(const uint8_t* source,
-                               size_t source_size,
-                               std::vector<size_t>* syncframe_sizes) {
+// Reads the size of the syncframe at the start of |source|, which should have
+// at least a complete syncframe.
+bool ReadEac3SyncframeSize(const uint8_t* source,
+                           size_t source_size,
+                           size_t* syncframe_size) {
   DCHECK(source);
-  DCHECK(syncframe_sizes);
+  DCHECK(syncframe_size);
 
-  syncframe_sizes->clear();
   BufferReader frame(source, source_size);
   // ASTC Standard A/52:2012 Annex E: Enhanced AC-3.
-  while (frame.HasBytes(1)) {
-    uint16_t syncword;
-    if (!frame.Read2(&syncword)) {
-      LOG(ERROR) << "Not enough bytes for syncword.";
-      return false;
-    }
-    if (syncword != 0x0B77) {
-      LOG(ERROR) << "Invalid E-AC3 frame. Seeing 0x" << std::hex << syncword
-                 << std::dec
-                 << ". The sync frame does not start with "
-                    "the valid syncword 0x0B77.";
-      return false;
-    }
-    uint16_t stream_type_and_syncframe_size;
-    if (!frame.Read2(&stream_type_and_syncframe_size)) {
-      LOG(ERROR) << "Not enough bytes for syncframe size.";
-      return false;
-    }
-    // frmsiz = least significant 11 bits. syncframe_size is (frmsiz + 1) * 2.
-    const size_t syncframe_size =
-        ((stream_type_and_syncframe_size & 0x7FF) + 1) * 2;
-    if (!frame.SkipBytes(syncframe_size - sizeof(syncword) -
-                         sizeof(stream_type_and_syncframe_size))) {
-      LOG(ERROR) << "Not enough bytes for syncframe. Expecting "
-                 << syncframe_size << " bytes.";
-      return false;
-    }
-    syncframe_sizes->push_back(syncframe_size);
+  uint16_t syncword;
+  if (!frame.Read2(&syncword)) {
+    LOG(ERROR) << "Not enough bytes for syncword.";
+    return false;
+  }
+  if (syncword != 0x0B77) {
+    LOG(ERROR) << "Invalid E-AC3 frame. Seeing 0x" << std::hex << syncword
+               << std::dec
+               << ". The sync frame does not start with "
+                  "the valid syncword 0x0B77.";
+    return false;
+  }
+  uint16_t stream_type_and_syncframe_size;
+  if (!frame.Read2(&stream_type_and_syncframe_size)) {
+    LOG(ERROR) << "Not enough bytes for syncframe size.";
+    return false;
+  }
+  // frmsiz = least significant 11 bits. syncframe_size is (frmsiz + 1) * 2.
+  *syncframe_size = ((stream_type_and_syncframe_size & 0x7FF) + 1) * 2;
+  if (*syncframe_size > source_size) {
+    LOG(ERROR) << "Not enough bytes for syncframe. Expecting "
+               << *syncframe_size << " bytes.";
+    return false;
   }
   return true;
 }
@@ -81,17 +77,28 @@ bool SampleAesEc3Cryptor::CryptInternal(const uint8_t* text,
   }
   *crypt_text_size = text_size;
 
-  std::vector<size_t> syncframe_sizes;
-  if (!ExtractEac3SyncframeSizes(text, text_size, &syncframe_sizes))
-    return false;
+  // Validate all the syncframes before encrypting any of them. The syncframe
+  // headers are read again below instead of keeping the sizes in a vector.
+  size_t syncframe_size = 0;
+  for (size_t offset = 0; offset < text_size; offset += syncframe_size) {
+    if (!ReadEac3SyncframeSize(text + offset, text_size - offset,
+                               &syncframe_size)) {
+      return false;
+    }
+  }
 
   // MPEG-2 Stream Encryption Format for HTTP Live Streaming 2.3.1.3 Enhanced
   // AC-3: The first 16 bytes, starting with the syncframe() header, are not
   // encrypted.
   const size_t kLeadingClearBytesSize = 16u;
 
-  for (size_t syncframe_size : syncframe_sizes) {
-    memcpy(crypt_text, text, std::min(syncframe_size, kLeadingClearBytesSize));
+  const uint8_t* const text_end = text + text_size;
+  while (text < text_end) {
+    CHECK(ReadEac3SyncframeSize(text, text_end - text, &syncframe_size));
+    if (crypt_text != text) {
+      memcpy(crypt_text, text,
+             std::min(syncframe_size, kLeadingClearBytesSize));
+    }
     if (syncframe_size > kLeadingClearBytesSize) {
       // The residual block is left untouched (copied without
       // encryption/decryption). No need to do special handling here.
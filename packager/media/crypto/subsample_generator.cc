@@ -204,45 +204,58 @@ Status SubsampleGenerator::Initialize(FourCC protection_scheme,
                       "Unexpected codec for SAMPLE-AES.");
     }
   }
-  return Status::OK;
-}
 
-Status SubsampleGenerator::GenerateSubsamples(
-    const uint8_t* frame,
-    size_t frame_size,
-    std::vector<SubsampleEntry>* subsamples) {
-  subsamples->clear();
   switch (codec_) {
     case kCodecAV1:
-      return GenerateSubsamplesFromAV1Frame(frame, frame_size, subsamples);
+      strategy_ = Strategy::kAV1;
+      break;
     case kCodecH264:
-      FALLTHROUGH_INTENDED;
     case kCodecH265:
     case kCodecH265DolbyVision:
-      return GenerateSubsamplesFromH26xFrame(frame, frame_size, subsamples);
+      strategy_ = Strategy::kH26x;
+      break;
     case kCodecVP9:
-      if (vp9_subsample_encryption_)
-        return GenerateSubsamplesFromVPxFrame(frame, frame_size, subsamples);
-      // Full sample encrypted so no subsamples.
+      strategy_ = vp9_subsample_encryption_ ? Strategy::kVPx
+                                            : Strategy::kFullSample;
       break;
     default:
       // Other codecs are full sample encrypted unless there are clear leading
       // bytes.
-      if (leading_clear_bytes_size_ > 0) {
-        SubsampleOrganizer subsample_organizer(align_protected_data_,
-                                               subsamples);
-        const size_t clear_bytes =
-            std::min(frame_size, leading_clear_bytes_size_);
-        const size_t cipher_bytes = frame_size - clear_bytes;
-        subsample_organizer.AddSubsample(clear_bytes, cipher_bytes);
-      } else {
-        // Full sample encrypted so no subsamples.
-      }
+      strategy_ = leading_clear_bytes_size_ > 0 ? Strategy::kLeadingClearBytes
+                                                : Strategy::kFullSample;
       break;
   }
   return Status::OK;
 }
 
+Status SubsampleGenerator::GenerateSubsamples(
+    const uint8_t* frame,
+    size_t frame_size,
+    std::vector<SubsampleEntry>* subsamples) {
+  subsamples->clear();
+  switch (strategy_) {
+    case Strategy::kFullSample:
+      // Full sample encrypted so no subsamples.
+      break;
+    case Strategy::kLeadingClearBytes: {
+      SubsampleOrganizer subsample_organizer(align_protected_data_,
+                                             subsamples);
+      const size_t clear_bytes =
+          std::min(frame_size, leading_clear_bytes_size_);
+      const size_t cipher_bytes = frame_size - clear_bytes;
+      subsample_organizer.AddSubsample(clear_bytes, cipher_bytes);
+      break;
+    }
+    case Strategy::kVPx:
+      return GenerateSubsamplesFromVPxFrame(frame, frame_size, subsamples);
+    case Strategy::kH26x:
+      return GenerateSubsamplesFromH26xFrame(frame, frame_size, subsamples);
+    case Strategy::kAV1:
+      return GenerateSubsamplesFromAV1Frame(frame, frame_size, subsamples);
+  }
+  return Status::OK;
+}
+
 void SubsampleGenerator::InjectVpxParserForTesting(
     std::unique_ptr<VPxParser> vpx_parser) {
   vpx_parser_ = std::move(vpx_parser);
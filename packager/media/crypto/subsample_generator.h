@@ -70,6 +70,17 @@ class SubsampleGenerator {
   SubsampleGenerator(const SubsampleGenerator&) = delete;
   SubsampleGenerator& operator=(const SubsampleGenerator&) = delete;
 
+  // How subsamples are generated for the stream, picked once in Initialize.
+  enum class Strategy {
+    // No subsamples, i.e. full sample encryption.
+    kFullSample,
+    // A fixed number of leading clear bytes, e.g. SAMPLE-AES audio.
+    kLeadingClearBytes,
+    kVPx,
+    kH26x,
+    kAV1,
+  };
+
   Status GenerateSubsamplesFromVPxFrame(
       const uint8_t* frame,
       size_t frame_size,
@@ -84,6 +95,7 @@ class SubsampleGenerator {
       std::vector<SubsampleEntry>* subsamples);
 
   const bool vp9_subsample_encryption_ = false;
+  Strategy strategy_ = Strategy::kFullSample;
   // Whether the protected portion should be AES block (16 bytes) aligned.
   bool align_protected_data_ = false;
   Codec codec_ = kUnknownCodec;
@@ -82,6 +82,23 @@ Demuxer::~Demuxer() {
 
 void Demuxer::SetKeySource(std::unique_ptr<KeySource> key_source) {
   key_source_ = std::move(key_source);
+  decryptor_source_.reset();
+}
+
+std::shared_ptr<DecryptorSource> Demuxer::GetDecryptorSource() {
+  if (!key_source_)
+    return nullptr;
+  if (!decryptor_source_) {
+    // The handlers may outlive the demuxer, so the DecryptorSource keeps the
+    // key source alive.
+    std::shared_ptr<KeySource> key_source = key_source_;
+    decryptor_source_.reset(
+        new DecryptorSource(key_source.get()),
+        [key_source](DecryptorSource* decryptor_source) {
+          delete decryptor_source;
+        });
+  }
+  return decryptor_source_;
 }
 
 Status Demuxer::Run() {
@@ -213,6 +230,12 @@ Status Demuxer::InitializeParser() {
       return Status(error::UNIMPLEMENTED, "Container not supported.");
   }
 
+  // The key source is passed to the parser even if the decryption is deferred,
+  // so that the keys in the 'pssh' boxes of the input are fetched.
+  if (IsDecryptionDeferred()) {
+    static_cast<mp4::MP4MediaParser*>(parser_.get())
+        ->set_defer_decryption(true);
+  }
   parser_->Init(base::Bind(&Demuxer::ParserInitEvent, base::Unretained(this)),
                 base::Bind(&Demuxer::NewSampleEvent, base::Unretained(this)),
                 key_source_.get());
@@ -277,7 +300,7 @@ void Demuxer::ParserInitEvent(
           stream_info->stream_type() != kStreamVideo) {
         stream_info->set_language(iter->second);
       }
-      if (stream_info->is_encrypted()) {
+      if (stream_info->is_encrypted() && !IsDecryptionDeferred()) {
         init_event_status_.Update(Status(error::INVALID_ARGUMENT,
                                          "A decryption key source is not "
                                          "provided for an encrypted stream."));
@@ -334,6 +357,13 @@ bool Demuxer::PushSample(uint32_t track_id,
   return status.ok();
 }
 
+bool Demuxer::IsDecryptionDeferred() const {
+  // Only the ISO BMFF parser leaves encrypted samples intact for a later
+  // decryption. Other parsers may need the clear sample data, e.g. to extract
+  // the codec configuration.
+  return defer_decryption_ && key_source_ && container_name_ == CONTAINER_MOV;
+}
+
 Status Demuxer::Parse() {
   DCHECK(media_file_);
   DCHECK(parser_);
@@ -23,6 +23,7 @@ class File;
 namespace media {
 
 class Decryptor;
+class DecryptorSource;
 class KeySource;
 class MediaParser;
 class MediaSample;
@@ -75,6 +76,21 @@ class Demuxer : public OriginHandler {
     dump_stream_info_ = dump_stream_info;
   }
 
+  /// Dispatch the samples of encrypted ISO BMFF streams without decrypting
+  /// them, together with their DecryptConfig, so that a downstream handler
+  /// can decrypt them, e.g. an EncryptionHandler re-encrypting the samples.
+  /// Has no effect if there is no KeySource or for other containers. The keys
+  /// are still fetched by the demuxer from the 'pssh' boxes of the input.
+  void set_defer_decryption(bool defer_decryption) {
+    defer_decryption_ = defer_decryption;
+  }
+
+  /// @return the DecryptorSource to decrypt the samples dispatched encrypted,
+  ///         backed by the KeySource of the demuxer, or null if there is no
+  ///         KeySource. It is shared by the downstream handlers of all the
+  ///         streams, which run on the thread of the demuxer.
+  std::shared_ptr<DecryptorSource> GetDecryptorSource();
+
  protected:
   /// @name MediaHandler implementation overrides.
   /// @{
@@ -118,6 +134,9 @@ class Demuxer : public OriginHandler {
   bool PushSample(uint32_t track_id,
                   const std::shared_ptr<MediaSample>& sample);
 
+  // @return true if the encrypted samples are dispatched without decryption.
+  bool IsDecryptionDeferred() const;
+
   // Read from the source and send it to the parser.
   Status Parse();
 
@@ -137,10 +156,13 @@ class Demuxer : public OriginHandler {
   std::map<size_t, std::string> language_overrides_;
   MediaContainerName container_name_ = CONTAINER_UNKNOWN;
   std::unique_ptr<uint8_t[]> buffer_;
-  std::unique_ptr<KeySource> key_source_;
+  std::shared_ptr<KeySource> key_source_;
+  std::shared_ptr<DecryptorSource> decryptor_source_;
   bool cancelled_ = false;
   // Whether to dump stream info when it is received.
   bool dump_stream_info_ = false;
+  // Whether to leave the decryption of the samples to a downstream handler.
+  bool defer_decryption_ = false;
   Status init_event_status_;
 };
 
@@ -32,6 +32,7 @@
       ],
       'dependencies': [
         '../../file/file.gyp:file',
+        '../../mpd/mpd.gyp:indexed_media_info',
         '../../mpd/mpd.gyp:media_info_proto',
         # Depends on full protobuf to read/write with TextFormat.
         '../../third_party/protobuf/protobuf.gyp:protobuf_full_do_not_use',
@@ -65,6 +66,7 @@
       ],
       'dependencies': [
         '../../base/base.gyp:base',
+        '../../mpd/mpd.gyp:indexed_media_info',
         '../../mpd/mpd.gyp:media_info_proto',
         '../../mpd/mpd.gyp:mpd_mocks',
         '../../testing/gmock.gyp:gmock',
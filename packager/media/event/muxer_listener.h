@@ -29,6 +29,9 @@ class StreamInfo;
 /// A MuxerListener cannot be shared amongst muxer instances, in other words,
 /// every muxer instance either owns a unique MuxerListener instance.
 /// This also assumes that there is one media stream per muxer.
+/// The events are never delivered concurrently, but the events of segments
+/// written in the background, e.g. OnNewSegment(), are delivered on the thread
+/// which completed the write.
 class MuxerListener {
  public:
   enum ContainerType {
@@ -25,11 +25,12 @@ namespace {
 const char kMediaInfoSuffix[] = ".media_info";
 
 std::unique_ptr<MuxerListener> CreateMediaInfoDumpListenerInternal(
-    const std::string& output) {
+    const std::string& output,
+    bool indexed_media_info) {
   DCHECK(!output.empty());
 
-  std::unique_ptr<MuxerListener> listener(
-      new VodMediaInfoDumpMuxerListener(output + kMediaInfoSuffix));
+  std::unique_ptr<MuxerListener> listener(new VodMediaInfoDumpMuxerListener(
+      output + kMediaInfoSuffix, indexed_media_info));
   return listener;
 }
 
@@ -80,9 +81,11 @@ std::list<std::unique_ptr<MuxerListener>> CreateHlsListenersInternal(
 }  // namespace
 
 MuxerListenerFactory::MuxerListenerFactory(bool output_media_info,
+                                           bool indexed_media_info,
                                            MpdNotifier* mpd_notifier,
                                            hls::HlsNotifier* hls_notifier)
     : output_media_info_(output_media_info),
+      indexed_media_info_(indexed_media_info),
       mpd_notifier_(mpd_notifier),
       hls_notifier_(hls_notifier) {}
 
@@ -103,7 +106,8 @@ std::unique_ptr<MuxerListener> MuxerListenerFactory::CreateListener(
         new CombinedMuxerListener);
     if (output_media_info_) {
       combined_listener->AddListener(
-          CreateMediaInfoDumpListenerInternal(stream.media_info_output));
+          CreateMediaInfoDumpListenerInternal(stream.media_info_output,
+                                              indexed_media_info_));
     }
 
     if (mpd_notifier_ && !stream.hls_only) {
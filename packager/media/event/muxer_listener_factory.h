@@ -58,11 +58,14 @@ class MuxerListenerFactory {
   /// Create a new muxer listener.
   /// @param output_media_info must be true for the combined listener to include
   ///        a media info dump listener.
+  /// @param indexed_media_info writes the media info in indexed binary format
+  ///        instead of human readable format if true.
   /// @param mpd_notifer must be non-null for the combined listener to include a
   ///        mpd listener.
   /// @param hls_notifier must be non-null for the combined listener to include
   ///        an HLS listener.
   MuxerListenerFactory(bool output_media_info,
+                       bool indexed_media_info,
                        MpdNotifier* mpd_notifier,
                        hls::HlsNotifier* hls_notifier);
 
@@ -78,6 +81,7 @@ class MuxerListenerFactory {
   MuxerListenerFactory operator=(const MuxerListenerFactory&) = delete;
 
   bool output_media_info_;
+  bool indexed_media_info_;
   MpdNotifier* mpd_notifier_;
   hls::HlsNotifier* hls_notifier_;
 
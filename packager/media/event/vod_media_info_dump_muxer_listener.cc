@@ -16,6 +16,7 @@
 #include "packager/media/base/protection_system_specific_info.h"
 #include "packager/media/base/stream_info.h"
 #include "packager/media/event/muxer_listener_internal.h"
+#include "packager/mpd/base/indexed_media_info.h"
 #include "packager/mpd/base/media_info.pb.h"
 
 namespace shaka {
@@ -25,6 +26,12 @@ VodMediaInfoDumpMuxerListener::VodMediaInfoDumpMuxerListener(
     const std::string& output_file_path)
     : output_file_name_(output_file_path) {}
 
+VodMediaInfoDumpMuxerListener::VodMediaInfoDumpMuxerListener(
+    const std::string& output_file_path,
+    bool use_indexed_format)
+    : output_file_name_(output_file_path),
+      use_indexed_format_(use_indexed_format) {}
+
 VodMediaInfoDumpMuxerListener::~VodMediaInfoDumpMuxerListener() {}
 
 void VodMediaInfoDumpMuxerListener::OnEncryptionInfoReady(
@@ -84,7 +91,10 @@ void VodMediaInfoDumpMuxerListener::OnMediaEnd(const MediaRanges& media_ranges,
   }
   if (!media_info_->has_bandwidth())
     media_info_->set_bandwidth(max_bitrate_);
-  WriteMediaInfoToFile(*media_info_, output_file_name_);
+  if (use_indexed_format_)
+    WriteIndexedMediaInfoToFile(*media_info_, output_file_name_);
+  else
+    WriteMediaInfoToFile(*media_info_, output_file_name_);
 }
 
 void VodMediaInfoDumpMuxerListener::OnNewSegment(const std::string& file_name,
@@ -137,5 +147,19 @@ bool VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
   return true;
 }
 
+// static
+bool VodMediaInfoDumpMuxerListener::WriteIndexedMediaInfoToFile(
+    const MediaInfo& media_info,
+    const std::string& output_file_path) {
+  std::string output_string;
+  if (!SerializeIndexedMediaInfo(media_info, &output_string))
+    return false;
+  if (!File::WriteStringToFile(output_file_path.c_str(), output_string)) {
+    LOG(ERROR) << "Failed to write MediaInfo to " << output_file_path;
+    return false;
+  }
+  return true;
+}
+
 }  // namespace media
 }  // namespace shaka
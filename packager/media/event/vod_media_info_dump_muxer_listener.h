@@ -28,6 +28,11 @@ namespace media {
 class VodMediaInfoDumpMuxerListener : public MuxerListener {
  public:
   VodMediaInfoDumpMuxerListener(const std::string& output_file_name);
+  /// @param output_file_name is the MediaInfo output file.
+  /// @param use_indexed_format writes MediaInfo in indexed binary format
+  ///        instead of human readable format if true.
+  VodMediaInfoDumpMuxerListener(const std::string& output_file_name,
+                                bool use_indexed_format);
   ~VodMediaInfoDumpMuxerListener() override;
 
   /// @name MuxerListener implementation overrides.
@@ -63,8 +68,18 @@ class VodMediaInfoDumpMuxerListener : public MuxerListener {
   static bool WriteMediaInfoToFile(const MediaInfo& media_info,
                                    const std::string& output_file_path);
 
+  /// Write @a media_info to @a output_file_path in indexed binary format, see
+  /// mpd/base/indexed_media_info.h. It is faster to write and parse than the
+  /// human readable format, and allows reading selected fields only.
+  /// @param media_info is the MediaInfo to write out.
+  /// @param output_file_path is the path of the output file.
+  /// @return true on success, false otherwise.
+  static bool WriteIndexedMediaInfoToFile(const MediaInfo& media_info,
+                                          const std::string& output_file_path);
+
  private:
   std::string output_file_name_;
+  bool use_indexed_format_ = false;
   std::unique_ptr<MediaInfo> media_info_;
   uint64_t max_bitrate_ = 0;
 
@@ -19,6 +19,7 @@
 #include "packager/media/base/video_stream_info.h"
 #include "packager/media/event/muxer_listener_test_helper.h"
 #include "packager/media/event/vod_media_info_dump_muxer_listener.h"
+#include "packager/mpd/base/indexed_media_info.h"
 #include "packager/mpd/base/media_info.pb.h"
 
 namespace {
@@ -59,6 +60,22 @@ MATCHER_P(FileContentEqualsProto, expected_protobuf, "") {
       actual_media_info, expected_media_info);
 }
 
+MATCHER_P(IndexedFileContentEqualsProto, expected_protobuf, "") {
+  std::string temp_file_media_info_str;
+  CHECK(File::ReadFileToString(arg.c_str(), &temp_file_media_info_str));
+
+  MediaInfo expected_media_info;
+  MediaInfo actual_media_info;
+  CHECK(::google::protobuf::TextFormat::ParseFromString(expected_protobuf,
+                                                        &expected_media_info));
+  CHECK(ParseIndexedMediaInfo(temp_file_media_info_str, &actual_media_info));
+
+  *result_listener << actual_media_info.ShortDebugString();
+
+  return ::google::protobuf::util::MessageDifferencer::Equals(
+      actual_media_info, expected_media_info);
+}
+
 }  // namespace
 
 class VodMediaInfoDumpMuxerListenerTest : public ::testing::Test {
@@ -274,5 +291,43 @@ TEST_F(VodMediaInfoDumpMuxerListenerTest, CheckBandwidth) {
               FileContentEqualsProto(kExpectedProtobufOutput));
 }
 
+TEST_F(VodMediaInfoDumpMuxerListenerTest, IndexedFormat) {
+  const bool kUseIndexedFormat = true;
+  listener_.reset(new VodMediaInfoDumpMuxerListener(
+      temp_file_path_.AsUTF8Unsafe(), kUseIndexedFormat));
+
+  std::shared_ptr<StreamInfo> stream_info =
+      CreateVideoStreamInfo(GetDefaultVideoStreamInfoParams());
+
+  FireOnMediaStartWithDefaultMuxerOptions(*stream_info, !kEnableEncryption);
+  OnMediaEndParameters media_end_param = GetDefaultOnMediaEndParams();
+  FireOnMediaEndWithParams(media_end_param);
+
+  const char kExpectedProtobufOutput[] =
+      "bandwidth: 0\n"
+      "video_info {\n"
+      "  codec: 'avc1.010101'\n"
+      "  width: 720\n"
+      "  height: 480\n"
+      "  time_scale: 10\n"
+      "  pixel_width: 1\n"
+      "  pixel_height: 1\n"
+      "}\n"
+      "init_range {\n"
+      "  begin: 0\n"
+      "  end: 120\n"
+      "}\n"
+      "index_range {\n"
+      "  begin: 121\n"
+      "  end: 221\n"
+      "}\n"
+      "reference_time_scale: 1000\n"
+      "container_type: 1\n"
+      "media_file_name: 'test_output_file_name.mp4'\n"
+      "media_duration_seconds: 10.5\n";
+  EXPECT_THAT(temp_file_path_.AsUTF8Unsafe(),
+              IndexedFileContentEqualsProto(kExpectedProtobufOutput));
+}
+
 }  // namespace media
 }  // namespace shaka
@@ -28,8 +28,11 @@ Status TsMuxer::InitializeMuxer() {
 }
 
 Status TsMuxer::Finalize() {
+  Status status = segmenter_->Finalize();
+  if (!status.ok())
+    return status;
   FireOnMediaEndEvent();
-  return segmenter_->Finalize();
+  return Status::OK;
 }
 
 Status TsMuxer::AddSample(size_t stream_id, const MediaSample& sample) {
@@ -57,9 +60,11 @@ void TsMuxer::FireOnMediaEndEvent() {
   if (!muxer_listener())
     return;
 
-  // For now, there is no single file TS segmenter. So all the values passed
-  // here are left empty.
+  // TS has no initialization or index section. The subsegment ranges are only
+  // set for single file output, where the segments are byte ranges of the
+  // file.
   MuxerListener::MediaRanges range;
+  range.subsegment_ranges = segmenter_->GetSegmentRanges();
   muxer_listener()->OnMediaEnd(range, 0);
 }
 
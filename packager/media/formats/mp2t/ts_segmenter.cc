@@ -6,8 +6,11 @@
 
 #include "packager/media/formats/mp2t/ts_segmenter.h"
 
+#include <inttypes.h>
+
 #include <memory>
 
+#include "packager/base/strings/stringprintf.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/muxer_util.h"
 #include "packager/media/base/video_stream_info.h"
@@ -22,6 +25,8 @@ namespace mp2t {
 
 namespace {
 const double kTsTimescale = 90000;
+// Suffix of the sidecar index of single file output.
+const char kSegmentIndexSuffix[] = ".idx";
 
 bool IsAudioCodec(Codec codec) {
   return codec >= kCodecAudio && codec < kCodecAudioMaxPlusOne;
@@ -44,8 +49,13 @@ TsSegmenter::TsSegmenter(const MuxerOptions& options, MuxerListener* listener)
 TsSegmenter::~TsSegmenter() {}
 
 Status TsSegmenter::Initialize(const StreamInfo& stream_info) {
-  if (muxer_options_.segment_template.empty())
-    return Status(error::MUXER_FAILURE, "Segment template not specified.");
+  if (muxer_options_.segment_template.empty()) {
+    if (muxer_options_.output_file_name.empty()) {
+      return Status(error::MUXER_FAILURE,
+                    "Neither segment template nor output file specified.");
+    }
+    single_file_ = true;
+  }
   if (!pes_packet_generator_->Initialize(stream_info)) {
     return Status(error::MUXER_FAILURE,
                   "Failed to initialize PesPacketGenerator.");
@@ -68,7 +78,13 @@ Status TsSegmenter::Initialize(const StreamInfo& stream_info) {
 }
 
 Status TsSegmenter::Finalize() {
-  return Status::OK;
+  if (!single_file_ || !output_file_opened_)
+    return Status::OK;
+  // The last segment has been finalized, so close the file.
+  if (!ts_writer_->FinalizeSegment())
+    return Status(error::MUXER_FAILURE, "Failed to finalize TsWriter.");
+  output_file_opened_ = false;
+  return WriteSegmentIndex();
 }
 
 Status TsSegmenter::AddSample(const MediaSample& sample) {
@@ -128,6 +144,26 @@ void TsSegmenter::SetTsWriterFileOpenedForTesting(bool value) {
 Status TsSegmenter::OpenNewSegmentIfClosed(int64_t next_pts) {
   if (ts_writer_file_opened_)
     return Status::OK;
+  if (single_file_) {
+    if (!output_file_opened_) {
+      if (!ts_writer_->NewSegment(muxer_options_.output_file_name)) {
+        return Status(error::MUXER_FAILURE,
+                      "Failed to initialize TsPacketWriter.");
+      }
+      output_file_opened_ = true;
+      current_segment_start_ = 0;
+    } else {
+      base::Optional<uint64_t> position = ts_writer_->GetFilePosition();
+      if (!position)
+        return Status(error::MUXER_FAILURE, "Failed to get file position.");
+      current_segment_start_ = *position;
+      if (!ts_writer_->NewSegmentInCurrentFile())
+        return Status(error::MUXER_FAILURE, "Failed to start a new segment.");
+    }
+    current_segment_path_ = muxer_options_.output_file_name;
+    ts_writer_file_opened_ = true;
+    return Status::OK;
+  }
   const std::string segment_name =
       GetSegmentName(muxer_options_.segment_template, next_pts,
                      segment_number_++, muxer_options_.bandwidth);
@@ -159,7 +195,10 @@ Status TsSegmenter::WritePesPacketsToFile() {
         return Status(error::MUXER_FAILURE,
                       "Failed to get file position in WritePesPacketsToFile.");
       }
-      listener_->OnKeyFrame(timestamp, *start_pos, *end_pos - *start_pos);
+      // In single file mode, the key frame offset is relative to the start of
+      // the segment, as for the other single file muxers.
+      listener_->OnKeyFrame(timestamp, *start_pos - current_segment_start_,
+                            *end_pos - *start_pos);
     } else {
       if (!ts_writer_->AddPesPacket(std::move(pes_packet)))
         return Status(error::MUXER_FAILURE, "Failed to add PES packet.");
@@ -181,16 +220,28 @@ Status TsSegmenter::FinalizeSegment(uint64_t start_timestamp,
   // This method may be called from Finalize() so ts_writer_file_opened_ could
   // be false.
   if (ts_writer_file_opened_) {
-    if (!ts_writer_->FinalizeSegment()) {
-      return Status(error::MUXER_FAILURE, "Failed to finalize TsWriter.");
+    const int64_t segment_start_time =
+        start_timestamp * timescale_scale_ + transport_stream_timestamp_offset_;
+    const int64_t segment_duration = duration * timescale_scale_;
+    int64_t segment_size = 0;
+    if (single_file_) {
+      // The file stays open for the next segment.
+      base::Optional<uint64_t> end_pos = ts_writer_->GetFilePosition();
+      if (!end_pos || *end_pos <= current_segment_start_)
+        return Status(error::MUXER_FAILURE, "Failed to get file position.");
+      segment_size = *end_pos - current_segment_start_;
+      segment_ranges_.push_back({current_segment_start_, *end_pos - 1});
+      segment_times_.emplace_back(segment_start_time, segment_duration);
+    } else {
+      if (!ts_writer_->FinalizeSegment()) {
+        return Status(error::MUXER_FAILURE, "Failed to finalize TsWriter.");
+      }
+      if (listener_)
+        segment_size = File::GetFileSize(current_segment_path_.c_str());
     }
     if (listener_) {
-      const int64_t file_size =
-          File::GetFileSize(current_segment_path_.c_str());
-      listener_->OnNewSegment(current_segment_path_,
-                              start_timestamp * timescale_scale_ +
-                                  transport_stream_timestamp_offset_,
-                              duration * timescale_scale_, file_size);
+      listener_->OnNewSegment(current_segment_path_, segment_start_time,
+                              segment_duration, segment_size);
     }
     ts_writer_file_opened_ = false;
   }
@@ -198,6 +249,25 @@ Status TsSegmenter::FinalizeSegment(uint64_t start_timestamp,
   return Status::OK;
 }
 
+Status TsSegmenter::WriteSegmentIndex() {
+  DCHECK_EQ(segment_ranges_.size(), segment_times_.size());
+  std::string index;
+  for (size_t i = 0; i < segment_ranges_.size(); ++i) {
+    const Range& range = segment_ranges_[i];
+    base::StringAppendF(
+        &index, "%" PRId64 " %" PRId64 " %" PRIu64 " %" PRIu64 "\n",
+        segment_times_[i].first, segment_times_[i].second, range.start,
+        range.end + 1 - range.start);
+  }
+  const std::string index_path =
+      muxer_options_.output_file_name + kSegmentIndexSuffix;
+  if (!File::WriteStringToFile(index_path.c_str(), index)) {
+    LOG(ERROR) << "Failed to write segment index " << index_path;
+    return Status(error::FILE_FAILURE, "Failed to write segment index.");
+  }
+  return Status::OK;
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
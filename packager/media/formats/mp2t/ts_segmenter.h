@@ -8,8 +8,12 @@
 #define PACKAGER_MEDIA_FORMATS_MP2T_TS_SEGMENTER_H_
 
 #include <memory>
+#include <utility>
+#include <vector>
+
 #include "packager/file/file.h"
 #include "packager/media/base/muxer_options.h"
+#include "packager/media/base/range.h"
 #include "packager/media/formats/mp2t/pes_packet_generator.h"
 #include "packager/media/formats/mp2t/ts_writer.h"
 #include "packager/status.h"
@@ -22,9 +26,11 @@ class MuxerListener;
 
 namespace mp2t {
 
-// TODO(rkuroiwa): For now, this implements multifile segmenter. Like other
-// make this an abstract super class and implement multifile and single file
-// segmenters.
+/// Writes the segments to the files named by MuxerOptions::segment_template,
+/// or, if the segment template is not specified, to the single file
+/// MuxerOptions::output_file_name. In the latter case the segments are byte
+/// ranges of the file, each starting with PAT and PMT, and a sidecar index
+/// listing the segments is written next to the file on Finalize().
 class TsSegmenter {
  public:
   // TODO(rkuroiwa): Add progress listener?
@@ -40,7 +46,7 @@ class TsSegmenter {
   /// @return OK on success.
   Status Initialize(const StreamInfo& stream_info);
 
-  /// Finalize the segmenter.
+  /// Finalize the segmenter. This closes the output file in single file mode.
   /// @return OK on success.
   Status Finalize();
 
@@ -60,6 +66,10 @@ class TsSegmenter {
   // as the segment start timestamp and duration could be tracked locally.
   Status FinalizeSegment(uint64_t start_timestamp, uint64_t duration);
 
+  /// @return the byte ranges of the finalized segments in the output file in
+  ///         single file mode, or an empty vector otherwise.
+  const std::vector<Range>& GetSegmentRanges() const { return segment_ranges_; }
+
   /// Only for testing.
   void InjectTsWriterForTesting(std::unique_ptr<TsWriter> writer);
 
@@ -77,6 +87,11 @@ class TsSegmenter {
   // it will open one. This will not close the file.
   Status WritePesPacketsToFile();
 
+  // Writes the sidecar index of the single file output. Each line holds the
+  // start time and duration of a segment in TS time scale, followed by its
+  // byte offset and size in the file.
+  Status WriteSegmentIndex();
+
   const MuxerOptions& muxer_options_;
   MuxerListener* const listener_;
 
@@ -103,6 +118,18 @@ class TsSegmenter {
   // the segment has been finalized.
   std::string current_segment_path_;
 
+  // Set if the segments are byte ranges of |muxer_options_.output_file_name|.
+  bool single_file_ = false;
+  // Set once the single output file has been opened by TsWriter::NewSegment().
+  bool output_file_opened_ = false;
+  // Start offset of the current segment in the single output file.
+  uint64_t current_segment_start_ = 0;
+  // Byte ranges of the finalized segments in the single output file.
+  std::vector<Range> segment_ranges_;
+  // Start times and durations of the finalized segments in TS time scale, for
+  // the sidecar index.
+  std::vector<std::pair<int64_t, int64_t>> segment_times_;
+
   DISALLOW_COPY_AND_ASSIGN(TsSegmenter);
 };
 
@@ -82,6 +82,8 @@ class MockTsWriter : public TsWriter {
             new VideoProgramMapTableWriter(kUnknownCodec))) {}
 
   MOCK_METHOD1(NewSegment, bool(const std::string& file_name));
+  MOCK_METHOD0(NewSegmentInCurrentFile, bool());
+  MOCK_METHOD0(GetFilePosition, base::Optional<uint64_t>());
   MOCK_METHOD0(SignalEncrypted, void());
   MOCK_METHOD0(FinalizeSegment, bool());
 
@@ -413,6 +415,98 @@ TEST_F(TsSegmenterTest, EncryptedSample) {
   EXPECT_OK(segmenter.AddSample(*sample2));
 }
 
+// Verify that without segment template, the segments are written to the same
+// file, each starting with PSI, and are reported as byte ranges of the file.
+TEST_F(TsSegmenterTest, SingleFile) {
+  std::shared_ptr<VideoStreamInfo> stream_info(new VideoStreamInfo(
+      kTrackId, kTimeScale, kDuration, kH264Codec,
+      H26xStreamFormat::kAnnexbByteStream, kCodecString, kExtraData,
+      arraysize(kExtraData), kWidth, kHeight, kPixelWidth, kPixelHeight,
+      kTransferCharacteristics, kTrickPlayFactor, kNaluLengthSize, kLanguage,
+      kIsEncrypted));
+  const char kOutputFile[] = "memory://output.ts";
+  MuxerOptions options;
+  options.output_file_name = kOutputFile;
+
+  MockMuxerListener mock_listener;
+  TsSegmenter segmenter(options, &mock_listener);
+
+  std::shared_ptr<MediaSample> sample1 =
+      MediaSample::CopyFrom(kAnyData, arraysize(kAnyData), kIsKeyFrame);
+  sample1->set_duration(kTimeScale * 2);
+  std::shared_ptr<MediaSample> sample2 =
+      MediaSample::CopyFrom(kAnyData, arraysize(kAnyData), kIsKeyFrame);
+  sample2->set_duration(kTimeScale * 3);
+
+  ON_CALL(*mock_pes_packet_generator_, Initialize(_))
+      .WillByDefault(Return(true));
+  ON_CALL(*mock_pes_packet_generator_, Flush()).WillByDefault(Return(true));
+  ON_CALL(*mock_ts_writer_, AddPesPacketMock(_)).WillByDefault(Return(true));
+  EXPECT_CALL(*mock_pes_packet_generator_, PushSample(_))
+      .Times(2)
+      .WillRepeatedly(Return(true));
+  // One PES packet for each AddSample() and none left to flush in
+  // FinalizeSegment().
+  EXPECT_CALL(*mock_pes_packet_generator_, NumberOfReadyPesPackets())
+      .WillOnce(Return(1u))
+      .WillOnce(Return(0u))
+      .WillOnce(Return(0u))
+      .WillOnce(Return(1u))
+      .WillOnce(Return(0u))
+      .WillOnce(Return(0u));
+  // The pointers are released inside the segmenter.
+  EXPECT_CALL(*mock_pes_packet_generator_, GetNextPesPacketMock())
+      .WillOnce(Return(new PesPacket()))
+      .WillOnce(Return(new PesPacket()));
+
+  const uint64_t kFirstSegmentSize = 1000;
+  const uint64_t kSecondSegmentSize = 1500;
+  InSequence s;
+  EXPECT_CALL(*mock_ts_writer_, NewSegment(StrEq(kOutputFile)))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_ts_writer_, GetFilePosition())
+      .WillOnce(Return(base::make_optional(kFirstSegmentSize)));
+  EXPECT_CALL(mock_listener, OnNewSegment(kOutputFile, 0, kTimeScale * 2,
+                                          kFirstSegmentSize));
+  // The file is not closed between the segments.
+  EXPECT_CALL(*mock_ts_writer_, GetFilePosition())
+      .WillOnce(Return(base::make_optional(kFirstSegmentSize)));
+  EXPECT_CALL(*mock_ts_writer_, NewSegmentInCurrentFile())
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_ts_writer_, GetFilePosition())
+      .WillOnce(Return(
+          base::make_optional(kFirstSegmentSize + kSecondSegmentSize)));
+  EXPECT_CALL(mock_listener,
+              OnNewSegment(kOutputFile, kTimeScale * 2, kTimeScale * 3,
+                           kSecondSegmentSize));
+  EXPECT_CALL(*mock_ts_writer_, FinalizeSegment()).WillOnce(Return(true));
+
+  segmenter.InjectPesPacketGeneratorForTesting(
+      std::move(mock_pes_packet_generator_));
+  ASSERT_OK(segmenter.Initialize(*stream_info));
+  segmenter.InjectTsWriterForTesting(std::move(mock_ts_writer_));
+
+  ASSERT_OK(segmenter.AddSample(*sample1));
+  ASSERT_OK(segmenter.FinalizeSegment(0, sample1->duration()));
+  ASSERT_OK(segmenter.AddSample(*sample2));
+  ASSERT_OK(segmenter.FinalizeSegment(kTimeScale * 2, sample2->duration()));
+  ASSERT_OK(segmenter.Finalize());
+
+  const std::vector<Range>& ranges = segmenter.GetSegmentRanges();
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_EQ(0u, ranges[0].start);
+  EXPECT_EQ(kFirstSegmentSize - 1, ranges[0].end);
+  EXPECT_EQ(kFirstSegmentSize, ranges[1].start);
+  EXPECT_EQ(kFirstSegmentSize + kSecondSegmentSize - 1, ranges[1].end);
+
+  std::string index;
+  ASSERT_TRUE(File::ReadFileToString("memory://output.ts.idx", &index));
+  EXPECT_EQ(
+      "0 180000 0 1000\n"
+      "180000 270000 1000 1500\n",
+      index);
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
@@ -6,6 +6,8 @@
 
 #include "packager/media/formats/mp2t/ts_writer.h"
 
+#include <string.h>
+
 #include <algorithm>
 
 #include "packager/base/logging.h"
@@ -47,13 +49,27 @@ const uint8_t kPat[] = {
 const bool kHasPcr = true;
 const bool kPayloadUnitStartIndicator = true;
 
+const uint8_t kSyncByte = 0x47;
 // This is the size of the first few fields in a TS packet, i.e. TS packet size
 // without adaptation field or the payload.
-const int kTsPacketHeaderSize = 4;
-const int kTsPacketSize = 188;
-const int kTsPacketMaximumPayloadSize =
+const size_t kTsPacketHeaderSize = 4;
+const size_t kTsPacketSize = 188;
+const size_t kTsPacketMaximumPayloadSize =
     kTsPacketSize - kTsPacketHeaderSize;
 
+// The size of the length field.
+const size_t kAdaptationFieldLengthSize = 1;
+// The size of the flags field.
+const size_t kAdaptationFieldHeaderSize = 1;
+const size_t kPcrFieldSize = 6;
+const size_t kTsPacketMaxPayloadWithPcr =
+    kTsPacketMaximumPayloadSize - kAdaptationFieldLengthSize -
+    kAdaptationFieldHeaderSize - kPcrFieldSize;
+
+// Sizes of the PES packet header fields.
+const size_t kPesStartCodeAndStreamIdSize = 4;
+const size_t kPesPacketLengthSize = 2;
+const uint8_t kPtsOrDtsSize = 5;
 const size_t kMaxPesPacketLengthValue = 0xFFFF;
 
 void WritePatToBuffer(const uint8_t* pat,
@@ -66,94 +82,170 @@ void WritePatToBuffer(const uint8_t* pat,
 }
 
 // The only difference between writing PTS or DTS is the leading bits.
-void WritePtsOrDts(uint8_t leading_bits,
-                   uint64_t pts_or_dts,
-                   BufferWriter* writer) {
+uint8_t* WritePtsOrDts(uint8_t leading_bits,
+                       uint64_t pts_or_dts,
+                       uint8_t* out) {
   // First byte has 3 MSB of PTS.
-  uint8_t first_byte =
-      leading_bits << 4 | (((pts_or_dts >> 30) & 0x07) << 1) | 1;
+  out[0] = leading_bits << 4 | (((pts_or_dts >> 30) & 0x07) << 1) | 1;
   // Second byte has the next 8 bits of pts.
-  uint8_t second_byte = (pts_or_dts >> 22) & 0xFF;
+  out[1] = (pts_or_dts >> 22) & 0xFF;
   // Third byte has the next 7 bits of pts followed by a marker bit.
-  uint8_t third_byte = (((pts_or_dts >> 15) & 0x7F) << 1) | 1;
+  out[2] = (((pts_or_dts >> 15) & 0x7F) << 1) | 1;
   // Fourth byte has the next 8 bits of pts.
-  uint8_t fourth_byte = ((pts_or_dts >> 7) & 0xFF);
+  out[3] = (pts_or_dts >> 7) & 0xFF;
   // Fifth byte has the last 7 bits of pts followed by a marker bit.
-  uint8_t fifth_byte = ((pts_or_dts & 0x7F) << 1) | 1;
-  writer->AppendInt(first_byte);
-  writer->AppendInt(second_byte);
-  writer->AppendInt(third_byte);
-  writer->AppendInt(fourth_byte);
-  writer->AppendInt(fifth_byte);
+  out[4] = ((pts_or_dts & 0x7F) << 1) | 1;
+  return out + kPtsOrDtsSize;
+}
+
+// Writes the TS packet header of a packet carrying payload.
+uint8_t* WriteTsPacketHeader(bool payload_unit_start_indicator,
+                             int pid,
+                             bool has_adaptation_field,
+                             ContinuityCounter* continuity_counter,
+                             uint8_t* out) {
+  out[0] = kSyncByte;
+  // transport_error_indicator and transport_priority are both '0'.
+  out[1] = static_cast<uint8_t>(payload_unit_start_indicator) << 6 |
+           ((pid >> 8) & 0x1F);
+  out[2] = pid & 0xFF;
+  // transport_scrambling_control is '00'. adaptation_field_control is '11'
+  // with adaptation field and '01' otherwise, i.e. there is always payload.
+  out[3] = (has_adaptation_field ? 0x30 : 0x10) | continuity_counter->GetNext();
+  return out + kTsPacketHeaderSize;
 }
 
-bool WritePesToFile(const PesPacket& pes,
-                    ContinuityCounter* continuity_counter,
-                    File* file) {
-  // The size of the length field.
-  const int kAdaptationFieldLengthSize = 1;
-  // The size of the flags field.
-  const int kAdaptationFieldHeaderSize = 1;
-  const int kPcrFieldSize = 6;
-  const int kTsPacketMaxPayloadWithPcr =
-      kTsPacketMaximumPayloadSize - kAdaptationFieldLengthSize -
-      kAdaptationFieldHeaderSize - kPcrFieldSize;
+// Writes the adaptation field with |stuffing_size| stuffing bytes, and the PCR
+// if |has_pcr|.
+uint8_t* WriteAdaptationField(bool has_pcr,
+                              uint64_t pcr_base,
+                              size_t stuffing_size,
+                              uint8_t* out) {
+  // Special case where a TS packet requires 1 byte padding.
+  if (!has_pcr && stuffing_size == 1) {
+    out[0] = 0;
+    return out + 1;
+  }
+
+  DCHECK(has_pcr || stuffing_size >= 2);
+  const size_t adaptation_field_length =
+      has_pcr ? kAdaptationFieldHeaderSize + kPcrFieldSize + stuffing_size
+              : stuffing_size - kAdaptationFieldLengthSize;
+  out[0] = static_cast<uint8_t>(adaptation_field_length);
+  // All flags except PCR_flag are 0.
+  out[1] = static_cast<uint8_t>(has_pcr) << 4;
+  out += kAdaptationFieldLengthSize + kAdaptationFieldHeaderSize;
+
+  if (has_pcr) {
+    // program_clock_reference_extension = 0.
+    const uint32_t most_significant_32bits_pcr =
+        static_cast<uint32_t>(pcr_base >> 1);
+    out[0] = most_significant_32bits_pcr >> 24;
+    out[1] = (most_significant_32bits_pcr >> 16) & 0xFF;
+    out[2] = (most_significant_32bits_pcr >> 8) & 0xFF;
+    out[3] = most_significant_32bits_pcr & 0xFF;
+    out[4] = static_cast<uint8_t>((pcr_base & 1) << 7);
+    out[5] = 0;
+    out += kPcrFieldSize;
+  }
+
+  const size_t padding_size =
+      adaptation_field_length - kAdaptationFieldHeaderSize -
+      (has_pcr ? kPcrFieldSize : 0);
+  memset(out, 0xFF, padding_size);
+  return out + padding_size;
+}
+
+// Packetizes |pes| into |buffer|, which is grown if needed but never shrunk so
+// it can be reused across PES packets. All the TS packets are written in a
+// single pass.
+// Returns the number of bytes written to |buffer|.
+size_t WritePesToBuffer(const PesPacket& pes,
+                        ContinuityCounter* continuity_counter,
+                        std::vector<uint8_t>* buffer) {
   const uint64_t pcr_base = pes.has_dts() ? pes.dts() : pes.pts();
   const int pid = ProgramMapTableWriter::kElementaryPid;
 
-  // This writer will hold part of PES packet after PES_packet_length field.
-  BufferWriter pes_header_writer;
+  // The part of PES packet header after PES_packet_length field.
+  const uint8_t pes_header_data_length =
+      (pes.has_pts() ? kPtsOrDtsSize : 0) + (pes.has_dts() ? kPtsOrDtsSize : 0);
+  const size_t pts_dts_size = pes.has_pts() ? pes_header_data_length : 0;
+  const size_t pes_header_size =
+      kPesStartCodeAndStreamIdSize + kPesPacketLengthSize + 3 + pts_dts_size;
+
+  // The first TS packet carries the PCR and the PES packet header.
+  const size_t data_size = pes.data().size();
+  const size_t first_packet_data_size =
+      std::min(data_size, kTsPacketMaxPayloadWithPcr - pes_header_size);
+  const size_t remaining_data_size = data_size - first_packet_data_size;
+  const size_t num_packets =
+      1 + (remaining_data_size + kTsPacketMaximumPayloadSize - 1) /
+              kTsPacketMaximumPayloadSize;
+  const size_t output_size = num_packets * kTsPacketSize;
+  if (buffer->size() < output_size)
+    buffer->resize(output_size);
+  uint8_t* out = buffer->data();
+
+  out = WriteTsPacketHeader(kPayloadUnitStartIndicator, pid,
+                            true /* has_adaptation_field */,
+                            continuity_counter, out);
+  out = WriteAdaptationField(
+      kHasPcr, pcr_base,
+      kTsPacketMaxPayloadWithPcr - pes_header_size - first_packet_data_size,
+      out);
+
+  // PES packet header.
+  out[0] = 0x00;
+  out[1] = 0x00;
+  out[2] = 0x01;
+  out[3] = pes.stream_id();
+  const size_t pes_packet_length =
+      data_size + pes_header_size - kPesStartCodeAndStreamIdSize -
+      kPesPacketLengthSize;
+  const uint16_t pes_packet_length_value = static_cast<uint16_t>(
+      pes_packet_length > kMaxPesPacketLengthValue ? 0 : pes_packet_length);
+  out[4] = pes_packet_length_value >> 8;
+  out[5] = pes_packet_length_value & 0xFF;
   // The first bit must be '10' for PES with video or audio stream id. The other
   // flags (bits) don't matter so they are 0.
-  pes_header_writer.AppendInt(static_cast<uint8_t>(0x80));
-  pes_header_writer.AppendInt(
-      static_cast<uint8_t>(static_cast<int>(pes.has_pts()) << 7 |
-                           static_cast<int>(pes.has_dts()) << 6
-                           // Other fields are all 0.
-                           ));
-  uint8_t pes_header_data_length = 0;
-  if (pes.has_pts())
-    pes_header_data_length += 5;
-  if (pes.has_dts())
-    pes_header_data_length += 5;
-  pes_header_writer.AppendInt(pes_header_data_length);
-
+  out[6] = 0x80;
+  out[7] = static_cast<uint8_t>(pes.has_pts()) << 7 |
+           static_cast<uint8_t>(pes.has_dts()) << 6;
+  // Other fields are all 0.
+  out[8] = pes_header_data_length;
+  out += 9;
   if (pes.has_pts() && pes.has_dts()) {
-    WritePtsOrDts(0x03, pes.pts(), &pes_header_writer);
-    WritePtsOrDts(0x01, pes.dts(), &pes_header_writer);
+    out = WritePtsOrDts(0x03, pes.pts(), out);
+    out = WritePtsOrDts(0x01, pes.dts(), out);
   } else if (pes.has_pts()) {
-    WritePtsOrDts(0x02, pes.pts(), &pes_header_writer);
+    out = WritePtsOrDts(0x02, pes.pts(), out);
   }
 
-  // Put the first TS packet's payload into a buffer. This contains the PES
-  // packet's header.
-  BufferWriter first_ts_packet_buffer(kTsPacketSize);
-  first_ts_packet_buffer.AppendNBytes(static_cast<uint64_t>(0x000001), 3);
-  first_ts_packet_buffer.AppendInt(pes.stream_id());
-  const size_t pes_packet_length = pes.data().size() + pes_header_writer.Size();
-  first_ts_packet_buffer.AppendInt(static_cast<uint16_t>(
-      pes_packet_length > kMaxPesPacketLengthValue ? 0 : pes_packet_length));
-  first_ts_packet_buffer.AppendBuffer(pes_header_writer);
-
-  const size_t available_payload =
-      kTsPacketMaxPayloadWithPcr - first_ts_packet_buffer.Size();
-  const size_t bytes_consumed = std::min(pes.data().size(), available_payload);
-  first_ts_packet_buffer.AppendArray(pes.data().data(), bytes_consumed);
-
-  BufferWriter output_writer;
-  WritePayloadToBufferWriter(first_ts_packet_buffer.Buffer(),
-                             first_ts_packet_buffer.Size(),
-                             kPayloadUnitStartIndicator, pid, kHasPcr, pcr_base,
-                             continuity_counter, &output_writer);
-
-  const size_t remaining_pes_data_size = pes.data().size() - bytes_consumed;
-  if (remaining_pes_data_size > 0) {
-    WritePayloadToBufferWriter(pes.data().data() + bytes_consumed,
-                               remaining_pes_data_size,
-                               !kPayloadUnitStartIndicator, pid, !kHasPcr, 0,
-                               continuity_counter, &output_writer);
+  const uint8_t* data = pes.data().data();
+  memcpy(out, data, first_packet_data_size);
+  out += first_packet_data_size;
+  data += first_packet_data_size;
+
+  // The rest of the PES packet data. Only the last TS packet needs stuffing.
+  size_t bytes_left = remaining_data_size;
+  while (bytes_left > 0) {
+    const size_t payload_size = std::min(bytes_left, kTsPacketMaximumPayloadSize);
+    const bool needs_stuffing = payload_size < kTsPacketMaximumPayloadSize;
+    out = WriteTsPacketHeader(!kPayloadUnitStartIndicator, pid,
+                              needs_stuffing, continuity_counter, out);
+    if (needs_stuffing) {
+      out = WriteAdaptationField(!kHasPcr, 0,
+                                 kTsPacketMaximumPayloadSize - payload_size,
+                                 out);
+    }
+    memcpy(out, data, payload_size);
+    out += payload_size;
+    data += payload_size;
+    bytes_left -= payload_size;
   }
-  return output_writer.WriteToFile(file).ok();
+
+  DCHECK_EQ(output_size, static_cast<size_t>(out - buffer->data()));
+  return output_size;
 }
 
 }  // namespace
@@ -173,7 +265,18 @@ bool TsWriter::NewSegment(const std::string& file_name) {
     LOG(ERROR) << "Failed to open file " << file_name;
     return false;
   }
+  return WritePsi();
+}
+
+bool TsWriter::NewSegmentInCurrentFile() {
+  if (!current_file_) {
+    LOG(ERROR) << "No file is open for the new segment.";
+    return false;
+  }
+  return WritePsi();
+}
 
+bool TsWriter::WritePsi() {
   BufferWriter psi;
   WritePatToBuffer(kPat, arraysize(kPat), &pat_continuity_counter_, &psi);
   if (encrypted_) {
@@ -204,10 +307,21 @@ bool TsWriter::FinalizeSegment() {
 
 bool TsWriter::AddPesPacket(std::unique_ptr<PesPacket> pes_packet) {
   DCHECK(current_file_);
-  if (!WritePesToFile(*pes_packet, &elementary_stream_continuity_counter_,
-                      current_file_.get())) {
-    LOG(ERROR) << "Failed to write pes to file.";
-    return false;
+  const size_t size = WritePesToBuffer(
+      *pes_packet, &elementary_stream_continuity_counter_, &pes_buffer_);
+  // The file may accept fewer bytes than requested, e.g. when writing to a
+  // pipe, so keep writing the remainder. A write that makes no progress is
+  // treated as a failure to avoid looping forever.
+  const uint8_t* data = pes_buffer_.data();
+  size_t remaining_size = size;
+  while (remaining_size > 0) {
+    const int64_t size_written = current_file_->Write(data, remaining_size);
+    if (size_written <= 0) {
+      LOG(ERROR) << "Failed to write pes to file.";
+      return false;
+    }
+    remaining_size -= size_written;
+    data += size_written;
   }
 
   // No need to keep pes_packet around so not passing it anywhere.
@@ -37,6 +37,12 @@ class TsWriter {
   /// @return true on success, false otherwise.
   virtual bool NewSegment(const std::string& file_name);
 
+  /// Start a new segment in the file opened by NewSegment(), i.e. write the
+  /// PSI without opening a new file. Used for single file output, where the
+  /// segments are byte ranges of one file.
+  /// @return true on success, false otherwise.
+  virtual bool NewSegmentInCurrentFile();
+
   /// Signals the writer that the rest of the segments are encrypted.
   virtual void SignalEncrypted();
 
@@ -52,12 +58,15 @@ class TsWriter {
   virtual bool AddPesPacket(std::unique_ptr<PesPacket> pes_packet);
 
   /// @return current file position on success, nullopt otherwise.
-  base::Optional<uint64_t> GetFilePosition();
+  virtual base::Optional<uint64_t> GetFilePosition();
 
  private:
   TsWriter(const TsWriter&) = delete;
   TsWriter& operator=(const TsWriter&) = delete;
 
+  // Writes PAT and PMT to the current file.
+  bool WritePsi();
+
   // True if further segments generated by this instance should be encrypted.
   bool encrypted_ = false;
 
@@ -67,6 +76,8 @@ class TsWriter {
   std::unique_ptr<ProgramMapTableWriter> pmt_writer_;
 
   std::unique_ptr<File, FileCloser> current_file_;
+  // TS packets of the current PES packet. Reused across PES packets.
+  std::vector<uint8_t> pes_buffer_;
 };
 
 }  // namespace mp2t
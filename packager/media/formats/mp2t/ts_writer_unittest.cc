@@ -9,6 +9,8 @@
 
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
+#include "packager/base/logging.h"
+#include "packager/base/time/time.h"
 #include "packager/media/base/audio_stream_info.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/video_stream_info.h"
@@ -520,6 +522,93 @@ TEST_F(TsWriterTest, TsPacketPayload183Bytes) {
       actual_prefix);
 }
 
+// The TS packets of a PES packet are written to a buffer reused across PES
+// packets. Verify that a smaller PES packet after a bigger one is not affected
+// by the leftover data.
+TEST_F(TsWriterTest, SmallPesPacketAfterBigPesPacket) {
+  TsWriter ts_writer(std::unique_ptr<ProgramMapTableWriter>(
+      new VideoProgramMapTableWriter(kCodecForTesting)));
+  EXPECT_TRUE(ts_writer.NewSegment(test_file_name_));
+
+  std::unique_ptr<PesPacket> big_pes(new PesPacket());
+  big_pes->set_pts(0);
+  big_pes->set_dts(0);
+  *big_pes->mutable_data() = std::vector<uint8_t>(400, 0x23);
+  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(big_pes)));
+
+  std::unique_ptr<PesPacket> small_pes(new PesPacket());
+  small_pes->set_stream_id(0xE0);
+  small_pes->set_pts(0x0);
+  const uint8_t kAnyData[] = {
+      0x12, 0x88, 0x4F, 0x4A,
+  };
+  small_pes->mutable_data()->assign(kAnyData, kAnyData + arraysize(kAnyData));
+  EXPECT_TRUE(ts_writer.AddPesPacket(std::move(small_pes)));
+  ASSERT_TRUE(ts_writer.FinalizeSegment());
+
+  std::vector<uint8_t> content;
+  ASSERT_TRUE(ReadFileToVector(test_file_path_, &content));
+  // PAT, PMT, 3 TS packets for the big PES packet and 1 for the small one.
+  ASSERT_EQ(6u * 188, content.size());
+
+  const int kPesStartPosition = 5 * 188;
+  const uint8_t kExpectedOutputPrefix[] = {
+      0x47,  // Sync byte.
+      0x40,  // payload_unit_start_indicator set.
+      0x50,  // pid.
+      0x33,  // Adaptation field and payload are both present. counter = 3.
+      0xA5,  // Adaptation Field length.
+      0x10,  // pcr flag.
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // PCR.
+  };
+  const uint8_t kExpectedPayload[] = {
+      0x00, 0x00, 0x01,  // Start code.
+      0xE0,              // stream id.
+      0x00, 0x0C,        // PES_packet_length.
+      0x80,              // Flags.
+      0x80,              // Only PTS present.
+      0x05,              // PES_header_data_length.
+      0x21, 0x00, 0x01, 0x00, 0x01,  // PTS 0.
+      0x12, 0x88, 0x4F, 0x4A,        // Payload.
+  };
+  EXPECT_NO_FATAL_FAILURE(ExpectTsPacketEqual(
+      kExpectedOutputPrefix, arraysize(kExpectedOutputPrefix), 158,
+      kExpectedPayload, arraysize(kExpectedPayload),
+      content.data() + kPesStartPosition));
+}
+
+// Measures the throughput of packetizing video PES packets. Run with
+// --gtest_also_run_disabled_tests.
+TEST_F(TsWriterTest, DISABLED_VideoPesPacketizationBenchmark) {
+  TsWriter ts_writer(std::unique_ptr<ProgramMapTableWriter>(
+      new VideoProgramMapTableWriter(kCodecForTesting)));
+  // Packetization only, without the cost of the file system.
+  const char kOutputFileName[] = "memory://ts_writer_benchmark.ts";
+  ASSERT_TRUE(ts_writer.NewSegment(kOutputFileName));
+
+  // A mix of frame sizes of a 6 Mbps 30 fps stream.
+  const size_t kFrameSizes[] = {150000, 20000, 12000, 12000, 20000, 12000};
+  const int kNumFrames = 3000;
+  uint64_t total_size = 0;
+  const base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumFrames; ++i) {
+    std::unique_ptr<PesPacket> pes(new PesPacket());
+    pes->set_stream_id(0xE0);
+    pes->set_pts(i * 3000 + 3000);
+    pes->set_dts(i * 3000);
+    pes->mutable_data()->resize(kFrameSizes[i % arraysize(kFrameSizes)], 0x23);
+    total_size += pes->data().size();
+    ASSERT_TRUE(ts_writer.AddPesPacket(std::move(pes)));
+  }
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  ASSERT_TRUE(ts_writer.FinalizeSegment());
+  File::Delete(kOutputFileName);
+
+  LOG(INFO) << "Packetized " << total_size << " bytes in "
+            << elapsed.InMilliseconds() << " ms ("
+            << total_size * 8 / elapsed.InSecondsF() / 1e9 << " Gbps).";
+}
+
 }  // namespace mp2t
 }  // namespace media
 }  // namespace shaka
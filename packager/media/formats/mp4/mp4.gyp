@@ -62,6 +62,8 @@
         'composition_offset_iterator_unittest.cc',
         'decoding_time_iterator_unittest.cc',
         'mp4_media_parser_unittest.cc',
+        'multi_segment_segmenter_unittest.cc',
+        'single_segment_segmenter_unittest.cc',
         'sync_sample_iterator_unittest.cc',
         'track_run_iterator_unittest.cc',
       ],
@@ -187,7 +187,7 @@ void MP4MediaParser::Init(const InitCB& init_cb,
   init_cb_ = init_cb;
   new_sample_cb_ = new_sample_cb;
   decryption_key_source_ = decryption_key_source;
-  if (decryption_key_source)
+  if (decryption_key_source && !defer_decryption_)
     decryptor_source_.reset(new DecryptorSource(decryption_key_source));
 }
 
@@ -819,8 +819,6 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
       MediaSample::CopyFrom(media_data, kDummyDataSize, runs_->is_keyframe()));
 
   if (runs_->is_encrypted()) {
-    std::shared_ptr<uint8_t> decrypted_media_data(
-        new uint8_t[media_data_size], std::default_delete<uint8_t[]>());
     std::unique_ptr<DecryptConfig> decrypt_config = runs_->GetDecryptConfig();
     if (!decrypt_config) {
       *err = true;
@@ -835,6 +833,8 @@ bool MP4MediaParser::EnqueueSample(bool* err) {
       stream_sample->set_decrypt_config(std::move(decrypt_config));
       stream_sample->set_is_encrypted(true);
     } else {
+      std::shared_ptr<uint8_t> decrypted_media_data(
+          new uint8_t[media_data_size], std::default_delete<uint8_t[]>());
       if (!decryptor_source_->DecryptSampleBuffer(decrypt_config.get(),
                                                   media_data, media_data_size,
                                                   decrypted_media_data.get())) {
@@ -49,6 +49,14 @@ class MP4MediaParser : public MediaParser {
   /// @return true if successful, false otherwise.
   bool LoadMoov(const std::string& file_path);
 
+  /// Dispatch the encrypted samples without decrypting them, together with
+  /// their DecryptConfig, e.g. to decrypt them in the same pass as their
+  /// re-encryption. The keys are still fetched from the 'pssh' boxes with the
+  /// KeySource passed to Init(). Must be called before Init().
+  void set_defer_decryption(bool defer_decryption) {
+    defer_decryption_ = defer_decryption;
+  }
+
  private:
   enum State {
     kWaitingForInit,
@@ -85,6 +93,7 @@ class MP4MediaParser : public MediaParser {
   NewSampleCB new_sample_cb_;
   KeySource* decryption_key_source_;
   std::unique_ptr<DecryptorSource> decryptor_source_;
+  bool defer_decryption_ = false;
 
   OffsetByteQueue queue_;
 
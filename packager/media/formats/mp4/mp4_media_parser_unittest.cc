@@ -53,6 +53,7 @@ class MP4MediaParserTest : public testing::Test {
   std::unique_ptr<MP4MediaParser> parser_;
   size_t num_streams_;
   size_t num_samples_;
+  size_t num_encrypted_samples_ = 0;
 
   bool AppendData(const uint8_t* data, size_t length) {
     return parser_->Parse(data, static_cast<int>(length));
@@ -87,6 +88,8 @@ class MP4MediaParserTest : public testing::Test {
     DVLOG(2) << "Track Id: " << track_id << " "
              << sample->ToString();
     ++num_samples_;
+    if (sample->is_encrypted())
+      ++num_encrypted_samples_;
     return true;
   }
 
@@ -294,6 +297,25 @@ TEST_F(MP4MediaParserTest, CencWithDecryptionSourceAndSenc) {
   EXPECT_EQ(82u, num_samples_);
 }
 
+TEST_F(MP4MediaParserTest, CencWithDeferredDecryption) {
+  MockKeySource mock_key_source;
+  // The keys are fetched for the downstream decryption.
+  EXPECT_CALL(mock_key_source, FetchKeys(_, _)).WillOnce(Return(Status::OK));
+  EXPECT_CALL(mock_key_source, GetKey(_, _)).Times(0);
+
+  parser_->set_defer_decryption(true);
+  InitializeParser(&mock_key_source);
+
+  std::vector<uint8_t> buffer =
+      ReadTestDataFile("bear-640x360-v_frag-cenc-senc.mp4");
+  EXPECT_TRUE(AppendDataInPieces(buffer.data(), buffer.size(), 512));
+  EXPECT_EQ(1u, num_streams_);
+  const int kVideoTrackId = 1;
+  EXPECT_TRUE(stream_map_[kVideoTrackId]->is_encrypted());
+  EXPECT_EQ(82u, num_samples_);
+  EXPECT_EQ(num_samples_, num_encrypted_samples_);
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
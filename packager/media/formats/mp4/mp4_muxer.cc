@@ -197,6 +197,10 @@ Status MP4Muxer::FinalizeSegment(size_t stream_id,
   return segmenter_->FinalizeSegment(stream_id, segment_info);
 }
 
+Status MP4Muxer::WaitForPendingSegments() {
+  return segmenter_ ? segmenter_->WaitForPendingSegments() : Status::OK;
+}
+
 Status MP4Muxer::DelayInitializeMuxer() {
   DCHECK(!streams().empty());
 
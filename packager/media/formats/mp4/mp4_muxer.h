@@ -42,6 +42,7 @@ class MP4Muxer : public Muxer {
   Status AddSample(size_t stream_id, const MediaSample& sample) override;
   Status FinalizeSegment(size_t stream_id,
                          const SegmentInfo& segment_info) override;
+  Status WaitForPendingSegments() override;
 
   Status DelayInitializeMuxer();
   Status UpdateEditListOffsetFromSample(const MediaSample& sample);
@@ -10,8 +10,6 @@
 
 #include "packager/base/strings/string_number_conversions.h"
 #include "packager/base/strings/string_util.h"
-#include "packager/file/file.h"
-#include "packager/file/file_closer.h"
 #include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/muxer_util.h"
@@ -29,7 +27,8 @@ MultiSegmentSegmenter::MultiSegmentSegmenter(const MuxerOptions& options,
                                              std::unique_ptr<Movie> moov)
     : Segmenter(options, std::move(ftyp), std::move(moov)),
       styp_(new SegmentType),
-      num_segments_(0) {
+      num_segments_(0),
+      segment_writer_(new SegmentWriter(options.segment_writer_params)) {
   // Use the same brands for styp as ftyp.
   styp_->major_brand = Segmenter::ftyp()->major_brand;
   styp_->compatible_brands = Segmenter::ftyp()->compatible_brands;
@@ -56,11 +55,16 @@ std::vector<Range> MultiSegmentSegmenter::GetSegmentRanges() {
   return std::vector<Range>();
 }
 
+Status MultiSegmentSegmenter::WaitForPendingSegments() {
+  return segment_writer_->Flush();
+}
+
 Status MultiSegmentSegmenter::DoInitialize() {
   return WriteInitSegment();
 }
 
 Status MultiSegmentSegmenter::DoFinalize() {
+  RETURN_IF_ERROR(segment_writer_->Flush());
   // Update init segment with media duration set.
   RETURN_IF_ERROR(WriteInitSegment());
   SetComplete();
@@ -71,6 +75,21 @@ Status MultiSegmentSegmenter::DoFinalizeSegment() {
   return WriteSegment();
 }
 
+Status MultiSegmentSegmenter::DoFinalizeChunk() {
+  if (!options().mp4_params.low_latency_dash_mode)
+    return Status::OK;
+
+  if (!segment_file_)
+    RETURN_IF_ERROR(OpenSegmentFile());
+  RETURN_IF_ERROR(WriteFragmentBuffer());
+  // Flush the chunk so it is available to readers of the segment immediately.
+  if (!segment_file_->Flush()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot flush file " + segment_file_name_);
+  }
+  return Status::OK;
+}
+
 Status MultiSegmentSegmenter::WriteInitSegment() {
   DCHECK(ftyp());
   DCHECK(moov());
@@ -88,8 +107,95 @@ Status MultiSegmentSegmenter::WriteInitSegment() {
 }
 
 Status MultiSegmentSegmenter::WriteSegment() {
-  DCHECK(sidx());
+  // In low latency mode, the segment is already partially written to its file.
+  if (!options().segment_template.empty() &&
+      !options().mp4_params.low_latency_dash_mode) {
+    return SubmitSegment();
+  }
+
+  if (!segment_file_)
+    RETURN_IF_ERROR(OpenSegmentFile());
+  RETURN_IF_ERROR(WriteFragmentBuffer());
+
+  const uint64_t segment_size = segment_size_;
+  DCHECK_NE(segment_size, 0u);
+  segment_size_ = 0;
+  num_key_frames_notified_ = 0;
+
+  // Close the file, which also does flushing, to make sure the file is written
+  // before manifest is updated.
+  if (!segment_file_.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + segment_file_name_ +
+            ", possibly file permission issue or running out of disk space.");
+  }
+
+  uint64_t segment_duration = 0;
+  // ISO/IEC 23009-1:2012: the value shall be identical to sum of the the
+  // values of all Subsegment_duration fields in the first ‘sidx’ box.
+  for (size_t i = 0; i < sidx()->references.size(); ++i)
+    segment_duration += sidx()->references[i].subsegment_duration;
+
+  UpdateProgress(segment_duration);
+  if (muxer_listener()) {
+    muxer_listener()->OnSampleDurationReady(sample_duration());
+    muxer_listener()->OnNewSegment(segment_file_name_,
+                                   sidx()->earliest_presentation_time,
+                                   segment_duration, segment_size);
+  }
+
+  return Status::OK;
+}
+
+Status MultiSegmentSegmenter::SubmitSegment() {
   DCHECK(fragment_buffer());
+
+  BufferWriter header;
+  WriteSegmentHeader(&header);
+  const uint64_t header_size = header.Size();
+
+  const std::string segment_name = GetSegmentName(
+      options().segment_template, sidx()->earliest_presentation_time,
+      num_segments_++, options().bandwidth);
+  const uint64_t earliest_presentation_time =
+      sidx()->earliest_presentation_time;
+  const uint64_t segment_size = header_size + fragment_buffer()->Size();
+  uint64_t segment_duration = 0;
+  for (size_t i = 0; i < sidx()->references.size(); ++i)
+    segment_duration += sidx()->references[i].subsegment_duration;
+
+  UpdateProgress(segment_duration);
+
+  SegmentWriter::Callback callback;
+  MuxerListener* listener = muxer_listener();
+  if (listener) {
+    // Key frame offsets are relative to the start of the fragments.
+    std::vector<KeyFrameInfo> key_frames = key_frame_infos();
+    for (KeyFrameInfo& key_frame_info : key_frames)
+      key_frame_info.start_byte_offset += header_size;
+    const uint32_t duration = sample_duration();
+    // The segment is notified once it is fully written, so it is never listed
+    // in a manifest before it is available.
+    callback = [listener, key_frames, duration, segment_name,
+                earliest_presentation_time, segment_duration, segment_size]() {
+      for (const KeyFrameInfo& key_frame_info : key_frames) {
+        listener->OnKeyFrame(key_frame_info.timestamp,
+                             key_frame_info.start_byte_offset,
+                             key_frame_info.size);
+      }
+      listener->OnSampleDurationReady(duration);
+      listener->OnNewSegment(segment_name, earliest_presentation_time,
+                             segment_duration, segment_size);
+    };
+  }
+  // The fragments are written without being copied after the header.
+  return segment_writer_->Write(segment_name, &header, fragment_buffer(),
+                                callback);
+}
+
+void MultiSegmentSegmenter::WriteSegmentHeader(BufferWriter* buffer) {
+  DCHECK(sidx());
   DCHECK(styp_);
 
   DCHECK(!sidx()->references.empty());
@@ -98,71 +204,67 @@ Status MultiSegmentSegmenter::WriteSegment() {
   sidx()->earliest_presentation_time =
       sidx()->references[0].earliest_presentation_time;
 
-  std::unique_ptr<BufferWriter> buffer(new BufferWriter());
-  std::unique_ptr<File, FileCloser> file;
-  std::string file_name;
+  if (!options().segment_template.empty())
+    styp_->Write(buffer);
+
+  // 'sidx' describes the whole segment, so it cannot be generated if the
+  // segment is written out chunk by chunk.
+  if (options().mp4_params.generate_sidx_in_media_segments &&
+      !options().mp4_params.low_latency_dash_mode) {
+    sidx()->Write(buffer);
+  }
+}
+
+Status MultiSegmentSegmenter::OpenSegmentFile() {
+  DCHECK(!segment_file_);
+
+  BufferWriter buffer;
+  WriteSegmentHeader(&buffer);
   if (options().segment_template.empty()) {
     // Append the segment to output file if segment template is not specified.
-    file_name = options().output_file_name.c_str();
-    file.reset(File::Open(file_name.c_str(), "a"));
-    if (!file) {
+    segment_file_name_ = options().output_file_name;
+    segment_file_.reset(File::Open(segment_file_name_.c_str(), "a"));
+    if (!segment_file_) {
       return Status(error::FILE_FAILURE, "Cannot open file for append " +
                                              options().output_file_name);
     }
   } else {
-    file_name = GetSegmentName(options().segment_template,
-                               sidx()->earliest_presentation_time,
-                               num_segments_++, options().bandwidth);
-    file.reset(File::Open(file_name.c_str(), "w"));
-    if (!file) {
+    segment_file_name_ = GetSegmentName(options().segment_template,
+                                        sidx()->earliest_presentation_time,
+                                        num_segments_++, options().bandwidth);
+    segment_file_.reset(File::Open(segment_file_name_.c_str(), "w"));
+    if (!segment_file_) {
       return Status(error::FILE_FAILURE,
-                    "Cannot open file for write " + file_name);
+                    "Cannot open file for write " + segment_file_name_);
     }
-    styp_->Write(buffer.get());
   }
 
-  if (options().mp4_params.generate_sidx_in_media_segments)
-    sidx()->Write(buffer.get());
+  segment_size_ = buffer.Size();
+  if (buffer.Size() > 0)
+    return buffer.WriteToFile(segment_file_.get());
+  return Status::OK;
+}
 
-  const size_t segment_header_size = buffer->Size();
-  const size_t segment_size = segment_header_size + fragment_buffer()->Size();
-  DCHECK_NE(segment_size, 0u);
+Status MultiSegmentSegmenter::WriteFragmentBuffer() {
+  DCHECK(fragment_buffer());
+  DCHECK(segment_file_);
 
-  RETURN_IF_ERROR(buffer->WriteToFile(file.get()));
+  // Key frame offsets are relative to the start of fragment_buffer(), which
+  // only holds the fragments not yet written to the segment.
   if (muxer_listener()) {
-    for (const KeyFrameInfo& key_frame_info : key_frame_infos()) {
+    for (size_t i = num_key_frames_notified_; i < key_frame_infos().size();
+         ++i) {
+      const KeyFrameInfo& key_frame_info = key_frame_infos()[i];
       muxer_listener()->OnKeyFrame(
           key_frame_info.timestamp,
-          segment_header_size + key_frame_info.start_byte_offset,
+          segment_size_ + key_frame_info.start_byte_offset,
           key_frame_info.size);
     }
   }
-  RETURN_IF_ERROR(fragment_buffer()->WriteToFile(file.get()));
+  num_key_frames_notified_ = key_frame_infos().size();
 
-  // Close the file, which also does flushing, to make sure the file is written
-  // before manifest is updated.
-  if (!file.release()->Close()) {
-    return Status(
-        error::FILE_FAILURE,
-        "Cannot close file " + file_name +
-            ", possibly file permission issue or running out of disk space.");
-  }
-
-  uint64_t segment_duration = 0;
-  // ISO/IEC 23009-1:2012: the value shall be identical to sum of the the
-  // values of all Subsegment_duration fields in the first ‘sidx’ box.
-  for (size_t i = 0; i < sidx()->references.size(); ++i)
-    segment_duration += sidx()->references[i].subsegment_duration;
-
-  UpdateProgress(segment_duration);
-  if (muxer_listener()) {
-    muxer_listener()->OnSampleDurationReady(sample_duration());
-    muxer_listener()->OnNewSegment(file_name,
-                                   sidx()->earliest_presentation_time,
-                                   segment_duration, segment_size);
-  }
-
-  return Status::OK;
+  segment_size_ += fragment_buffer()->Size();
+  return fragment_buffer()->WriteToFile(segment_file_.get());
 }
 
 }  // namespace mp4
@@ -7,6 +7,9 @@
 #ifndef PACKAGER_MEDIA_FORMATS_MP4_MULTI_SEGMENT_SEGMENTER_H_
 #define PACKAGER_MEDIA_FORMATS_MP4_MULTI_SEGMENT_SEGMENTER_H_
 
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+#include "packager/media/base/segment_writer.h"
 #include "packager/media/formats/mp4/segmenter.h"
 
 namespace shaka {
@@ -20,6 +23,12 @@ struct SegmentType;
 /// are written to files defined by @b MuxerOptions.segment_template if
 /// specified; otherwise, the segments are appended to the main output file
 /// specified by @b MuxerOptions.output_file_name.
+/// In low latency DASH mode, i.e. @b Mp4OutputParams.low_latency_dash_mode,
+/// each fragment is appended to the open segment as soon as it is finalized.
+/// Otherwise, the segments defined by @b MuxerOptions.segment_template are
+/// written by a SegmentWriter, asynchronously if configured by
+/// @b MuxerOptions.segment_writer_params, and the muxer listener is notified
+/// of a segment once it is fully written.
 class MultiSegmentSegmenter : public Segmenter {
  public:
   MultiSegmentSegmenter(const MuxerOptions& options,
@@ -32,6 +41,7 @@ class MultiSegmentSegmenter : public Segmenter {
   bool GetInitRange(size_t* offset, size_t* size) override;
   bool GetIndexRange(size_t* offset, size_t* size) override;
   std::vector<Range> GetSegmentRanges() override;
+  Status WaitForPendingSegments() override;
   /// @}
 
  private:
@@ -39,14 +49,37 @@ class MultiSegmentSegmenter : public Segmenter {
   Status DoInitialize() override;
   Status DoFinalize() override;
   Status DoFinalizeSegment() override;
+  Status DoFinalizeChunk() override;
 
   // Write segment to file.
   Status WriteInitSegment();
   Status WriteSegment();
+  // Submit the segment in fragment_buffer() to |segment_writer_|.
+  Status SubmitSegment();
+
+  // Set the earliest presentation time of the current segment and write the
+  // segment header, i.e. 'styp' and 'sidx' as applicable, to |buffer|.
+  void WriteSegmentHeader(BufferWriter* buffer);
+  // Open the file for the current segment and write the segment header.
+  Status OpenSegmentFile();
+  // Write the fragments in fragment_buffer() to the current segment file.
+  Status WriteFragmentBuffer();
 
   std::unique_ptr<SegmentType> styp_;
   uint32_t num_segments_;
 
+  // The current segment file, which stays open between chunks in low latency
+  // mode.
+  std::unique_ptr<File, FileCloser> segment_file_;
+  std::string segment_file_name_;
+  // Number of bytes written to the current segment so far.
+  uint64_t segment_size_ = 0;
+  // Number of key frames in key_frame_infos() already notified to the muxer
+  // listener.
+  size_t num_key_frames_notified_ = 0;
+
+  std::unique_ptr<SegmentWriter> segment_writer_;
+
   DISALLOW_COPY_AND_ASSIGN(MultiSegmentSegmenter);
 };
 
@@ -0,0 +1,241 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/multi_segment_segmenter.h"
+
+#include <gtest/gtest.h>
+
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/file/file.h"
+#include "packager/media/base/media_handler.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/media/formats/mp4/box_reader.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+namespace {
+
+const int kTrackId = 1;
+const uint32_t kTimeScale = 10000;
+const uint64_t kDuration = 120000;
+const uint16_t kWidth = 320;
+const uint16_t kHeight = 240;
+const uint8_t kCodecConfig[] = {0x01, 0x00, 0x00, 0x00, 0x01, 0x00};
+const int64_t kSampleDuration = 1000;
+const int kSamplesPerChunk = 2;
+const int kChunksPerSegment = 3;
+const int kNumSegments = 2;
+const int64_t kChunkDuration = kSampleDuration * kSamplesPerChunk;
+const uint8_t kSampleData[] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70};
+
+}  // namespace
+
+class MultiSegmentSegmenterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(base::CreateNewTempDirectory(FILE_PATH_LITERAL(""),
+                                             &temp_dir_));
+    stream_info_.reset(new VideoStreamInfo(
+        kTrackId, kTimeScale, kDuration, kCodecVP9,
+        H26xStreamFormat::kUnSpecified, "vp09.00.10.08", kCodecConfig,
+        sizeof(kCodecConfig), kWidth, kHeight, 1, 1, 0, 0, 0, "und",
+        false));
+
+    options_.output_file_name = OutputFileName("init.mp4");
+    options_.segment_template = OutputFileName("segment_$Number$.m4s");
+  }
+
+  void TearDown() override {
+    const bool kRecursive = true;
+    base::DeleteFile(temp_dir_, kRecursive);
+  }
+
+  std::string OutputFileName(const std::string& name) const {
+    return temp_dir_.AppendASCII(name).AsUTF8Unsafe();
+  }
+
+  std::string SegmentFileName(int segment_number) const {
+    return OutputFileName("segment_" + std::to_string(segment_number) +
+                          ".m4s");
+  }
+
+  void InitializeSegmenter() {
+    segmenter_.reset(
+        new MultiSegmentSegmenter(options_, CreateFileType(), CreateMovie()));
+    ASSERT_OK(segmenter_->Initialize({stream_info_}, nullptr, nullptr));
+  }
+
+  // Adds the samples of the chunk starting at |timestamp| and finalizes it,
+  // as a subsegment unless it ends the segment.
+  void AddChunk(int64_t timestamp, bool is_key_frame, bool ends_segment) {
+    for (int i = 0; i < kSamplesPerChunk; ++i) {
+      std::shared_ptr<MediaSample> sample =
+          MediaSample::CopyFrom(kSampleData, sizeof(kSampleData),
+                                is_key_frame && i == 0);
+      sample->set_dts(timestamp + i * kSampleDuration);
+      sample->set_pts(timestamp + i * kSampleDuration);
+      sample->set_duration(kSampleDuration);
+      ASSERT_OK(segmenter_->AddSample(0, *sample));
+    }
+    SegmentInfo segment_info;
+    segment_info.is_subsegment = !ends_segment;
+    segment_info.start_timestamp = timestamp;
+    segment_info.duration = kChunkDuration;
+    ASSERT_OK(segmenter_->FinalizeSegment(0, segment_info));
+  }
+
+  // Parses the top level boxes in |data|. |box_types| is set to their types
+  // and |decode_times| to the base media decode times of the 'moof' boxes.
+  // All the boxes are expected to be complete.
+  void ParseSegment(const std::string& data,
+                    std::vector<FourCC>* box_types,
+                    std::vector<uint64_t>* decode_times) {
+    box_types->clear();
+    decode_times->clear();
+    const uint8_t* buffer = reinterpret_cast<const uint8_t*>(data.data());
+    size_t offset = 0;
+    while (offset < data.size()) {
+      FourCC type = FOURCC_NULL;
+      uint64_t box_size = 0;
+      bool err = false;
+      ASSERT_TRUE(BoxReader::StartBox(buffer + offset, data.size() - offset,
+                                      &type, &box_size, &err));
+      ASSERT_LE(offset + box_size, data.size());
+      box_types->push_back(type);
+      if (type == FOURCC_moof) {
+        std::unique_ptr<BoxReader> reader(
+            BoxReader::ReadBox(buffer + offset, box_size, &err));
+        ASSERT_TRUE(reader);
+        MovieFragment moof;
+        ASSERT_TRUE(moof.Parse(reader.get()));
+        ASSERT_EQ(1u, moof.tracks.size());
+        decode_times->push_back(moof.tracks[0].decode_time.decode_time);
+      }
+      offset += box_size;
+    }
+  }
+
+  std::unique_ptr<FileType> CreateFileType() const {
+    std::unique_ptr<FileType> ftyp(new FileType);
+    ftyp->major_brand = FOURCC_isom;
+    ftyp->compatible_brands.push_back(FOURCC_iso8);
+    ftyp->compatible_brands.push_back(FOURCC_dash);
+    return ftyp;
+  }
+
+  std::unique_ptr<Movie> CreateMovie() const {
+    std::unique_ptr<Movie> moov(new Movie);
+    moov->header.next_track_id = kTrackId + 1;
+    moov->tracks.resize(1);
+    moov->extends.tracks.resize(1);
+
+    Track& trak = moov->tracks[0];
+    trak.header.track_id = kTrackId;
+    trak.header.width = kWidth * 0x10000;
+    trak.header.height = kHeight * 0x10000;
+    trak.media.header.timescale = kTimeScale;
+
+    VideoSampleEntry video;
+    video.format = FOURCC_vp09;
+    video.width = kWidth;
+    video.height = kHeight;
+    video.codec_configuration.data.assign(std::begin(kCodecConfig),
+                                          std::end(kCodecConfig));
+    SampleDescription& sample_description =
+        trak.media.information.sample_table.description;
+    sample_description.type = kVideo;
+    sample_description.video_entries.push_back(video);
+
+    TrackExtends& trex = moov->extends.tracks[0];
+    trex.track_id = kTrackId;
+    trex.default_sample_description_index = 1;
+    return moov;
+  }
+
+  base::FilePath temp_dir_;
+  std::shared_ptr<StreamInfo> stream_info_;
+  MuxerOptions options_;
+  std::unique_ptr<MultiSegmentSegmenter> segmenter_;
+};
+
+// In low latency mode, each chunk is appended to the segment file as a
+// 'moof' and 'mdat' pair and flushed as soon as it is finalized, so the
+// segment can be read while it is still being written.
+TEST_F(MultiSegmentSegmenterTest, LowLatencyChunks) {
+  options_.mp4_params.low_latency_dash_mode = true;
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter());
+
+  int64_t timestamp = 0;
+  for (int i = 0; i < kNumSegments; ++i) {
+    for (int j = 0; j < kChunksPerSegment; ++j) {
+      const bool ends_segment = j == kChunksPerSegment - 1;
+      ASSERT_NO_FATAL_FAILURE(AddChunk(timestamp, j == 0, ends_segment));
+      timestamp += kChunkDuration;
+
+      // The segment holds a complete 'moof' and 'mdat' pair for each chunk
+      // finalized so far, behind the 'styp'.
+      std::string segment;
+      ASSERT_TRUE(File::ReadFileToString(SegmentFileName(i + 1).c_str(),
+                                         &segment));
+      std::vector<FourCC> box_types;
+      std::vector<uint64_t> decode_times;
+      ASSERT_NO_FATAL_FAILURE(ParseSegment(segment, &box_types,
+                                           &decode_times));
+      std::vector<FourCC> expected_box_types = {FOURCC_styp};
+      std::vector<uint64_t> expected_decode_times;
+      for (int k = 0; k <= j; ++k) {
+        expected_box_types.push_back(FOURCC_moof);
+        expected_box_types.push_back(FOURCC_mdat);
+        expected_decode_times.push_back((i * kChunksPerSegment + k) *
+                                        kChunkDuration);
+      }
+      EXPECT_EQ(expected_box_types, box_types);
+      EXPECT_EQ(expected_decode_times, decode_times);
+
+      // The next segment is not started before the current one ends.
+      EXPECT_FALSE(base::PathExists(
+          base::FilePath::FromUTF8Unsafe(SegmentFileName(i + 2))));
+    }
+  }
+  ASSERT_OK(segmenter_->Finalize());
+}
+
+// Otherwise, the chunks are only written out with the complete segment.
+TEST_F(MultiSegmentSegmenterTest, ChunksWrittenWithSegment) {
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter());
+
+  int64_t timestamp = 0;
+  for (int j = 0; j < kChunksPerSegment; ++j) {
+    const bool ends_segment = j == kChunksPerSegment - 1;
+    ASSERT_NO_FATAL_FAILURE(AddChunk(timestamp, j == 0, ends_segment));
+    timestamp += kChunkDuration;
+    if (!ends_segment) {
+      EXPECT_FALSE(base::PathExists(
+          base::FilePath::FromUTF8Unsafe(SegmentFileName(1))));
+    }
+  }
+  ASSERT_OK(segmenter_->Finalize());
+
+  std::string segment;
+  ASSERT_TRUE(File::ReadFileToString(SegmentFileName(1).c_str(), &segment));
+  std::vector<FourCC> box_types;
+  std::vector<uint64_t> decode_times;
+  ASSERT_NO_FATAL_FAILURE(ParseSegment(segment, &box_types, &decode_times));
+  std::vector<uint64_t> expected_decode_times;
+  for (int j = 0; j < kChunksPerSegment; ++j)
+    expected_decode_times.push_back(j * kChunkDuration);
+  EXPECT_EQ(expected_decode_times, decode_times);
+}
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
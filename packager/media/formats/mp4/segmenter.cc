@@ -231,6 +231,10 @@ Status Segmenter::FinalizeSegment(size_t stream_id,
     key_frame_infos_.clear();
     return status;
   }
+  return DoFinalizeChunk();
+}
+
+Status Segmenter::WaitForPendingSegments() {
   return Status::OK;
 }
 
@@ -268,6 +272,10 @@ void Segmenter::SetComplete() {
   progress_listener_->OnProgress(1.0);
 }
 
+Status Segmenter::DoFinalizeChunk() {
+  return Status::OK;
+}
+
 uint32_t Segmenter::GetReferenceStreamId() {
   DCHECK(sidx_);
   return sidx_->reference_id - 1;
@@ -278,14 +286,20 @@ void Segmenter::FinalizeFragmentForKeyRotation(
     bool fragment_encrypted,
     const EncryptionConfig& encryption_config) {
   if (options_.mp4_params.include_pssh_in_stream) {
-    moof_->pssh.clear();
-    const auto& key_system_info = encryption_config.key_system_info;
-    for (const ProtectionSystemSpecificInfo& system : key_system_info) {
-      if (system.psshs.empty())
-        continue;
-      ProtectionSystemSpecificHeader pssh;
-      pssh.raw_box = system.psshs;
-      moof_->pssh.push_back(pssh);
+    // The 'pssh' boxes only change with the key, so the serialized boxes are
+    // copied into |moof_| once per crypto period.
+    if (moof_pssh_key_id_.empty() ||
+        moof_pssh_key_id_ != encryption_config.key_id) {
+      moof_->pssh.clear();
+      const auto& key_system_info = encryption_config.key_system_info;
+      for (const ProtectionSystemSpecificInfo& system : key_system_info) {
+        if (system.psshs.empty())
+          continue;
+        ProtectionSystemSpecificHeader pssh;
+        pssh.raw_box = system.psshs;
+        moof_->pssh.push_back(pssh);
+      }
+      moof_pssh_key_id_ = encryption_config.key_id;
     }
   } else {
     LOG(WARNING)
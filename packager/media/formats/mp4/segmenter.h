@@ -76,6 +76,11 @@ class Segmenter {
   /// @return OK on success, an error status otherwise.
   Status FinalizeSegment(size_t stream_id, const SegmentInfo& segment_info);
 
+  /// Wait for the segments being written and their notifications to the muxer
+  /// listener. The default implementation does nothing.
+  /// @return OK on success, an error status otherwise.
+  virtual Status WaitForPendingSegments();
+
   // TODO(rkuroiwa): Change these Get*Range() methods to return
   // base::Optional<Range> as well.
   /// @return true if there is an initialization range, while setting @a offset
@@ -125,6 +130,10 @@ class Segmenter {
   virtual Status DoInitialize() = 0;
   virtual Status DoFinalize() = 0;
   virtual Status DoFinalizeSegment() = 0;
+  // Called when a subsegment (fragment) is finalized and written to
+  // fragment_buffer(). Subclasses may output the fragment immediately, e.g. for
+  // low latency chunked output. The default implementation does nothing.
+  virtual Status DoFinalizeChunk();
 
   uint32_t GetReferenceStreamId();
 
@@ -147,6 +156,9 @@ class Segmenter {
   uint32_t sample_duration_ = 0u;
   std::vector<uint64_t> stream_durations_;
   std::vector<KeyFrameInfo> key_frame_infos_;
+  // Key ID of the 'pssh' boxes in |moof_|. The boxes are reused by the
+  // following fragments until the key changes.
+  std::vector<uint8_t> moof_pssh_key_id_;
 
   DISALLOW_COPY_AND_ASSIGN(Segmenter);
 };
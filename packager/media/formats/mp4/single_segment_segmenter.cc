@@ -7,6 +7,7 @@
 #include "packager/media/formats/mp4/single_segment_segmenter.h"
 
 #include <algorithm>
+#include <limits>
 
 #include "packager/file/file.h"
 #include "packager/file/file_util.h"
@@ -15,10 +16,21 @@
 #include "packager/media/event/progress_listener.h"
 #include "packager/media/formats/mp4/box_definitions.h"
 #include "packager/media/formats/mp4/key_frame_info.h"
+#include "packager/status_macros.h"
 
 namespace shaka {
 namespace media {
 namespace mp4 {
+namespace {
+// The sidx references are estimated assuming that the segments are not
+// shorter than this, when reserving space for the header.
+const uint64_t kMinExpectedSegmentDurationInSeconds = 1;
+// Extra space reserved for the boxes in moov that are only populated on
+// finalization, e.g. mehd.
+const uint64_t kMoovFinalizationSlack = 64;
+// Size of a box header with a 32-bit box size.
+const uint64_t kBoxHeaderSize = 8;
+}  // namespace
 
 SingleSegmentSegmenter::SingleSegmentSegmenter(const MuxerOptions& options,
                                                std::unique_ptr<FileType> ftyp,
@@ -26,6 +38,8 @@ SingleSegmentSegmenter::SingleSegmentSegmenter(const MuxerOptions& options,
     : Segmenter(options, std::move(ftyp), std::move(moov)) {}
 
 SingleSegmentSegmenter::~SingleSegmentSegmenter() {
+  if (output_file_)
+    output_file_.release()->Close();
   if (temp_file_)
     temp_file_.release()->Close();
   if (!temp_file_name_.empty()) {
@@ -66,6 +80,15 @@ std::vector<Range> SingleSegmentSegmenter::GetSegmentRanges() {
 }
 
 Status SingleSegmentSegmenter::DoInitialize() {
+  if (options().mp4_params.reserve_header_space) {
+    const uint64_t header_size = EstimateHeaderSize();
+    if (header_size > 0 && OpenOutputWithReservedHeader(header_size))
+      return Status::OK;
+    LOG(WARNING) << "Unable to reserve header space in '"
+                 << options().output_file_name
+                 << "'. Writing the media to a temporary file instead.";
+  }
+
   // Single segment segmentation involves two stages:
   //   Stage 1: Create media subsegments from media samples
   //   Stage 2: Update media header (moov) which involves copying of media
@@ -84,77 +107,28 @@ Status SingleSegmentSegmenter::DoInitialize() {
 }
 
 Status SingleSegmentSegmenter::DoFinalize() {
-  DCHECK(temp_file_);
   DCHECK(ftyp());
   DCHECK(moov());
   DCHECK(vod_sidx_);
 
-  // Close the temp file to prepare for reading later.
-  if (!temp_file_.release()->Close()) {
-    return Status(
-        error::FILE_FAILURE,
-        "Cannot close the temp file " + temp_file_name_ +
-            ", possibly file permission issue or running out of disk space.");
+  if (!output_file_) {
+    // The target of 2nd stage of single segment segmentation.
+    RETURN_IF_ERROR(WriteHeaderAndCopyTempFile(progress_target() * 0.5));
+    SetComplete();
+    return Status::OK;
   }
 
-  std::unique_ptr<File, FileCloser> file(
-      File::Open(options().output_file_name.c_str(), "w"));
-  if (file == NULL) {
-    return Status(error::FILE_FAILURE,
-                  "Cannot open file to write " + options().output_file_name);
-  }
-
-  LOG(INFO) << "Update media header (moov) and rewrite the file to '"
-            << options().output_file_name << "'.";
-
-  // Write ftyp, moov and sidx to output file.
-  std::unique_ptr<BufferWriter> buffer(new BufferWriter());
-  ftyp()->Write(buffer.get());
-  moov()->Write(buffer.get());
-  vod_sidx_->Write(buffer.get());
-  Status status = buffer->WriteToFile(file.get());
-  if (!status.ok())
-    return status;
-
-  // Load the temp file and write to output file.
-  std::unique_ptr<File, FileCloser> temp_file(
-      File::Open(temp_file_name_.c_str(), "r"));
-  if (temp_file == NULL) {
-    return Status(error::FILE_FAILURE,
-                  "Cannot open file to read " + temp_file_name_);
-  }
-
-  // The target of 2nd stage of single segment segmentation.
-  const uint64_t re_segment_progress_target = progress_target() * 0.5;
-
-  const int kBufSize = 0x200000;  // 2MB.
-  std::unique_ptr<uint8_t[]> buf(new uint8_t[kBufSize]);
-  while (true) {
-    int64_t size = temp_file->Read(buf.get(), kBufSize);
-    if (size == 0) {
-      break;
-    } else if (size < 0) {
-      return Status(error::FILE_FAILURE,
-                    "Failed to read file " + temp_file_name_);
-    }
-    int64_t size_written = file->Write(buf.get(), size);
-    if (size_written != size) {
-      return Status(error::FILE_FAILURE,
-                    "Failed to write file " + options().output_file_name);
-    }
-    UpdateProgress(static_cast<double>(size) / temp_file->Size() *
-                   re_segment_progress_target);
-  }
-  if (!temp_file.release()->Close()) {
-    return Status(error::FILE_FAILURE, "Cannot close the temp file " +
-                                           temp_file_name_ + " after reading.");
-  }
-  if (!file.release()->Close()) {
-    return Status(
-        error::FILE_FAILURE,
-        "Cannot close file " + options().output_file_name +
-            ", possibly file permission issue or running out of disk space.");
+  if (FitHeaderInReservedSpace()) {
+    RETURN_IF_ERROR(WriteReservedHeader());
+    SetComplete();
+    return Status::OK;
   }
+  LOG(WARNING) << "The header does not fit in the " << reserved_header_size_
+               << " bytes reserved in '" << options().output_file_name
+               << "'. Rewriting the file.";
+  RETURN_IF_ERROR(MoveMediaToTempFile());
+  // The progress target does not account for the rewrite.
+  RETURN_IF_ERROR(WriteHeaderAndCopyTempFile(0));
   SetComplete();
   return Status::OK;
 }
@@ -209,9 +183,9 @@ Status SingleSegmentSegmenter::DoFinalizeSegment() {
                                    key_frame_info.size);
     }
   }
-  // Append fragment buffer to temp file.
+  // Append fragment buffer to the output file or the temp file.
   size_t segment_size = fragment_buffer()->Size();
-  Status status = fragment_buffer()->WriteToFile(temp_file_.get());
+  Status status = fragment_buffer()->WriteToFile(media_file());
   if (!status.ok()) return status;
 
   UpdateProgress(vod_ref.subsegment_duration);
@@ -224,6 +198,205 @@ Status SingleSegmentSegmenter::DoFinalizeSegment() {
   return Status::OK;
 }
 
+uint64_t SingleSegmentSegmenter::EstimateHeaderSize() {
+  // The progress target is the duration of the reference stream, which is
+  // in the timescale of sidx.
+  const uint64_t duration = progress_target();
+  if (duration == 0 || sidx()->timescale == 0)
+    return 0;
+  const uint64_t duration_in_seconds = duration / sidx()->timescale + 1;
+
+  SegmentIndex sidx_estimate;
+  // Forces the larger version 1 sidx.
+  sidx_estimate.earliest_presentation_time =
+      std::numeric_limits<uint64_t>::max();
+  sidx_estimate.references.resize(
+      duration_in_seconds / kMinExpectedSegmentDurationInSeconds + 1);
+  return ftyp()->ComputeSize() + moov()->ComputeSize() +
+         kMoovFinalizationSlack + sidx_estimate.ComputeSize();
+}
+
+bool SingleSegmentSegmenter::OpenOutputWithReservedHeader(
+    uint64_t header_size) {
+  // Only local files can be written out of order.
+  const std::string& file_name = options().output_file_name;
+  const size_t prefix_end = file_name.find("://");
+  if (prefix_end != std::string::npos &&
+      file_name.compare(0, prefix_end + 3, kLocalFilePrefix) != 0) {
+    return false;
+  }
+
+  output_file_.reset(File::Open(file_name.c_str(), "w"));
+  if (!output_file_)
+    return false;
+  // The reserved space is left unwritten until finalization. Fails if the
+  // output is not seekable, e.g. a pipe.
+  if (!output_file_->Seek(header_size)) {
+    output_file_.release()->Close();
+    return false;
+  }
+  reserved_header_size_ = header_size;
+  return true;
+}
+
+bool SingleSegmentSegmenter::FitHeaderInReservedSpace() {
+  vod_sidx_->first_offset = 0;
+  const uint64_t header_size = ftyp()->ComputeSize() + moov()->ComputeSize() +
+                               vod_sidx_->ComputeSize();
+  if (header_size > reserved_header_size_)
+    return false;
+  const uint64_t free_size = reserved_header_size_ - header_size;
+  if (free_size == 0)
+    return true;
+  if (free_size < kBoxHeaderSize)
+    return false;
+
+  // The unused space is covered by a 'free' box between sidx and the first
+  // subsegment, which is skipped with sidx first_offset.
+  vod_sidx_->first_offset = free_size;
+  if (ftyp()->ComputeSize() + moov()->ComputeSize() +
+          vod_sidx_->ComputeSize() !=
+      header_size) {
+    // A larger sidx version is needed for the first_offset.
+    vod_sidx_->first_offset = 0;
+    return false;
+  }
+  return true;
+}
+
+Status SingleSegmentSegmenter::WriteReservedHeader() {
+  LOG(INFO) << "Update media header (moov) in the reserved space of '"
+            << options().output_file_name << "'.";
+
+  BufferWriter buffer;
+  ftyp()->Write(&buffer);
+  moov()->Write(&buffer);
+  vod_sidx_->Write(&buffer);
+  if (vod_sidx_->first_offset > 0) {
+    // Only the header of the 'free' box is written. Its payload is the
+    // unwritten remainder of the reserved space.
+    DCHECK_LE(vod_sidx_->first_offset, std::numeric_limits<uint32_t>::max());
+    buffer.AppendInt(static_cast<uint32_t>(vod_sidx_->first_offset));
+    buffer.AppendInt(static_cast<uint32_t>(FOURCC_free));
+  }
+
+  if (!output_file_->Seek(0)) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot seek to the beginning of " +
+                      options().output_file_name);
+  }
+  RETURN_IF_ERROR(buffer.WriteToFile(output_file_.get()));
+  if (!output_file_.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + options().output_file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+  return Status::OK;
+}
+
+Status SingleSegmentSegmenter::MoveMediaToTempFile() {
+  const std::string& file_name = options().output_file_name;
+  if (!output_file_.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+
+  if (!TempFilePath(options().temp_dir, &temp_file_name_))
+    return Status(error::FILE_FAILURE, "Unable to create temporary file.");
+  temp_file_.reset(File::Open(temp_file_name_.c_str(), "w"));
+  if (!temp_file_) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to write " + temp_file_name_);
+  }
+
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name.c_str(), "r"));
+  if (!file)
+    return Status(error::FILE_FAILURE, "Cannot open file to read " + file_name);
+  if (!file->Seek(reserved_header_size_) ||
+      File::CopyFile(file.get(), temp_file_.get()) < 0) {
+    return Status(error::FILE_FAILURE,
+                  "Failed to copy " + file_name + " to " + temp_file_name_);
+  }
+  if (!file.release()->Close()) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot close file " + file_name + " after reading.");
+  }
+  return Status::OK;
+}
+
+Status SingleSegmentSegmenter::WriteHeaderAndCopyTempFile(
+    uint64_t re_segment_progress_target) {
+  DCHECK(temp_file_);
+
+  // Close the temp file to prepare for reading later.
+  if (!temp_file_.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close the temp file " + temp_file_name_ +
+            ", possibly file permission issue or running out of disk space.");
+  }
+
+  std::unique_ptr<File, FileCloser> file(
+      File::Open(options().output_file_name.c_str(), "w"));
+  if (file == NULL) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to write " + options().output_file_name);
+  }
+
+  LOG(INFO) << "Update media header (moov) and rewrite the file to '"
+            << options().output_file_name << "'.";
+
+  // Write ftyp, moov and sidx to output file.
+  std::unique_ptr<BufferWriter> buffer(new BufferWriter());
+  ftyp()->Write(buffer.get());
+  moov()->Write(buffer.get());
+  vod_sidx_->Write(buffer.get());
+  Status status = buffer->WriteToFile(file.get());
+  if (!status.ok())
+    return status;
+
+  // Load the temp file and write to output file.
+  std::unique_ptr<File, FileCloser> temp_file(
+      File::Open(temp_file_name_.c_str(), "r"));
+  if (temp_file == NULL) {
+    return Status(error::FILE_FAILURE,
+                  "Cannot open file to read " + temp_file_name_);
+  }
+
+  const int kBufSize = 0x200000;  // 2MB.
+  std::unique_ptr<uint8_t[]> buf(new uint8_t[kBufSize]);
+  while (true) {
+    int64_t size = temp_file->Read(buf.get(), kBufSize);
+    if (size == 0) {
+      break;
+    } else if (size < 0) {
+      return Status(error::FILE_FAILURE,
+                    "Failed to read file " + temp_file_name_);
+    }
+    int64_t size_written = file->Write(buf.get(), size);
+    if (size_written != size) {
+      return Status(error::FILE_FAILURE,
+                    "Failed to write file " + options().output_file_name);
+    }
+    UpdateProgress(static_cast<double>(size) / temp_file->Size() *
+                   re_segment_progress_target);
+  }
+  if (!temp_file.release()->Close()) {
+    return Status(error::FILE_FAILURE, "Cannot close the temp file " +
+                                           temp_file_name_ + " after reading.");
+  }
+  if (!file.release()->Close()) {
+    return Status(
+        error::FILE_FAILURE,
+        "Cannot close file " + options().output_file_name +
+            ", possibly file permission issue or running out of disk space.");
+  }
+  return Status::OK;
+}
+
 }  // namespace mp4
 }  // namespace media
 }  // namespace shaka
@@ -26,6 +26,10 @@ namespace mp4 {
 /// overall subsegment/fragment duration not smaller than defined duration and
 /// yet meet SAP requirements. SingleSegmentSegmenter ignores @b
 /// MuxerOptions.mp4_params.generate_sidx_in_media_segments.
+/// The media is written to a temporary file and copied behind the header on
+/// finalization, unless @b MuxerOptions.mp4_params.reserve_header_space is
+/// set, in which case it is written to the output file directly behind space
+/// reserved for the header.
 class SingleSegmentSegmenter : public Segmenter {
  public:
   SingleSegmentSegmenter(const MuxerOptions& options,
@@ -46,9 +50,37 @@ class SingleSegmentSegmenter : public Segmenter {
   Status DoFinalize() override;
   Status DoFinalizeSegment() override;
 
+  // Estimates the size of the header, i.e. 'ftyp', 'moov' and 'sidx', from
+  // the stream duration. Returns 0 if it cannot be estimated. Virtual for
+  // testing.
+  virtual uint64_t EstimateHeaderSize();
+  // Opens the output file for writing the media behind |header_size| bytes
+  // reserved for the header. Returns false if the output does not support it.
+  bool OpenOutputWithReservedHeader(uint64_t header_size);
+  // Fits the header into the reserved space, setting the 'sidx' first_offset
+  // to skip the 'free' box covering the unused space. Returns false if the
+  // header does not fit.
+  bool FitHeaderInReservedSpace();
+  // Writes the header into the reserved space and closes the output file.
+  Status WriteReservedHeader();
+  // Moves the media written behind the reserved space to the temporary file,
+  // if the header turns out not to fit in the reserved space.
+  Status MoveMediaToTempFile();
+  // Writes the header to the output file followed by the media in the
+  // temporary file.
+  Status WriteHeaderAndCopyTempFile(uint64_t re_segment_progress_target);
+  // The file the media subsegments are written to.
+  File* media_file() {
+    return output_file_ ? output_file_.get() : temp_file_.get();
+  }
+
   std::unique_ptr<SegmentIndex> vod_sidx_;
   std::string temp_file_name_;
   std::unique_ptr<File, FileCloser> temp_file_;
+  // Output file with space reserved for the header, if the header space is
+  // reserved.
+  std::unique_ptr<File, FileCloser> output_file_;
+  uint64_t reserved_header_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(SingleSegmentSegmenter);
 };
@@ -0,0 +1,294 @@
+// Copyright 2020 Google LLC. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/media/formats/mp4/single_segment_segmenter.h"
+
+#include <gtest/gtest.h>
+
+#if !defined(OS_WIN)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif  // !defined(OS_WIN)
+
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/file/file.h"
+#include "packager/media/base/media_handler.h"
+#include "packager/media/base/media_sample.h"
+#include "packager/media/base/muxer_options.h"
+#include "packager/media/base/video_stream_info.h"
+#include "packager/media/formats/mp4/box_definitions.h"
+#include "packager/status_test_util.h"
+
+namespace shaka {
+namespace media {
+namespace mp4 {
+namespace {
+
+const int kTrackId = 1;
+const uint32_t kTimeScale = 10000;
+const uint64_t kDuration = 150000;
+const uint16_t kWidth = 320;
+const uint16_t kHeight = 240;
+const uint8_t kCodecConfig[] = {0x01, 0x00, 0x00, 0x00, 0x01, 0x00};
+const int64_t kSampleDuration = 1000;
+const int kSamplesPerSegment = 5;
+const int kNumSegments = 3;
+const uint8_t kSampleData[] = {0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70};
+// Size of the 'free' box header covering the unused reserved space.
+const size_t kFreeBoxHeaderSize = 8;
+
+// Reserves a given size for the header instead of the estimate from the
+// stream duration.
+class TestSingleSegmentSegmenter : public SingleSegmentSegmenter {
+ public:
+  TestSingleSegmentSegmenter(const MuxerOptions& options,
+                             std::unique_ptr<FileType> ftyp,
+                             std::unique_ptr<Movie> moov,
+                             uint64_t header_size)
+      : SingleSegmentSegmenter(options, std::move(ftyp), std::move(moov)),
+        header_size_(header_size) {}
+
+ private:
+  uint64_t EstimateHeaderSize() override { return header_size_; }
+
+  const uint64_t header_size_;
+};
+
+}  // namespace
+
+class SingleSegmentSegmenterTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(base::CreateNewTempDirectory(FILE_PATH_LITERAL(""),
+                                             &temp_dir_));
+    stream_info_.reset(new VideoStreamInfo(
+        kTrackId, kTimeScale, kDuration, kCodecVP9,
+        H26xStreamFormat::kUnSpecified, "vp09.00.10.08", kCodecConfig,
+        sizeof(kCodecConfig), kWidth, kHeight, 1, 1, 0, 0, 0, "und",
+        false));
+
+    // Packages the media without reserving header space for reference.
+    reference_file_name_ = OutputFileName("reference.mp4");
+    MuxerOptions options;
+    options.output_file_name = reference_file_name_;
+    ASSERT_NO_FATAL_FAILURE(Package(options, 0, &reference_header_size_));
+    ASSERT_TRUE(
+        File::ReadFileToString(reference_file_name_.c_str(), &reference_));
+  }
+
+  void TearDown() override {
+    const bool kRecursive = true;
+    base::DeleteFile(temp_dir_, kRecursive);
+  }
+
+  std::string OutputFileName(const std::string& name) const {
+    return temp_dir_.AppendASCII(name).AsUTF8Unsafe();
+  }
+
+  // Packages the media with |header_size| bytes reserved for the header if
+  // it is not 0. |header_size_out|, if not NULL, is set to the size of the
+  // header, i.e. 'ftyp', 'moov' and 'sidx'. |segment_ranges|, if not NULL,
+  // is set to the segment byte ranges.
+  void Package(const MuxerOptions& options,
+               uint64_t header_size,
+               uint64_t* header_size_out,
+               std::vector<Range>* segment_ranges = nullptr) {
+    MuxerOptions segmenter_options = options;
+    segmenter_options.mp4_params.reserve_header_space = header_size > 0;
+    TestSingleSegmentSegmenter segmenter(segmenter_options, CreateFileType(),
+                                         CreateMovie(), header_size);
+    ASSERT_OK(segmenter.Initialize({stream_info_}, nullptr, nullptr));
+
+    int64_t timestamp = 0;
+    for (int i = 0; i < kNumSegments; ++i) {
+      SegmentInfo segment_info;
+      segment_info.start_timestamp = timestamp;
+      segment_info.duration = kSampleDuration * kSamplesPerSegment;
+      for (int j = 0; j < kSamplesPerSegment; ++j) {
+        std::shared_ptr<MediaSample> sample = MediaSample::CopyFrom(
+            kSampleData, sizeof(kSampleData), j == 0 /* is_key_frame */);
+        sample->set_dts(timestamp);
+        sample->set_pts(timestamp);
+        sample->set_duration(kSampleDuration);
+        ASSERT_OK(segmenter.AddSample(0, *sample));
+        timestamp += kSampleDuration;
+      }
+      ASSERT_OK(segmenter.FinalizeSegment(0, segment_info));
+    }
+    ASSERT_OK(segmenter.Finalize());
+
+    if (header_size_out) {
+      size_t index_offset = 0;
+      size_t index_size = 0;
+      ASSERT_TRUE(segmenter.GetIndexRange(&index_offset, &index_size));
+      *header_size_out = index_offset + index_size;
+    }
+    if (segment_ranges)
+      *segment_ranges = segmenter.GetSegmentRanges();
+  }
+
+  std::unique_ptr<FileType> CreateFileType() const {
+    std::unique_ptr<FileType> ftyp(new FileType);
+    ftyp->major_brand = FOURCC_isom;
+    ftyp->compatible_brands.push_back(FOURCC_iso8);
+    ftyp->compatible_brands.push_back(FOURCC_dash);
+    return ftyp;
+  }
+
+  std::unique_ptr<Movie> CreateMovie() const {
+    std::unique_ptr<Movie> moov(new Movie);
+    moov->header.next_track_id = kTrackId + 1;
+    moov->tracks.resize(1);
+    moov->extends.tracks.resize(1);
+
+    Track& trak = moov->tracks[0];
+    trak.header.track_id = kTrackId;
+    trak.header.width = kWidth * 0x10000;
+    trak.header.height = kHeight * 0x10000;
+    trak.media.header.timescale = kTimeScale;
+
+    VideoSampleEntry video;
+    video.format = FOURCC_vp09;
+    video.width = kWidth;
+    video.height = kHeight;
+    video.codec_configuration.data.assign(std::begin(kCodecConfig),
+                                          std::end(kCodecConfig));
+    SampleDescription& sample_description =
+        trak.media.information.sample_table.description;
+    sample_description.type = kVideo;
+    sample_description.video_entries.push_back(video);
+
+    TrackExtends& trex = moov->extends.tracks[0];
+    trex.track_id = kTrackId;
+    trex.default_sample_description_index = 1;
+    return moov;
+  }
+
+  base::FilePath temp_dir_;
+  std::shared_ptr<StreamInfo> stream_info_;
+  std::string reference_file_name_;
+  std::string reference_;
+  uint64_t reference_header_size_ = 0;
+};
+
+TEST_F(SingleSegmentSegmenterTest, HeaderFitsInReservedSpace) {
+  const uint64_t kFreeSize = 100;
+  const uint64_t reserved_size = reference_header_size_ + kFreeSize;
+
+  MuxerOptions options;
+  options.output_file_name = OutputFileName("output.mp4");
+  uint64_t header_size = 0;
+  std::vector<Range> segment_ranges;
+  ASSERT_NO_FATAL_FAILURE(
+      Package(options, reserved_size, &header_size, &segment_ranges));
+  EXPECT_EQ(reference_header_size_, header_size);
+
+  std::string output;
+  ASSERT_TRUE(File::ReadFileToString(options.output_file_name.c_str(),
+                                     &output));
+  ASSERT_EQ(reference_.size() + kFreeSize, output.size());
+
+  // The header is followed by a 'free' box covering the unused space, then by
+  // the media written directly behind the reserved space.
+  const uint8_t kExpectedFreeBoxHeader[] = {
+      0, 0, 0, static_cast<uint8_t>(kFreeSize), 'f', 'r', 'e', 'e',
+  };
+  EXPECT_EQ(std::string(std::begin(kExpectedFreeBoxHeader),
+                        std::end(kExpectedFreeBoxHeader)),
+            output.substr(header_size, kFreeBoxHeaderSize));
+  EXPECT_EQ(reference_.substr(reference_header_size_),
+            output.substr(reserved_size));
+
+  ASSERT_EQ(static_cast<size_t>(kNumSegments), segment_ranges.size());
+  EXPECT_EQ(reserved_size, segment_ranges.front().start);
+  EXPECT_EQ(output.size() - 1, segment_ranges.back().end);
+}
+
+TEST_F(SingleSegmentSegmenterTest, HeaderFitsInReservedSpaceExactly) {
+  MuxerOptions options;
+  options.output_file_name = OutputFileName("output.mp4");
+  ASSERT_NO_FATAL_FAILURE(Package(options, reference_header_size_, nullptr));
+
+  std::string output;
+  ASSERT_TRUE(File::ReadFileToString(options.output_file_name.c_str(),
+                                     &output));
+  EXPECT_EQ(reference_, output);
+}
+
+TEST_F(SingleSegmentSegmenterTest, HeaderLargerThanReservedSpace) {
+  MuxerOptions options;
+  options.output_file_name = OutputFileName("output.mp4");
+  std::vector<Range> segment_ranges;
+  ASSERT_NO_FATAL_FAILURE(Package(options, reference_header_size_ / 2,
+                                  nullptr, &segment_ranges));
+
+  // The media is moved behind the header, i.e. the output is the same as
+  // without reserving header space.
+  std::string output;
+  ASSERT_TRUE(File::ReadFileToString(options.output_file_name.c_str(),
+                                     &output));
+  EXPECT_EQ(reference_, output);
+  ASSERT_EQ(static_cast<size_t>(kNumSegments), segment_ranges.size());
+  EXPECT_EQ(reference_header_size_, segment_ranges.front().start);
+}
+
+TEST_F(SingleSegmentSegmenterTest, ReservedSpaceTooSmallForFreeBox) {
+  MuxerOptions options;
+  options.output_file_name = OutputFileName("output.mp4");
+  // The leftover space cannot hold a 'free' box header.
+  ASSERT_NO_FATAL_FAILURE(Package(
+      options, reference_header_size_ + kFreeBoxHeaderSize - 1, nullptr));
+
+  std::string output;
+  ASSERT_TRUE(File::ReadFileToString(options.output_file_name.c_str(),
+                                     &output));
+  EXPECT_EQ(reference_, output);
+}
+
+TEST_F(SingleSegmentSegmenterTest, NonLocalOutput) {
+  MuxerOptions options;
+  options.output_file_name = "memory://single_segment_segmenter/output.mp4";
+  ASSERT_NO_FATAL_FAILURE(
+      Package(options, reference_header_size_ + 100, nullptr));
+
+  std::string output;
+  ASSERT_TRUE(File::ReadFileToString(options.output_file_name.c_str(),
+                                     &output));
+  EXPECT_EQ(reference_, output);
+  ASSERT_TRUE(File::Delete(options.output_file_name.c_str()));
+}
+
+#if !defined(OS_WIN)
+TEST_F(SingleSegmentSegmenterTest, OutputNotSeekable) {
+  MuxerOptions options;
+  options.output_file_name = OutputFileName("output.fifo");
+  ASSERT_EQ(0, mkfifo(options.output_file_name.c_str(), 0600));
+  // Opening the read end first keeps the segmenter from blocking on opening
+  // the write end. The output is small enough to fit in the pipe buffer.
+  const int fd = open(options.output_file_name.c_str(), O_RDONLY | O_NONBLOCK);
+  ASSERT_GE(fd, 0);
+
+  ASSERT_NO_FATAL_FAILURE(
+      Package(options, reference_header_size_ + 100, nullptr));
+
+  // The header space cannot be reserved in a pipe, so the media is written to
+  // a temporary file and copied behind the header on finalization.
+  std::string output;
+  char buffer[4096];
+  ssize_t bytes_read = 0;
+  while ((bytes_read = read(fd, buffer, sizeof(buffer))) > 0)
+    output.append(buffer, bytes_read);
+  EXPECT_EQ(0, bytes_read);
+  close(fd);
+  EXPECT_EQ(reference_, output);
+}
+#endif  // !defined(OS_WIN)
+
+}  // namespace mp4
+}  // namespace media
+}  // namespace shaka
@@ -17,15 +17,22 @@
 namespace shaka {
 namespace media {
 namespace {
-std::string TimestampToString(uint64_t timestamp) {
-  // https://tools.ietf.org/html/rfc8216 The ID3 payload MUST be a 33-bit MPEG-2
-  // Program Elementary Stream timestamp expressed as a big-endian eight-octet
-  // number, with the upper 31 bits set to zero.
+// Size of the timestamp in the ID3 PRIV tag.
+const size_t kTimestampSize = sizeof(uint64_t);
+// Offset of the timestamp in the ID3 tag, which starts with the timestamp
+// PRIV frame: 10-byte ID3v2 header, 10-byte frame header, then the owner
+// identifier with its NULL terminating byte.
+// See http://id3.org/id3v2.4.0-structure and http://id3.org/id3v2.4.0-frames.
+const size_t kId3TimestampOffset = 10 + 10 + sizeof(kTimestampOwnerIdentifier);
+
+// https://tools.ietf.org/html/rfc8216 The ID3 payload MUST be a 33-bit MPEG-2
+// Program Elementary Stream timestamp expressed as a big-endian eight-octet
+// number, with the upper 31 bits set to zero.
+void WriteTimestamp(uint64_t timestamp, uint8_t* output) {
   timestamp &= 0x1FFFFFFFFull;
-
-  BufferWriter buffer;
-  buffer.AppendInt(timestamp);
-  return std::string(buffer.Buffer(), buffer.Buffer() + buffer.Size());
+  for (size_t i = 0; i < kTimestampSize; ++i)
+    output[i] =
+        static_cast<uint8_t>(timestamp >> (8 * (kTimestampSize - 1 - i)));
 }
 }  // namespace
 
@@ -67,11 +74,10 @@ Status PackedAudioSegmenter::AddSample(const MediaSample& sample) {
   }
 
   if (adts_converter_) {
-    std::vector<uint8_t> audio_frame;
     if (!adts_converter_->ConvertToADTS(sample.data(), sample.data_size(),
-                                        &audio_frame))
+                                        &adts_frame_))
       return Status(error::MUXER_FAILURE, "Failed to convert to ADTS.");
-    segment_buffer_.AppendArray(audio_frame.data(), audio_frame.size());
+    segment_buffer_.AppendVector(adts_frame_);
   } else {
     segment_buffer_.AppendArray(sample.data(), sample.data_size());
   }
@@ -123,6 +129,8 @@ Status PackedAudioSegmenter::EncryptionAudioSetup(const MediaSample& sample) {
   }
   audio_setup_information_.assign(buffer.Buffer(),
                                   buffer.Buffer() + buffer.Size());
+  // The ID3 tag now carries the audio setup information too.
+  id3_template_.clear();
   return Status::OK;
 }
 
@@ -140,15 +148,29 @@ Status PackedAudioSegmenter::StartNewSegment(const MediaSample& sample) {
     return Status(error::MUXER_FAILURE, "Unsupported negative timestamp.");
   }
 
+  if (id3_template_.empty())
+    RETURN_IF_ERROR(BuildId3Template());
+  WriteTimestamp(pts, &id3_template_[kId3TimestampOffset]);
+  segment_buffer_.AppendVector(id3_template_);
+
+  return Status::OK;
+}
+
+Status PackedAudioSegmenter::BuildId3Template() {
   // Use a unique_ptr so it can be mocked for testing.
   std::unique_ptr<Id3Tag> id3_tag = CreateId3Tag();
-  id3_tag->AddPrivateFrame(kTimestampOwnerIdentifier, TimestampToString(pts));
+  // The timestamp frame must be the first frame, at |kId3TimestampOffset|.
+  id3_tag->AddPrivateFrame(kTimestampOwnerIdentifier,
+                           std::string(kTimestampSize, 0));
   if (!audio_setup_information_.empty()) {
     id3_tag->AddPrivateFrame(kAudioDescriptionOwnerIdentifier,
                              audio_setup_information_);
   }
-  CHECK(id3_tag->WriteToBuffer(&segment_buffer_));
-
+  CHECK(id3_tag->WriteToVector(&id3_template_));
+  if (id3_template_.size() < kId3TimestampOffset + kTimestampSize) {
+    LOG(ERROR) << "Unexpected ID3 tag size " << id3_template_.size();
+    return Status(error::MUXER_FAILURE, "Failed to write ID3 tag.");
+  }
   return Status::OK;
 }
 
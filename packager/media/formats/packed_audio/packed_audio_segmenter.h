@@ -80,6 +80,8 @@ class PackedAudioSegmenter {
 
   Status EncryptionAudioSetup(const MediaSample& sample);
   Status StartNewSegment(const MediaSample& first_sample);
+  // Builds |id3_template_| with a zero timestamp.
+  Status BuildId3Template();
 
   const uint32_t transport_stream_timestamp_offset_ = 0;
   // Codec for the stream.
@@ -95,7 +97,16 @@ class PackedAudioSegmenter {
   std::string audio_setup_information_;
   // AAC is carried in ADTS.
   std::unique_ptr<AACAudioSpecificConfig> adts_converter_;
+  // ADTS frame of the current sample. Reused across samples.
+  std::vector<uint8_t> adts_frame_;
 
+  // The ID3 tag starting every segment, which only differs by the timestamp
+  // between the segments. It is built once, or again once the audio setup
+  // information is known, and only the timestamp is patched for each segment.
+  std::vector<uint8_t> id3_template_;
+
+  // Reused across segments, so it keeps the capacity of the largest segment
+  // and does not reallocate once the segment size is stable.
   BufferWriter segment_buffer_;
 };
 
@@ -6,7 +6,9 @@
 
 #include "packager/media/formats/packed_audio/packed_audio_writer.h"
 
+#include "packager/media/base/buffer_writer.h"
 #include "packager/media/base/muxer_util.h"
+#include "packager/media/base/segment_writer.h"
 #include "packager/media/formats/packed_audio/packed_audio_segmenter.h"
 #include "packager/status_macros.h"
 
@@ -18,7 +20,8 @@ PackedAudioWriter::PackedAudioWriter(const MuxerOptions& muxer_options)
       transport_stream_timestamp_offset_(
           muxer_options.transport_stream_timestamp_offset_ms *
           kPackedAudioTimescale / 1000),
-      segmenter_(new PackedAudioSegmenter(transport_stream_timestamp_offset_)) {
+      segmenter_(new PackedAudioSegmenter(transport_stream_timestamp_offset_)),
+      segment_writer_(new SegmentWriter(muxer_options.segment_writer_params)) {
 }
 
 PackedAudioWriter::~PackedAudioWriter() = default;
@@ -50,6 +53,7 @@ Status PackedAudioWriter::InitializeMuxer() {
 Status PackedAudioWriter::Finalize() {
   if (output_file_)
     RETURN_IF_ERROR(CloseFile(std::move(output_file_)));
+  RETURN_IF_ERROR(segment_writer_->Flush());
 
   if (muxer_listener()) {
     muxer_listener()->OnMediaEnd(
@@ -83,42 +87,48 @@ Status PackedAudioWriter::FinalizeSegment(size_t stream_id,
 
   // Save |segment_size| as it will be cleared after writing.
   const size_t segment_size = segmenter_->segment_buffer()->Size();
-
-  RETURN_IF_ERROR(WriteSegment(segment_path, segmenter_->segment_buffer()));
   total_duration_ += segment_info.duration;
 
-  if (muxer_listener()) {
-    muxer_listener()->OnNewSegment(
-        segment_path, segment_timestamp + transport_stream_timestamp_offset_,
-        segment_info.duration * segmenter_->TimescaleScale(), segment_size);
+  std::function<void()> callback;
+  MuxerListener* listener = muxer_listener();
+  if (listener) {
+    const int64_t start_time =
+        segment_timestamp + transport_stream_timestamp_offset_;
+    const int64_t duration =
+        segment_info.duration * segmenter_->TimescaleScale();
+    callback = [listener, segment_path, start_time, duration, segment_size]() {
+      listener->OnNewSegment(segment_path, start_time, duration, segment_size);
+    };
   }
-  return Status::OK;
+  return WriteSegment(segment_path, segmenter_->segment_buffer(), callback);
+}
+
+Status PackedAudioWriter::WaitForPendingSegments() {
+  return segment_writer_->Flush();
 }
 
 Status PackedAudioWriter::WriteSegment(const std::string& segment_path,
-                                       BufferWriter* segment_buffer) {
-  std::unique_ptr<File, FileCloser> file;
-  if (output_file_) {
-    // This is in single segment mode.
-    Range range;
-    range.start = media_ranges_.subsegment_ranges.empty()
-                      ? 0
-                      : (media_ranges_.subsegment_ranges.back().end + 1);
-    range.end = range.start + segment_buffer->Size() - 1;
-    media_ranges_.subsegment_ranges.push_back(range);
-  } else {
-    file.reset(File::Open(segment_path.c_str(), "w"));
-    if (!file) {
-      return Status(error::FILE_FAILURE,
-                    "Cannot open file for write " + segment_path);
-    }
+                                       BufferWriter* segment_buffer,
+                                       const std::function<void()>& callback) {
+  if (!output_file_) {
+    // The segment writer writes the segment buffer directly, or swaps its
+    // content into a buffer of its own for a background write, so the segment
+    // is not copied. Either way, the buffer is left empty for the segmenter.
+    return segment_writer_->Write(segment_path, nullptr, segment_buffer,
+                                  callback);
   }
 
-  RETURN_IF_ERROR(segment_buffer->WriteToFile(output_file_ ? output_file_.get()
-                                                           : file.get()));
-
-  if (file)
-    RETURN_IF_ERROR(CloseFile(std::move(file)));
+  // This is in single segment mode.
+  Range range;
+  range.start = media_ranges_.subsegment_ranges.empty()
+                    ? 0
+                    : (media_ranges_.subsegment_ranges.back().end + 1);
+  range.end = range.start + segment_buffer->Size() - 1;
+  media_ranges_.subsegment_ranges.push_back(range);
+
+  RETURN_IF_ERROR(segment_buffer->WriteToFile(output_file_.get()));
+  if (callback)
+    callback();
   return Status::OK;
 }
 
@@ -7,6 +7,8 @@
 #ifndef PACKAGER_MEDIA_FORMATS_PACKED_AUDIO_PACKED_AUDIO_WRITER_H_
 #define PACKAGER_MEDIA_FORMATS_PACKED_AUDIO_PACKED_AUDIO_WRITER_H_
 
+#include <functional>
+
 #include "packager/file/file_closer.h"
 #include "packager/media/base/muxer.h"
 
@@ -15,6 +17,7 @@ namespace media {
 
 class BufferWriter;
 class PackedAudioSegmenter;
+class SegmentWriter;
 
 /// Implements packed audio writer.
 /// https://tools.ietf.org/html/draft-pantos-http-live-streaming-23#section-3.4
@@ -37,9 +40,13 @@ class PackedAudioWriter : public Muxer {
   Status Finalize() override;
   Status AddSample(size_t stream_id, const MediaSample& sample) override;
   Status FinalizeSegment(size_t stream_id, const SegmentInfo& sample) override;
+  Status WaitForPendingSegments() override;
 
+  // Append the segment to the output file in single segment mode. Otherwise,
+  // submit it to |segment_writer_|, which runs |callback| once it is written.
   Status WriteSegment(const std::string& segment_path,
-                      BufferWriter* segment_buffer);
+                      BufferWriter* segment_buffer,
+                      const std::function<void()>& callback);
 
   Status CloseFile(std::unique_ptr<File, FileCloser> file);
 
@@ -54,6 +61,7 @@ class PackedAudioWriter : public Muxer {
 
   // Used in multi-segment mode for segment template.
   uint64_t segment_number_ = 0;
+  std::unique_ptr<SegmentWriter> segment_writer_;
 };
 
 }  // namespace media
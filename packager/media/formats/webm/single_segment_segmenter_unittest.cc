@@ -194,6 +194,70 @@ TEST_F(SingleSegmentSegmenterTest, SplitsClustersOnSegment) {
   EXPECT_EQ(3u, parser.GetFrameCountForCluster(1));
 }
 
+TEST_F(SingleSegmentSegmenterTest, ReservedCuesSpace) {
+  MuxerOptions options = CreateMuxerOptions();
+  options.webm_reserve_cues_space = true;
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter(options));
+
+  // Write the samples to the Segmenter.
+  for (int i = 0; i < 8; i++) {
+    if (i == 5) {
+      ASSERT_OK(segmenter_->FinalizeSegment(0, 5 * kDuration, !kSubsegment));
+    }
+    std::shared_ptr<MediaSample> sample =
+        CreateSample(kKeyFrame, kDuration, kNoSideData);
+    ASSERT_OK(segmenter_->AddSample(*sample));
+  }
+  ASSERT_OK(
+      segmenter_->FinalizeSegment(5 * kDuration, 8 * kDuration, !kSubsegment));
+  ASSERT_OK(segmenter_->Finalize());
+
+  // The Cues are right after the header, as with the temporary file.
+  uint64_t init_start, init_end, index_start, index_end;
+  ASSERT_TRUE(segmenter_->GetInitRangeStartAndEnd(&init_start, &init_end));
+  ASSERT_TRUE(segmenter_->GetIndexRangeStartAndEnd(&index_start, &index_end));
+  EXPECT_EQ(init_end + 1, index_start);
+  const std::vector<Range> ranges = segmenter_->GetSegmentRanges();
+  ASSERT_EQ(2u, ranges.size());
+  EXPECT_LT(index_end, ranges[0].start);
+  EXPECT_EQ(static_cast<int64_t>(ranges[1].end + 1),
+            File::GetFileSize(OutputFileName().c_str()));
+
+  // Verify the resulting data.
+  ClusterParser parser;
+  ASSERT_NO_FATAL_FAILURE(parser.PopulateFromSegment(OutputFileName()));
+  ASSERT_EQ(2u, parser.cluster_count());
+  EXPECT_EQ(5u, parser.GetFrameCountForCluster(0));
+  EXPECT_EQ(3u, parser.GetFrameCountForCluster(1));
+}
+
+TEST_F(SingleSegmentSegmenterTest, ReservedCuesSpaceTooSmall) {
+  MuxerOptions options = CreateMuxerOptions();
+  options.webm_reserve_cues_space = true;
+  ASSERT_NO_FATAL_FAILURE(InitializeSegmenter(options));
+
+  // Many more segments than expected from the stream duration.
+  const int kNumSegments = 30;
+  for (int i = 0; i < kNumSegments; i++) {
+    std::shared_ptr<MediaSample> sample =
+        CreateSample(kKeyFrame, kDuration, kNoSideData);
+    ASSERT_OK(segmenter_->AddSample(*sample));
+    ASSERT_OK(
+        segmenter_->FinalizeSegment(i * kDuration, kDuration, !kSubsegment));
+  }
+  ASSERT_OK(segmenter_->Finalize());
+
+  // The Cues are written to the end of the file instead.
+  uint64_t index_start, index_end;
+  ASSERT_TRUE(segmenter_->GetIndexRangeStartAndEnd(&index_start, &index_end));
+  EXPECT_EQ(static_cast<int64_t>(index_end + 1),
+            File::GetFileSize(OutputFileName().c_str()));
+
+  ClusterParser parser;
+  ASSERT_NO_FATAL_FAILURE(parser.PopulateFromSegment(OutputFileName()));
+  EXPECT_EQ(static_cast<size_t>(kNumSegments), parser.cluster_count());
+}
+
 TEST_F(SingleSegmentSegmenterTest, IgnoresSubsegment) {
   MuxerOptions options = CreateMuxerOptions();
   ASSERT_NO_FATAL_FAILURE(InitializeSegmenter(options));
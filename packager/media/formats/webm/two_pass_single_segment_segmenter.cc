@@ -7,11 +7,13 @@
 #include "packager/media/formats/webm/two_pass_single_segment_segmenter.h"
 
 #include <algorithm>
+#include <vector>
 
 #include "packager/file/file_util.h"
 #include "packager/media/base/media_sample.h"
 #include "packager/media/base/muxer_options.h"
 #include "packager/media/base/stream_info.h"
+#include "packager/status_macros.h"
 #include "packager/third_party/libwebm/src/mkvmuxer.hpp"
 #include "packager/third_party/libwebm/src/mkvmuxerutil.hpp"
 #include "packager/third_party/libwebm/src/webmids.hpp"
@@ -20,6 +22,15 @@ namespace shaka {
 namespace media {
 namespace webm {
 namespace {
+// The Cues are estimated assuming that the segments are not shorter than
+// this, when reserving space for the Cues.
+const uint64_t kMinExpectedSegmentDurationInSeconds = 1;
+// Upper bound of the output size assumed when estimating the Cues.
+const uint64_t kMaxEstimatedFileSize = 1ull << 40;
+// Void elements use either a 1-byte or an 8-byte size.
+const uint64_t kMaxOneByteVoidSize = 1 + 1 + 126;
+const uint64_t kEightByteVoidHeaderSize = 1 + 8;
+
 // Cues will be inserted before clusters. All clusters will be shifted down by
 // the size of cues. However, cluster positions affect the size of cues. This
 // function adjusts cues size iteratively until it is stable.
@@ -60,6 +71,34 @@ bool ReadSkip(File* file, int64_t byte_count) {
   DCHECK_EQ(bytes_read, byte_count);
   return true;
 }
+
+// Writes a Void element of exactly |size| bytes, which must be at least 2.
+// Unlike mkvmuxer::WriteVoidElement, this works for any size.
+bool WriteVoid(mkvmuxer::IMkvWriter* writer, uint64_t size) {
+  DCHECK_GE(size, 2u);
+  if (mkvmuxer::WriteID(writer, mkvmuxer::kMkvVoid) != 0)
+    return false;
+  uint64_t payload_size = 0;
+  if (size <= kMaxOneByteVoidSize) {
+    payload_size = size - 2;
+    if (mkvmuxer::WriteUIntSize(writer, payload_size, 1) != 0)
+      return false;
+  } else {
+    payload_size = size - kEightByteVoidHeaderSize;
+    if (mkvmuxer::WriteUIntSize(writer, payload_size, 8) != 0)
+      return false;
+  }
+
+  const uint64_t kBufferSize = 0x1000;
+  const std::vector<uint8_t> zeros(kBufferSize, 0);
+  while (payload_size > 0) {
+    const uint64_t write_size = std::min(payload_size, kBufferSize);
+    if (writer->Write(zeros.data(), static_cast<uint32_t>(write_size)) != 0)
+      return false;
+    payload_size -= write_size;
+  }
+  return true;
+}
 }  // namespace
 
 TwoPassSingleSegmentSegmenter::TwoPassSingleSegmentSegmenter(
@@ -69,6 +108,19 @@ TwoPassSingleSegmentSegmenter::TwoPassSingleSegmentSegmenter(
 TwoPassSingleSegmentSegmenter::~TwoPassSingleSegmentSegmenter() {}
 
 Status TwoPassSingleSegmentSegmenter::DoInitialize() {
+  if (options().webm_reserve_cues_space) {
+    const uint64_t cues_size = EstimateCuesSize();
+    if (cues_size > 0) {
+      bool reserved = false;
+      RETURN_IF_ERROR(InitializeWithReservedCues(cues_size, &reserved));
+      if (reserved)
+        return Status::OK;
+    }
+    LOG(WARNING) << "Unable to reserve Cues space in '"
+                 << options().output_file_name
+                 << "'. Writing the media to a temporary file instead.";
+  }
+
   // Assume the amount of time to copy the temp file as the same amount
   // of time as to make it.
   set_progress_target(duration() * 2);
@@ -85,6 +137,9 @@ Status TwoPassSingleSegmentSegmenter::DoInitialize() {
 }
 
 Status TwoPassSingleSegmentSegmenter::DoFinalize() {
+  if (reserved_cues_size_ > 0)
+    return FinalizeWithReservedCues();
+
   const uint64_t header_size = init_end() + 1;
   const uint64_t cues_pos = header_size - segment_payload_pos();
   const uint64_t cues_size = UpdateCues(cues());
@@ -137,6 +192,81 @@ Status TwoPassSingleSegmentSegmenter::DoFinalize() {
   return real_writer->Close();
 }
 
+uint64_t TwoPassSingleSegmentSegmenter::EstimateCuesSize() {
+  if (duration() == 0 || time_scale() == 0)
+    return 0;
+  const uint64_t num_cues =
+      duration() / time_scale() / kMinExpectedSegmentDurationInSeconds + 2;
+
+  // Use the largest time and cluster position for the estimate, so that the
+  // size of each CuePoint is not underestimated.
+  mkvmuxer::CuePoint cue_point;
+  cue_point.set_time(FromBmffTimestamp(duration()));
+  cue_point.set_track(track_id());
+  cue_point.set_cluster_pos(kMaxEstimatedFileSize);
+  // Cues header: ID and an 8-byte size.
+  return mkvmuxer::GetUIntSize(mkvmuxer::kMkvCues) + 8 +
+         cue_point.Size() * num_cues;
+}
+
+Status TwoPassSingleSegmentSegmenter::InitializeWithReservedCues(
+    uint64_t cues_size,
+    bool* reserved) {
+  *reserved = false;
+  std::unique_ptr<MkvWriter> output(new MkvWriter);
+  RETURN_IF_ERROR(output->Open(options().output_file_name));
+  if (!output->Seekable())
+    return output->Close();
+  set_writer(std::move(output));
+
+  RETURN_IF_ERROR(SingleSegmentSegmenter::DoInitialize());
+  const uint64_t cues_pos = writer()->Position();
+  if (!WriteVoid(writer(), cues_size))
+    return Status(error::FILE_FAILURE, "Error reserving space for Cues.");
+  seek_head()->set_cues_pos(cues_pos - segment_payload_pos());
+  seek_head()->set_cluster_pos(writer()->Position() - segment_payload_pos());
+  reserved_cues_size_ = cues_size;
+  *reserved = true;
+  return Status::OK;
+}
+
+Status TwoPassSingleSegmentSegmenter::FinalizeWithReservedCues() {
+  const uint64_t cues_size = cues()->Size();
+  // The unused space needs to be covered by a Void element, which takes at
+  // least two bytes.
+  if (cues_size > reserved_cues_size_ ||
+      reserved_cues_size_ - cues_size == 1) {
+    LOG(WARNING) << "Cues do not fit in the " << reserved_cues_size_
+                 << " bytes reserved in '" << options().output_file_name
+                 << "'. Writing them to the end of the file.";
+    // The reserved space is left as a Void element.
+    return SingleSegmentSegmenter::DoFinalize();
+  }
+
+  const uint64_t file_size = writer()->Position();
+  const uint64_t cues_pos = init_end() + 1;
+  if (writer()->Position(cues_pos) != 0)
+    return Status(error::FILE_FAILURE, "Error seeking to the Cues.");
+  set_index_start(cues_pos);
+  if (!cues()->Write(writer()))
+    return Status(error::FILE_FAILURE, "Error writing Cues data.");
+  set_index_end(writer()->Position() - 1);
+  if (cues_size < reserved_cues_size_ &&
+      !WriteVoid(writer(), reserved_cues_size_ - cues_size)) {
+    return Status(error::FILE_FAILURE, "Error writing Void element.");
+  }
+  DCHECK_EQ(writer()->Position(),
+            static_cast<int64_t>(cues_pos + reserved_cues_size_));
+
+  // Update the header with the file size and the final durations.
+  if (writer()->Position(0) != 0)
+    return Status(error::FILE_FAILURE, "Error seeking to the header.");
+  Status status = WriteSegmentHeader(file_size, writer());
+  DCHECK_EQ(writer()->Position(), static_cast<int64_t>(cues_pos));
+  status.Update(writer()->Close());
+  return status;
+}
+
 bool TwoPassSingleSegmentSegmenter::CopyFileWithClusterRewrite(
     File* source,
     MkvWriter* dest,
@@ -23,6 +23,9 @@ namespace webm {
 
 /// An implementation of a Segmenter for a single-segment that performs two
 /// passes.  This does not use seeking and is used for non-seekable files.
+/// If @b MuxerOptions.webm_reserve_cues_space is set and the output is
+/// seekable, space for the Cues is reserved with a Void element before the
+/// first Cluster instead, and the output is written in a single pass.
 class TwoPassSingleSegmentSegmenter : public SingleSegmentSegmenter {
  public:
   explicit TwoPassSingleSegmentSegmenter(const MuxerOptions& options);
@@ -41,7 +44,19 @@ class TwoPassSingleSegmentSegmenter : public SingleSegmentSegmenter {
                                   MkvWriter* dest,
                                   uint64_t last_size);
 
+  // Estimates the size of the Cues from the stream duration. Returns 0 if it
+  // cannot be estimated.
+  uint64_t EstimateCuesSize();
+  // Opens the output file and writes the header followed by a Void element of
+  // |cues_size| bytes. Sets |reserved| to false if the output is not seekable.
+  Status InitializeWithReservedCues(uint64_t cues_size, bool* reserved);
+  // Writes the Cues to the reserved space and updates the header.
+  Status FinalizeWithReservedCues();
+
   std::string temp_file_name_;
+  // Size of the space reserved for the Cues; 0 if the media is written to a
+  // temporary file.
+  uint64_t reserved_cues_size_ = 0;
 
   DISALLOW_COPY_AND_ASSIGN(TwoPassSingleSegmentSegmenter);
 };
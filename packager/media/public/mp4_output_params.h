@@ -20,6 +20,21 @@ struct Mp4OutputParams {
   /// Note that it is required by spec if segment_template contains $Times$
   /// specifier.
   bool generate_sidx_in_media_segments = true;
+  /// Enables chunked CMAF output for low latency DASH (LL-DASH). Each
+  /// subsegment (fragment) is appended to the open segment file as soon as it
+  /// is finalized instead of being buffered until the end of the segment, so
+  /// that the segment can be fetched while it is still being produced. 'sidx'
+  /// is not generated in media segments in this mode since it cannot be
+  /// written before the segment is complete.
+  bool low_latency_dash_mode = false;
+  /// For single file VOD output only. Reserves space for the header boxes
+  /// ('ftyp', 'moov' and 'sidx') at the beginning of the output file, so that
+  /// the media is written to the output directly instead of to a temporary
+  /// file which is copied to the output on finalization. The unused part of
+  /// the reserved space is covered by a 'free' box. Falls back to the
+  /// temporary file if the stream duration is unknown or the output is not a
+  /// seekable local file.
+  bool reserve_header_space = false;
 };
 
 }  // namespace shaka
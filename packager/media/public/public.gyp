@@ -17,6 +17,7 @@
         'chunking_params.h',
         'crypto_params.h',
         'mp4_output_params.h',
+        'segment_writer_params.h',
       ],
     },
   ],
@@ -0,0 +1,39 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef PACKAGER_MEDIA_PUBLIC_SEGMENT_WRITER_PARAMS_H_
+#define PACKAGER_MEDIA_PUBLIC_SEGMENT_WRITER_PARAMS_H_
+
+#include <stdint.h>
+
+namespace shaka {
+
+/// Policy of flushing the segments to the storage device once written.
+enum class SegmentSyncPolicy {
+  /// Leave it to the operating system.
+  kNone,
+  /// Flush the data and the metadata needed to read it, like fdatasync.
+  kDataSync,
+  /// Flush the data and all the metadata, like fsync.
+  kFullSync,
+};
+
+/// Segment writing related parameters.
+struct SegmentWriterParams {
+  /// Maximum number of media segments of an output being written in the
+  /// background, while the muxer goes on with the next segments. The muxer
+  /// waits when the limit is reached. The segments are written synchronously
+  /// by the muxer if it is 0. The manifests are only updated with the
+  /// segments once they are fully written.
+  uint32_t max_in_flight_writes = 0;
+  /// Policy of flushing the media segments to the storage device once
+  /// written. Applies to local files only.
+  SegmentSyncPolicy sync_policy = SegmentSyncPolicy::kNone;
+};
+
+}  // namespace shaka
+
+#endif  // PACKAGER_MEDIA_PUBLIC_SEGMENT_WRITER_PARAMS_H_
@@ -0,0 +1,237 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/indexed_media_info.h"
+
+#include <algorithm>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include "packager/base/logging.h"
+#include "packager/media/base/buffer_reader.h"
+#include "packager/media/base/buffer_writer.h"
+#include "packager/mpd/base/media_info.pb.h"
+
+namespace shaka {
+
+using google::protobuf::internal::WireFormatLite;
+using google::protobuf::io::CodedInputStream;
+
+namespace {
+
+const uint8_t kMagic[] = {'S', 'M', 'I', 'B'};
+const uint32_t kVersion = 1;
+// Magic, version and number of index entries.
+const size_t kHeaderSize = sizeof(kMagic) + 2 * sizeof(uint32_t);
+// Field number, offset and size.
+const size_t kIndexEntrySize = 3 * sizeof(uint32_t);
+
+struct IndexEntry {
+  uint32_t field_number;
+  uint32_t offset;
+  uint32_t size;
+};
+
+// Parses the header in |reader|. |num_entries| receives the number of index
+// entries following the header.
+bool ParseHeader(media::BufferReader* reader, uint32_t* num_entries) {
+  std::vector<uint8_t> magic;
+  uint32_t version = 0;
+  if (!reader->ReadToVector(&magic, sizeof(kMagic)) ||
+      !std::equal(magic.begin(), magic.end(), kMagic) ||
+      !reader->Read4(&version) || !reader->Read4(num_entries)) {
+    LOG(ERROR) << "Invalid indexed MediaInfo header.";
+    return false;
+  }
+  if (version != kVersion) {
+    LOG(ERROR) << "Unsupported indexed MediaInfo version " << version;
+    return false;
+  }
+  return true;
+}
+
+bool ReadFully(File* file, size_t size, std::vector<uint8_t>* data) {
+  data->resize(size);
+  size_t size_read = 0;
+  while (size_read < size) {
+    const int64_t result =
+        file->Read(data->data() + size_read, size - size_read);
+    if (result <= 0) {
+      LOG(ERROR) << "Failed to read " << size << " bytes from "
+                 << file->file_name();
+      return false;
+    }
+    size_read += result;
+  }
+  return true;
+}
+
+}  // namespace
+
+bool IsIndexedMediaInfo(const std::string& content) {
+  return content.size() >= sizeof(kMagic) &&
+         std::equal(kMagic, kMagic + sizeof(kMagic), content.begin());
+}
+
+bool SerializeIndexedMediaInfo(const MediaInfo& media_info,
+                               std::string* output) {
+  DCHECK(output);
+
+  std::string payload;
+  if (!media_info.SerializeToString(&payload)) {
+    LOG(ERROR) << "Failed to serialize MediaInfo.";
+    return false;
+  }
+
+  // Walk the wire-format records to locate each top-level field. The records
+  // of a repeated field are contiguous, so they share one index entry.
+  std::vector<IndexEntry> index;
+  CodedInputStream input(reinterpret_cast<const uint8_t*>(payload.data()),
+                         payload.size());
+  while (true) {
+    const uint32_t offset = input.CurrentPosition();
+    const uint32_t tag = input.ReadTag();
+    if (tag == 0)
+      break;
+    if (!WireFormatLite::SkipField(&input, tag)) {
+      LOG(ERROR) << "Failed to index serialized MediaInfo.";
+      return false;
+    }
+    const uint32_t field_number = WireFormatLite::GetTagFieldNumber(tag);
+    const uint32_t size = input.CurrentPosition() - offset;
+    if (!index.empty() && index.back().field_number == field_number &&
+        index.back().offset + index.back().size == offset) {
+      index.back().size += size;
+    } else {
+      index.push_back({field_number, offset, size});
+    }
+  }
+
+  media::BufferWriter header(kHeaderSize + index.size() * kIndexEntrySize);
+  header.AppendArray(kMagic, sizeof(kMagic));
+  header.AppendInt(kVersion);
+  header.AppendInt(static_cast<uint32_t>(index.size()));
+  for (const IndexEntry& entry : index) {
+    header.AppendInt(entry.field_number);
+    header.AppendInt(entry.offset);
+    header.AppendInt(entry.size);
+  }
+
+  output->reserve(header.Size() + payload.size());
+  output->assign(reinterpret_cast<const char*>(header.Buffer()),
+                 header.Size());
+  output->append(payload);
+  return true;
+}
+
+bool ParseIndexedMediaInfo(const std::string& content, MediaInfo* media_info) {
+  DCHECK(media_info);
+
+  media::BufferReader reader(reinterpret_cast<const uint8_t*>(content.data()),
+                             content.size());
+  uint32_t num_entries = 0;
+  if (!ParseHeader(&reader, &num_entries))
+    return false;
+  if (num_entries > (content.size() - reader.pos()) / kIndexEntrySize ||
+      !reader.SkipBytes(num_entries * kIndexEntrySize)) {
+    LOG(ERROR) << "Truncated indexed MediaInfo index.";
+    return false;
+  }
+  return media_info->ParseFromArray(content.data() + reader.pos(),
+                                    content.size() - reader.pos());
+}
+
+IndexedMediaInfoReader::IndexedMediaInfoReader() {}
+
+IndexedMediaInfoReader::~IndexedMediaInfoReader() {}
+
+bool IndexedMediaInfoReader::Open(const std::string& file_name) {
+  file_.reset(File::Open(file_name.c_str(), "r"));
+  if (!file_) {
+    LOG(ERROR) << "Failed to open " << file_name;
+    return false;
+  }
+
+  const int64_t file_size = file_->Size();
+  if (file_size < static_cast<int64_t>(kHeaderSize)) {
+    VLOG(1) << file_name << " is not an indexed MediaInfo file.";
+    return false;
+  }
+  std::vector<uint8_t> data;
+  if (!ReadFully(file_.get(), kHeaderSize, &data))
+    return false;
+  if (!std::equal(kMagic, kMagic + sizeof(kMagic), data.begin())) {
+    VLOG(1) << file_name << " is not an indexed MediaInfo file.";
+    return false;
+  }
+  media::BufferReader header_reader(data.data(), data.size());
+  uint32_t num_entries = 0;
+  if (!ParseHeader(&header_reader, &num_entries))
+    return false;
+
+  // The number of entries comes from the file, so it is checked against the
+  // file size before allocating the index.
+  if (num_entries > (file_size - kHeaderSize) / kIndexEntrySize) {
+    LOG(ERROR) << "Invalid number of index entries " << num_entries << " in "
+               << file_name;
+    return false;
+  }
+  payload_position_ = kHeaderSize + num_entries * kIndexEntrySize;
+  const uint64_t payload_size = file_size - payload_position_;
+
+  if (!ReadFully(file_.get(), num_entries * kIndexEntrySize, &data))
+    return false;
+  media::BufferReader index_reader(data.data(), data.size());
+  index_.clear();
+  for (uint32_t i = 0; i < num_entries; ++i) {
+    uint32_t field_number = 0;
+    FieldRange range;
+    if (!index_reader.Read4(&field_number) ||
+        !index_reader.Read4(&range.offset) ||
+        !index_reader.Read4(&range.size) ||
+        static_cast<uint64_t>(range.offset) + range.size > payload_size) {
+      LOG(ERROR) << "Invalid indexed MediaInfo index in " << file_name;
+      return false;
+    }
+    index_[field_number].push_back(range);
+  }
+  return true;
+}
+
+bool IndexedMediaInfoReader::HasField(int field_number) const {
+  return index_.find(field_number) != index_.end();
+}
+
+bool IndexedMediaInfoReader::ReadFields(const std::vector<int>& field_numbers,
+                                        MediaInfo* media_info) {
+  DCHECK(file_);
+  DCHECK(media_info);
+
+  std::vector<uint8_t> data;
+  for (int field_number : field_numbers) {
+    auto iter = index_.find(field_number);
+    if (iter == index_.end())
+      continue;
+    for (const FieldRange& range : iter->second) {
+      if (!file_->Seek(payload_position_ + range.offset)) {
+        LOG(ERROR) << "Failed to seek in " << file_->file_name();
+        return false;
+      }
+      if (!ReadFully(file_.get(), range.size, &data))
+        return false;
+      CodedInputStream input(data.data(), data.size());
+      if (!media_info->MergeFromCodedStream(&input)) {
+        LOG(ERROR) << "Failed to parse MediaInfo field " << field_number
+                   << " in " << file_->file_name();
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace shaka
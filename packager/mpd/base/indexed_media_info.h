@@ -0,0 +1,91 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_INDEXED_MEDIA_INFO_H_
+#define MPD_BASE_INDEXED_MEDIA_INFO_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+
+class MediaInfo;
+
+/// Binary MediaInfo dump format with a field index. The layout is:
+///   magic 'SMIB' | version (32 bits) | number of index entries (32 bits) |
+///   index entries | serialized MediaInfo
+/// Each index entry is a (field number, offset, size) triple of 32-bit
+/// big-endian integers, locating the wire-format records of one top-level
+/// MediaInfo field relative to the start of the serialized MediaInfo. The
+/// serialized MediaInfo is the regular protobuf binary encoding, so it can be
+/// parsed as a whole, or field by field using the index.
+
+/// @return true if @a content starts with the indexed MediaInfo magic.
+bool IsIndexedMediaInfo(const std::string& content);
+
+/// Serialize @a media_info in indexed binary format.
+/// @param media_info is the MediaInfo to serialize.
+/// @param[out] output receives the serialized data. Should not be NULL.
+/// @return true on success, false otherwise.
+bool SerializeIndexedMediaInfo(const MediaInfo& media_info,
+                               std::string* output);
+
+/// Parse the whole MediaInfo from indexed binary format @a content.
+/// @param[out] media_info receives the parsed MediaInfo. Should not be NULL.
+/// @return true on success, false otherwise.
+bool ParseIndexedMediaInfo(const std::string& content, MediaInfo* media_info);
+
+/// Reads selected fields from an indexed MediaInfo file. Only the header and
+/// the index are read on Open(); field data is read on demand.
+class IndexedMediaInfoReader {
+ public:
+  IndexedMediaInfoReader();
+  ~IndexedMediaInfoReader();
+
+  /// Open @a file_name and load its index.
+  /// @return true on success, false if the file cannot be read or is not an
+  ///         indexed MediaInfo file. Only the latter is not logged as an
+  ///         error.
+  bool Open(const std::string& file_name);
+
+  /// @return true if the file contains @a field_number.
+  bool HasField(int field_number) const;
+
+  /// Read the fields in @a field_numbers and merge them into @a media_info.
+  /// Fields not present in the file are ignored.
+  /// @param field_numbers are MediaInfo top-level field numbers, e.g.
+  ///        MediaInfo::kVideoInfoFieldNumber.
+  /// @param[out] media_info receives the fields. Should not be NULL.
+  /// @return true on success, false otherwise.
+  bool ReadFields(const std::vector<int>& field_numbers,
+                  MediaInfo* media_info);
+
+ private:
+  IndexedMediaInfoReader(const IndexedMediaInfoReader&) = delete;
+  IndexedMediaInfoReader& operator=(const IndexedMediaInfoReader&) = delete;
+
+  struct FieldRange {
+    uint32_t offset = 0;
+    uint32_t size = 0;
+  };
+
+  std::unique_ptr<File, FileCloser> file_;
+  // Position of the serialized MediaInfo in the file.
+  uint64_t payload_position_ = 0;
+  // Byte ranges of each field in the serialized MediaInfo.
+  std::map<int, std::vector<FieldRange>> index_;
+};
+
+}  // namespace shaka
+
+#endif  // MPD_BASE_INDEXED_MEDIA_INFO_H_
@@ -0,0 +1,192 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gmock/gmock.h>
+#include <google/protobuf/text_format.h>
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/base/logging.h"
+#include "packager/base/time/time.h"
+#include "packager/file/file.h"
+#include "packager/mpd/base/indexed_media_info.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/test/mpd_builder_test_helper.h"
+
+namespace shaka {
+
+namespace {
+
+const char kMediaInfo[] =
+    "video_info {\n"
+    "  codec: 'avc1.010101'\n"
+    "  width: 1920\n"
+    "  height: 1080\n"
+    "  time_scale: 90000\n"
+    "  frame_duration: 3000\n"
+    "  pixel_width: 1\n"
+    "  pixel_height: 1\n"
+    "}\n"
+    "content_protections {\n"
+    "  uuid: 'edef8ba9-79d6-4ace-a3c8-27dcd51d21ed'\n"
+    "  pssh: 'pssh1'\n"
+    "}\n"
+    "content_protections {\n"
+    "  uuid: '9a04f079-9840-4286-ab92-e65be0885f95'\n"
+    "  pssh: 'pssh2'\n"
+    "}\n"
+    "init_range {\n"
+    "  begin: 0\n"
+    "  end: 120\n"
+    "}\n"
+    "index_range {\n"
+    "  begin: 121\n"
+    "  end: 221\n"
+    "}\n"
+    "reference_time_scale: 90000\n"
+    "container_type: CONTAINER_MP4\n"
+    "media_file_name: 'video.mp4'\n"
+    "media_duration_seconds: 10800\n"
+    "bandwidth: 4000000\n";
+
+MATCHER_P(EqualsProto, message, "") {
+  return ::google::protobuf::util::MessageDifferencer::Equals(arg, message);
+}
+
+}  // namespace
+
+class IndexedMediaInfoTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(base::CreateTemporaryFile(&temp_file_path_));
+    media_info_ = ConvertToMediaInfo(kMediaInfo);
+  }
+
+  void TearDown() override { base::DeleteFile(temp_file_path_, false); }
+
+  std::string temp_file_name() const { return temp_file_path_.AsUTF8Unsafe(); }
+
+  base::FilePath temp_file_path_;
+  MediaInfo media_info_;
+};
+
+TEST_F(IndexedMediaInfoTest, RoundTrip) {
+  std::string serialized;
+  ASSERT_TRUE(SerializeIndexedMediaInfo(media_info_, &serialized));
+  EXPECT_TRUE(IsIndexedMediaInfo(serialized));
+
+  MediaInfo media_info;
+  ASSERT_TRUE(ParseIndexedMediaInfo(serialized, &media_info));
+  EXPECT_THAT(media_info, EqualsProto(media_info_));
+}
+
+TEST_F(IndexedMediaInfoTest, NotIndexed) {
+  std::string serialized;
+  ASSERT_TRUE(media_info_.SerializeToString(&serialized));
+  EXPECT_FALSE(IsIndexedMediaInfo(serialized));
+  EXPECT_FALSE(IsIndexedMediaInfo(kMediaInfo));
+
+  MediaInfo media_info;
+  EXPECT_FALSE(ParseIndexedMediaInfo(serialized, &media_info));
+}
+
+TEST_F(IndexedMediaInfoTest, ReadSelectedFields) {
+  std::string serialized;
+  ASSERT_TRUE(SerializeIndexedMediaInfo(media_info_, &serialized));
+  ASSERT_TRUE(File::WriteStringToFile(temp_file_name().c_str(), serialized));
+
+  IndexedMediaInfoReader reader;
+  ASSERT_TRUE(reader.Open(temp_file_name()));
+  EXPECT_TRUE(reader.HasField(MediaInfo::kContentProtectionsFieldNumber));
+  EXPECT_FALSE(reader.HasField(MediaInfo::kAudioInfoFieldNumber));
+
+  MediaInfo media_info;
+  ASSERT_TRUE(reader.ReadFields({MediaInfo::kContentProtectionsFieldNumber,
+                                 MediaInfo::kMediaFileNameFieldNumber,
+                                 MediaInfo::kAudioInfoFieldNumber},
+                                &media_info));
+
+  MediaInfo expected_media_info;
+  *expected_media_info.mutable_content_protections() =
+      media_info_.content_protections();
+  expected_media_info.set_media_file_name(media_info_.media_file_name());
+  EXPECT_THAT(media_info, EqualsProto(expected_media_info));
+
+  // The remaining fields can be read later.
+  ASSERT_TRUE(reader.ReadFields({MediaInfo::kVideoInfoFieldNumber,
+                                 MediaInfo::kInitRangeFieldNumber,
+                                 MediaInfo::kIndexRangeFieldNumber,
+                                 MediaInfo::kReferenceTimeScaleFieldNumber,
+                                 MediaInfo::kContainerTypeFieldNumber,
+                                 MediaInfo::kMediaDurationSecondsFieldNumber,
+                                 MediaInfo::kBandwidthFieldNumber},
+                                &media_info));
+  EXPECT_THAT(media_info, EqualsProto(media_info_));
+}
+
+TEST_F(IndexedMediaInfoTest, CorruptIndex) {
+  std::string serialized;
+  ASSERT_TRUE(SerializeIndexedMediaInfo(media_info_, &serialized));
+  MediaInfo media_info;
+
+  // A number of index entries larger than the file.
+  std::string too_many_entries = serialized;
+  too_many_entries.replace(8, 4, "\xff\xff\xff\xff");
+  EXPECT_FALSE(ParseIndexedMediaInfo(too_many_entries, &media_info));
+  ASSERT_TRUE(
+      File::WriteStringToFile(temp_file_name().c_str(), too_many_entries));
+  IndexedMediaInfoReader reader;
+  EXPECT_FALSE(reader.Open(temp_file_name()));
+
+  // A field beyond the end of the file, i.e. the size of the first entry.
+  std::string field_out_of_range = serialized;
+  field_out_of_range.replace(20, 4, "\x7f\xff\xff\xff");
+  ASSERT_TRUE(
+      File::WriteStringToFile(temp_file_name().c_str(), field_out_of_range));
+  EXPECT_FALSE(reader.Open(temp_file_name()));
+}
+
+// Compares the round-trip time of the human readable and the indexed binary
+// formats on the MediaInfo of a 3-hour title with sizeable PSSH boxes. Run
+// with --gtest_also_run_disabled_tests.
+TEST_F(IndexedMediaInfoTest, DISABLED_TextVsIndexedRoundTripBenchmark) {
+  const int kNumRoundTrips = 1000;
+  const size_t kPsshSize = 4096;
+  for (auto& content_protection : *media_info_.mutable_content_protections())
+    content_protection.set_pssh(std::string(kPsshSize, 'p'));
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumRoundTrips; ++i) {
+    std::string text;
+    ASSERT_TRUE(
+        google::protobuf::TextFormat::PrintToString(media_info_, &text));
+    ASSERT_TRUE(File::WriteStringToFile(temp_file_name().c_str(), text));
+    ASSERT_TRUE(File::ReadFileToString(temp_file_name().c_str(), &text));
+    MediaInfo media_info;
+    ASSERT_TRUE(google::protobuf::TextFormat::ParseFromString(text,
+                                                              &media_info));
+  }
+  const base::TimeDelta text_time = base::TimeTicks::Now() - start;
+
+  start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumRoundTrips; ++i) {
+    std::string serialized;
+    ASSERT_TRUE(SerializeIndexedMediaInfo(media_info_, &serialized));
+    ASSERT_TRUE(File::WriteStringToFile(temp_file_name().c_str(), serialized));
+    ASSERT_TRUE(File::ReadFileToString(temp_file_name().c_str(), &serialized));
+    MediaInfo media_info;
+    ASSERT_TRUE(ParseIndexedMediaInfo(serialized, &media_info));
+  }
+  const base::TimeDelta indexed_time = base::TimeTicks::Now() - start;
+
+  LOG(INFO) << kNumRoundTrips << " round trips: text "
+            << text_time.InMilliseconds() << " ms, indexed binary "
+            << indexed_time.InMilliseconds() << " ms.";
+}
+
+}  // namespace shaka
@@ -0,0 +1,124 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/mpd_aggregator.h"
+
+#include "packager/base/logging.h"
+#include "packager/mpd/base/media_info.pb.h"
+#include "packager/mpd/base/simple_mpd_notifier.h"
+
+namespace shaka {
+
+MpdAggregator::MpdAggregator(const MpdOptions& mpd_options)
+    : mpd_options_(mpd_options) {
+  if (mpd_options_.dash_profile != DashProfile::kUnknown)
+    mpd_notifier_.reset(new SimpleMpdNotifier(mpd_options_));
+}
+
+MpdAggregator::~MpdAggregator() {}
+
+bool MpdAggregator::Init() {
+  // Otherwise, the notifier is initialized when it is created.
+  return !mpd_notifier_ || mpd_notifier_->Init();
+}
+
+void MpdAggregator::AddEventLog(const std::string& file_name) {
+  EventLog event_log;
+  event_log.reader.reset(new MpdEventLogReader(file_name));
+  event_logs_.push_back(std::move(event_log));
+}
+
+bool MpdAggregator::Poll(size_t* num_events) {
+  size_t total_events = 0;
+  for (EventLog& event_log : event_logs_) {
+    std::vector<MpdEvent> events;
+    if (!event_log.reader->ReadNewEvents(&events))
+      return false;
+    for (const MpdEvent& event : events) {
+      if (!ApplyEvent(event, &event_log)) {
+        LOG(ERROR) << "Failed to apply MpdEvent from "
+                   << event_log.reader->file_name() << ": "
+                   << event.ShortDebugString();
+        return false;
+      }
+    }
+    total_events += events.size();
+  }
+  if (num_events)
+    *num_events = total_events;
+  return true;
+}
+
+bool MpdAggregator::Flush() {
+  // Without any container, there is nothing to choose the profile from.
+  if (!mpd_notifier_ && !CreateMpdNotifier(DashProfile::kOnDemand))
+    return false;
+  return mpd_notifier_->Flush();
+}
+
+bool MpdAggregator::ApplyEvent(const MpdEvent& event, EventLog* event_log) {
+  if (event.type() == MpdEvent::NEW_CONTAINER) {
+    if (!mpd_notifier_ &&
+        !CreateMpdNotifier(event.media_info().has_segment_template()
+                               ? DashProfile::kLive
+                               : DashProfile::kOnDemand)) {
+      return false;
+    }
+    uint32_t container_id = 0;
+    if (!mpd_notifier_->NotifyNewContainer(event.media_info(), &container_id))
+      return false;
+    event_log->container_ids[event.container_id()] = container_id;
+    return true;
+  }
+  // The MPD is written out by the aggregator when it sees fit.
+  if (event.type() == MpdEvent::FLUSH)
+    return true;
+
+  auto iter = event_log->container_ids.find(event.container_id());
+  if (iter == event_log->container_ids.end()) {
+    LOG(ERROR) << "Unexpected container_id: " << event.container_id();
+    return false;
+  }
+  const uint32_t container_id = iter->second;
+
+  switch (event.type()) {
+    case MpdEvent::SAMPLE_DURATION:
+      return mpd_notifier_->NotifySampleDuration(container_id,
+                                                 event.sample_duration());
+    case MpdEvent::NEW_SEGMENT:
+      return mpd_notifier_->NotifyNewSegment(container_id, event.start_time(),
+                                             event.duration(), event.size());
+    case MpdEvent::CUE_EVENT:
+      return mpd_notifier_->NotifyCueEvent(container_id, event.timestamp());
+    case MpdEvent::ENCRYPTION_UPDATE:
+      return mpd_notifier_->NotifyEncryptionUpdate(
+          container_id, event.drm_uuid(),
+          std::vector<uint8_t>(event.new_key_id().begin(),
+                               event.new_key_id().end()),
+          std::vector<uint8_t>(event.new_pssh().begin(),
+                               event.new_pssh().end()));
+    case MpdEvent::MEDIA_INFO_UPDATE:
+      return mpd_notifier_->NotifyMediaInfoUpdate(container_id,
+                                                  event.media_info());
+    default:
+      LOG(ERROR) << "Unknown MpdEvent type " << event.type();
+      return false;
+  }
+}
+
+bool MpdAggregator::CreateMpdNotifier(DashProfile dash_profile) {
+  DCHECK(!mpd_notifier_);
+  MpdOptions mpd_options = mpd_options_;
+  mpd_options.dash_profile = dash_profile;
+  mpd_notifier_.reset(new SimpleMpdNotifier(mpd_options));
+  if (!mpd_notifier_->Init()) {
+    LOG(ERROR) << "Failed to initialize MpdNotifier.";
+    return false;
+  }
+  return true;
+}
+
+}  // namespace shaka
@@ -0,0 +1,85 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_MPD_AGGREGATOR_H_
+#define MPD_BASE_MPD_AGGREGATOR_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/mpd/base/mpd_event_log.h"
+#include "packager/mpd/base/mpd_notifier.h"
+#include "packager/mpd/base/mpd_options.h"
+
+namespace shaka {
+
+class MpdEvent;
+
+/// Generates a single MPD from the MpdEvents published by multiple packager
+/// instances through PublishingMpdNotifier. Each packager instance publishes to
+/// its own event log, which is added with AddEventLog(). The aggregator owns
+/// the MPD state, so the packager instances can be scaled horizontally.
+class MpdAggregator {
+ public:
+  /// @param mpd_options is used to generate the MPD. The MPD is written to
+  ///        @b MpdParams.mpd_output. If @b dash_profile is
+  ///        DashProfile::kUnknown, the profile is chosen from the first
+  ///        container: live profile if it has a segment template, on-demand
+  ///        profile otherwise.
+  explicit MpdAggregator(const MpdOptions& mpd_options);
+  ~MpdAggregator();
+
+  /// Initialize the aggregator.
+  /// @return true on success, false otherwise.
+  bool Init();
+
+  /// Add an event log published by a packager instance.
+  /// @param file_name is the event log file name.
+  void AddEventLog(const std::string& file_name);
+
+  /// Read and apply the events appended to the event logs since the last call.
+  /// @param[out] num_events, if not NULL, receives the number of new events.
+  /// @return true on success, false otherwise.
+  bool Poll(size_t* num_events);
+
+  /// Write out the MPD.
+  /// @return true on success, false otherwise.
+  bool Flush();
+
+ private:
+  MpdAggregator(const MpdAggregator&) = delete;
+  MpdAggregator& operator=(const MpdAggregator&) = delete;
+
+  friend class MpdAggregatorTest;
+
+  struct EventLog {
+    std::unique_ptr<MpdEventLogReader> reader;
+    // Maps container IDs in the event log to container IDs in |mpd_notifier_|.
+    std::map<uint32_t, uint32_t> container_ids;
+  };
+
+  bool ApplyEvent(const MpdEvent& event, EventLog* event_log);
+  // Creates and initializes |mpd_notifier_| with |dash_profile|.
+  bool CreateMpdNotifier(DashProfile dash_profile);
+
+  // Testing only method. Sets mpd_notifier_.
+  void SetMpdNotifierForTesting(std::unique_ptr<MpdNotifier> mpd_notifier) {
+    mpd_notifier_ = std::move(mpd_notifier);
+  }
+
+  MpdOptions mpd_options_;
+  // Created on the first container if the DASH profile is not known upfront.
+  std::unique_ptr<MpdNotifier> mpd_notifier_;
+  std::vector<EventLog> event_logs_;
+};
+
+}  // namespace shaka
+
+#endif  // MPD_BASE_MPD_AGGREGATOR_H_
@@ -0,0 +1,207 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include <gmock/gmock.h>
+#include <google/protobuf/util/message_differencer.h>
+#include <gtest/gtest.h>
+
+#include "packager/base/files/file_path.h"
+#include "packager/base/files/file_util.h"
+#include "packager/file/file.h"
+#include "packager/mpd/base/mock_mpd_notifier.h"
+#include "packager/mpd/base/mpd_aggregator.h"
+#include "packager/mpd/base/mpd_options.h"
+#include "packager/mpd/base/publishing_mpd_notifier.h"
+#include "packager/mpd/test/mpd_builder_test_helper.h"
+
+namespace shaka {
+
+using ::testing::_;
+using ::testing::DoAll;
+using ::testing::InSequence;
+using ::testing::Return;
+using ::testing::SetArgPointee;
+
+namespace {
+
+const char kVideoMediaInfo[] =
+    "video_info {\n"
+    "  codec: 'avc1'\n"
+    "  width: 1280\n"
+    "  height: 720\n"
+    "  time_scale: 10\n"
+    "  frame_duration: 10\n"
+    "  pixel_width: 1\n"
+    "  pixel_height: 1\n"
+    "}\n"
+    "container_type: 1\n";
+const char kAudioMediaInfo[] =
+    "audio_info {\n"
+    "  codec: 'mp4a.40.2'\n"
+    "  sampling_frequency: 44100\n"
+    "  time_scale: 1200\n"
+    "  num_channels: 2\n"
+    "}\n"
+    "container_type: 1\n";
+const char kSegmentTemplate[] = "video_$Number$.m4s";
+const char kLiveProfile[] = "urn:mpeg:dash:profile:isoff-live:2011";
+
+MATCHER_P(EqualsProto, message, "") {
+  return ::google::protobuf::util::MessageDifferencer::Equals(arg, message);
+}
+
+}  // namespace
+
+class MpdAggregatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(base::CreateTemporaryFile(&video_event_log_path_));
+    ASSERT_TRUE(base::CreateTemporaryFile(&audio_event_log_path_));
+
+    MpdOptions video_options;
+    video_options.mpd_params.mpd_event_output =
+        video_event_log_path_.AsUTF8Unsafe();
+    video_publisher_.reset(new PublishingMpdNotifier(video_options));
+    ASSERT_TRUE(video_publisher_->Init());
+
+    MpdOptions audio_options;
+    audio_options.mpd_params.mpd_event_output =
+        audio_event_log_path_.AsUTF8Unsafe();
+    audio_publisher_.reset(new PublishingMpdNotifier(audio_options));
+    ASSERT_TRUE(audio_publisher_->Init());
+
+    aggregator_.reset(new MpdAggregator(aggregator_options_));
+    std::unique_ptr<MockMpdNotifier> mock_notifier(
+        new MockMpdNotifier(aggregator_options_));
+    mock_notifier_ = mock_notifier.get();
+    aggregator_->SetMpdNotifierForTesting(std::move(mock_notifier));
+    aggregator_->AddEventLog(video_event_log_path_.AsUTF8Unsafe());
+    aggregator_->AddEventLog(audio_event_log_path_.AsUTF8Unsafe());
+  }
+
+  void TearDown() override {
+    video_publisher_.reset();
+    audio_publisher_.reset();
+    base::DeleteFile(video_event_log_path_, false);
+    base::DeleteFile(audio_event_log_path_, false);
+  }
+
+  base::FilePath video_event_log_path_;
+  base::FilePath audio_event_log_path_;
+  std::unique_ptr<PublishingMpdNotifier> video_publisher_;
+  std::unique_ptr<PublishingMpdNotifier> audio_publisher_;
+  MpdOptions aggregator_options_;
+  std::unique_ptr<MpdAggregator> aggregator_;
+  MockMpdNotifier* mock_notifier_ = nullptr;
+};
+
+TEST_F(MpdAggregatorTest, ContainersFromMultiplePublishers) {
+  const MediaInfo video_media_info = ConvertToMediaInfo(kVideoMediaInfo);
+  const MediaInfo audio_media_info = ConvertToMediaInfo(kAudioMediaInfo);
+
+  uint32_t video_container_id = 100;
+  uint32_t audio_container_id = 100;
+  ASSERT_TRUE(video_publisher_->NotifyNewContainer(video_media_info,
+                                                   &video_container_id));
+  ASSERT_TRUE(audio_publisher_->NotifyNewContainer(audio_media_info,
+                                                   &audio_container_id));
+  // Container IDs are assigned by each publisher independently.
+  EXPECT_EQ(0u, video_container_id);
+  EXPECT_EQ(0u, audio_container_id);
+  ASSERT_TRUE(video_publisher_->NotifyNewSegment(video_container_id, 0, 10, 1));
+  ASSERT_TRUE(audio_publisher_->NotifyNewSegment(audio_container_id, 0, 20, 2));
+  ASSERT_TRUE(video_publisher_->Flush());
+
+  const uint32_t kAggregatedVideoContainerId = 5;
+  const uint32_t kAggregatedAudioContainerId = 6;
+  {
+    InSequence in_sequence;
+    EXPECT_CALL(*mock_notifier_,
+                NotifyNewContainer(EqualsProto(video_media_info), _))
+        .WillOnce(
+            DoAll(SetArgPointee<1>(kAggregatedVideoContainerId), Return(true)));
+    EXPECT_CALL(*mock_notifier_,
+                NotifyNewSegment(kAggregatedVideoContainerId, 0, 10, 1))
+        .WillOnce(Return(true));
+    EXPECT_CALL(*mock_notifier_,
+                NotifyNewContainer(EqualsProto(audio_media_info), _))
+        .WillOnce(
+            DoAll(SetArgPointee<1>(kAggregatedAudioContainerId), Return(true)));
+    EXPECT_CALL(*mock_notifier_,
+                NotifyNewSegment(kAggregatedAudioContainerId, 0, 20, 2))
+        .WillOnce(Return(true));
+  }
+
+  size_t num_events = 0;
+  ASSERT_TRUE(aggregator_->Poll(&num_events));
+  EXPECT_EQ(5u, num_events);
+}
+
+TEST_F(MpdAggregatorTest, PollReturnsOnlyNewEvents) {
+  const MediaInfo video_media_info = ConvertToMediaInfo(kVideoMediaInfo);
+  uint32_t container_id = 0;
+  ASSERT_TRUE(
+      video_publisher_->NotifyNewContainer(video_media_info, &container_id));
+
+  const uint32_t kAggregatedContainerId = 3;
+  EXPECT_CALL(*mock_notifier_, NotifyNewContainer(_, _))
+      .WillOnce(DoAll(SetArgPointee<1>(kAggregatedContainerId), Return(true)));
+  size_t num_events = 0;
+  ASSERT_TRUE(aggregator_->Poll(&num_events));
+  EXPECT_EQ(1u, num_events);
+
+  ASSERT_TRUE(video_publisher_->NotifySampleDuration(container_id, 2));
+  ASSERT_TRUE(video_publisher_->NotifyNewSegment(container_id, 0, 10, 100));
+  ASSERT_TRUE(video_publisher_->NotifyNewSegment(container_id, 10, 10, 200));
+
+  EXPECT_CALL(*mock_notifier_, NotifySampleDuration(kAggregatedContainerId, 2))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_notifier_,
+              NotifyNewSegment(kAggregatedContainerId, 0, 10, 100))
+      .WillOnce(Return(true));
+  EXPECT_CALL(*mock_notifier_,
+              NotifyNewSegment(kAggregatedContainerId, 10, 10, 200))
+      .WillOnce(Return(true));
+  ASSERT_TRUE(aggregator_->Poll(&num_events));
+  EXPECT_EQ(3u, num_events);
+
+  ASSERT_TRUE(aggregator_->Poll(&num_events));
+  EXPECT_EQ(0u, num_events);
+}
+
+TEST_F(MpdAggregatorTest, UnknownContainer) {
+  ASSERT_TRUE(video_publisher_->NotifySampleDuration(1, 2));
+  EXPECT_FALSE(aggregator_->Poll(nullptr));
+}
+
+// Without a DASH profile, the live profile is chosen for streams with segment
+// templates.
+TEST_F(MpdAggregatorTest, ChoosesProfileFromStreams) {
+  base::FilePath mpd_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&mpd_path));
+  MpdOptions mpd_options;
+  mpd_options.dash_profile = DashProfile::kUnknown;
+  mpd_options.mpd_params.mpd_output = mpd_path.AsUTF8Unsafe();
+  MpdAggregator aggregator(mpd_options);
+  ASSERT_TRUE(aggregator.Init());
+  aggregator.AddEventLog(video_event_log_path_.AsUTF8Unsafe());
+
+  MediaInfo video_media_info = ConvertToMediaInfo(kVideoMediaInfo);
+  video_media_info.set_segment_template(kSegmentTemplate);
+  uint32_t container_id = 0;
+  ASSERT_TRUE(
+      video_publisher_->NotifyNewContainer(video_media_info, &container_id));
+  ASSERT_TRUE(video_publisher_->NotifyNewSegment(container_id, 0, 10, 100));
+
+  ASSERT_TRUE(aggregator.Poll(nullptr));
+  ASSERT_TRUE(aggregator.Flush());
+  std::string mpd;
+  ASSERT_TRUE(File::ReadFileToString(mpd_path.AsUTF8Unsafe().c_str(), &mpd));
+  EXPECT_NE(std::string::npos, mpd.find(kLiveProfile)) << mpd;
+  base::DeleteFile(mpd_path, false);
+}
+
+}  // namespace shaka
@@ -190,6 +190,14 @@ xmlDocPtr MpdBuilder::GenerateMpd() {
       return nullptr;
   }
 
+  // ServiceDescription must precede Period elements.
+  if (mpd_options_.mpd_type == MpdType::kDynamic &&
+      mpd_options_.mpd_params.low_latency_dash_mode &&
+      Positive(mpd_options_.mpd_params.target_latency)) {
+    if (!AddServiceDescription(&mpd))
+      return nullptr;
+  }
+
   bool output_period_duration = false;
   if (mpd_options_.mpd_type == MpdType::kStatic) {
     UpdatePeriodDurationAndPresentationTimestamp();
@@ -334,6 +342,22 @@ void MpdBuilder::AddUtcTiming(XmlNode* mpd_node) {
   }
 }
 
+bool MpdBuilder::AddServiceDescription(XmlNode* mpd_node) {
+  DCHECK(mpd_node);
+  DCHECK_EQ(MpdType::kDynamic, mpd_options_.mpd_type);
+
+  // DASH-IF IOP Low-Latency Modes: Latency@target is in milliseconds.
+  XmlNode latency("Latency");
+  latency.SetIntegerAttribute(
+      "target", static_cast<uint64_t>(
+                    mpd_options_.mpd_params.target_latency * 1000 + 0.5));
+
+  XmlNode service_description("ServiceDescription");
+  service_description.SetId(0);
+  return service_description.AddChild(latency.PassScopedPtr()) &&
+         mpd_node->AddChild(service_description.PassScopedPtr());
+}
+
 float MpdBuilder::GetStaticMpdDuration() {
   DCHECK_EQ(MpdType::kStatic, mpd_options_.mpd_type);
 
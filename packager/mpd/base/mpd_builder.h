@@ -102,6 +102,9 @@ class MpdBuilder {
   // Add UTCTiming element if utc timing is provided.
   void AddUtcTiming(xml::XmlNode* mpd_node);
 
+  // Add ServiceDescription element with latency targets for low latency DASH.
+  bool AddServiceDescription(xml::XmlNode* mpd_node);
+
   float GetStaticMpdDuration();
 
   // Set MPD attributes for dynamic profile MPD. Uses non-zero |mpd_options_| as
@@ -293,6 +293,34 @@ TEST_F(LiveMpdBuilderTest, DynamicCheckMpdAttributes) {
   ASSERT_EQ(kExpectedOutput, mpd_doc);
 }
 
+TEST_F(LiveMpdBuilderTest, LowLatencyServiceDescription) {
+  static const char kExpectedOutput[] =
+      "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      "<!--Generated with https://github.com/google/shaka-packager"
+      " version <tag>-<hash>-<test>-->\n"
+      "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\""
+      " xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\""
+      " xsi:schemaLocation=\"urn:mpeg:dash:schema:mpd:2011 DASH-MPD.xsd\""
+      " profiles=\"urn:mpeg:dash:profile:isoff-live:2011\""
+      " minBufferTime=\"PT2S\""
+      " type=\"dynamic\""
+      " publishTime=\"2016-01-11T15:10:24Z\""
+      " availabilityStartTime=\"2011-12-25T12:30:00\""
+      " minimumUpdatePeriod=\"PT2S\">\n"
+      "  <ServiceDescription id=\"0\">\n"
+      "    <Latency target=\"3500\"/>\n"
+      "  </ServiceDescription>\n"
+      "</MPD>\n";
+
+  std::string mpd_doc;
+  mutable_mpd_options()->mpd_type = MpdType::kDynamic;
+  mutable_mpd_options()->mpd_params.minimum_update_period = 2;
+  mutable_mpd_options()->mpd_params.low_latency_dash_mode = true;
+  mutable_mpd_options()->mpd_params.target_latency = 3.5;
+  ASSERT_TRUE(mpd_.ToString(&mpd_doc));
+  ASSERT_EQ(kExpectedOutput, mpd_doc);
+}
+
 TEST_F(LiveMpdBuilderTest, StaticCheckMpdAttributes) {
   static const char kExpectedOutput[] =
       "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
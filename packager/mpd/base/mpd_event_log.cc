@@ -0,0 +1,120 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/mpd_event_log.h"
+
+#include <string.h>
+
+#include "packager/base/logging.h"
+#include "packager/base/sys_byteorder.h"
+#include "packager/mpd/base/media_info.pb.h"
+
+namespace shaka {
+
+namespace {
+const size_t kEventSizeFieldSize = sizeof(uint32_t);
+const size_t kReadBufferSize = 64 * 1024;
+}  // namespace
+
+MpdEventLogWriter::MpdEventLogWriter() {}
+
+MpdEventLogWriter::~MpdEventLogWriter() {}
+
+bool MpdEventLogWriter::Open(const std::string& file_name) {
+  DCHECK(!file_);
+  file_.reset(File::Open(file_name.c_str(), "w"));
+  if (!file_) {
+    LOG(ERROR) << "Failed to open MPD event log " << file_name;
+    return false;
+  }
+  return true;
+}
+
+bool MpdEventLogWriter::Write(const MpdEvent& event) {
+  DCHECK(file_);
+  std::string record;
+  if (!event.SerializeToString(&record)) {
+    LOG(ERROR) << "Failed to serialize MpdEvent.";
+    return false;
+  }
+  const uint32_t size = base::HostToNet32(static_cast<uint32_t>(record.size()));
+  record.insert(0, reinterpret_cast<const char*>(&size), sizeof(size));
+
+  const char* data = record.data();
+  size_t remaining_size = record.size();
+  while (remaining_size > 0) {
+    const int64_t size_written = file_->Write(data, remaining_size);
+    if (size_written <= 0) {
+      LOG(ERROR) << "Failed to write to MPD event log " << file_->file_name();
+      return false;
+    }
+    remaining_size -= size_written;
+    data += size_written;
+  }
+  // Make the event visible to the readers.
+  return file_->Flush();
+}
+
+bool MpdEventLogWriter::Close() {
+  if (!file_)
+    return true;
+  return file_.release()->Close();
+}
+
+MpdEventLogReader::MpdEventLogReader(const std::string& file_name)
+    : file_name_(file_name) {}
+
+MpdEventLogReader::~MpdEventLogReader() {}
+
+bool MpdEventLogReader::ReadNewEvents(std::vector<MpdEvent>* events) {
+  DCHECK(events);
+
+  std::unique_ptr<File, FileCloser> file(File::Open(file_name_.c_str(), "r"));
+  if (!file) {
+    VLOG(1) << "MPD event log " << file_name_ << " is not available yet.";
+    return true;
+  }
+  if (position_ > 0 && !file->Seek(position_)) {
+    LOG(ERROR) << "Failed to seek to " << position_ << " in " << file_name_;
+    return false;
+  }
+
+  std::string data;
+  std::vector<char> buffer(kReadBufferSize);
+  while (true) {
+    const int64_t size_read = file->Read(buffer.data(), buffer.size());
+    if (size_read < 0) {
+      LOG(ERROR) << "Failed to read MPD event log " << file_name_;
+      return false;
+    }
+    if (size_read == 0)
+      break;
+    data.append(buffer.data(), size_read);
+  }
+
+  size_t offset = 0;
+  while (data.size() - offset >= kEventSizeFieldSize) {
+    uint32_t event_size = 0;
+    memcpy(&event_size, data.data() + offset, kEventSizeFieldSize);
+    event_size = base::NetToHost32(event_size);
+    if (data.size() - offset - kEventSizeFieldSize < event_size)
+      break;
+
+    MpdEvent event;
+    if (!event.ParseFromArray(data.data() + offset + kEventSizeFieldSize,
+                              event_size)) {
+      LOG(ERROR) << "Failed to parse MpdEvent at position "
+                 << position_ + offset << " in " << file_name_;
+      return false;
+    }
+    events->push_back(event);
+    offset += kEventSizeFieldSize + event_size;
+  }
+  position_ += offset;
+  return true;
+}
+
+}  // namespace shaka
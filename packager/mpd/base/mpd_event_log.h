@@ -0,0 +1,80 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_MPD_EVENT_LOG_H_
+#define MPD_BASE_MPD_EVENT_LOG_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "packager/file/file.h"
+#include "packager/file/file_closer.h"
+
+namespace shaka {
+
+class MpdEvent;
+
+/// Appends MpdEvents to an event log file. Each event is stored as a 32-bit
+/// big-endian size followed by the serialized MpdEvent, so the log can be read
+/// by MpdEventLogReader while it is still being written, possibly by another
+/// process.
+class MpdEventLogWriter {
+ public:
+  MpdEventLogWriter();
+  ~MpdEventLogWriter();
+
+  /// Open the event log for writing. Existing content is discarded.
+  /// @param file_name is the event log file name.
+  /// @return true on success, false otherwise.
+  bool Open(const std::string& file_name);
+
+  /// Append @a event to the event log and flush it.
+  /// @return true on success, false otherwise.
+  bool Write(const MpdEvent& event);
+
+  /// Close the event log.
+  /// @return true on success, false otherwise.
+  bool Close();
+
+ private:
+  MpdEventLogWriter(const MpdEventLogWriter&) = delete;
+  MpdEventLogWriter& operator=(const MpdEventLogWriter&) = delete;
+
+  std::unique_ptr<File, FileCloser> file_;
+};
+
+/// Reads MpdEvents written by MpdEventLogWriter. The reader remembers its
+/// position so that only the newly appended events are returned on each call.
+class MpdEventLogReader {
+ public:
+  /// @param file_name is the event log file name.
+  explicit MpdEventLogReader(const std::string& file_name);
+  ~MpdEventLogReader();
+
+  /// Read the events appended since the last call. A partially written event
+  /// at the end of the log is left for the next call.
+  /// @param[out] events receives the new events. Should not be NULL.
+  /// @return true on success, false otherwise. Note that it is not an error if
+  ///         the event log does not exist yet.
+  bool ReadNewEvents(std::vector<MpdEvent>* events);
+
+  const std::string& file_name() const { return file_name_; }
+
+ private:
+  MpdEventLogReader(const MpdEventLogReader&) = delete;
+  MpdEventLogReader& operator=(const MpdEventLogReader&) = delete;
+
+  const std::string file_name_;
+  // Position of the first event not read yet.
+  uint64_t position_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // MPD_BASE_MPD_EVENT_LOG_H_
@@ -0,0 +1,123 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#include "packager/mpd/base/publishing_mpd_notifier.h"
+
+#include "packager/base/logging.h"
+#include "packager/mpd/base/media_info.pb.h"
+
+namespace shaka {
+
+PublishingMpdNotifier::PublishingMpdNotifier(const MpdOptions& mpd_options)
+    : MpdNotifier(mpd_options),
+      output_path_(mpd_options.mpd_params.mpd_event_output) {}
+
+PublishingMpdNotifier::~PublishingMpdNotifier() {
+  if (!event_log_writer_.Close())
+    LOG(WARNING) << "Failed to close MPD event log " << output_path_;
+}
+
+bool PublishingMpdNotifier::Init() {
+  return event_log_writer_.Open(output_path_);
+}
+
+bool PublishingMpdNotifier::NotifyNewContainer(const MediaInfo& media_info,
+                                               uint32_t* container_id) {
+  DCHECK(container_id);
+
+  base::AutoLock auto_lock(lock_);
+  MpdEvent event;
+  event.set_type(MpdEvent::NEW_CONTAINER);
+  event.set_container_id(next_container_id_);
+  *event.mutable_media_info() = media_info;
+  if (!Publish(event))
+    return false;
+  *container_id = next_container_id_++;
+  return true;
+}
+
+bool PublishingMpdNotifier::NotifySampleDuration(uint32_t container_id,
+                                                 uint32_t sample_duration) {
+  MpdEvent event;
+  event.set_type(MpdEvent::SAMPLE_DURATION);
+  event.set_container_id(container_id);
+  event.set_sample_duration(sample_duration);
+
+  base::AutoLock auto_lock(lock_);
+  return Publish(event);
+}
+
+bool PublishingMpdNotifier::NotifyNewSegment(uint32_t container_id,
+                                             uint64_t start_time,
+                                             uint64_t duration,
+                                             uint64_t size) {
+  MpdEvent event;
+  event.set_type(MpdEvent::NEW_SEGMENT);
+  event.set_container_id(container_id);
+  event.set_start_time(start_time);
+  event.set_duration(duration);
+  event.set_size(size);
+
+  base::AutoLock auto_lock(lock_);
+  return Publish(event);
+}
+
+bool PublishingMpdNotifier::NotifyCueEvent(uint32_t container_id,
+                                           uint64_t timestamp) {
+  MpdEvent event;
+  event.set_type(MpdEvent::CUE_EVENT);
+  event.set_container_id(container_id);
+  event.set_timestamp(timestamp);
+
+  base::AutoLock auto_lock(lock_);
+  return Publish(event);
+}
+
+bool PublishingMpdNotifier::NotifyEncryptionUpdate(
+    uint32_t container_id,
+    const std::string& drm_uuid,
+    const std::vector<uint8_t>& new_key_id,
+    const std::vector<uint8_t>& new_pssh) {
+  MpdEvent event;
+  event.set_type(MpdEvent::ENCRYPTION_UPDATE);
+  event.set_container_id(container_id);
+  event.set_drm_uuid(drm_uuid);
+  event.set_new_key_id(new_key_id.data(), new_key_id.size());
+  event.set_new_pssh(new_pssh.data(), new_pssh.size());
+
+  base::AutoLock auto_lock(lock_);
+  return Publish(event);
+}
+
+bool PublishingMpdNotifier::NotifyMediaInfoUpdate(uint32_t container_id,
+                                                  const MediaInfo& media_info) {
+  MpdEvent event;
+  event.set_type(MpdEvent::MEDIA_INFO_UPDATE);
+  event.set_container_id(container_id);
+  *event.mutable_media_info() = media_info;
+
+  base::AutoLock auto_lock(lock_);
+  return Publish(event);
+}
+
+bool PublishingMpdNotifier::Flush() {
+  MpdEvent event;
+  event.set_type(MpdEvent::FLUSH);
+
+  base::AutoLock auto_lock(lock_);
+  return Publish(event);
+}
+
+bool PublishingMpdNotifier::Publish(const MpdEvent& event) {
+  lock_.AssertAcquired();
+  if (!event_log_writer_.Write(event)) {
+    LOG(ERROR) << "Failed to publish MpdEvent to " << output_path_;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace shaka
@@ -0,0 +1,67 @@
+// Copyright 2020 Google Inc. All rights reserved.
+//
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file or at
+// https://developers.google.com/open-source/licenses/bsd
+
+#ifndef MPD_BASE_PUBLISHING_MPD_NOTIFIER_H_
+#define MPD_BASE_PUBLISHING_MPD_NOTIFIER_H_
+
+#include <string>
+#include <vector>
+
+#include "packager/base/synchronization/lock.h"
+#include "packager/mpd/base/mpd_event_log.h"
+#include "packager/mpd/base/mpd_notifier.h"
+
+namespace shaka {
+
+class MpdEvent;
+
+/// An MpdNotifier implementation which does not generate the MPD itself, but
+/// publishes the notifications as MpdEvents to the event log specified by
+/// @b MpdParams.mpd_event_output. This allows the streams of one presentation
+/// to be packaged by multiple packager instances, possibly on different hosts,
+/// with a single MpdAggregator generating the MPD.
+class PublishingMpdNotifier : public MpdNotifier {
+ public:
+  explicit PublishingMpdNotifier(const MpdOptions& mpd_options);
+  ~PublishingMpdNotifier() override;
+
+  /// @name MpdNotifier implemetation overrides.
+  /// @{
+  bool Init() override;
+  bool NotifyNewContainer(const MediaInfo& media_info, uint32_t* id) override;
+  bool NotifySampleDuration(uint32_t container_id,
+                            uint32_t sample_duration) override;
+  bool NotifyNewSegment(uint32_t container_id,
+                        uint64_t start_time,
+                        uint64_t duration,
+                        uint64_t size) override;
+  bool NotifyCueEvent(uint32_t container_id, uint64_t timestamp) override;
+  bool NotifyEncryptionUpdate(uint32_t container_id,
+                              const std::string& drm_uuid,
+                              const std::vector<uint8_t>& new_key_id,
+                              const std::vector<uint8_t>& new_pssh) override;
+  bool NotifyMediaInfoUpdate(uint32_t container_id,
+                             const MediaInfo& media_info) override;
+  bool Flush() override;
+  /// @}
+
+ private:
+  PublishingMpdNotifier(const PublishingMpdNotifier&) = delete;
+  PublishingMpdNotifier& operator=(const PublishingMpdNotifier&) = delete;
+
+  bool Publish(const MpdEvent& event);
+
+  // MPD event log path.
+  std::string output_path_;
+  MpdEventLogWriter event_log_writer_;
+  base::Lock lock_;
+
+  uint32_t next_container_id_ = 0;
+};
+
+}  // namespace shaka
+
+#endif  // MPD_BASE_PUBLISHING_MPD_NOTIFIER_H_
@@ -153,6 +153,17 @@ bool Representation::Init() {
     return false;
 
   codecs_ = GetCodecs(media_info_);
+
+  // In low latency mode, a segment can be requested as soon as its first chunk
+  // is available.
+  if (mpd_options_.mpd_type == MpdType::kDynamic &&
+      mpd_options_.mpd_params.low_latency_dash_mode) {
+    const double availability_time_offset =
+        mpd_options_.mpd_params.target_segment_duration -
+        mpd_options_.mpd_params.target_chunk_duration;
+    if (availability_time_offset > 0)
+      media_info_.set_availability_time_offset(availability_time_offset);
+  }
   return true;
 }
 
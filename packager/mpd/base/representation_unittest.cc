@@ -560,6 +560,36 @@ TEST_F(SegmentTemplateTest, PresentationTimeOffset) {
   EXPECT_THAT(representation_->GetXml().get(), XmlNodeEqual(kExpectedXml));
 }
 
+TEST_F(SegmentTemplateTest, LowLatencyAvailabilityTimeOffset) {
+  mpd_options_.mpd_params.low_latency_dash_mode = true;
+  mpd_options_.mpd_params.target_segment_duration = 2;
+  mpd_options_.mpd_params.target_chunk_duration = 0.5;
+  representation_ =
+      CreateRepresentation(ConvertToMediaInfo(GetDefaultMediaInfo()),
+                           kAnyRepresentationId, NoListener());
+  ASSERT_TRUE(representation_->Init());
+
+  const int64_t kStartTime = 0;
+  const int64_t kDuration = 10;
+  const uint64_t kSize = 128;
+  AddSegments(kStartTime, kDuration, kSize, 0);
+
+  const char kExpectedXml[] =
+      "<Representation id=\"1\" bandwidth=\"102400\" "
+      " codecs=\"avc1.010101\" mimeType=\"video/mp4\" sar=\"1:1\" "
+      " width=\"720\" height=\"480\" frameRate=\"10/5\">\n"
+      "  <SegmentTemplate timescale=\"1000\" initialization=\"init.mp4\" "
+      "   media=\"$Time$.mp4\" startNumber=\"1\" "
+      "   availabilityTimeOffset=\"1.5\" "
+      "   availabilityTimeComplete=\"false\">\n"
+      "    <SegmentTimeline>\n"
+      "      <S t=\"0\" d=\"10\"/>\n"
+      "     </SegmentTimeline>\n"
+      "  </SegmentTemplate>\n"
+      "</Representation>\n";
+  EXPECT_THAT(representation_->GetXml().get(), XmlNodeEqual(kExpectedXml));
+}
+
 TEST_F(SegmentTemplateTest, GetStartAndEndTimestamps) {
   double start_timestamp;
   double end_timestamp;
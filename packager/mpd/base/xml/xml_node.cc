@@ -429,6 +429,12 @@ bool RepresentationXmlNode::AddLiveOnlyInfo(
     segment_template.SetIntegerAttribute("startNumber", start_number);
   }
 
+  if (media_info.has_availability_time_offset()) {
+    segment_template.SetFloatingPointAttribute(
+        "availabilityTimeOffset", media_info.availability_time_offset());
+    segment_template.SetStringAttribute("availabilityTimeComplete", "false");
+  }
+
   if (!segment_infos.empty()) {
     // Don't use SegmentTimeline if all segments except the last one are of
     // the same duration.
@@ -36,6 +36,25 @@
         '../base/base.gyp:base',
       ],
     },
+    {
+      # Used by the muxer listeners to write MediaInfo files and by mpd_util to
+      # read them, so it does not depend on mpd_builder.
+      'target_name': 'indexed_media_info',
+      'type': 'static_library',
+      'sources': [
+        'base/indexed_media_info.cc',
+        'base/indexed_media_info.h',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../file/file.gyp:file',
+        '../media/base/media_base.gyp:media_base',
+        'media_info_proto',
+      ],
+      'export_dependent_settings': [
+        'media_info_proto',
+      ],
+    },
     {
       'target_name': 'mpd_builder',
       'type': 'static_library',
@@ -44,8 +63,12 @@
         'base/adaptation_set.h',
         'base/content_protection_element.cc',
         'base/content_protection_element.h',
+        'base/mpd_aggregator.cc',
+        'base/mpd_aggregator.h',
         'base/mpd_builder.cc',
         'base/mpd_builder.h',
+        'base/mpd_event_log.cc',
+        'base/mpd_event_log.h',
         'base/mpd_notifier_util.cc',
         'base/mpd_notifier_util.h',
         'base/mpd_notifier.h',
@@ -54,6 +77,8 @@
         'base/mpd_utils.h',
         'base/period.cc',
         'base/period.h',
+        'base/publishing_mpd_notifier.cc',
+        'base/publishing_mpd_notifier.h',
         'base/representation.cc',
         'base/representation.h',
         'base/segment_info.h',
@@ -99,6 +124,8 @@
       'sources': [
         'base/adaptation_set_unittest.cc',
         'base/bandwidth_estimator_unittest.cc',
+        'base/indexed_media_info_unittest.cc',
+        'base/mpd_aggregator_unittest.cc',
         'base/mpd_builder_unittest.cc',
         'base/mpd_utils_unittest.cc',
         'base/period_unittest.cc',
@@ -118,6 +145,7 @@
         '../testing/gmock.gyp:gmock',
         '../testing/gtest.gyp:gtest',
         '../third_party/gflags/gflags.gyp:gflags',
+        'indexed_media_info',
         'mpd_builder',
         'mpd_mocks',
         'mpd_util',
@@ -133,6 +161,7 @@
       'dependencies': [
         '../file/file.gyp:file',
         '../third_party/gflags/gflags.gyp:gflags',
+        'indexed_media_info',
         'mpd_builder',
         'mpd_mocks',
       ],
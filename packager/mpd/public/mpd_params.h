@@ -16,6 +16,12 @@ namespace shaka {
 struct MpdParams {
   /// MPD output file path.
   std::string mpd_output;
+  /// MPD event log output file path. If specified, the MPD is not generated by
+  /// this packager instance; instead MediaInfo and segment events are
+  /// published to this file, so that a single MpdAggregator can generate the
+  /// MPD for streams packaged by multiple packager instances. Cannot be used
+  /// with @a mpd_output.
+  std::string mpd_event_output;
   /// BaseURLs for the MPD. The values will be added as <BaseURL> element(s)
   /// under the <MPD> element.
   std::vector<std::string> base_urls;
@@ -83,6 +89,20 @@ struct MpdParams {
   /// If enabled, allow switching between different codecs, if they have the
   /// same language, media type (audio, video etc) and container type.
   bool allow_codec_switching = false;
+  /// For dynamic MPD only. Enables low latency DASH (LL-DASH) signalling:
+  /// SegmentTemplate@availabilityTimeOffset and
+  /// SegmentTemplate@availabilityTimeComplete=false are generated so players
+  /// can fetch segments while they are still being produced. The media needs
+  /// to be generated with Mp4OutputParams::low_latency_dash_mode.
+  bool low_latency_dash_mode = false;
+  /// For low latency DASH only. Target latency in seconds, which is advertised
+  /// in the ServiceDescription element. Not advertised if the value is 0.
+  double target_latency = 0;
+  /// This is the target chunk (subsegment) duration requested by the user.
+  /// It is used to compute availabilityTimeOffset in low latency DASH mode.
+  /// It will be populated from subsegment duration specified in ChunkingParams
+  /// if not specified.
+  double target_chunk_duration = 0;
 };
 
 }  // namespace shaka
@@ -7,12 +7,17 @@
 #include "packager/mpd/util/mpd_writer.h"
 
 #include <gflags/gflags.h>
+#include <google/protobuf/io/tokenizer.h>
 #include <google/protobuf/text_format.h>
 #include <stdint.h>
 
 #include "packager/base/files/file_path.h"
 #include "packager/base/files/file_util.h"
+#include "packager/base/strings/string_util.h"
+#include "packager/base/strings/stringprintf.h"
 #include "packager/file/file.h"
+#include "packager/mpd/base/indexed_media_info.h"
+#include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_builder.h"
 #include "packager/mpd/base/mpd_notifier.h"
 #include "packager/mpd/base/mpd_utils.h"
@@ -38,29 +43,98 @@ class SimpleMpdNotifierFactory : public MpdNotifierFactory {
   }
 };
 
+// Keeps the errors from parsing MediaInfo as text, so that they are only
+// logged if the content turns out not to be binary MediaInfo either.
+class TextFormatErrorCollector : public ::google::protobuf::io::ErrorCollector {
+ public:
+  void AddError(int line, int column, const std::string& message) override {
+    // |line| and |column| are zero-based.
+    errors_.push_back(base::StringPrintf("%d:%d: %s", line + 1, column + 1,
+                                         message.c_str()));
+  }
+
+  void AddWarning(int line, int column, const std::string& message) override {
+    LOG(WARNING) << "MediaInfo text format " << line + 1 << ":" << column + 1
+                 << ": " << message;
+  }
+
+  const std::vector<std::string>& errors() const { return errors_; }
+
+ private:
+  std::vector<std::string> errors_;
+};
+
+// Returns the numbers of the MediaInfo fields used in the MPD, i.e. all of them
+// but the HLS specific ones.
+const std::vector<int>& GetMpdFieldNumbers() {
+  static const std::vector<int>* const field_numbers = [] {
+    std::vector<int>* numbers = new std::vector<int>;
+    const ::google::protobuf::Descriptor* descriptor = MediaInfo::descriptor();
+    for (int i = 0; i < descriptor->field_count(); ++i) {
+      const ::google::protobuf::FieldDescriptor* field = descriptor->field(i);
+      if (!base::StartsWith(field->name(), "hls_",
+                            base::CompareCase::SENSITIVE)) {
+        numbers->push_back(field->number());
+      }
+    }
+    return numbers;
+  }();
+  return *field_numbers;
+}
+
+// Parses |content| as text format MediaInfo, or binary MediaInfo if it is not
+// in text format. The text format parse errors are logged if both fail.
+bool ParseMediaInfo(const std::string& content, MediaInfo* media_info) {
+  TextFormatErrorCollector error_collector;
+  ::google::protobuf::TextFormat::Parser parser;
+  parser.RecordErrorsTo(&error_collector);
+  if (parser.ParseFromString(content, media_info))
+    return true;
+  if (media_info->ParseFromString(content))
+    return true;
+  for (const std::string& error : error_collector.errors())
+    LOG(ERROR) << "Failed to parse MediaInfo text format: " << error;
+  return false;
+}
+
 }  // namespace
 
 MpdWriter::MpdWriter() : notifier_factory_(new SimpleMpdNotifierFactory()) {}
 MpdWriter::~MpdWriter() {}
 
 bool MpdWriter::AddFile(const std::string& media_info_path) {
-  std::string file_content;
-  if (!File::ReadFileToString(media_info_path.c_str(), &file_content)) {
+  // Only the fields used in the MPD are read from indexed MediaInfo files.
+  IndexedMediaInfoReader indexed_reader;
+  if (indexed_reader.Open(media_info_path)) {
+    media_infos_.emplace_back();
+    if (!indexed_reader.ReadFields(GetMpdFieldNumbers(),
+                                   &media_infos_.back())) {
+      LOG(ERROR) << "Failed to read MediaInfo from " << media_info_path;
+      media_infos_.pop_back();
+      return false;
+    }
+    return true;
+  }
+
+  file_content_.clear();
+  if (!File::ReadFileToString(media_info_path.c_str(), &file_content_)) {
     LOG(ERROR) << "Failed to read " << media_info_path << " to string.";
     return false;
   }
 
-  MediaInfo media_info;
-  if (!::google::protobuf::TextFormat::ParseFromString(file_content,
-                                                       &media_info)) {
-    LOG(ERROR) << "Failed to parse " << file_content << " to MediaInfo.";
+  media_infos_.emplace_back();
+  if (!ParseMediaInfo(file_content_, &media_infos_.back())) {
+    LOG(ERROR) << "Failed to parse " << media_info_path << " to MediaInfo.";
+    media_infos_.pop_back();
     return false;
   }
-
-  media_infos_.push_back(media_info);
   return true;
 }
 
+void MpdWriter::Reset() {
+  media_infos_.clear();
+}
+
 void MpdWriter::AddBaseUrl(const std::string& base_url) {
   base_urls_.push_back(base_url);
 }
@@ -53,10 +53,16 @@ class MpdWriter {
   // Add |media_info_path| for MPD generation.
   // The content of |media_info_path| should be a string representation of
   // MediaInfo, i.e. the content should be a result of using
-  // google::protobuf::TestFormat::Print*() methods.
+  // google::protobuf::TestFormat::Print*() methods, a binary serialized
+  // MediaInfo, or an indexed MediaInfo file. Only the fields used for the MPD
+  // are read from an indexed MediaInfo file.
   // If necessary, this method can be called after WriteMpd*() methods.
   bool AddFile(const std::string& media_info_path);
 
+  // Remove the MediaInfos added so far, so that the MpdWriter can be reused to
+  // generate another MPD. Base URLs are kept. Buffers are reused across MPDs.
+  void Reset();
+
   // |base_url| will be used for <BaseURL> element for the MPD. The BaseURL
   // element will be a direct child element of the <MPD> element.
   void AddBaseUrl(const std::string& base_url);
@@ -78,6 +84,8 @@ class MpdWriter {
 
   std::list<MediaInfo> media_infos_;
   std::vector<std::string> base_urls_;
+  // Buffer for the content of MediaInfo files, reused across AddFile() calls.
+  std::string file_content_;
 
   std::unique_ptr<MpdNotifierFactory> notifier_factory_;
 
@@ -9,6 +9,8 @@
 
 #include "packager/base/files/file_util.h"
 #include "packager/base/path_service.h"
+#include "packager/file/file.h"
+#include "packager/mpd/base/indexed_media_info.h"
 #include "packager/mpd/base/mock_mpd_notifier.h"
 #include "packager/mpd/base/mpd_options.h"
 #include "packager/mpd/test/mpd_builder_test_helper.h"
@@ -67,6 +69,10 @@ class MpdWriterTest : public ::testing::Test {
     mpd_writer_.SetMpdNotifierFactoryForTest(std::move(notifier_factory_));
   }
 
+  const std::list<MediaInfo>& media_infos() const {
+    return mpd_writer_.media_infos_;
+  }
+
   std::unique_ptr<TestMpdNotifierFactory> notifier_factory_;
   MpdWriter mpd_writer_;
 };
@@ -98,4 +104,74 @@ TEST_F(MpdWriterTest, WriteMpdToFile) {
   EXPECT_TRUE(mpd_writer_.WriteMpdToFile(mpd_file_path.AsUTF8Unsafe().c_str()));
 }
 
+// Verify that binary serialized MediaInfo files are accepted, and that
+// MpdWriter can be reused after Reset().
+TEST_F(MpdWriterTest, BinaryMediaInfoAndReset) {
+  std::string text_media_info;
+  ASSERT_TRUE(File::ReadFileToString(
+      GetTestDataFilePath(kFileNameVideoMediaInfo1).AsUTF8Unsafe().c_str(),
+      &text_media_info));
+  const MediaInfo media_info = ConvertToMediaInfo(text_media_info);
+  std::string binary_media_info;
+  ASSERT_TRUE(media_info.SerializeToString(&binary_media_info));
+
+  base::FilePath binary_media_info_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&binary_media_info_path));
+  ASSERT_TRUE(File::WriteStringToFile(
+      binary_media_info_path.AsUTF8Unsafe().c_str(), binary_media_info));
+
+  SetMpdNotifierFactoryForTest();
+  // Added before Reset(), so it is not expected to be notified.
+  EXPECT_TRUE(mpd_writer_.AddFile(binary_media_info_path.AsUTF8Unsafe()));
+  mpd_writer_.Reset();
+  EXPECT_TRUE(mpd_writer_.AddFile(binary_media_info_path.AsUTF8Unsafe()));
+  EXPECT_TRUE(mpd_writer_.AddFile(
+      GetTestDataFilePath(kFileNameVideoMediaInfo2).AsUTF8Unsafe()));
+
+  base::FilePath mpd_file_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&mpd_file_path));
+  EXPECT_TRUE(mpd_writer_.WriteMpdToFile(mpd_file_path.AsUTF8Unsafe().c_str()));
+}
+
+// Verify that indexed MediaInfo files are accepted and that the HLS only
+// fields are not read from them.
+TEST_F(MpdWriterTest, IndexedMediaInfo) {
+  std::string text_media_info;
+  ASSERT_TRUE(File::ReadFileToString(
+      GetTestDataFilePath(kFileNameVideoMediaInfo1).AsUTF8Unsafe().c_str(),
+      &text_media_info));
+  MediaInfo media_info = ConvertToMediaInfo(text_media_info);
+  media_info.add_hls_characteristics("public.accessibility.describes-video");
+  std::string indexed_media_info;
+  ASSERT_TRUE(SerializeIndexedMediaInfo(media_info, &indexed_media_info));
+
+  base::FilePath indexed_media_info_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&indexed_media_info_path));
+  ASSERT_TRUE(File::WriteStringToFile(
+      indexed_media_info_path.AsUTF8Unsafe().c_str(), indexed_media_info));
+
+  SetMpdNotifierFactoryForTest();
+  ASSERT_TRUE(mpd_writer_.AddFile(indexed_media_info_path.AsUTF8Unsafe()));
+  ASSERT_EQ(1u, media_infos().size());
+  const MediaInfo& read_media_info = media_infos().back();
+  EXPECT_EQ(0, read_media_info.hls_characteristics_size());
+  EXPECT_EQ(media_info.video_info().width(),
+            read_media_info.video_info().width());
+  EXPECT_EQ(media_info.media_file_name(), read_media_info.media_file_name());
+
+  base::FilePath mpd_file_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&mpd_file_path));
+  EXPECT_TRUE(mpd_writer_.WriteMpdToFile(mpd_file_path.AsUTF8Unsafe().c_str()));
+}
+
+// Verify that a file that is neither text format nor binary MediaInfo is
+// rejected.
+TEST_F(MpdWriterTest, InvalidMediaInfo) {
+  base::FilePath media_info_path;
+  ASSERT_TRUE(base::CreateTemporaryFile(&media_info_path));
+  ASSERT_TRUE(File::WriteStringToFile(
+      media_info_path.AsUTF8Unsafe().c_str(), "invalid_field: 1"));
+  EXPECT_FALSE(mpd_writer_.AddFile(media_info_path.AsUTF8Unsafe()));
+}
+
 }  // namespace shaka
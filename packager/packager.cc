@@ -6,7 +6,11 @@
 
 #include "packager/packager.h"
 
+#include <string.h>
+
 #include <algorithm>
+#include <map>
+#include <set>
 
 #include "packager/app/job_manager.h"
 #include "packager/app/libcrypto_threading.h"
@@ -23,6 +27,7 @@
 #include "packager/base/threading/simple_thread.h"
 #include "packager/base/time/clock.h"
 #include "packager/file/file.h"
+#include "packager/file/ram_store.h"
 #include "packager/hls/base/hls_notifier.h"
 #include "packager/hls/base/simple_hls_notifier.h"
 #include "packager/media/base/container_names.h"
@@ -48,6 +53,7 @@
 #include "packager/media/trick_play/trick_play_handler.h"
 #include "packager/mpd/base/media_info.pb.h"
 #include "packager/mpd/base/mpd_builder.h"
+#include "packager/mpd/base/publishing_mpd_notifier.h"
 #include "packager/mpd/base/simple_mpd_notifier.h"
 #include "packager/status_macros.h"
 #include "packager/version/version.h"
@@ -75,6 +81,8 @@ MuxerOptions CreateMuxerOptions(const StreamDescriptor& stream,
   options.mp4_params = params.mp4_output_params;
   options.transport_stream_timestamp_offset_ms =
       params.transport_stream_timestamp_offset_ms;
+  options.webm_reserve_cues_space = params.webm_reserve_cues_space;
+  options.segment_writer_params = params.segment_writer_params;
   options.temp_dir = params.temp_dir;
   options.bandwidth = stream.bandwidth;
   options.output_file_name = stream.output;
@@ -214,17 +222,11 @@ Status ValidateStreamDescriptor(bool dump_stream_info,
     return Status(error::INVALID_ARGUMENT, "Unsupported output format.");
   }
   if (output_format == MediaContainerName::CONTAINER_MPEG2TS) {
-    if (stream.segment_template.empty()) {
-      return Status(
-          error::INVALID_ARGUMENT,
-          "Please specify 'segment_template'. Single file TS output is "
-          "not supported.");
-    }
-
-    // Right now the init segment is saved in |output| for multi-segment
-    // content. However, for TS all segments must be self-initializing so
-    // there cannot be an init segment.
-    if (stream.output.length()) {
+    // Without 'segment_template', the segments are byte ranges of the single
+    // file |output|. Right now the init segment is saved in |output| for
+    // multi-segment content. However, for TS all segments must be
+    // self-initializing so there cannot be an init segment.
+    if (stream.segment_template.length() && stream.output.length()) {
       return Status(error::INVALID_ARGUMENT,
                     "All TS segments must be self-initializing. Stream "
                     "descriptors 'output' or 'init_segment' are not allowed.");
@@ -277,6 +279,20 @@ Status ValidateParams(const PackagingParams& packaging_params,
                   "subsegment_sap_aligned to true is not allowed.");
   }
 
+  if (packaging_params.mp4_output_params.low_latency_dash_mode &&
+      packaging_params.chunking_params.subsegment_duration_in_seconds <= 0) {
+    return Status(error::INVALID_ARGUMENT,
+                  "Low latency DASH mode requires subsegment (chunk) duration "
+                  "to be specified.");
+  }
+
+  if (!packaging_params.mpd_params.mpd_output.empty() &&
+      !packaging_params.mpd_params.mpd_event_output.empty()) {
+    return Status(error::INVALID_ARGUMENT,
+                  "mpd_output and mpd_event_output cannot both be specified. "
+                  "The MPD is generated by the aggregator of the MPD events.");
+  }
+
   if (stream_descriptors.empty()) {
     return Status(error::INVALID_ARGUMENT,
                   "Stream descriptors cannot be empty.");
@@ -413,12 +429,16 @@ bool StreamInfoToTextMediaInfo(const StreamDescriptor& stream_descriptor,
 
 /// Create a new demuxer handler for the given stream. If a demuxer cannot be
 /// created, an error will be returned. If a demuxer can be created, this
-/// |new_demuxer| will be set and Status::OK will be returned.
+/// |new_demuxer| will be set and Status::OK will be returned. If
+/// |defer_decryption| is true, the samples are decrypted by the downstream
+/// encryption handlers instead of the demuxer.
 Status CreateDemuxer(const StreamDescriptor& stream,
                      const PackagingParams& packaging_params,
+                     bool defer_decryption,
                      std::shared_ptr<Demuxer>* new_demuxer) {
   std::shared_ptr<Demuxer> demuxer = std::make_shared<Demuxer>(stream.input);
   demuxer->set_dump_stream_info(packaging_params.test_params.dump_stream_info);
+  demuxer->set_defer_decryption(defer_decryption);
 
   if (packaging_params.decryption_params.key_provider != KeyProvider::kNone) {
     std::unique_ptr<KeySource> decryption_key_source(
@@ -435,10 +455,30 @@ Status CreateDemuxer(const StreamDescriptor& stream,
   return Status::OK;
 }
 
-std::shared_ptr<MediaHandler> CreateEncryptionHandler(
+// Apple Sample AES is used for MPEG2TS and Packed Audio outputs.
+// TODO(kqyang): Consider adding a new flag to enable Sample AES as we
+// will support CENC in TS in the future.
+bool UseSampleAes(const StreamDescriptor& stream) {
+  const MediaContainerName output_format = GetOutputFormat(stream);
+  return output_format == CONTAINER_MPEG2TS ||
+         output_format == CONTAINER_AAC || output_format == CONTAINER_AC3 ||
+         output_format == CONTAINER_EAC3;
+}
+
+// Returns the encryption group of |stream|. The outputs of a stream in the
+// same encryption group are encrypted with the same scheme and keys, so they
+// can share an EncryptionHandler.
+std::string GetEncryptionGroup(const StreamDescriptor& stream,
+                               KeySource* key_source) {
+  if (stream.skip_encryption || !key_source)
+    return "clear";
+  return (UseSampleAes(stream) ? "sample-aes:" : "default:") + stream.drm_label;
+}
+
+std::shared_ptr<EncryptionHandler> CreateEncryptionHandler(
     const PackagingParams& packaging_params,
     const StreamDescriptor& stream,
-    KeySource* key_source) {
+    std::shared_ptr<KeySource> key_source) {
   if (stream.skip_encryption) {
     return nullptr;
   }
@@ -450,13 +490,7 @@ std::shared_ptr<MediaHandler> CreateEncryptionHandler(
   // Make a copy so that we can modify it for this specific stream.
   EncryptionParams encryption_params = packaging_params.encryption_params;
 
-  // Use Sample AES in MPEG2TS.
-  // TODO(kqyang): Consider adding a new flag to enable Sample AES as we
-  // will support CENC in TS in the future.
-  if (GetOutputFormat(stream) == CONTAINER_MPEG2TS ||
-      GetOutputFormat(stream) == CONTAINER_AAC ||
-      GetOutputFormat(stream) == CONTAINER_AC3 ||
-      GetOutputFormat(stream) == CONTAINER_EAC3) {
+  if (UseSampleAes(stream)) {
     VLOG(1) << "Use Apple Sample AES encryption for MPEG2TS or Packed Audio.";
     encryption_params.protection_scheme = kAppleSampleAesProtectionScheme;
   }
@@ -476,7 +510,8 @@ std::shared_ptr<MediaHandler> CreateEncryptionHandler(
         kDefaultMaxHdPixels, kDefaultMaxUhd1Pixels, std::placeholders::_1);
   }
 
-  return std::make_shared<EncryptionHandler>(encryption_params, key_source);
+  return std::make_shared<EncryptionHandler>(encryption_params,
+                                             std::move(key_source));
 }
 
 std::unique_ptr<TextChunker> CreateTextChunker(
@@ -655,8 +690,15 @@ Status CreateTextJobs(
         }
 
         if (packaging_params.output_media_info) {
-          VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
-              text_media_info, stream.output + kMediaInfoSuffix);
+          const std::string media_info_output =
+              stream.output + kMediaInfoSuffix;
+          if (packaging_params.indexed_media_info) {
+            VodMediaInfoDumpMuxerListener::WriteIndexedMediaInfoToFile(
+                text_media_info, media_info_output);
+          } else {
+            VodMediaInfoDumpMuxerListener::WriteMediaInfoToFile(
+                text_media_info, media_info_output);
+          }
         }
       }
     }
@@ -668,7 +710,7 @@ Status CreateTextJobs(
 Status CreateAudioVideoJobs(
     const std::vector<std::reference_wrapper<const StreamDescriptor>>& streams,
     const PackagingParams& packaging_params,
-    KeySource* encryption_key_source,
+    std::shared_ptr<KeySource> encryption_key_source,
     SyncPointQueue* sync_points,
     MuxerListenerFactory* muxer_listener_factory,
     MuxerFactory* muxer_factory,
@@ -682,14 +724,38 @@ Status CreateAudioVideoJobs(
   std::map<std::string, std::shared_ptr<Demuxer>> sources;
   std::map<std::string, std::shared_ptr<MediaHandler>> cue_aligners;
 
+  // The samples of an input with all its output streams re-encrypted are
+  // decrypted by the encryption handlers, which decrypt and re-encrypt each
+  // sample in a single pass, e.g. to convert 'cenc' content to 'cbcs'. This
+  // is only done if each stream of the input is encrypted by a single
+  // encryption handler; otherwise the demuxer decrypts the samples once,
+  // before they are fanned out to the encryption handlers.
+  std::map<std::string, bool> reencrypted_inputs;
+  if (packaging_params.decryption_params.key_provider != KeyProvider::kNone &&
+      encryption_key_source) {
+    std::map<std::pair<std::string, std::string>, std::set<std::string>>
+        encryption_groups;
+    for (const StreamDescriptor& stream : streams) {
+      if (stream.output.empty() && stream.segment_template.empty())
+        continue;
+      std::set<std::string>& groups =
+          encryption_groups[{stream.input, stream.stream_selector}];
+      groups.insert(GetEncryptionGroup(stream, encryption_key_source.get()));
+      auto iter = reencrypted_inputs.insert({stream.input, true}).first;
+      iter->second = iter->second && !stream.skip_encryption &&
+                     groups.size() == 1;
+    }
+  }
+
   for (const StreamDescriptor& stream : streams) {
     bool seen_input_before = sources.find(stream.input) != sources.end();
     if (seen_input_before) {
       continue;
     }
 
-    RETURN_IF_ERROR(
-        CreateDemuxer(stream, packaging_params, &sources[stream.input]));
+    RETURN_IF_ERROR(CreateDemuxer(stream, packaging_params,
+                                  reencrypted_inputs[stream.input],
+                                  &sources[stream.input]));
     cue_aligners[stream.input] =
         sync_points ? std::make_shared<CueAlignmentHandler>(sync_points)
                     : nullptr;
@@ -699,9 +765,16 @@ Status CreateAudioVideoJobs(
     job_manager->Add("RemuxJob", source.second);
   }
 
-  // Replicators are shared among all streams with the same input and stream
-  // selector.
-  std::shared_ptr<MediaHandler> replicator;
+  // The chunking handler, i.e. the segment plan, is shared among all streams
+  // with the same input and stream selector. Its output is fanned out to an
+  // encryption handler per encryption group, whose output is in turn fanned
+  // out to the muxers, so the samples of a track are chunked once and
+  // encrypted once per scheme and keys, whatever the number of outputs, e.g.
+  // for both TS and fMP4 outputs.
+  std::shared_ptr<MediaHandler> chunk_replicator;
+  // Replicators after the encryption handlers of the current stream, keyed by
+  // encryption group.
+  std::map<std::string, std::shared_ptr<MediaHandler>> replicators;
 
   std::string previous_input;
   std::string previous_selector;
@@ -731,24 +804,37 @@ Status CreateAudioVideoJobs(
         demuxer->SetLanguageOverride(stream.stream_selector, stream.language);
       }
 
-      replicator = std::make_shared<Replicator>();
+      chunk_replicator = std::make_shared<Replicator>();
+      replicators.clear();
       auto chunker =
           std::make_shared<ChunkingHandler>(packaging_params.chunking_params);
-      auto encryptor = CreateEncryptionHandler(packaging_params, stream,
-                                               encryption_key_source);
 
       // TODO(vaage) : Create a nicer way to connect handlers to demuxers.
       if (sync_points) {
         RETURN_IF_ERROR(
-            MediaHandler::Chain({cue_aligner, chunker, encryptor, replicator}));
+            MediaHandler::Chain({cue_aligner, chunker, chunk_replicator}));
         RETURN_IF_ERROR(
             demuxer->SetHandler(stream.stream_selector, cue_aligner));
       } else {
-        RETURN_IF_ERROR(MediaHandler::Chain({chunker, encryptor, replicator}));
+        RETURN_IF_ERROR(MediaHandler::Chain({chunker, chunk_replicator}));
         RETURN_IF_ERROR(demuxer->SetHandler(stream.stream_selector, chunker));
       }
     }
 
+    std::shared_ptr<MediaHandler>& replicator =
+        replicators[GetEncryptionGroup(stream, encryption_key_source.get())];
+    if (!replicator) {
+      replicator = std::make_shared<Replicator>();
+      auto encryptor = CreateEncryptionHandler(packaging_params, stream,
+                                               encryption_key_source);
+      // The samples are decrypted with the keys fetched by the demuxer, e.g.
+      // from the 'pssh' boxes of the input.
+      if (encryptor && reencrypted_inputs[stream.input])
+        encryptor->SetDecryptorSource(demuxer->GetDecryptorSource());
+      RETURN_IF_ERROR(
+          MediaHandler::Chain({chunk_replicator, encryptor, replicator}));
+    }
+
     // Create the muxer (output) for this track.
     std::shared_ptr<Muxer> muxer =
         muxer_factory->CreateMuxer(GetOutputFormat(stream), stream);
@@ -777,7 +863,7 @@ Status CreateAudioVideoJobs(
 Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
                      const PackagingParams& packaging_params,
                      MpdNotifier* mpd_notifier,
-                     KeySource* encryption_key_source,
+                     std::shared_ptr<KeySource> encryption_key_source,
                      SyncPointQueue* sync_points,
                      MuxerListenerFactory* muxer_listener_factory,
                      MuxerFactory* muxer_factory,
@@ -855,7 +941,9 @@ Status CreateAllJobs(const std::vector<StreamDescriptor>& stream_descriptors,
 
 struct Packager::PackagerInternal {
   media::FakeClock fake_clock;
-  std::unique_ptr<KeySource> encryption_key_source;
+  // Shared with the encryption handlers, as their outstanding key requests may
+  // use it after packaging ends.
+  std::shared_ptr<KeySource> encryption_key_source;
   std::unique_ptr<MpdNotifier> mpd_notifier;
   std::unique_ptr<hls::HlsNotifier> hls_notifier;
   BufferCallbackParams buffer_callback_params;
@@ -905,6 +993,12 @@ Status Packager::Initialize(
       packaging_params.chunking_params.segment_duration_in_seconds;
   mpd_params.target_segment_duration = target_segment_duration;
   hls_params.target_segment_duration = target_segment_duration;
+  // |target_chunk_duration| is needed for low latency DASH
+  // availabilityTimeOffset.
+  if (mpd_params.target_chunk_duration <= 0) {
+    mpd_params.target_chunk_duration =
+        packaging_params.chunking_params.subsegment_duration_in_seconds;
+  }
 
   // Store callback params to make it available during packaging.
   internal->buffer_callback_params = packaging_params.buffer_callback_params;
@@ -927,12 +1021,17 @@ Status Packager::Initialize(
   hls_params.default_text_language =
       LanguageToShortestForm(hls_params.default_text_language);
 
-  if (!mpd_params.mpd_output.empty()) {
+  if (!mpd_params.mpd_output.empty() ||
+      !mpd_params.mpd_event_output.empty()) {
     const bool on_demand_dash_profile =
         stream_descriptors.begin()->segment_template.empty();
     const MpdOptions mpd_options =
         media::GetMpdOptions(on_demand_dash_profile, mpd_params);
-    internal->mpd_notifier.reset(new SimpleMpdNotifier(mpd_options));
+    if (!mpd_params.mpd_event_output.empty()) {
+      internal->mpd_notifier.reset(new PublishingMpdNotifier(mpd_options));
+    } else {
+      internal->mpd_notifier.reset(new SimpleMpdNotifier(mpd_options));
+    }
     if (!internal->mpd_notifier->Init()) {
       LOG(ERROR) << "MpdNotifier failed to initialize.";
       return Status(error::INVALID_ARGUMENT,
@@ -957,6 +1056,15 @@ Status Packager::Initialize(
     // We may need to overwrite some values, so make a copy first.
     StreamDescriptor copy = descriptor;
 
+    // Only the media segments of the ram:// outputs may be evicted from the
+    // store, so that the init segments and manifests stay available to the
+    // new clients.
+    if (base::StartsWith(descriptor.segment_template, kRamFilePrefix,
+                         base::CompareCase::SENSITIVE)) {
+      RamStore::GetInstance()->AddSegmentTemplate(
+          descriptor.segment_template.substr(strlen(kRamFilePrefix)));
+    }
+
     if (internal->buffer_callback_params.read_func) {
       copy.input = File::MakeCallbackFileName(internal->buffer_callback_params,
                                               descriptor.input);
@@ -988,12 +1096,12 @@ Status Packager::Initialize(
   }
 
   media::MuxerListenerFactory muxer_listener_factory(
-      packaging_params.output_media_info, internal->mpd_notifier.get(),
-      internal->hls_notifier.get());
+      packaging_params.output_media_info, packaging_params.indexed_media_info,
+      internal->mpd_notifier.get(), internal->hls_notifier.get());
 
   RETURN_IF_ERROR(media::CreateAllJobs(
       streams_for_jobs, packaging_params, internal->mpd_notifier.get(),
-      internal->encryption_key_source.get(),
+      internal->encryption_key_source,
       internal->job_manager->sync_points(), &muxer_listener_factory,
       &muxer_factory, internal->job_manager.get()));
 
@@ -120,6 +120,8 @@
       ],
       'dependencies': [
         'base/base.gyp:base',
+        'file/file.gyp:file',
+        'mpd/mpd.gyp:mpd_builder',
         'mpd/mpd.gyp:mpd_util',
         'third_party/gflags/gflags.gyp:gflags',
         'tools/license_notice.gyp:license_notice',
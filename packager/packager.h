@@ -17,6 +17,7 @@
 #include "packager/media/public/chunking_params.h"
 #include "packager/media/public/crypto_params.h"
 #include "packager/media/public/mp4_output_params.h"
+#include "packager/media/public/segment_writer_params.h"
 #include "packager/mpd/public/mpd_params.h"
 #include "packager/status.h"
 
@@ -44,6 +45,14 @@ struct PackagingParams {
   /// audio) timestamps to compensate for possible negative timestamps in the
   /// input.
   uint32_t transport_stream_timestamp_offset_ms = 0;
+  /// For single file WebM output only. Reserve space for the Cues between
+  /// the header and the first Cluster, so that the media is written to the
+  /// output directly in a single pass instead of to a temporary file which is
+  /// copied to the output on finalization.
+  bool webm_reserve_cues_space = false;
+  /// Segment writing related parameters, e.g. to write the media segments in
+  /// the background.
+  SegmentWriterParams segment_writer_params;
   /// Chunking (segmentation) related parameters.
   ChunkingParams chunking_params;
 
@@ -53,6 +62,9 @@ struct PackagingParams {
   /// Create a human readable format of MediaInfo. The output file name will be
   /// the name specified by output flag, suffixed with `.media_info`.
   bool output_media_info = false;
+  /// Write MediaInfo in indexed binary format instead of human readable
+  /// format. Only applicable if output_media_info is set.
+  bool indexed_media_info = false;
   /// DASH MPD related parameters.
   MpdParams mpd_params;
   /// HLS related parameters.
@@ -7,6 +7,9 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <map>
+#include <string>
+
 #include "packager/packager.h"
 
 using testing::_;
@@ -25,6 +28,7 @@ namespace {
 const char kTestFile[] = "packager/media/test/data/bear-640x360.mp4";
 const char kOutputVideo[] = "output_video.mp4";
 const char kOutputVideoTemplate[] = "output_video_$Number$.m4s";
+const char kOutputVideoTsTemplate[] = "output_video_$Number$.ts";
 const char kOutputAudio[] = "output_audio.mp4";
 const char kOutputAudioTemplate[] = "output_audio_$Number$.m4s";
 const char kOutputMpd[] = "output.mpd";
@@ -204,6 +208,87 @@ TEST_F(PackagerTest, SegmentNotAlignedButSubsegmentAligned) {
   ASSERT_EQ(error::INVALID_ARGUMENT, status.error_code());
 }
 
+TEST_F(PackagerTest, MpdOutputAndMpdEventOutput) {
+  auto packaging_params = SetupPackagingParams();
+  packaging_params.mpd_params.mpd_event_output = GetFullPath("output.events");
+  Packager packager;
+  auto status = packager.Initialize(packaging_params, SetupStreamDescriptors());
+  ASSERT_EQ(error::INVALID_ARGUMENT, status.error_code());
+}
+
+// The video stream is chunked once and encrypted with both the default scheme
+// and SAMPLE-AES, for the fMP4 and the TS outputs respectively.
+TEST_F(PackagerTest, Fmp4AndTsOutputsOfTheSameStream) {
+  auto packaging_params = SetupPackagingParams();
+  packaging_params.mpd_params.mpd_output.clear();
+
+  std::vector<StreamDescriptor> stream_descriptors;
+  StreamDescriptor stream_descriptor;
+  stream_descriptor.input = kTestFile;
+  stream_descriptor.stream_selector = "video";
+  stream_descriptor.output = GetFullPath(kOutputVideo);
+  stream_descriptor.segment_template = GetFullPath(kOutputVideoTemplate);
+  stream_descriptors.push_back(stream_descriptor);
+
+  stream_descriptor.output.clear();
+  stream_descriptor.segment_template = GetFullPath(kOutputVideoTsTemplate);
+  stream_descriptors.push_back(stream_descriptor);
+
+  // Keeps the contents written to each output file. All the outputs are
+  // written by the same remux job, i.e. on the same thread.
+  std::map<std::string, std::string> outputs;
+  packaging_params.buffer_callback_params.write_func =
+      [&outputs](const std::string& name, const void* buffer,
+                 uint64_t length) {
+        outputs[name].append(static_cast<const char*>(buffer), length);
+        return static_cast<int64_t>(length);
+      };
+
+  Packager packager;
+  ASSERT_EQ(Status::OK,
+            packager.Initialize(packaging_params, stream_descriptors));
+  ASSERT_EQ(Status::OK, packager.Run());
+
+  // The fMP4 output is encrypted with 'cenc' and the TS output with Apple
+  // Sample AES, signalled by the 'zavc' private data in the PMT.
+  const char kSchemeTypeCenc[] = "schm\0\0\0\0cenc";
+  const std::string& init_segment = outputs[GetFullPath(kOutputVideo)];
+  EXPECT_NE(std::string::npos, init_segment.find("encv"));
+  EXPECT_NE(std::string::npos,
+            init_segment.find(std::string(std::begin(kSchemeTypeCenc),
+                                          std::end(kSchemeTypeCenc) - 1)));
+  EXPECT_NE(std::string::npos,
+            init_segment.find(std::string(std::begin(kKeyId),
+                                          std::end(kKeyId))));
+
+  auto get_segment_name = [this](int segment_number,
+                                 const std::string& extension) {
+    return GetFullPath("output_video_" + std::to_string(segment_number) +
+                       extension);
+  };
+  int num_segments = 0;
+  while (outputs.count(get_segment_name(num_segments + 1, ".m4s")) > 0)
+    ++num_segments;
+  ASSERT_GE(num_segments, 2);
+  // Both outputs get the same segments.
+  for (int i = 1; i <= num_segments; ++i)
+    EXPECT_EQ(1u, outputs.count(get_segment_name(i, ".ts"))) << i;
+  EXPECT_EQ(1u + 2 * num_segments, outputs.size());
+
+  // The first segment is in the clear lead and the last one is encrypted.
+  const std::string& first_mp4_segment = outputs[get_segment_name(1, ".m4s")];
+  const std::string& last_mp4_segment =
+      outputs[get_segment_name(num_segments, ".m4s")];
+  EXPECT_EQ(std::string::npos, first_mp4_segment.find("senc"));
+  EXPECT_NE(std::string::npos, last_mp4_segment.find("senc"));
+
+  const std::string& first_ts_segment = outputs[get_segment_name(1, ".ts")];
+  const std::string& last_ts_segment =
+      outputs[get_segment_name(num_segments, ".ts")];
+  EXPECT_EQ(std::string::npos, first_ts_segment.find("zavc"));
+  EXPECT_NE(std::string::npos, last_ts_segment.find("zavc"));
+}
+
 TEST_F(PackagerTest, WriteOutputToBuffer) {
   auto packaging_params = SetupPackagingParams();
 